@@ -14,6 +14,7 @@ Copyright:    ©2005 Robert J. Lang. All Rights Reserved.
 // My libraries
 #include "tmArray.h"          // my general-purposes container class
 #include "tmArrayIterator.h"  // my redefinition of PowerPlant tmArrayIterator
+#include "tmIndexedArray.h"   // tmArray with hashed lookup
 
 // stream output for a list (helps in testing)
 template <class T>
@@ -120,5 +121,25 @@ int main() {
 		<< "clist = " << clist << '\n'
 		<< "dlist = " << dlist << '\n'
 		<< "clist.intersects(dlist) = " << clist.intersects(dlist) << '\n'
-		<< "dlist.intersects(clist) = " << dlist.intersects(clist) << '\n';
+		<< "dlist.intersects(clist) = " << dlist.intersects(clist) << "\n\n";
+
+	// indexed array should behave just like tmArray
+	tmIndexedArray<int> elist;
+	for (int n = 0; n < 10; ++n)
+		elist.union_with(n % 7);
+	elist.push_back(3);
+	std::cout
+		<< "elist = " << elist << '\n'
+		<< "elist.GetOffset(3) = " << elist.GetOffset(3) << '\n'
+		<< "elist.contains(7) = " << elist.contains(7) << '\n';
+	elist.erase_remove(1);
+	elist.RemoveItemAt(3);
+	std::cout
+		<< "After erase_remove(1), RemoveItemAt(3) elist = " << elist << '\n'
+		<< "elist.GetOffset(3) = " << elist.GetOffset(3) << '\n'
+		<< "elist.GetIndex(6) = " << elist.GetIndex(6) << '\n';
+	elist.intersect_with(clist);
+	std::cout
+		<< "elist.intersect_with(clist) = " << elist << '\n'
+		<< "elist.intersects(dlist) = " << elist.intersects(dlist) << '\n';
 }
@@ -0,0 +1,234 @@
+/*******************************************************************************
+File:         tmAutoDiffBenchmark.cpp
+Project:      TreeMaker 5.x
+Purpose:      Timing of automatically differentiated constraint functions
+Author:       Robert J. Lang
+Modified by:
+Created:      2026-10-19
+Copyright:    ©2026 Robert J. Lang. All Rights Reserved.
+*******************************************************************************/
+
+/*
+This program checks the constraint functions written with tmAutoDiffFn (see
+tmAutoDiffFn.h) against hand-coded derivatives and times the two. It pairs
+  - the hand-coded PathFn1 and StrainPathFn1 with versions of the same
+    functions written as tmAutoDiffFn expressions here, and
+  - copies of the original hand-coded CollinearFn1 and StickToEdgeFn with the
+    library's versions, which now use tmAutoDiffFn.
+Each function is evaluated at the same random points through Func() + Grad()
+and through FuncGrad(). The gradient vector has the length of a typical tree
+optimization, so clearing it costs what it does in real use. The differences
+reported should be at the level of rounding error.
+
+You can give the number of evaluations on the command line (default 2000000).
+*/
+
+// Standard libraries
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// My libraries
+#include "tmConstraintFns.h"
+
+
+/*****
+PathFn1 written as a tmAutoDiffFn
+*****/
+class AutoPathFn1 : public tmAutoDiffFn<AutoPathFn1, 5> {
+public:
+  AutoPathFn1(size_t aix, size_t aiy, size_t ajx, size_t ajy, double alij) :
+    lij(alij) {
+    mVars[0] = 0; mVars[1] = aix; mVars[2] = aiy; mVars[3] = ajx;
+    mVars[4] = ajy;};
+  template <class T>
+  T Eval(const T* x) const {
+    return x[0] * lij - sqrt(pow(x[1] - x[3], 2) + pow(x[2] - x[4], 2));};
+private:
+  double lij;
+};
+
+
+/*****
+StrainPathFn1 written as a tmAutoDiffFn
+*****/
+class AutoStrainPathFn1 : public tmAutoDiffFn<AutoStrainPathFn1, 5> {
+public:
+  AutoStrainPathFn1(size_t aix, size_t aiy, size_t ajx, size_t ajy,
+    double alfix, double alvar) : lfix(alfix), lvar(alvar) {
+    mVars[0] = 0; mVars[1] = aix; mVars[2] = aiy; mVars[3] = ajx;
+    mVars[4] = ajy;};
+  template <class T>
+  T Eval(const T* x) const {
+    return lfix + x[0] * lvar -
+      sqrt(pow(x[1] - x[3], 2) + pow(x[2] - x[4], 2));};
+private:
+  double lfix;
+  double lvar;
+};
+
+
+/*****
+The original hand-coded CollinearFn1
+*****/
+class RefCollinearFn1 : public tmDifferentiableFn {
+public:
+  RefCollinearFn1(size_t aix, size_t aiy, size_t ajx, size_t ajy, size_t akx,
+    size_t aky) : ix(aix), iy(aiy), jx(ajx), jy(ajy), kx(akx), ky(aky) {};
+  double Func(const vector<double>& u) {
+    return (u[jy] - u[iy]) * (u[kx] - u[jx]) -
+      (u[ky] - u[jy]) * (u[jx] - u[ix]);};
+  void Grad(const vector<double>& u, vector<double>& du) {
+    du.assign(du.size(), 0.);
+    du[ix] = (u[ky] - u[jy]);
+    du[kx] = (u[jy] - u[iy]);
+    du[jx] = -(du[ix] + du[kx]);
+    du[iy] = (u[jx] - u[kx]);
+    du[ky] = (u[ix] - u[jx]);
+    du[jy] = -(du[iy] + du[ky]);};
+private:
+  size_t ix, iy, jx, jy, kx, ky;
+};
+
+
+/*****
+The original hand-coded StickToEdgeFn
+*****/
+class RefStickToEdgeFn : public tmDifferentiableFn {
+public:
+  RefStickToEdgeFn(size_t aix, size_t aiy, double aw, double ah) :
+    ix(aix), iy(aiy), w(aw), h(ah) {};
+  double Func(const vector<double>& u) {
+    return 10.0 * u[ix] * (u[ix] - w) * u[iy] * (u[iy] - h);};
+  void Grad(const vector<double>& u, vector<double>& du) {
+    du.assign(du.size(), 0.);
+    du[ix] = 10.0 * (2 * u[ix] - w) * u[iy] * (u[iy] - h);
+    du[iy] = 10.0 * (2 * u[iy] - h) * u[ix] * (u[ix] - w);};
+private:
+  size_t ix, iy;
+  double w, h;
+};
+
+
+/*****
+Uniform random number in [0, 1)
+*****/
+double Random()
+{
+  return double(rand()) / (double(RAND_MAX) + 1.0);
+}
+
+
+/*****
+Return milliseconds elapsed since start
+*****/
+double ElapsedMs(const chrono::steady_clock::time_point& start)
+{
+  return chrono::duration<double, milli>(chrono::steady_clock::now() - start).
+    count();
+}
+
+
+const size_t NUM_VARS = 81;     // scale plus 40 nodes
+const size_t NUM_POINTS = 256;  // distinct random points we cycle through
+
+
+/*****
+Time n evaluations of f at the points in pts, through Func() + Grad() if fused
+is false or through FuncGrad() if it's true. The values and the last gradient
+computed at each point are returned in vals and grads.
+*****/
+double TimeFn(tmDifferentiableFn& f, const vector<vector<double> >& pts,
+  size_t n, bool fused, vector<double>& vals, vector<vector<double> >& grads)
+{
+  vals.assign(pts.size(), 0.);
+  grads.assign(pts.size(), vector<double>(NUM_VARS));
+  vector<double> du(NUM_VARS);
+  // Call through a pointer the compiler can't see through, so that neither
+  // version gets inlined into the loop and we time what the optimizer sees.
+  tmDifferentiableFn* volatile fp = &f;
+  double sum = 0;
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  for (size_t i = 0; i < n; ++i) {
+    size_t k = i % pts.size();
+    double v;
+    tmDifferentiableFn* fn = fp;
+    if (fused) v = fn->FuncGrad(pts[k], du);
+    else {
+      v = fn->Func(pts[k]);
+      fn->Grad(pts[k], du);
+    }
+    sum += v + du[k % NUM_VARS];
+    if (i < pts.size()) {
+      vals[k] = v;
+      grads[k] = du;
+    }
+  }
+  double ms = ElapsedMs(start);
+  if (sum == 12345.6789) cout << "";   // keep the loop from being optimized out
+  return ms;
+}
+
+
+/*****
+Compare a hand-coded function with its automatically differentiated twin.
+*****/
+void Compare(const string& name, tmDifferentiableFn& hand,
+  tmDifferentiableFn& autodiff, const vector<vector<double> >& pts, size_t n)
+{
+  vector<double> hv, av;
+  vector<vector<double> > hg, ag;
+  double diff = 0;
+  for (int fused = 0; fused < 2; ++fused) {
+    double ht = TimeFn(hand, pts, n, fused != 0, hv, hg);
+    double at = TimeFn(autodiff, pts, n, fused != 0, av, ag);
+    for (size_t k = 0; k < pts.size(); ++k) {
+      diff = max(diff, fabs(hv[k] - av[k]));
+      for (size_t j = 0; j < NUM_VARS; ++j)
+        diff = max(diff, fabs(hg[k][j] - ag[k][j]));
+    }
+    cout << name << (fused ? " FuncGrad:    " : " Func + Grad: ") <<
+      "hand-coded " << 1.e6 * ht / n << " ns, automatic " <<
+      1.e6 * at / n << " ns, ratio " << at / ht << endl;
+  }
+  cout << name << " largest difference " << diff << endl << endl;
+}
+
+
+/*****
+Main program
+*****/
+int main(int argc, char* argv[])
+{
+  cout << "Hello World\n\n";
+  size_t n = 2000000;
+  if (argc > 1) n = size_t(atol(argv[1]));
+  if (n == 0) n = 1;
+
+  vector<vector<double> > pts(NUM_POINTS, vector<double>(NUM_VARS));
+  for (size_t k = 0; k < NUM_POINTS; ++k)
+    for (size_t j = 0; j < NUM_VARS; ++j) pts[k][j] = Random();
+
+  PathFn1 p1(11, 12, 37, 38, 1.5);
+  AutoPathFn1 ap1(11, 12, 37, 38, 1.5);
+  Compare("PathFn1", p1, ap1, pts, n);
+
+  StrainPathFn1 s1(11, 12, 37, 38, 0.5, 1.5);
+  AutoStrainPathFn1 as1(11, 12, 37, 38, 0.5, 1.5);
+  Compare("StrainPathFn1", s1, as1, pts, n);
+
+  RefCollinearFn1 c1(3, 4, 21, 22, 63, 64);
+  CollinearFn1 ac1(3, 4, 21, 22, 63, 64);
+  Compare("CollinearFn1", c1, ac1, pts, n);
+
+  RefStickToEdgeFn e1(41, 42, 1.0, 1.0);
+  StickToEdgeFn ae1(41, 42, 1.0, 1.0);
+  Compare("StickToEdgeFn", e1, ae1, pts, n);
+
+  return 0;
+}
@@ -76,6 +76,22 @@ public:
 };
 
 
+// Class E inherits tmDpptrTarget non-virtually, like the TreeMaker model
+// classes; only then can a tmDpptrArray defer removals within a teardown.
+
+class E : public tmDpptrTarget {
+	std::string mName;
+
+public:
+	E(const std::string& str) : tmDpptrTarget(), mName(str) {
+		std::cout << mName << " created\n";
+	}
+	virtual ~E() {
+		std::cout << mName << " deleted\n";
+	}
+};
+
+
 int main() {
 	std::cout << "Hello World\n";
 
@@ -157,6 +173,29 @@ int main() {
 	rld.clear();
 	std::cout << "After clear() rld has " << rld.size() << " elements.\n";
 
+	// Within a tmDpptrTeardown, deleted objects stay in the list until the
+	// teardown goes out of scope; then they are all removed in one pass.
+
+	tmDpptrArray<E> rle;
+
+	E* e1 = new E("e1");
+	E* e2 = new E("e2");
+	E* e3 = new E("e3");
+
+	rle.push_back(e1);
+	rle.push_back(e2);
+	rle.push_back(e3);
+	rle.push_back(e1);
+	std::cout << "Initially rle has " << rle.size() << " elements.\n";
+	{
+		tmDpptrTeardown td;
+		delete e1;
+		delete e2;
+		std::cout << "Inside teardown rle has " << rle.size() << " elements.\n";
+	}
+	std::cout << "After teardown rle has " << rle.size() << " elements.\n";
+	delete e3;
+
 	// done
 	std::cout << "Bye...\n";
 }
@@ -0,0 +1,306 @@
+/*******************************************************************************
+File:         tmMatrixBenchmark.cpp
+Project:      TreeMaker 5.x
+Purpose:      Timing of the tmMatrix kernels against the original loops
+Author:       Robert J. Lang
+Modified by:
+Created:      2026-10-19
+Copyright:    ©2026 Robert J. Lang. All Rights Reserved.
+*******************************************************************************/
+
+/*
+This program times the dense linear algebra used by the solvers -- the LU
+decomposition and back substitution of tmNewtonRaphson and the BFGS update of
+the inverse Hessian in tmNLCO_alm -- against the original implementations,
+which stored a matrix as a vector of separately allocated rows and walked it a
+column at a time. Sizes run from 4 (tmStubFinder) to 2000 (a large ALM
+problem); you can give your own list of sizes on the command line, e.g.
+
+  tmMatrixBenchmark 4 100 1000
+
+For each size it also reports the largest difference between the results of
+the two implementations, which should be zero.
+*/
+
+// Standard libraries
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+// My libraries
+#include "tmNewtonRaphson.h"
+
+
+/*****
+The original matrix class, a vector of rows.
+*****/
+typedef vector<vector<double> > RefMatrix;
+
+
+/*****
+The original Crout LU decomposition (PFTV's ludcmp), for comparison.
+*****/
+void RefLUDecomposition(RefMatrix& a, vector<double>& vv,
+  vector<size_t>& indx, double& d)
+{
+  size_t n = a.size();
+  const double TINY = 1.0e-20;
+  d = 1.0;
+  double big, dum, sum, temp;
+  for (size_t i = 0; i < n; ++i) {
+    big = 0.0;
+    for (size_t j = 0; j < n; ++j)
+      if ((temp = fabs(a[i][j])) > big) big = temp;
+    vv[i] = 1.0 / big;
+  }
+  for (size_t j = 0; j < n; ++j) {
+    size_t imax = size_t(-1);
+    for (size_t i = 0; i < j; ++i) {
+      sum = a[i][j];
+      for (size_t k = 0; k < i; ++k) sum -= a[i][k] * a[k][j];
+      a[i][j] = sum;
+    }
+    big = 0.0;
+    for (size_t i = j; i < n; ++i) {
+      sum = a[i][j];
+      for (size_t k = 0; k < j; ++k) sum -= a[i][k] * a[k][j];
+      a[i][j] = sum;
+      if ((dum = vv[i] * fabs(sum)) >= big) {
+        big = dum;
+        imax = i;
+      }
+    }
+    if (j != imax) {
+      for (size_t k = 0; k < n; ++k) {
+        dum = a[imax][k];
+        a[imax][k] = a[j][k];
+        a[j][k] = dum;
+      }
+      d = -d;
+      vv[imax] = vv[j];
+    }
+    indx[j] = imax;
+    if (a[j][j] == 0.0) a[j][j] = TINY;
+    dum = 1.0 / (a[j][j]);
+    for (size_t i = j + 1; i < n; ++i) a[i][j] *= dum;
+  }
+}
+
+
+/*****
+The original back substitution (PFTV's lubksb), for comparison.
+*****/
+void RefLUBackSubstitution(RefMatrix& a, vector<size_t>& indx,
+  vector<double>& b)
+{
+  size_t n = a.size();
+  size_t BAD_INDEX = size_t(-1);
+  size_t ii = BAD_INDEX;
+  double sum;
+  for (size_t i = 0; i < n; ++i) {
+    size_t ip = indx[i];
+    sum = b[ip];
+    b[ip] = b[i];
+    if (ii != BAD_INDEX)
+      for (size_t j = ii; j <= i - 1; ++j) sum -= a[i][j] * b[j];
+    else if (sum) ii = i;
+    b[i] = sum;
+  }
+  for (size_t i = n - 1; i != BAD_INDEX; i--) {
+    sum = b[i];
+    for (size_t j = i + 1; j < n; ++j) sum -= a[i][j] * b[j];
+    b[i] = sum / a[i][i];
+  }
+}
+
+
+/*****
+The original BFGS update and search direction of tmNLCO_alm, for comparison.
+*****/
+void RefBFGSStep(RefMatrix& h, const vector<double>& s,
+  const vector<double>& dg, const vector<double>& g, vector<double>& dir)
+{
+  size_t n = h.size();
+  vector<double> hdg(n), u(n);
+  for (size_t i = 0; i < n; ++i) {
+    hdg[i] = 0.0;
+    for (size_t j = 0; j < n; ++j) hdg[i] += h[i][j] * dg[j];
+  }
+  double fac = 0.0, fae = 0.0;
+  for (size_t i = 0; i < n; ++i) {
+    fac += dg[i] * s[i];
+    fae += dg[i] * hdg[i];
+  }
+  fac = 1.0 / fac;
+  double fad = 1.0 / fae;
+  for (size_t i = 0; i < n; ++i) u[i] = fac * s[i] - fad * hdg[i];
+  for (size_t i = 0; i < n; ++i) {
+    for (size_t j = i; j < n; ++j) {
+      h[i][j] += fac * s[i] * s[j] - fad * hdg[i] * hdg[j] + fae * u[i] * u[j];
+      h[j][i] = h[i][j];
+    }
+  }
+  for (size_t i = 0; i < n; ++i) {
+    dir[i] = 0.0;
+    for (size_t j = 0; j < n; ++j) dir[i] -= h[i][j] * g[j];
+  }
+}
+
+
+/*****
+The same BFGS step using the tmMatrix kernels.
+*****/
+void BFGSStep(tmMatrix<double>& h, const vector<double>& s,
+  const vector<double>& dg, const vector<double>& g, vector<double>& dir)
+{
+  size_t n = h.GetRows();
+  vector<double> hdg(n), u(n);
+  tmSymmetricMultiply(h, &dg[0], &hdg[0]);
+  double fac = 0.0, fae = 0.0;
+  for (size_t i = 0; i < n; ++i) {
+    fac += dg[i] * s[i];
+    fae += dg[i] * hdg[i];
+  }
+  fac = 1.0 / fac;
+  double fad = 1.0 / fae;
+  for (size_t i = 0; i < n; ++i) u[i] = fac * s[i] - fad * hdg[i];
+  tmBFGSUpdate(h, &s[0], &hdg[0], &u[0], fac, fad, fae);
+  tmSymmetricMultiply(h, &g[0], &dir[0]);
+  for (size_t i = 0; i < n; ++i) dir[i] = -dir[i];
+}
+
+
+/*****
+Return a pseudo-random number in [-1, 1), the same sequence on every platform.
+*****/
+double Random()
+{
+  static unsigned long seed = 12345;
+  seed = (seed * 1103515245UL + 12345UL) & 0x7fffffffUL;
+  return double(seed) / double(0x40000000UL) - 1.0;
+}
+
+
+/*****
+Return the elapsed time since start in milliseconds.
+*****/
+double ElapsedMs(chrono::steady_clock::time_point start)
+{
+  return chrono::duration<double, milli>(chrono::steady_clock::now() -
+    start).count();
+}
+
+
+/*****
+Time LU decomposition and back substitution of a random n x n system.
+*****/
+void BenchmarkLU(size_t n, size_t reps)
+{
+  tmMatrix<double> a0(n, n);
+  for (size_t i = 0; i < n; ++i)
+    for (size_t j = 0; j < n; ++j) a0[i][j] = Random();
+  vector<double> b0(n);
+  for (size_t i = 0; i < n; ++i) b0[i] = Random();
+
+  RefMatrix ra(n, vector<double>(n));
+  vector<double> rvv(n), rb(n);
+  vector<size_t> rindx(n);
+  double rd;
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  for (size_t r = 0; r < reps; ++r) {
+    for (size_t i = 0; i < n; ++i) ra[i].assign(a0[i], a0[i] + n);
+    rb = b0;
+    RefLUDecomposition(ra, rvv, rindx, rd);
+    RefLUBackSubstitution(ra, rindx, rb);
+  }
+  double refTime = ElapsedMs(start) / reps;
+
+  tmNewtonRaphson<double> nr;
+  tmMatrix<double> a;
+  vector<double> b;
+  double d;
+  start = chrono::steady_clock::now();
+  for (size_t r = 0; r < reps; ++r) {
+    a = a0;
+    b = b0;
+    nr.LUDecomposition(a, d);
+    nr.LUBackSubstitution(a, b);
+  }
+  double newTime = ElapsedMs(start) / reps;
+
+  double diff = fabs(d - rd);
+  for (size_t i = 0; i < n; ++i) {
+    diff = max(diff, fabs(b[i] - rb[i]));
+    for (size_t j = 0; j < n; ++j) diff = max(diff, fabs(a[i][j] - ra[i][j]));
+  }
+  cout << "LU   n = " << n << ": original " << refTime << " ms, tmMatrix " <<
+    newTime << " ms, speedup " << refTime / newTime << ", difference " <<
+    diff << endl;
+}
+
+
+/*****
+Time BFGS updates of an n x n inverse Hessian.
+*****/
+void BenchmarkBFGS(size_t n, size_t reps)
+{
+  vector<vector<double> > s(reps, vector<double>(n)), dg(s), g(s);
+  for (size_t r = 0; r < reps; ++r)
+    for (size_t i = 0; i < n; ++i) {
+      s[r][i] = Random();
+      dg[r][i] = s[r][i] + 0.1 * Random();  // keeps the update positive
+      g[r][i] = Random();
+    }
+  vector<double> rdir(n), dir(n);
+
+  RefMatrix rh(n, vector<double>(n, 0.0));
+  for (size_t i = 0; i < n; ++i) rh[i][i] = 1.0;
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  for (size_t r = 0; r < reps; ++r) RefBFGSStep(rh, s[r], dg[r], g[r], rdir);
+  double refTime = ElapsedMs(start) / reps;
+
+  tmMatrix<double> h(n, n, 0.0);
+  for (size_t i = 0; i < n; ++i) h[i][i] = 1.0;
+  start = chrono::steady_clock::now();
+  for (size_t r = 0; r < reps; ++r) BFGSStep(h, s[r], dg[r], g[r], dir);
+  double newTime = ElapsedMs(start) / reps;
+
+  double diff = 0.0;
+  for (size_t i = 0; i < n; ++i) {
+    diff = max(diff, fabs(dir[i] - rdir[i]));
+    for (size_t j = 0; j < n; ++j) diff = max(diff, fabs(h[i][j] - rh[i][j]));
+  }
+  cout << "BFGS n = " << n << ": original " << refTime << " ms, tmMatrix " <<
+    newTime << " ms, speedup " << refTime / newTime << ", difference " <<
+    diff << endl;
+}
+
+
+/*****
+Main program
+*****/
+int main(int argc, char* argv[])
+{
+  cout << "Hello World\n\n";
+  vector<size_t> sizes;
+  for (int i = 1; i < argc; ++i) sizes.push_back(size_t(atol(argv[i])));
+  if (sizes.empty()) {
+    const size_t DEFAULT_SIZES[] = {4, 16, 64, 256, 1000, 2000};
+    sizes.assign(DEFAULT_SIZES, DEFAULT_SIZES + 6);
+  }
+  for (size_t i = 0; i < sizes.size(); ++i) {
+    size_t n = sizes[i];
+    if (n == 0) continue;
+
+    // Aim for a comparable amount of work at every size.
+    size_t reps = max(size_t(1), size_t(2.0e8 / (double(n) * n * n)));
+    BenchmarkLU(n, min(reps, size_t(100000)));
+    BenchmarkBFGS(n, min(max(size_t(2), size_t(2.0e8 / (double(n) * n))),
+      size_t(100000)));
+  }
+  return 0;
+}
@@ -0,0 +1,883 @@
+/*******************************************************************************
+File:         tmModelBenchmark.cpp
+Project:      TreeMaker 5.x
+Purpose:      Timing of the TreeMaker model on large structures (no GUI)
+Author:       Robert J. Lang
+Modified by:
+Created:      2026-10-19
+Copyright:    ©2026 Robert J. Lang. All Rights Reserved.
+*******************************************************************************/
+
+/*
+This program times the operations of the TreeMaker model that dominate work
+on large designs -- building and destroying crease patterns and trees -- and
+reports how many parts they allocate. Give it the directory that holds the
+tmModelTester files and optionally the number of flaps in the synthetic star
+tree, e.g.
+
+  tmModelBenchmark ../test/tmModelTester 60
+
+The star tree has a single hub with many leaves of slightly different lengths,
+arranged around the circle so that the whole tree forms one big active
+polygon; its crease pattern grows quadratically with the number of flaps.
+
+It times reading saved trees with and without trusting the stored crease
+pattern, and checks that a trusted load verifies against the file's checksum.
+It compares the full and compact saved forms of the same trees, and times
+building a branching tree of ten nodes per flap with AddNode(), BuildTree() and
+the CSV and JSON importers, and then editing its edges one at a time.
+
+Then it optimizes the scale of the star tree with the ALM optimizer
+evaluating constraints on 1, 2, 4, ... threads, up to the number of hardware
+threads (at least 4), and checks that each thread count reproduces its own
+result exactly.
+
+Last, it lengthens a few well-separated groups of flaps of the star tree and
+relieves the resulting conflicts by a strain optimization of just those groups,
+once as a single problem and once split into independent blocks, and reports
+the number of blocks, the times and the strain and feasibility of each answer.
+
+Then it pins every third leaf of the star tree in place and optimizes its
+scale with the pinned coordinates imposed as equality constraints and then
+eliminated from the problem.
+
+Finally it optimizes the scale of the star tree without limits and then within
+a quarter and a half of the time and of the evaluations that took, and reports
+the time, evaluations, scale and feasibility of the best answer each found.
+*/
+
+// standard libraries
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// TreeMaker model classes
+#include "tmModel.h"
+
+
+// The path to the test files
+static fs::path testdir;
+
+
+/*****
+Return the time elapsed since the given start, in milliseconds.
+*****/
+static double ElapsedMs(std::chrono::steady_clock::time_point startTime) {
+	using namespace std::chrono;
+	return duration<double, std::milli>(steady_clock::now() - startTime).count();
+}
+
+
+/*****
+Record of the allocation counts of all part pools at some moment.
+*****/
+struct PoolSnapshot {
+	std::vector<std::size_t> mNumAllocs;
+	std::vector<std::size_t> mNumSlabAllocs;
+
+	PoolSnapshot() {
+#if TM_PART_POOLS
+		for (auto pool : tmPartPool::GetPools()) {
+			mNumAllocs.push_back(pool->GetNumAllocs());
+			mNumSlabAllocs.push_back(pool->GetNumSlabAllocs());
+		}
+#endif
+	}
+};
+
+
+/*****
+Write the number of parts of each kind allocated since the snapshot was taken,
+and how many heap allocations that took.
+*****/
+static void ReportPools(std::string_view what, const PoolSnapshot& before) {
+#if TM_PART_POOLS
+	const auto& pools = tmPartPool::GetPools();
+	std::size_t numAllocs = 0, numSlabAllocs = 0;
+	std::cout << what << " allocations:";
+	for (std::size_t i = 0; i < pools.size(); ++i) {
+		std::size_t n = pools[i]->GetNumAllocs() -
+			(i < before.mNumAllocs.size() ? before.mNumAllocs[i] : 0);
+		std::size_t s = pools[i]->GetNumSlabAllocs() -
+			(i < before.mNumSlabAllocs.size() ? before.mNumSlabAllocs[i] : 0);
+		numAllocs += n;
+		numSlabAllocs += s;
+		if (n != 0) std::cout << ' ' << pools[i]->GetName() << '=' << n;
+	}
+	std::cout << "\n  " << numAllocs << " parts from " << numSlabAllocs << " heap allocations\n";
+#else
+	std::cout << what << " allocations: part pools disabled\n";
+#endif
+}
+
+
+/*****
+Write the number of slabs currently held by the part pools.
+*****/
+static void ReportSlabs() {
+#if TM_PART_POOLS
+	std::size_t numSlabs = 0, numLive = 0;
+	for (auto pool : tmPartPool::GetPools()) {
+		numSlabs += pool->GetNumSlabs();
+		numLive += pool->GetNumLive();
+	}
+	std::cout << "Pools hold " << numSlabs << " slabs, " << numLive << " live parts\n";
+#endif
+}
+
+
+/*****
+Read a tree from one of the test files.
+*****/
+static tmTree* ReadTree(std::string_view filename) {
+	auto fullname = testdir / filename;
+	std::ifstream fin(fullname);
+	if (!fin.good()) {
+		std::cout << "Unable to find file " << fullname << '\n';
+		std::exit(EXIT_FAILURE);
+	}
+	tmTree* theTree = new tmTree();
+	try {
+		theTree->GetSelf(fin);
+	} catch(...) {
+		std::cout << "Unexpected exception reading file " << fullname << '\n';
+		std::exit(EXIT_FAILURE);
+	}
+	return theTree;
+}
+
+
+/*****
+Make a star tree with the given number of flaps. The flap lengths vary a bit
+and the leaves are spaced around a circle so that each pair of neighbors is
+exactly active at the scale we set.
+*****/
+static tmTree* MakeStarTree(std::size_t numFlaps) {
+	tmTree* theTree = new tmTree();
+	std::vector<tmFloat> lengths(numFlaps), chords(numFlaps);
+	for (std::size_t i = 0; i < numFlaps; ++i)
+		lengths[i] = 0.8 + 0.4 * std::fabs(std::sin(1.7 * tmFloat(i + 1)));
+	for (std::size_t i = 0; i < numFlaps; ++i)
+		chords[i] = lengths[i] + lengths[(i + 1) % numFlaps];
+
+	// Find the scale at which the neighboring leaves just go around the circle.
+	const tmFloat radius = 0.45;
+	tmFloat lo = 0.0, hi = 2 * radius / *std::max_element(chords.begin(), chords.end());
+	for (int iter = 0; iter < 200; ++iter) {
+		tmFloat scale = 0.5 * (lo + hi), angle = 0.0;
+		for (auto chord : chords) angle += 2 * std::asin(scale * chord / (2 * radius));
+		if (angle > TWO_PI) hi = scale;
+		else lo = scale;
+	}
+	tmNode* hub;
+	tmEdge* theEdge;
+	theTree->AddNode(nullptr, tmPoint(0.5, 0.5), hub, theEdge);
+	tmFloat theta = 0.0;
+	for (std::size_t i = 0; i < numFlaps; ++i) {
+		tmNode* leaf;
+		theTree->AddNode(hub, tmPoint(0.5 + radius * std::cos(theta),
+			0.5 + radius * std::sin(theta)), leaf, theEdge);
+		theEdge->SetLength(lengths[i]);
+		theta += 2 * std::asin(lo * chords[i] / (2 * radius));
+	}
+	theTree->SetScale(lo);
+	return theTree;
+}
+
+
+/*****
+Build the crease pattern of a tree, then repeatedly destroy and rebuild it, and
+finally destroy the whole tree, reporting times and allocations.
+*****/
+static void DoRebuildBenchmark(std::string_view name, tmTree* theTree, std::size_t numReps) {
+	std::cout << "Crease pattern of " << name << '\n';
+
+	PoolSnapshot beforeBuild;
+	auto startTime = std::chrono::steady_clock::now();
+	theTree->BuildPolysAndCreasePattern();
+	double buildTime = ElapsedMs(startTime);
+	std::cout
+		<< "  " << theTree->GetNumPolys() << " polys, " << theTree->GetNumVertices()
+		<< " vertices, " << theTree->GetNumCreases() << " creases, "
+		<< theTree->GetFacets().size() << " facets\n"
+		<< "Build time = " << buildTime << "ms\n";
+	ReportPools("Build", beforeBuild);
+
+	double killTime = 0.0, rebuildTime = 0.0;
+	PoolSnapshot beforeRebuild;
+	for (std::size_t i = 0; i < numReps; ++i) {
+		startTime = std::chrono::steady_clock::now();
+		theTree->KillPolysAndCreasePattern();
+		killTime += ElapsedMs(startTime);
+		startTime = std::chrono::steady_clock::now();
+		theTree->BuildPolysAndCreasePattern();
+		rebuildTime += ElapsedMs(startTime);
+	}
+	std::cout
+		<< "Kill time = " << killTime / numReps << "ms, rebuild time = "
+		<< rebuildTime / numReps << "ms (average of " << numReps << ")\n";
+	ReportPools("Kill and rebuild", beforeRebuild);
+	ReportSlabs();
+
+	startTime = std::chrono::steady_clock::now();
+	theTree->KillAllParts();
+	double killAllTime = ElapsedMs(startTime);
+	startTime = std::chrono::steady_clock::now();
+	delete theTree;
+	double deleteTime = ElapsedMs(startTime);
+	std::cout
+		<< "KillAllParts time = " << killAllTime << "ms, delete time = "
+		<< deleteTime << "ms\n";
+	ReportSlabs();
+	std::cout << '\n';
+}
+
+
+/*****
+Clone a tree the way tmTree::Clone() used to, by writing it to a stream and
+reading it back into a new tree.
+*****/
+static tmTree* StreamClone(tmTree* theTree) {
+	std::stringstream ss;
+	theTree->PutSelf(ss);
+	tmTree* newTree = new tmTree();
+	newTree->GetSelf(ss);
+	return newTree;
+}
+
+
+/*****
+Return the saved form of a tree.
+*****/
+static std::string SavedForm(tmTree* theTree) {
+	std::stringstream ss;
+	theTree->PutSelf(ss);
+	return ss.str();
+}
+
+
+/*****
+Time cloning a tree through a stream and by Clone(), and check that the clone
+saves exactly as the original does.
+*****/
+static void DoCloneBenchmark(std::string_view name, tmTree* theTree, std::size_t numReps) {
+	std::cout << "Clone of " << name << '\n';
+	theTree->BuildPolysAndCreasePattern();
+
+	auto startTime = std::chrono::steady_clock::now();
+	for (std::size_t i = 0; i < numReps; ++i) delete StreamClone(theTree);
+	double streamTime = ElapsedMs(startTime) / numReps;
+
+	PoolSnapshot beforeClone;
+	startTime = std::chrono::steady_clock::now();
+	for (std::size_t i = 0; i < numReps; ++i) delete theTree->Clone();
+	double cloneTime = ElapsedMs(startTime) / numReps;
+
+	tmTree* theClone = theTree->Clone();
+	bool same = SavedForm(theTree) == SavedForm(theClone);
+	delete theClone;
+	std::cout
+		<< "Stream clone time = " << streamTime << "ms, Clone() time = " << cloneTime
+		<< "ms (average of " << numReps << "), speedup = " << streamTime / cloneTime << '\n'
+		<< "Clone " << (same ? "matches" : "DOES NOT MATCH") << " the original\n";
+	ReportPools("Clone", beforeClone);
+	delete theTree;
+	std::cout << '\n';
+}
+
+
+/*****
+Read a tree from its saved form, trusting the stored crease pattern or not.
+*****/
+static tmTree* LoadTree(const std::string& savedForm, bool trustStoredState) {
+	tmTree::SetTrustStoredState(trustStoredState);
+	std::stringstream ss(savedForm);
+	tmTree* newTree = new tmTree();
+	newTree->GetSelf(ss);
+	tmTree::SetTrustStoredState(true);
+	return newTree;
+}
+
+
+/*****
+Time reading a saved tree with a full cleanup, on trust, and on trust followed
+by verification against the checksum. Check that a trusted load reads back
+exactly what was saved, and that a damaged checksum sends verification back to
+the same cleanup as an untrusted load. (The cleanup needn't reproduce the saved
+file exactly, since it starts from node positions rounded to 10 digits.)
+*****/
+static void DoLoadBenchmark(std::string_view name, tmTree* theTree, std::size_t numReps) {
+	std::cout << "Load of " << name << '\n';
+	theTree->BuildPolysAndCreasePattern();
+	std::string savedForm = SavedForm(theTree);
+
+	auto startTime = std::chrono::steady_clock::now();
+	for (std::size_t i = 0; i < numReps; ++i) delete LoadTree(savedForm, false);
+	double cleanupTime = ElapsedMs(startTime) / numReps;
+
+	startTime = std::chrono::steady_clock::now();
+	for (std::size_t i = 0; i < numReps; ++i) delete LoadTree(savedForm, true);
+	double trustTime = ElapsedMs(startTime) / numReps;
+
+	startTime = std::chrono::steady_clock::now();
+	for (std::size_t i = 0; i < numReps; ++i) {
+		tmTree* newTree = LoadTree(savedForm, true);
+		newTree->VerifyStoredState();
+		delete newTree;
+	}
+	double verifyTime = ElapsedMs(startTime) / numReps;
+
+	tmTree* cleanedTree = LoadTree(savedForm, false);
+	tmTree* trustedTree = LoadTree(savedForm, true);
+	bool trusted = trustedTree->HasUnverifiedState();
+	bool verified = trustedTree->VerifyStoredState();
+	bool same = SavedForm(trustedTree) == savedForm;
+	delete trustedTree;
+
+	// The checksum is the last line; change it.
+	std::string damagedForm = savedForm;
+	std::size_t lastLine = damagedForm.rfind('\n', damagedForm.size() - 2) + 1;
+	damagedForm.replace(lastLine, damagedForm.size() - lastLine, "1\n");
+	tmTree* damagedTree = LoadTree(damagedForm, true);
+	bool rejected = !damagedTree->VerifyStoredState();
+	bool repaired = SavedForm(damagedTree) == SavedForm(cleanedTree);
+	delete damagedTree;
+	delete cleanedTree;
+
+	std::cout
+		<< "Cleanup load time = " << cleanupTime << "ms, trusted load time = "
+		<< trustTime << "ms, trusted and verified = " << verifyTime
+		<< "ms (average of " << numReps << "), speedup = " << cleanupTime / trustTime
+		<< '\n'
+		<< "Trusted load " << (trusted && verified ? "verifies" : "DOES NOT VERIFY")
+		<< " and " << (same ? "matches" : "DOES NOT MATCH") << " the original\n"
+		<< "Damaged checksum " << (rejected && repaired ? "is caught and repaired" :
+			"IS NOT CAUGHT") << '\n';
+	delete theTree;
+	std::cout << '\n';
+}
+
+
+/*****
+Compare the size of the full and compact saved forms of a tree and the time to
+write and read each, and check that reading the compact form back rebuilds a
+tree with the same number of parts that saves to the same compact form.
+*****/
+static void DoCompactBenchmark(std::string_view name, tmTree* theTree, std::size_t numReps) {
+	std::cout << "Compact save of " << name << '\n';
+	theTree->BuildPolysAndCreasePattern();
+	std::string fullForm = SavedForm(theTree);
+
+	auto startTime = std::chrono::steady_clock::now();
+	std::string compactForm;
+	for (std::size_t i = 0; i < numReps; ++i) {
+		std::stringstream ss;
+		theTree->PutCompactSelf(ss);
+		compactForm = ss.str();
+	}
+	double putTime = ElapsedMs(startTime) / numReps;
+
+	startTime = std::chrono::steady_clock::now();
+	for (std::size_t i = 0; i < numReps; ++i) delete LoadTree(fullForm, true);
+	double fullGetTime = ElapsedMs(startTime) / numReps;
+
+	startTime = std::chrono::steady_clock::now();
+	for (std::size_t i = 0; i < numReps; ++i) delete LoadTree(compactForm, true);
+	double compactGetTime = ElapsedMs(startTime) / numReps;
+
+	tmTree* newTree = LoadTree(compactForm, true);
+	std::stringstream ss;
+	newTree->PutCompactSelf(ss);
+	bool same = ss.str() == compactForm &&
+		newTree->GetNodes().size() == theTree->GetNodes().size() &&
+		newTree->GetPaths().size() == theTree->GetPaths().size() &&
+		newTree->GetPolys().size() == theTree->GetPolys().size() &&
+		newTree->IsFeasible() == theTree->IsFeasible();
+	std::cout
+		<< "Full size = " << fullForm.size() << " bytes, compact size = "
+		<< compactForm.size() << " bytes, ratio = "
+		<< double(fullForm.size()) / compactForm.size() << '\n'
+		<< "Compact write time = " << putTime << "ms, full read time = "
+		<< fullGetTime << "ms, compact read time = " << compactGetTime
+		<< "ms (average of " << numReps << ")\n"
+		<< "Rebuilt tree has " << newTree->GetCreases().size() << " creases vs. "
+		<< theTree->GetCreases().size() << ", and "
+		<< (same ? "matches" : "DOES NOT MATCH") << " the original\n";
+	delete newTree;
+	delete theTree;
+	std::cout << '\n';
+}
+
+
+/*****
+Return the location and edge length of node i of the branching tree of
+DoBuildBenchmark(). Node i > 0 hangs from node (i - 1) / 3.
+*****/
+static tmPoint BranchingLoc(std::size_t i) {
+	tmFloat r = 0.45 * std::sqrt(tmFloat(i) / (i + 20));
+	return tmPoint(0.5 + r * std::cos(2.4 * i), 0.5 + r * std::sin(2.4 * i));
+}
+
+static tmFloat BranchingLength(std::size_t i) {
+	return 0.5 + 0.5 * std::fabs(std::sin(1.3 * tmFloat(i)));
+}
+
+
+/*****
+Make the branching tree of the given number of nodes with BuildTree().
+*****/
+static tmTree* MakeBranchingTree(std::size_t numNodes) {
+	tmTree* theTree = new tmTree();
+	std::vector<tmTree::NodeDesc> nodeList;
+	std::vector<tmTree::EdgeDesc> edgeList;
+	for (std::size_t i = 0; i < numNodes; ++i) {
+		nodeList.push_back(tmTree::NodeDesc(BranchingLoc(i)));
+		if (i > 0) edgeList.push_back(tmTree::EdgeDesc((i - 1) / 3, i,
+			BranchingLength(i)));
+	}
+	tmArray<tmNode*> newNodes;
+	tmArray<tmEdge*> newEdges;
+	theTree->BuildTree(nodeList, edgeList, newNodes, newEdges);
+	return theTree;
+}
+
+
+/*****
+Build a branching tree of the given number of nodes four ways -- one AddNode()
+per node in a single cleanup, one call to BuildTree(), and imports of CSV and
+JSON descriptions of it -- and report the times and whether all four trees are
+the same.
+*****/
+static void DoBuildBenchmark(std::size_t numNodes) {
+	std::cout << "Building a " << numNodes << "-node branching tree\n";
+
+	auto startTime = std::chrono::steady_clock::now();
+	tmTree* addTree = new tmTree();
+	{
+		tmTreeCleaner tc(addTree);
+		std::vector<tmNode*> nodes(numNodes);
+		tmEdge* theEdge;
+		addTree->AddNode(nullptr, BranchingLoc(0), nodes[0], theEdge);
+		for (std::size_t i = 1; i < numNodes; ++i) {
+			addTree->AddNode(nodes[(i - 1) / 3], BranchingLoc(i), nodes[i], theEdge);
+			theEdge->SetLength(BranchingLength(i));
+		}
+	}
+	double addTime = ElapsedMs(startTime);
+
+	startTime = std::chrono::steady_clock::now();
+	tmTree* buildTree = MakeBranchingTree(numNodes);
+	double buildTime = ElapsedMs(startTime);
+
+	std::stringstream csv, json;
+	csv.precision(17);
+	json.precision(17);
+	json << "{\"nodes\": [";
+	for (std::size_t i = 0; i < numNodes; ++i) {
+		tmPoint loc = BranchingLoc(i);
+		csv << "node," << i << ',' << loc.x << ',' << loc.y << '\n';
+		json << (i ? ",\n" : "\n") << "{\"id\": " << i << ", \"x\": " << loc.x
+			<< ", \"y\": " << loc.y << '}';
+	}
+	json << "],\n\"edges\": [";
+	for (std::size_t i = 1; i < numNodes; ++i) {
+		csv << "edge," << (i - 1) / 3 << ',' << i << ',' << BranchingLength(i) << '\n';
+		json << (i > 1 ? ",\n" : "\n") << "{\"nodes\": [" << (i - 1) / 3 << ", "
+			<< i << "], \"length\": " << BranchingLength(i) << '}';
+	}
+	json << "]}\n";
+
+	startTime = std::chrono::steady_clock::now();
+	tmTree* csvTree = new tmTree();
+	csvTree->ImportCSV(csv);
+	double csvTime = ElapsedMs(startTime);
+
+	startTime = std::chrono::steady_clock::now();
+	tmTree* jsonTree = new tmTree();
+	jsonTree->ImportJSON(json);
+	double jsonTime = ElapsedMs(startTime);
+
+	std::stringstream addForm, buildForm, csvForm, jsonForm;
+	addTree->PutCompactSelf(addForm);
+	buildTree->PutCompactSelf(buildForm);
+	csvTree->PutCompactSelf(csvForm);
+	jsonTree->PutCompactSelf(jsonForm);
+	bool same = buildForm.str() == addForm.str() &&
+		csvForm.str() == addForm.str() && jsonForm.str() == addForm.str() &&
+		buildTree->GetPaths().size() == addTree->GetPaths().size();
+	std::cout
+		<< "AddNode() time = " << addTime << "ms, BuildTree() time = "
+		<< buildTime << "ms, ratio = " << addTime / buildTime << '\n'
+		<< "CSV import time = " << csvTime << "ms, JSON import time = "
+		<< jsonTime << "ms\n"
+		<< "Trees have " << addTree->GetPaths().size() << " paths and "
+		<< (same ? "match" : "DO NOT MATCH") << '\n';
+	delete addTree;
+	delete buildTree;
+	delete csvTree;
+	delete jsonTree;
+	std::cout << '\n';
+}
+
+
+/*****
+Time edits of the length and strain of one edge at a time, each followed by a
+cleanup, and check that afterwards every path's minimum length is still the
+sum of its edges' strained lengths.
+*****/
+static void DoEdgeEditBenchmark(std::size_t numNodes, std::size_t numEdits) {
+	std::cout << "Editing single edges of a " << numNodes << "-node branching tree\n";
+	tmTree* theTree = MakeBranchingTree(numNodes);
+	const tmArray<tmEdge*>& edges = theTree->GetEdges();
+
+	auto startTime = std::chrono::steady_clock::now();
+	for (std::size_t i = 0; i < numEdits; ++i) {
+		tmEdge* theEdge = edges[(37 * i) % edges.size()];
+		if (i % 2 == 0) theEdge->SetLength(1.01 * theEdge->GetLength());
+		else theEdge->SetStrain(theEdge->GetStrain() + 0.01);
+	}
+	double editTime = ElapsedMs(startTime) / numEdits;
+
+	std::size_t numWrong = 0;
+	const tmArray<tmPath*>& paths = theTree->GetOwnedPaths();
+	for (std::size_t i = 0; i < paths.size(); ++i) {
+		tmFloat length = 0;
+		for (std::size_t j = 0; j < paths[i]->GetEdges().size(); ++j)
+			length += paths[i]->GetEdges()[j]->GetStrainedLength();
+		if (length != paths[i]->GetMinTreeLength()) ++numWrong;
+	}
+	std::cout
+		<< "Edit time = " << editTime << "ms (average of " << numEdits << ")\n"
+		<< numWrong << " of " << paths.size() << " paths have wrong lengths\n";
+	delete theTree;
+	std::cout << '\n';
+}
+
+
+/*****
+Optimize the scale of a fresh copy of a tree with the ALM optimizer using the
+given number of threads. Return the time taken and the saved form of the
+result.
+*****/
+static double TimeScaleOptimization(tmTree* theTree, std::size_t numThreads,
+	std::string& result) {
+	tmTree* theCopy = theTree->Clone();
+	tmNLCO_alm::SetNumThreads(numThreads);
+	tmNLCO_alm* theNLCO = new tmNLCO_alm();
+	tmScaleOptimizer* theOptimizer = new tmScaleOptimizer(theCopy, theNLCO);
+	theOptimizer->Initialize();
+	auto startTime = std::chrono::steady_clock::now();
+	try {
+		theOptimizer->Optimize();
+	} catch (...) {
+		std::cout << "Scale optimization failed\n";
+	}
+	double optTime = ElapsedMs(startTime);
+	delete theOptimizer;
+	delete theNLCO;
+	tmNLCO_alm::SetNumThreads(1);
+	result = SavedForm(theCopy);
+	delete theCopy;
+	return optTime;
+}
+
+
+/*****
+Time scale optimization of a tree with serial and threaded constraint
+evaluation, and check that each thread count gives the same answer every time.
+*****/
+static void DoThreadBenchmark(std::string_view name, tmTree* theTree) {
+	std::cout << "Scale optimization of " << name << '\n';
+	std::size_t maxThreads = std::max(4u, std::thread::hardware_concurrency());
+	std::string serial;
+	double serialTime = TimeScaleOptimization(theTree, 1, serial);
+	std::cout << "1 thread: " << serialTime << "ms\n";
+	for (std::size_t numThreads = 2; numThreads <= maxThreads; numThreads *= 2) {
+		std::string first, second;
+		double optTime = TimeScaleOptimization(theTree, numThreads, first);
+		TimeScaleOptimization(theTree, numThreads, second);
+		std::cout
+			<< numThreads << " threads: " << optTime << "ms, speedup = "
+			<< serialTime / optTime << ", repeat "
+			<< (first == second ? "matches" : "DOES NOT MATCH") << ", "
+			<< (first == serial ? "same as" : "differs from") << " serial\n";
+	}
+	delete theTree;
+	std::cout << '\n';
+}
+
+
+/*****
+Lengthen numGroups evenly spaced groups of groupSize consecutive flaps of the
+tree by 10% and optimize the strain of their edges, moving their leaf nodes,
+with the problem split into blocks or not. Return the time taken and report
+the number of blocks, the RMS strain and whether the result is feasible.
+*****/
+static double TimeStrainOptimization(tmTree* theTree, std::size_t numGroups,
+	std::size_t groupSize, bool splitBlocks, std::size_t& numBlocks,
+	tmFloat& rmsStrain, bool& feasible) {
+	tmTree* theCopy = theTree->Clone();
+	tmDpptrArray<tmNode> movingNodes;
+	tmDpptrArray<tmEdge> stretchyEdges;
+	std::size_t numEdges = theCopy->GetEdges().size();
+	for (std::size_t g = 0; g < numGroups; ++g)
+		for (std::size_t i = 0; i < groupSize; ++i) {
+			tmEdge* theEdge = theCopy->GetEdges()[(g * numEdges / numGroups + i) % numEdges];
+			theEdge->SetLength(1.1 * theEdge->GetLength());
+			stretchyEdges.push_back(theEdge);
+			tmNode* theNode = theEdge->GetNodes()[0];
+			if (!theNode->IsLeafNode()) theNode = theEdge->GetNodes()[1];
+			movingNodes.push_back(theNode);
+		}
+	tmOptimizer::SetSplitBlocks(splitBlocks);
+	tmNLCO_alm* theNLCO = new tmNLCO_alm();
+	tmStrainOptimizer* theOptimizer = new tmStrainOptimizer(theCopy, theNLCO);
+	theOptimizer->Initialize(movingNodes, stretchyEdges);
+	auto startTime = std::chrono::steady_clock::now();
+	try {
+		theOptimizer->Optimize();
+	} catch (...) {
+		std::cout << "Strain optimization failed\n";
+	}
+	double optTime = ElapsedMs(startTime);
+	numBlocks = theOptimizer->GetNumBlocks();
+	delete theOptimizer;  // cleans up the tree
+	delete theNLCO;
+	tmOptimizer::SetSplitBlocks(true);
+	tmFloat sumSq = 0;
+	for (auto theEdge : stretchyEdges) sumSq += theEdge->GetStrain() * theEdge->GetStrain();
+	rmsStrain = std::sqrt(sumSq / stretchyEdges.size());
+	feasible = theCopy->IsFeasible();
+	delete theCopy;
+	return optTime;
+}
+
+
+/*****
+Time strain optimization of separate groups of flaps as one problem and split
+into independent blocks, and compare the answers. The node locations needn't
+agree, since many placements may have the same strain.
+*****/
+static void DoBlockBenchmark(std::string_view name, tmTree* theTree,
+	std::size_t numGroups, std::size_t groupSize) {
+	std::cout << "Strain optimization of " << numGroups << " groups of "
+		<< groupSize << " flaps of " << name << '\n';
+	std::size_t wholeBlocks, splitBlocks;
+	tmFloat wholeStrain, splitStrain;
+	bool wholeFeasible, splitFeasible;
+	double wholeTime = TimeStrainOptimization(theTree, numGroups, groupSize,
+		false, wholeBlocks, wholeStrain, wholeFeasible);
+	double splitTime = TimeStrainOptimization(theTree, numGroups, groupSize,
+		true, splitBlocks, splitStrain, splitFeasible);
+	std::cout
+		<< "Whole: " << wholeTime << "ms, RMS strain = " << 100 * wholeStrain
+		<< "%, " << (wholeFeasible ? "feasible" : "NOT FEASIBLE") << '\n'
+		<< "Split into " << splitBlocks << " blocks: " << splitTime
+		<< "ms, RMS strain = " << 100 * splitStrain << "%, "
+		<< (splitFeasible ? "feasible" : "NOT FEASIBLE")
+		<< ", speedup = " << wholeTime / splitTime << '\n';
+	delete theTree;
+	std::cout << '\n';
+}
+
+
+/*****
+Optimize the scale of a fresh copy of a tree with the ALM optimizer, either
+eliminating the variables that conditions fix or imposing them as equality
+constraints. Return the time taken and report the size of the problem the
+optimizer saw, the scale and whether the result is feasible.
+*****/
+static double TimeConditionedOptimization(tmTree* theTree,
+	bool eliminateEqualities, std::size_t& numVars, std::size_t& numEqualities,
+	tmFloat& scale, bool& feasible) {
+	tmTree* theCopy = theTree->Clone();
+	tmOptimizer::SetEliminateEqualities(eliminateEqualities);
+	tmNLCO_alm* theNLCO = new tmNLCO_alm();
+	tmScaleOptimizer* theOptimizer = new tmScaleOptimizer(theCopy, theNLCO);
+	theOptimizer->Initialize();
+	numVars = theNLCO->GetNumVariables();
+	numEqualities = theNLCO->GetNumEqualities();
+	auto startTime = std::chrono::steady_clock::now();
+	try {
+		theOptimizer->Optimize();
+	} catch (...) {
+		std::cout << "Scale optimization failed\n";
+	}
+	double optTime = ElapsedMs(startTime);
+	delete theOptimizer;
+	delete theNLCO;
+	tmOptimizer::SetEliminateEqualities(true);
+	scale = theCopy->GetScale();
+	feasible = theCopy->IsFeasible();
+	delete theCopy;
+	return optTime;
+}
+
+
+/*****
+Pin every third leaf of a tree where it is and time scale optimization with
+the pinned coordinates imposed as equalities and eliminated.
+*****/
+static void DoConditionedBenchmark(std::string_view name, tmTree* theTree) {
+	std::cout << "Scale optimization of " << name
+		<< " with every third leaf pinned\n";
+	tmArray<tmNode*> leafNodes;
+	theTree->GetLeafNodes(leafNodes);
+	for (std::size_t i = 0; i < leafNodes.size(); i += 3)
+		new tmConditionNodeFixed(theTree, leafNodes[i], true,
+			leafNodes[i]->GetLocX(), true, leafNodes[i]->GetLocY());
+	std::size_t keptVars, keptEqualities, elimVars, elimEqualities;
+	tmFloat keptScale, elimScale;
+	bool keptFeasible, elimFeasible;
+	double keptTime = TimeConditionedOptimization(theTree, false, keptVars,
+		keptEqualities, keptScale, keptFeasible);
+	double elimTime = TimeConditionedOptimization(theTree, true, elimVars,
+		elimEqualities, elimScale, elimFeasible);
+	std::cout
+		<< "As constraints: " << keptVars << " variables, " << keptEqualities
+		<< " equalities, " << keptTime << "ms, scale = " << keptScale << ", "
+		<< (keptFeasible ? "feasible" : "NOT FEASIBLE") << '\n'
+		<< "Eliminated: " << elimVars << " variables, " << elimEqualities
+		<< " equalities, " << elimTime << "ms, scale = " << elimScale << ", "
+		<< (elimFeasible ? "feasible" : "NOT FEASIBLE")
+		<< ", speedup = " << keptTime / elimTime << '\n';
+	delete theTree;
+	std::cout << '\n';
+}
+
+
+/*****
+Optimize the scale of a fresh copy of a tree with the ALM optimizer within the
+given limits, 0 for none. Return the time taken and report the evaluations,
+whether the budget ran out, the scale and whether the result is feasible.
+*****/
+static double TimeBudgetedOptimization(tmTree* theTree, double timeLimit,
+	std::size_t evaluationLimit, std::size_t& numEvaluations, bool& expired,
+	tmFloat& scale, bool& feasible) {
+	tmTree* theCopy = theTree->Clone();
+	tmNLCO_alm* theNLCO = new tmNLCO_alm();
+	tmScaleOptimizer* theOptimizer = new tmScaleOptimizer(theCopy, theNLCO);
+	theOptimizer->GetBudget().SetTimeLimit(timeLimit);
+	theOptimizer->GetBudget().SetEvaluationLimit(evaluationLimit);
+	theOptimizer->Initialize();
+	try {
+		theOptimizer->Optimize();
+	} catch (...) {
+		std::cout << "Scale optimization found nothing feasible\n";
+	}
+	double optTime = 1000 * theOptimizer->GetBudget().GetElapsedTime();
+	numEvaluations = theOptimizer->GetBudget().GetNumEvaluations();
+	expired = theOptimizer->GetBudget().IsExpired();
+	delete theOptimizer;
+	delete theNLCO;
+	scale = theCopy->GetScale();
+	feasible = theCopy->IsFeasible();
+	delete theCopy;
+	return optTime;
+}
+
+
+/*****
+Time scale optimization of a tree without limits, and then limited to fractions
+of the time and the evaluations that it took.
+*****/
+static void DoBudgetBenchmark(std::string_view name, tmTree* theTree) {
+	std::cout << "Scale optimization of " << name << " within a budget\n";
+	std::size_t numEvaluations;
+	bool expired, feasible;
+	tmFloat scale;
+	double fullTime = TimeBudgetedOptimization(theTree, 0, 0, numEvaluations,
+		expired, scale, feasible);
+	std::size_t fullEvaluations = numEvaluations;
+	std::cout
+		<< "No limit: " << fullTime << "ms, " << numEvaluations
+		<< " evaluations, scale = " << scale << ", "
+		<< (feasible ? "feasible" : "NOT FEASIBLE") << '\n';
+	for (std::size_t k = 4; k >= 2; k /= 2) {
+		double optTime = TimeBudgetedOptimization(theTree, fullTime / k / 1000,
+			0, numEvaluations, expired, scale, feasible);
+		std::cout
+			<< "1/" << k << " of the time: " << optTime << "ms, " << numEvaluations
+			<< " evaluations, " << (expired ? "expired" : "finished")
+			<< ", scale = " << scale << ", "
+			<< (feasible ? "feasible" : "NOT FEASIBLE") << '\n';
+	}
+	for (std::size_t k = 4; k >= 2; k /= 2) {
+		double optTime = TimeBudgetedOptimization(theTree, 0, fullEvaluations / k,
+			numEvaluations, expired, scale, feasible);
+		std::cout
+			<< "1/" << k << " of the evaluations: " << optTime << "ms, "
+			<< numEvaluations << " evaluations, "
+			<< (expired ? "expired" : "finished") << ", scale = " << scale << ", "
+			<< (feasible ? "feasible" : "NOT FEASIBLE") << '\n';
+	}
+	delete theTree;
+	std::cout << '\n';
+}
+
+
+/*****
+Main Program
+*****/
+int main(int argc, const char** argv) {
+	std::cout << "**************************************************\n"
+	             "TreeMaker Model Benchmark Program\n"
+	             "**************************************************\n\n";
+
+	if (argc < 2) {
+		std::cout << "Please specify the path of test files\n";
+		return 0;
+	}
+	testdir = argv[1];
+	std::size_t numFlaps = (argc > 2) ? std::size_t(std::atoi(argv[2])) : 60;
+
+	std::cout.setf(std::ios_base::fixed);
+	std::cout.precision(3);
+
+	tmPart::InitTypes();
+
+	// tmModelTester_4.tmd5 is an optimized centipede.
+	DoRebuildBenchmark("tmModelTester_4.tmd5", ReadTree("tmModelTester_4.tmd5"), 10);
+
+	// A star tree is one big polygon.
+	DoRebuildBenchmark(std::to_string(numFlaps) + "-flap star tree",
+		MakeStarTree(numFlaps), 3);
+
+	DoCloneBenchmark("tmModelTester_4.tmd5", ReadTree("tmModelTester_4.tmd5"), 20);
+	DoCloneBenchmark(std::to_string(numFlaps) + "-flap star tree",
+		MakeStarTree(numFlaps), 5);
+
+	DoLoadBenchmark("tmModelTester_4.tmd5", ReadTree("tmModelTester_4.tmd5"), 20);
+	DoLoadBenchmark(std::to_string(numFlaps) + "-flap star tree",
+		MakeStarTree(numFlaps), 5);
+
+	DoCompactBenchmark("tmModelTester_4.tmd5", ReadTree("tmModelTester_4.tmd5"), 20);
+	DoCompactBenchmark(std::to_string(numFlaps) + "-flap star tree",
+		MakeStarTree(numFlaps), 5);
+
+	DoBuildBenchmark(10 * numFlaps);
+	DoEdgeEditBenchmark(10 * numFlaps, 20);
+
+	DoThreadBenchmark(std::to_string(numFlaps) + "-flap star tree",
+		MakeStarTree(numFlaps));
+
+	DoBlockBenchmark(std::to_string(numFlaps) + "-flap star tree",
+		MakeStarTree(numFlaps), 4, 3);
+
+	DoConditionedBenchmark(std::to_string(numFlaps) + "-flap star tree",
+		MakeStarTree(numFlaps));
+
+	DoBudgetBenchmark(std::to_string(numFlaps) + "-flap star tree",
+		MakeStarTree(numFlaps));
+}
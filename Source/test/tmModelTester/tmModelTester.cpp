@@ -29,6 +29,7 @@ namespace fs = std::filesystem;
 // TreeMaker model classes
 #include "tmModel.h"
 #include "tmNLCO.h"
+#include "tmProfiler.h"
 
 
 // The path to the test files
@@ -267,4 +268,13 @@ int main(int argc, const char** argv) {
 	std::cout << "Using RFSQP optimizer\n"
 	DoSeveralOptimizations<tmNLCO_rfsqp>();
 #endif // tmUSE_RFSQP
+
+#ifdef TMPROFILE
+	// Profiling builds report where the time went, and leave a trace for
+	// chrome://tracing in the current directory.
+	std::cout << "\nProfile summary\n";
+	tmProfiler::WriteSummary(std::cout);
+	std::ofstream fout("tmModelTester_profile.json");
+	tmProfiler::WriteTrace(fout);
+#endif // TMPROFILE
 }
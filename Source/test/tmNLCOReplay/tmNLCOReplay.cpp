@@ -0,0 +1,343 @@
+/*******************************************************************************
+File:         tmNLCOReplay.cpp
+Project:      TreeMaker 5.x
+Purpose:      Replays recorded optimization problems on every optimizer (no GUI)
+Author:       Robert J. Lang
+Modified by:
+Created:      2026-10-19
+Copyright:    ©2026 Robert J. Lang. All Rights Reserved.
+*******************************************************************************/
+
+/*
+This program compares the nonlinear constrained optimizers on problems taken
+from real designs. Give it the directory that holds the tmModelTester files
+and optionally a directory of recorded problems, e.g.
+
+  tmNLCOReplay ../test/tmModelTester nlco
+
+It first records the problems that tmModelTester solves -- the scale
+optimizations of files 1 to 3, the edge optimization of file 4 and the strain
+optimization of file 5 -- as they are posed, before any reduction by symmetry
+or elimination, into files named like tmModelTester_1.scale.nlco in the
+problem directory (./nlco if none is given). Problems recorded elsewhere with
+tmOptimizer::PutProblem() can be dropped into the same directory.
+
+Then it solves every problem in the directory with every optimizer that's
+compiled in (see tmNLCO.h), starting from the recorded starting point, and
+reports for each the result code, the number of iterations, the number of
+function and gradient calls of the objective and constraints together, the
+time taken, the objective and the worst violation of any constraint or bound
+at the answer.
+*/
+
+// standard libraries
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// TreeMaker model classes
+#include "tmModel.h"
+#include "tmNLCO.h"
+#include "tmRecordingNLCO.h"
+
+
+// The path to the tmModelTester files
+static fs::path testdir;
+
+
+/*****
+Numbers of calls of all of the functions of a problem
+*****/
+struct CallCounts {
+	std::size_t mFunc = 0;
+	std::size_t mGrad = 0;
+};
+
+
+/*****
+A function that counts its calls, whatever kind of build this is, and passes
+them on to the function it owns.
+*****/
+class CountedFn : public tmDifferentiableFn {
+public:
+	CountedFn(tmDifferentiableFn* f, CallCounts& counts) : mFn(f), mCounts(counts) {}
+	~CountedFn() { delete mFn; }
+	double Func(const std::vector<double>& x) {
+		++mCounts.mFunc;
+		return mFn->Func(x);
+	}
+	void Grad(const std::vector<double>& x, std::vector<double>& gradx) {
+		++mCounts.mGrad;
+		mFn->Grad(x, gradx);
+	}
+	double FuncGrad(const std::vector<double>& x, std::vector<double>& gradx) {
+		++mCounts.mFunc;
+		++mCounts.mGrad;
+		return mFn->FuncGrad(x, gradx);
+	}
+	bool GetVariables(std::vector<std::size_t>& vars) const {
+		return mFn->GetVariables(vars);
+	}
+	// The value without counting it
+	double Value(const std::vector<double>& x) const { return mFn->Func(x); }
+private:
+	tmDifferentiableFn* mFn;
+	CallCounts& mCounts;
+};
+
+
+/*****
+An optimizer that wraps each function of the problem in a CountedFn on its
+way to the optimizer that does the work, and keeps them so that we can check
+the answer.
+*****/
+class CountingNLCO : public tmNLCO {
+public:
+	CountingNLCO(tmNLCO* aNLCO) : mNLCO(aNLCO) {}
+	void SetSize(std::size_t n) {
+		tmNLCO::SetSize(n);
+		mNLCO->SetSize(n);
+	}
+	std::size_t GetNumEqualities() { return mNLCO->GetNumEqualities(); }
+	std::size_t GetNumInequalities() { return mNLCO->GetNumInequalities(); }
+	void SetObjective(tmDifferentiableFn* f) {
+		mObjective = new CountedFn(f, mCounts);
+		mNLCO->SetObjective(mObjective);
+	}
+	void AddLinearEquality(tmDifferentiableFn* f) {
+		mNLCO->AddLinearEquality(Count(f, mEqualities));
+	}
+	void AddNonlinearEquality(tmDifferentiableFn* f) {
+		mNLCO->AddNonlinearEquality(Count(f, mEqualities));
+	}
+	void AddLinearInequality(tmDifferentiableFn* f) {
+		mNLCO->AddLinearInequality(Count(f, mInequalities));
+	}
+	void AddNonlinearInequality(tmDifferentiableFn* f) {
+		mNLCO->AddNonlinearInequality(Count(f, mInequalities));
+	}
+	void SetBounds(const std::vector<double>& bl, const std::vector<double>& bu) {
+		mBl = bl;
+		mBu = bu;
+		mNLCO->SetBounds(bl, bu);
+	}
+	int Minimize(std::vector<double>& x) {
+		int inform = mNLCO->Minimize(x);
+		mNumIterations = mNLCO->GetNumIterations();
+		return inform;
+	}
+
+	const CallCounts& GetCounts() const { return mCounts; }
+	double GetObjectiveValue(const std::vector<double>& x) const {
+		return mObjective->Value(x);
+	}
+	// The worst violation of any constraint or bound at x
+	double GetViolation(const std::vector<double>& x) const {
+		double v = 0;
+		for (auto f : mEqualities) v = std::max(v, std::fabs(f->Value(x)));
+		for (auto f : mInequalities) v = std::max(v, f->Value(x));
+		for (std::size_t i = 0; i < x.size(); ++i)
+			v = std::max({v, mBl[i] - x[i], x[i] - mBu[i]});
+		return v;
+	}
+private:
+	tmNLCO* mNLCO;
+	CallCounts mCounts;
+	CountedFn* mObjective = nullptr;
+	std::vector<CountedFn*> mEqualities;
+	std::vector<CountedFn*> mInequalities;
+	std::vector<double> mBl;
+	std::vector<double> mBu;
+
+	CountedFn* Count(tmDifferentiableFn* f, std::vector<CountedFn*>& list) {
+		list.push_back(new CountedFn(f, mCounts));
+		return list.back();
+	}
+};
+
+
+/*****
+Return the name of an optimizer.
+*****/
+std::string_view GetAlgorithmName(tmNLCO::Algorithm algorithm) {
+	switch (algorithm) {
+#ifdef tmUSE_CFSQP
+		case tmNLCO::CFSQP: return "CFSQP";
+#endif
+#ifdef tmUSE_RFSQP
+		case tmNLCO::RFSQP: return "RFSQP";
+#endif
+#ifdef tmUSE_ALM
+		case tmNLCO::ALM: return "ALM";
+#endif
+#ifdef tmUSE_WNLIB
+		case tmNLCO::WNLIB: return "WNLIB";
+#endif
+		default: return "?";
+	}
+}
+
+
+/*****
+Read in a tree from the test directory.
+*****/
+tmTree* ReadTree(std::string_view filename) {
+	auto fullname = testdir / filename;
+	std::ifstream fin(fullname);
+	if (!fin.good()) {
+		std::cout << "Unable to find file " << fullname << '\n';
+		std::exit(EXIT_FAILURE);
+	}
+	tmTree* theTree = new tmTree();
+	try {
+		theTree->GetSelf(fin);
+	} catch(...) {
+		std::cout << "Unexpected exception reading file " << fullname << '\n';
+		std::exit(EXIT_FAILURE);
+	}
+	return theTree;
+}
+
+
+/*****
+Write the problem the optimizer has set up into the problem directory.
+*****/
+void WriteProblem(const fs::path& problemdir, std::string_view filename,
+	std::string_view kind, tmOptimizer* theOptimizer) {
+	fs::path name = problemdir / fs::path(filename).stem();
+	name += std::string(".") + std::string(kind) + ".nlco";
+	std::ofstream fout(name);
+	if (!theOptimizer->PutProblem(fout) || !fout.good()) {
+		std::cout << "Unable to record problem " << name << '\n';
+		std::exit(EXIT_FAILURE);
+	}
+	std::cout << "Recorded " << name.filename() << '\n';
+}
+
+
+/*****
+Record the scale optimization of a file.
+*****/
+void RecordScaleProblem(const fs::path& problemdir, std::string_view filename) {
+	tmTree* theTree = ReadTree(filename);
+	tmNLCO* theNLCO = tmNLCO::MakeNLCO();
+	tmScaleOptimizer* theOptimizer = new tmScaleOptimizer(theTree, theNLCO);
+	theOptimizer->Initialize();
+	WriteProblem(problemdir, filename, "scale", theOptimizer);
+	delete theOptimizer;
+	delete theNLCO;
+	delete theTree;
+}
+
+
+/*****
+Record the edge or strain optimization of a file, over all of its nodes and
+edges.
+*****/
+template <class Optimizer>
+void RecordStrainProblem(const fs::path& problemdir, std::string_view filename,
+	std::string_view kind) {
+	tmTree* theTree = ReadTree(filename);
+	tmNLCO* theNLCO = tmNLCO::MakeNLCO();
+	Optimizer* theOptimizer = new Optimizer(theTree, theNLCO);
+	tmDpptrArray<tmNode> movingNodes = theTree->GetOwnedNodes();
+	tmDpptrArray<tmEdge> stretchyEdges = theTree->GetOwnedEdges();
+	theOptimizer->Initialize(movingNodes, stretchyEdges);
+	WriteProblem(problemdir, filename, kind, theOptimizer);
+	delete theOptimizer;
+	delete theNLCO;
+	delete theTree;
+}
+
+
+/*****
+Solve a recorded problem with one optimizer and report how it went.
+*****/
+void ReplayProblem(const fs::path& problem, tmNLCO::Algorithm algorithm) {
+	using namespace std::chrono;
+
+	tmNLCO::SetAlgorithm(algorithm);
+	tmNLCO* theNLCO = tmNLCO::MakeNLCO();
+	CountingNLCO* theCounter = new CountingNLCO(theNLCO);
+	std::vector<double> x;
+	std::ifstream fin(problem);
+	try {
+		tmRecordingNLCO::GetProblem(fin, theCounter, x);
+	} catch (const tmRecordingNLCO::EX_BAD_PROBLEM&) {
+		std::cout << "  " << GetAlgorithmName(algorithm) << ": unable to read problem\n";
+		delete theCounter;
+		delete theNLCO;
+		return;
+	}
+	if (algorithm == 0)
+		std::cout << "  " << x.size() << " variables, " << theCounter->GetNumEqualities()
+			<< " equalities, " << theCounter->GetNumInequalities() << " inequalities\n";
+	auto startTime = steady_clock::now();
+	int inform = theCounter->Minimize(x);
+	auto stopTime = steady_clock::now();
+	CallCounts counts = theCounter->GetCounts();
+	std::cout
+		<< "  " << GetAlgorithmName(algorithm) << ": result " << inform
+		<< ", " << theCounter->GetNumIterations() << " iterations"
+		<< ", calls = (" << counts.mFunc << ", " << counts.mGrad << ")"
+		<< ", time = " << duration<double, std::milli>(stopTime - startTime).count() << "ms\n"
+		<< "    objective = " << theCounter->GetObjectiveValue(x)
+		<< ", worst violation = " << std::scientific << theCounter->GetViolation(x)
+		<< std::fixed << '\n';
+	delete theCounter;
+	delete theNLCO;
+}
+
+
+/*****
+Main Program
+*****/
+int main(int argc, const char** argv) {
+	std::cout << "**************************************************\n"
+	             "TreeMaker NLCO Replay Program\n"
+	             "**************************************************\n\n";
+
+	if (argc < 2) {
+		std::cout << "Please specify the path of test files\n";
+		return 0;
+	}
+	testdir = argv[1];
+	fs::path problemdir = (argc > 2) ? fs::path(argv[2]) : fs::path("nlco");
+	fs::create_directories(problemdir);
+
+	std::cout.setf(std::ios_base::fixed);
+	std::cout.precision(6);
+
+	tmPart::InitTypes();
+
+	// Record the problems of the tmModelTester files.
+	RecordScaleProblem(problemdir, "tmModelTester_1.tmd5");
+	RecordScaleProblem(problemdir, "tmModelTester_2.tmd5");
+	RecordScaleProblem(problemdir, "tmModelTester_3.tmd5");
+	RecordStrainProblem<tmEdgeOptimizer>(problemdir, "tmModelTester_4.tmd5", "edge");
+	RecordStrainProblem<tmStrainOptimizer>(problemdir, "tmModelTester_5.tmd5", "strain");
+	std::cout << '\n';
+
+	// Replay everything in the problem directory, in order of name.
+	std::vector<fs::path> problems;
+	for (const auto& entry : fs::directory_iterator(problemdir))
+		if (entry.path().extension() == ".nlco") problems.push_back(entry.path());
+	std::sort(problems.begin(), problems.end());
+	tmNLCO::Algorithm oldAlgorithm = tmNLCO::GetAlgorithm();
+	for (const auto& problem : problems) {
+		std::cout << "Replaying " << problem.filename() << '\n';
+		for (int i = 0; i < tmNLCO::NUM_ALGORITHMS; ++i)
+			ReplayProblem(problem, tmNLCO::Algorithm(i));
+		std::cout << '\n';
+	}
+	tmNLCO::SetAlgorithm(oldAlgorithm);
+}
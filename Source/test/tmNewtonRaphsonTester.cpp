@@ -17,10 +17,13 @@ using namespace std;
 // My libraries
 #include "tmNewtonRaphson.h"
 
-// stream output for vectors, also works for tmMatrix
+// stream output for vectors and tmMatrix
 template <class T>
 ostream& operator<<(ostream& os, const vector<T>& v);
 
+template <class T>
+ostream& operator<<(ostream& os, const tmMatrix<T>& m);
+
 template <class T>
 ostream& operator<<(ostream& os, const vector<T>& v)
 {
@@ -33,6 +36,18 @@ ostream& operator<<(ostream& os, const vector<T>& v)
   return os;
 }
 
+template <class T>
+ostream& operator<<(ostream& os, const tmMatrix<T>& m)
+{
+  os << "(";
+  for (size_t i = 0; i < m.GetRows(); ++i) {
+    os << vector<T>(m[i], m[i] + m.GetCols());
+    if (i < m.GetRows() - 1) os << ", ";
+  }
+  os << ")";
+  return os;
+}
+
 
 /*****
 Main program to test tmMatrix<T> class
@@ -52,7 +67,7 @@ int main_Matrix()
   for (size_t i = 0; i < foo.GetRows(); ++i) 
     for (size_t j = 0; j < foo.GetCols(); ++j) foo[i][j] = i + 0.1 * j;
   cout << "foo = " << foo << endl;
-  cout << "foo[0] = " << foo[0] << endl;
+  cout << "foo[0] = " << vector<double>(foo[0], foo[0] + foo.GetCols()) << endl;
   cout << "foo[0][0] = " << foo[0][0] << endl;
   foo[2][2] = 3.14159;
   cout << "modified matrix = " << foo << endl;
@@ -10,8 +10,113 @@ Copyright:    ©2004 Robert J. Lang. All Rights Reserved.
 
 #include "tmNLCO.h"
 
+#include <chrono>
+
 using namespace std;
 
+/**********
+class tmNLCOBudget
+Limits on the time and the number of evaluations an optimization may use
+**********/
+
+/*****
+Constructor. By default there are no limits.
+*****/
+tmNLCOBudget::tmNLCOBudget()
+  : mTimeLimit(0), mEvaluationLimit(0), mStartTime(0), mElapsedTime(0),
+  mRunning(false), mNumEvaluations(0), mExpired(false)
+{
+}
+
+
+/*****
+Set the longest time in seconds that an optimization may run, 0 for no limit.
+*****/
+void tmNLCOBudget::SetTimeLimit(double seconds)
+{
+  TMASSERT(seconds >= 0);
+  mTimeLimit = seconds;
+}
+
+
+/*****
+Set the most points at which an optimization may evaluate the objective and
+constraints, 0 for no limit.
+*****/
+void tmNLCOBudget::SetEvaluationLimit(size_t evaluations)
+{
+  mEvaluationLimit = evaluations;
+}
+
+
+/*****
+Start the clock and clear the record of the last run. Call this before
+Minimize(), not from within it, so that a budget shared by several optimizers
+covers all of them.
+*****/
+void tmNLCOBudget::Start()
+{
+  mStartTime = GetTime();
+  mElapsedTime = 0;
+  mRunning = true;
+  mNumEvaluations = 0;
+  mExpired = false;
+}
+
+
+/*****
+Charge for one evaluation and return true if the budget is now used up. Once it
+is, it stays used up until the next Start(). Safe to call from several threads.
+*****/
+bool tmNLCOBudget::Charge()
+{
+  size_t n = ++mNumEvaluations;
+  if (mExpired) return true;
+  if ((mEvaluationLimit > 0 && n >= mEvaluationLimit) ||
+    (mTimeLimit > 0 && GetTime() - mStartTime >= mTimeLimit))
+    mExpired = true;
+  return mExpired;
+}
+
+
+/*****
+Stop the clock at the end of the run.
+*****/
+void tmNLCOBudget::Stop()
+{
+  if (!mRunning) return;
+  mElapsedTime = GetTime() - mStartTime;
+  mRunning = false;
+}
+
+
+/*****
+Return the time in seconds since Start(), or that the run took if it's over.
+*****/
+double tmNLCOBudget::GetElapsedTime() const
+{
+  return mRunning ? GetTime() - mStartTime : mElapsedTime;
+}
+
+
+/*****
+STATIC
+Return the time in seconds from some fixed moment, on a clock that only runs
+forward.
+*****/
+double tmNLCOBudget::GetTime()
+{
+  return chrono::duration<double>(
+    chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+#ifdef __MWERKS__
+  #pragma mark -
+#endif
+
+
+
 /**********
 class tmNLCO
 Abstract class for nonlinear constrained optimizer object used in TreeMaker.
@@ -22,7 +127,7 @@ Any constrained optimizer code must be adapted to this interface.
 Constructor
 *****/
 tmNLCO::tmNLCO()
-  : mSize(0), mUpdater(0), mObjective(0)
+  : mSize(0), mUpdater(0), mBudget(0), mNumIterations(0), mObjective(0)
 {
 }
 
@@ -116,6 +221,17 @@ void tmNLCO::SetUpdater(tmNLCOUpdater* updater)
 }
 
 
+/*****
+Specify the limits (see class tmNLCOBudget) that the optimization must stay
+within, or NULL for none. The caller keeps ownership and starts the budget.
+Optimizers that don't enforce limits ignore it.
+*****/
+void tmNLCO::SetBudget(tmNLCOBudget* budget)
+{
+  mBudget = budget;
+}
+
+
 /*****
 Set the objective function. Subclasses should override but call the base routine
 *****/
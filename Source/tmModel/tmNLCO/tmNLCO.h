@@ -12,6 +12,8 @@ Copyright:    ©2004 Robert J. Lang. All Rights Reserved.
 #define _TMNLCO_H_
 
 #include "tmHeader.h"
+#include <atomic>
+#include <iosfwd>
 #include <vector>
 
 /*
@@ -58,6 +60,22 @@ public:
   virtual double Func(const std::vector<double>& x) = 0;
   virtual void Grad(const std::vector<double>& x, 
     std::vector<double>& gradx) = 0;
+  // Value and gradient at the same point. Override this when the two share
+  // expensive intermediate results; the default simply calls both.
+  virtual double FuncGrad(const std::vector<double>& x, 
+    std::vector<double>& gradx) {
+    double f = Func(x);
+    Grad(x, gradx);
+    return f;
+  };
+  // The indices of the elements of x that the function actually reads. A
+  // function that knows them can return them and true, which lets callers
+  // skip work on the rest of x; the default returns false, meaning all of x.
+  virtual bool GetVariables(std::vector<std::size_t>&) const {return false;};
+  // Write the name and constants of the function on one line, so that a
+  // recorded problem can be read back (see tmRecordingNLCO.h). Functions
+  // that can't be written return false.
+  virtual bool PutSelf(std::ostream&) const {return false;};
 #if TM_PROFILE_OPTIMIZERS
   tmDifferentiableFn() : mFuncCalls(0), mGradCalls(0) {};
   std::size_t GetNumFuncCalls() const {return mFuncCalls;};
@@ -96,6 +114,50 @@ public:
 };
 
 
+/**********
+class tmNLCOBudget
+Limits on the time and the number of evaluations an optimization may use. If
+you pass one of these objects to a tmNLCO via tmNLCO::SetBudget(), the
+optimizer charges it for every point at which it evaluates the problem. An
+optimizer that runs out of budget stops and returns the best feasible point it
+has seen, or fails if it hasn't seen one. Afterward the budget tells how much
+was used and whether it ran out. Optimizers working on parts of a problem at
+once can share a budget.
+**********/
+class tmNLCOBudget {
+public:
+  tmNLCOBudget();
+
+  // Limits, 0 for none
+  double GetTimeLimit() const {return mTimeLimit;};
+  void SetTimeLimit(double seconds);
+  std::size_t GetEvaluationLimit() const {return mEvaluationLimit;};
+  void SetEvaluationLimit(std::size_t evaluations);
+  bool IsLimited() const {return mTimeLimit > 0 || mEvaluationLimit > 0;};
+
+  // Used by optimizers
+  void Start();
+  bool Charge();
+  void Stop();
+
+  // Report on the last run
+  bool IsExpired() const {return mExpired;};
+  std::size_t GetNumEvaluations() const {return mNumEvaluations;};
+  double GetElapsedTime() const;
+
+private:
+  double mTimeLimit;                        // seconds, 0 = no limit
+  std::size_t mEvaluationLimit;             // evaluations, 0 = no limit
+  double mStartTime;                        // when Start() was called
+  double mElapsedTime;                      // time of the run, once stopped
+  bool mRunning;                            // true between Start() and Stop()
+  std::atomic<std::size_t> mNumEvaluations; // evaluations since Start()
+  std::atomic<bool> mExpired;               // true once a limit is reached
+
+  static double GetTime();
+};
+
+
 /**********
 class tmNLCO
 Abstract class for nonlinear constrained optimizer object used in TreeMaker.
@@ -137,6 +199,7 @@ public:
   static tmNLCO* MakeNLCO();
   
   void SetUpdater(tmNLCOUpdater* updater);
+  void SetBudget(tmNLCOBudget* budget);
   virtual void SetSize(std::size_t);
 
   virtual std::size_t GetNumEqualities() = 0;
@@ -161,6 +224,9 @@ public:
     
   // Performing the optimization
   virtual int Minimize(std::vector<double>& x) = 0;
+  // Iterations taken by the last Minimize(), as the algorithm counts them, or
+  // 0 if it doesn't count them
+  std::size_t GetNumIterations() const {return mNumIterations;};
   
   // UI updating from the objective function
   virtual void ObjectiveUpdateUI();
@@ -168,6 +234,8 @@ public:
 protected:
   std::size_t mSize;        // dimensionality of the problem
   tmNLCOUpdater* mUpdater;  // object that shows progress
+  tmNLCOBudget* mBudget;    // limits on the optimization, or NULL
+  std::size_t mNumIterations; // iterations of the last Minimize()
 
   // Utility for copying between dimensioned vectors and C arrays in which size
   // is always taken from the vector.
@@ -12,9 +12,14 @@ Copyright:    ©2004 Robert J. Lang. All Rights Reserved.
 #ifdef tmUSE_ALM
 #include "tmNLCO_alm.h"
 #include "tmMatrix.h"
+#include "tmProfiler.h"
 
 #include <cmath>
+#include <condition_variable>
+#include <exception>
 #include <limits>
+#include <mutex>
+#include <thread>
 #include <vector>
 #include <sstream>
 
@@ -39,25 +44,152 @@ inline T1 MAX(const T1& t1, const T2& t2) {return (t1 < t2) ? t2 : t1; };
 template <class T>
 inline T SQR(const T& t) {return t * t;};
 
+// Fewest constraints per thread for which parallel evaluation pays for waking
+// up the helper threads. Below this many we stay serial.
+const size_t MIN_CONSTRAINTS_PER_THREAD = 64;
+
+// Tolerance on feasibility
+const double TOL_FEAS = 1.0e-5;
+
+
+/**********
+class tmNLCO_alm::WorkerPool
+A fixed set of helper threads that run the chunks of a tmNLCO_alm. Chunk 0
+always runs on the calling thread and chunk k on helper thread k, so a given
+chunk always runs alone and in the same order, and with the same number of
+threads the results don't depend on scheduling.
+**********/
+class tmNLCO_alm::WorkerPool {
+public:
+  WorkerPool(tmNLCO_alm* owner, size_t numThreads);
+  ~WorkerPool();
+  size_t GetNumThreads() const {return mThreads.size() + 1;};
+  void Run();
+private:
+  tmNLCO_alm* mOwner;          // whose chunks we run
+  vector<thread> mThreads;      // the helpers, chunks 1..n-1
+  mutex mMutex;                 // guards everything below
+  condition_variable mWake;     // signals helpers that a run has started
+  condition_variable mDone;     // signals the caller that the helpers are done
+  size_t mGeneration;           // number of runs started
+  size_t mNumBusy;              // helpers still working on this run
+  bool mQuit;                   // true when the helpers should exit
+  exception_ptr mError;         // first exception thrown by a helper
+  
+  void Work(size_t k);
+};
+
+
+/*****
+Constructor. Start numThreads - 1 helpers, which wait for Run().
+*****/
+tmNLCO_alm::WorkerPool::WorkerPool(tmNLCO_alm* owner, size_t numThreads)
+  : mOwner(owner), mGeneration(0), mNumBusy(0), mQuit(false)
+{
+  TMASSERT(numThreads > 1);
+  for (size_t k = 1; k < numThreads; ++k)
+    mThreads.push_back(thread(&WorkerPool::Work, this, k));
+}
+
+
+/*****
+Destructor. Tell the helpers to quit and wait for them.
+*****/
+tmNLCO_alm::WorkerPool::~WorkerPool()
+{
+  {
+    lock_guard<mutex> lock(mMutex);
+    mQuit = true;
+  }
+  mWake.notify_all();
+  for (size_t k = 0; k < mThreads.size(); ++k) mThreads[k].join();
+}
+
+
+/*****
+Run every chunk of the owner and return when all are finished. An exception
+thrown by any chunk is passed on to the caller.
+*****/
+void tmNLCO_alm::WorkerPool::Run()
+{
+  {
+    lock_guard<mutex> lock(mMutex);
+    ++mGeneration;
+    mNumBusy = mThreads.size();
+    mError = exception_ptr();
+  }
+  mWake.notify_all();
+  exception_ptr error;
+  try {
+    mOwner->RunChunk(0);
+  }
+  catch (...) {
+    error = current_exception();
+  }
+  {
+    unique_lock<mutex> lock(mMutex);
+    while (mNumBusy != 0) mDone.wait(lock);
+    if (!error) error = mError;
+  }
+  if (error) rethrow_exception(error);
+}
+
+
+/*****
+Body of helper thread k. Run chunk k once per generation until told to quit.
+*****/
+void tmNLCO_alm::WorkerPool::Work(size_t k)
+{
+  size_t seen = 0;
+  for (;;) {
+    {
+      unique_lock<mutex> lock(mMutex);
+      while (!mQuit && mGeneration == seen) mWake.wait(lock);
+      if (mQuit) return;
+      seen = mGeneration;
+    }
+    exception_ptr error;
+    try {
+      mOwner->RunChunk(k);
+    }
+    catch (...) {
+      error = current_exception();
+    }
+    lock_guard<mutex> lock(mMutex);
+    if (error && !mError) mError = error;
+    if (--mNumBusy == 0) mDone.notify_one();
+  }
+}
+
+
 /**********
 class tmNLCO_alm
 Nonlinear constrained optimizer using the Augmented Lagrangian Multiplier method
 **********/
 
+/*****
+Static member initialization. By default we evaluate constraints serially.
+*****/
+size_t tmNLCO_alm::sNumThreads = 1;
+
+
 /*****
 Constructor
 *****/
 tmNLCO_alm::tmNLCO_alm()
-  : mNumBnds(0), mWeight(0), mObjective(NULL)
+  : mNumBnds(0), mWeight(0), mObjective(NULL), mCacheValid(false),
+  mCacheObjective(0), mPool(NULL), mTaskX(NULL), mTaskCached(false),
+  mTaskGrad(false), mHaveBest(false), mBestObjective(0)
 {
 }
 
 
 /*****
-Destructor. Destroy owned constraint functions.
+Destructor. Stop the helper threads and destroy owned constraint functions.
 *****/
 tmNLCO_alm::~tmNLCO_alm()
 {
+  delete mPool;
   if (mObjective) delete mObjective;
   for (size_t i = 0; i < mEqns.size(); ++i) delete mEqns[i];
   for (size_t i = 0; i < mIneqns.size(); ++i) delete mIneqns[i];
@@ -134,6 +266,30 @@ size_t tmNLCO_alm::GetNumInequalities()
 }
 
 
+/*****
+Return the number of threads that optimizers created from now on will use to
+evaluate constraints; 0 means one per hardware thread.
+*****/
+size_t tmNLCO_alm::GetNumThreads()
+{
+  return sNumThreads;
+}
+
+
+/*****
+Set the number of threads used to evaluate constraints by optimizers created
+from now on. 1 (the default) evaluates them serially; 0 uses one thread per
+hardware thread. With more than one thread, the gradient is summed in a fixed
+order that depends only on the number of threads and constraints, so repeated
+runs with the same setting give identical results, although these can differ
+in the last bits from the serial results.
+*****/
+void tmNLCO_alm::SetNumThreads(size_t numThreads)
+{
+  sNumThreads = numThreads;
+}
+
+
 /*****
 Record lower and upper bounds in member variables
 *****/
@@ -168,10 +324,30 @@ void tmNLCO_alm::ObjectiveUpdateUI()
 
 /*****
 Find the constrained minimum, starting with the value x and returning the
-optimum in the variable x.
+optimum in the variable x. If we have a budget and it runs out, we return the
+feasible point with the lowest objective that we've seen, or
+ERROR_BUDGET_EXPIRED if we haven't seen one.
 *****/
 int tmNLCO_alm::Minimize(vector<double>& x)
 {
+  mHaveBest = false;
+  try {
+    return MinimizeALM(x);
+  }
+  catch (EX_BUDGET_EXPIRED&) {
+    if (!mHaveBest) return ERROR_BUDGET_EXPIRED;
+    x = mBestX;
+    return 0;
+  }
+}
+
+
+/*****
+The outer loop of the ALM method, which does the work of Minimize().
+*****/
+int tmNLCO_alm::MinimizeALM(vector<double>& x)
+{
+  TM_PROFILE_SCOPE("tmNLCO_alm::Minimize");
   TMASSERT(mSize != 0);
   TMASSERT(x.size() == mSize);
   TMASSERT(mObjective != 0);
@@ -179,16 +355,20 @@ int tmNLCO_alm::Minimize(vector<double>& x)
   const double WEIGHT_START = 10;      // initial penalty weight
   const double WEIGHT_RATIO = 10;      // growth rate of penalty
   const double WEIGHT_MAX = 1e8;      // maximum penalty weight
-  const double TOL_FEAS = 1.0e-5;      // tolerance on feasibility
   const double TOL_F = 1.0e-5;      // tolerance on objective function value
   const double ITER_OUTER_MAX = 50;    // maximum number of outer iterations
   
   size_t ne = mEqns.size();
   size_t ni = mIneqns.size();
   
-  // Initialize Lagrangian multipliers. Note: mNumBnds = 0 if we haven't set
-  // bounds, = mSize if we have.
-  mLagMul.assign(ne + ni + 2 * mNumBnds, 0.);
+  // Don't trust any values left over from a previous call.
+  mCacheValid = false;
+  SetUpThreads();
+  
+  // Initialize Lagrangian multipliers. The bounds don't get any; the inner
+  // minimization keeps x within them directly, starting here.
+  mLagMul.assign(ne + ni, 0.);
+  ProjectOntoBounds(x);
   
   // Set the maximum step size for line searches to be the space diagonal of
   // the mNumBnds-dimensional box defined by the upper and lower bounds.
@@ -203,10 +383,17 @@ int tmNLCO_alm::Minimize(vector<double>& x)
   size_t iter_outer = 1;
   mWeight = WEIGHT_START;
   double fval_old = 1.e30;
+  mNumIterations = 0;
   while (iter_outer < ITER_OUTER_MAX) {
+    TM_PROFILE_SCOPE("ALM outer iteration");
+    mNumIterations = iter_outer;
     size_t iter_inner = 0;
     double f_alm;
     MinimizeAugLag(x, iter_inner, f_alm);
+    
+    // The inner loop has almost always just evaluated everything at x, in
+    // which case this costs nothing.
+    EvalAtPoint(x);
   
 #if USE_WORST_CASE_FEASIBILITY
     // Compute feasibility, using worst-case feasibility. At the same time,
@@ -215,38 +402,20 @@ int tmNLCO_alm::Minimize(vector<double>& x)
     double feas = 0;
     // Go through equalities.
     for (size_t i = 0; i < ne; ++i) {
-      double f = mEqns[i]->Func(x);
+      double f = mCacheEqns[i];
       feas = MAX(feas, fabs(f));
       double& lm = mLagMul[i];
       lm += 2 * mWeight * f;
     }
     // Go through inequalities.
     for (size_t i = 0; i < ni; ++i) {
-      double f = mIneqns[i]->Func(x);
+      double f = mCacheIneqns[i];
       if (f > 0) feas = MAX(feas, f);
       double& lm = mLagMul[i + ne];
       double mu = -0.5 * lm / mWeight;
       if (f < mu) lm = 0;
       else lm += 2 * mWeight * f;
     };
-    // Go through lower bounds.
-    for (size_t i = 0; i < mNumBnds; ++i) {
-      double f = mbl[i] - x[i];
-      if (f > 0) feas = MAX(feas, f);
-      double& lm = mLagMul[i + ne + ni];
-      double mu = -0.5 * lm / mWeight;
-      if (f < mu) lm = 0;
-      else lm += 2 * mWeight * f;
-    }
-    // go through upper bounds.
-    for (size_t i = 0; i < mNumBnds; ++i) {
-      double f = x[i] - mbu[i];
-      if (f > 0) feas = MAX(feas, f);
-      double& lm = mLagMul[i + ne + ni + mNumBnds];
-      double mu = -0.5 * lm / mWeight;
-      if (f < mu) lm = 0;
-      else lm += 2 * mWeight * f;
-    }
 #else
     // Compute feasibility, using summed absolute value of feasibility. At the
     // same time, we'll update the values of the Lagrangian multipliers in
@@ -254,41 +423,23 @@ int tmNLCO_alm::Minimize(vector<double>& x)
     double feas = 0;
     // Go through equalities.
     for (size_t i = 0; i < ne; ++i) {
-      double f = mEqns[i]->Func(x);
+      double f = mCacheEqns[i];
       feas += fabs(f);
       double& lm = mLagMul[i];
       lm += 2 * mWeight * f;
     }
     // Go through inequalities.
     for (size_t i = 0; i < ni; ++i) {
-      double f = mIneqns[i]->Func(x);
+      double f = mCacheIneqns[i];
       if (f > 0) feas += f;
       double& lm = mLagMul[i + ne];
       double mu = -0.5 * lm / mWeight;
       if (f < mu) lm = 0;
       else lm += 2 * mWeight * f;
     };
-    // Go through lower bounds.
-    for (size_t i = 0; i < mNumBnds; ++i) {
-      double f = mbl[i] - x[i];
-      if (f > 0) feas += f;
-      double& lm = mLagMul[i + ne + ni];
-      double mu = -0.5 * lm / mWeight;
-      if (f < mu) lm = 0;
-      else lm += 2 * mWeight * f;
-    }
-    // go through upper bounds.
-    for (size_t i = 0; i < mNumBnds; ++i) {
-      double f = x[i] - mbu[i];
-      if (f > 0) feas += f;
-      double& lm = mLagMul[i + ne + ni + mNumBnds];
-      double mu = -0.5 * lm / mWeight;
-      if (f < mu) lm = 0;
-      else lm += 2 * mWeight * f;
-    }
 #endif
     // Get the value of the objective function (NOT the same as f_alm).
-    double fval = mObjective->Func(x);
+    double fval = mCacheObjective;
 
 #if DEBUG_SHOW_PROGRESS
     stringstream info;
@@ -345,10 +496,17 @@ int tmNLCO_alm::Minimize(vector<double>& x)
 
 
 /*****
-Minimize the Augmented Lagrangian.
+Minimize the Augmented Lagrangian within the bounds.
 x == The starting point and the returned position of the minimum
 iter_inner == the number of iterations that were performed
 f_min == the returned minimum value of the function
+
+This is a projected quasi-Newton method. A variable that sits on a bound with
+the gradient pushing it outward is held there: it gets no share of the search
+direction, and the other variables are searched with the quasi-Newton
+direction of the gradient without it. The line search then follows the
+projection of the search direction onto the box, so every point we try is
+within the bounds.
 *****/
 void tmNLCO_alm::MinimizeAugLag(vector<double>& x, size_t &iter_inner, 
   double &f_min)
@@ -360,25 +518,28 @@ void tmNLCO_alm::MinimizeAugLag(vector<double>& x, size_t &iter_inner,
   const double TOL_X = 4 * EPS;
   const double TOL_G = 1.0e-5;
 
-  // Calculate starting function value and gradient.
-  f_min = AugLagFn(x);
-  tmCheckNaN(f_min);
+  // Calculate starting gradient and function value. Taking the gradient first
+  // lets it evaluate the functions and their gradients together; the function
+  // value then comes straight from the cache.
   vector<double> g(mSize);
   AugLagGrad(x, g);
   tmCheckNaN(g);
+  f_min = AugLagFn(x);
+  tmCheckNaN(f_min);
   
   // Initialize the inverse Hessian matrix and the search direction.
-  tmMatrix<double> hess_inv(mSize, mSize);
-  vector<double> srch_dir(mSize);
+  tmMatrix<double> hess_inv(mSize, mSize, 0.0);
+  vector<double> srch_dir(mSize), g_free(mSize);
   for (size_t i = 0; i < mSize; ++i) {
-    for (size_t j = 0; j < mSize; ++j) hess_inv[i][j] = 0.0;
     hess_inv[i][i] = 1.0;
-    srch_dir[i] = -g[i];
+    g_free[i] = IsHeld(x, g, i) ? 0.0 : g[i];
+    srch_dir[i] = -g_free[i];
   }
 
   // Enter the main iteration loop.
   vector<double> x_new(mSize), dg(mSize), hdg(mSize);
   for (size_t iter = 1; iter <= ITER_INNER_MAX; ++iter) {
+    TM_PROFILE_SCOPE("ALM inner iteration");
     iter_inner = iter;
     LineSearchAugLag(x, f_min, g, srch_dir, x_new, f_min);
     
@@ -402,22 +563,24 @@ void tmNLCO_alm::MinimizeAugLag(vector<double>& x, size_t &iter_inner,
     AugLagGrad(x, g);
     tmCheckNaN(g);
     
-    // Test for convergence on zero gradient
+    // Test for convergence on zero gradient, ignoring the components that
+    // push held variables against their bounds.
     double gtest = 0.0;
     double den = MAX(f_min, 1.0);
     for (size_t i = 0; i < mSize; ++i) {
-      double gtemp = fabs(g[i]) * MAX(fabs(x[i]), 1.0) / den;
+      g_free[i] = IsHeld(x, g, i) ? 0.0 : g[i];
+      double gtemp = fabs(g_free[i]) * MAX(fabs(x[i]), 1.0) / den;
       if (gtemp > gtest) gtest = gtemp;
     }
     if (gtest < TOL_G) return;
     
     // Compute the difference between the previous and new gradient and
-    // its product with the current inverse Hessian matrix.
-    for (size_t i = 0; i < mSize; ++i) dg[i] = g[i] - dg[i];
-    for (size_t i = 0; i < mSize; ++i) {
-      hdg[i] = 0.0;
-      for (size_t j = 0; j < mSize; ++j) hdg[i] += hess_inv[i][j] * dg[j];
-    }
+    // its product with the current inverse Hessian matrix. A held variable
+    // doesn't move, and the change in its gradient is the push of the bound
+    // rather than curvature we can use, so we leave it out.
+    for (size_t i = 0; i < mSize; ++i) 
+      dg[i] = IsHeld(x, g, i) ? 0.0 : g[i] - dg[i];
+    tmSymmetricMultiply(hess_inv, &dg[0], &hdg[0]);
     
     // Calculate dot products used in denominators
     double fac(0.0), fae(0.0), sumdg(0.0), sumxi(0.0);
@@ -437,21 +600,14 @@ void tmNLCO_alm::MinimizeAugLag(vector<double>& x, size_t &iter_inner,
       tmCheckNaN(fad);
       for (size_t i = 0; i < mSize; ++i) 
         dg[i] = fac * srch_dir[i] - fad * hdg[i];
-      for (size_t i = 0; i < mSize; ++i) {
-        for (size_t j = i; j < mSize; ++j) {
-          hess_inv[i][j] += fac * srch_dir[i] * srch_dir[j] - 
-            fad * hdg[i] * hdg[j] + fae * dg[i] * dg[j];
-          hess_inv[j][i] = hess_inv[i][j];
-        }
-      }
+      tmBFGSUpdate(hess_inv, &srch_dir[0], &hdg[0], &dg[0], fac, fad, fae);
     }
     
-    // Finally, calculate the next search direction
-    for (size_t i = 0; i < mSize; ++i) {
-      srch_dir[i] = 0.0;
-      for (size_t j = 0; j < mSize; ++j) 
-        srch_dir[i] -= hess_inv[i][j] * g[j];
-    }
+    // Finally, calculate the next search direction, which leaves the held
+    // variables where they are.
+    tmSymmetricMultiply(hess_inv, &g_free[0], &srch_dir[0]);
+    for (size_t i = 0; i < mSize; ++i)
+      srch_dir[i] = IsHeld(x, g, i) ? 0.0 : -srch_dir[i];
   }
   // If we ended the loop without returning, we've exceeded the number of
   // iterations. Since our outer loop will try again, we can just keep going.
@@ -459,7 +615,8 @@ void tmNLCO_alm::MinimizeAugLag(vector<double>& x, size_t &iter_inner,
 
 
 /*****
-Perform a minimization of the Augmented Lagrangian along a line.
+Perform a minimization of the Augmented Lagrangian along a line, or rather,
+along its projection onto the bounds.
 x_old = the previous location
 f_old = the previous value of the function at x_old
 g_old = the previous value of the gradient (at x_old)
@@ -497,7 +654,11 @@ void tmNLCO_alm::LineSearchAugLag(const vector<double>& x_old,
     slope += g_old[i] * srch_dir[i];
 
   // TBD, better check?
-  if (slope >= 0.0) return;
+  if (slope >= 0.0) {
+    x_new = x_old;
+    f_new = f_old;
+    return;
+  }
 
   // Compute the minimum step length
   double lmtest = 0.0;
@@ -514,9 +675,12 @@ void tmNLCO_alm::LineSearchAugLag(const vector<double>& x_old,
   double lm_2 = 0.0;
   double f_new_2 = 0.0;
   for (;;) {
-    // Take a step along the search direction from our initial starting point.
+    // Take a step along the search direction from our initial starting point
+    // and bring it back within the bounds.
     for (size_t i = 0; i < mSize; ++i) x_new[i] = x_old[i] + lm * srch_dir[i];
+    ProjectOntoBounds(x_new);
     f_new = AugLagFn(x_new);
+    TM_PROFILE_COUNT("ALM line search steps", 1);
     
     // If the step size is smaller than our minimum tolerance, we're done.
     // Copy the old value into the return value and return.
@@ -526,8 +690,12 @@ void tmNLCO_alm::LineSearchAugLag(const vector<double>& x_old,
     };
     
     // If the function value has decreased sufficiently with this step,
-    // we're done.
-    double f_tobeat = f_old + ALF * lm * slope;
+    // we're done. The decrease we expect comes from the step we actually
+    // took, which the bounds may have cut short.
+    double step_slope = 0.0;
+    for (size_t i = 0; i < mSize; ++i) 
+      step_slope += g_old[i] * (x_new[i] - x_old[i]);
+    double f_tobeat = f_old + ALF * step_slope;
     if (f_new <= f_tobeat) return;
     
     // But if not, then we'll have to backtrack. Compute a backtrack step.
@@ -567,34 +735,19 @@ double tmNLCO_alm::AugLagFn(const vector<double>& x)
   size_t ni = mIneqns.size();
 
   // Compute objective function value
-  double fret = mObjective->Func(x);
+  EvalAtPoint(x);
+  double fret = mCacheObjective;
 
   // Accumulate contributions from equality constraints
   for (size_t i = 0; i < ne; ++i) {
-    tmDifferentiableFn* eqn = mEqns[i];
     const double& lm = mLagMul[i];
-    double f = eqn->Func(x);
+    double f = mCacheEqns[i];
     fret += (lm + f * mWeight) * f;
   }
   // Contributions from inequality constraints
   for (size_t i = 0; i < ni; ++i) {
-    tmDifferentiableFn* ineqn = mIneqns[i];
     const double& lm = mLagMul[i + ne];
-    double f = ineqn->Func(x);
-    double mu = -0.5 * lm / mWeight;
-    fret += (f < mu) ? mu : (lm + f * mWeight) * f;
-  }
-  // Contributions from lower bounds
-  for (size_t i = 0; i < mNumBnds; ++i) {
-    const double& lm = mLagMul[i + ne + ni];
-    double f = mbl[i] - x[i];
-    double mu = -0.5 * lm / mWeight;
-    fret += (f < mu) ? mu : (lm + f * mWeight) * f;
-  }
-  // Contributions from upper bounds
-  for (size_t i = 0; i < mNumBnds; ++i) {
-    const double& lm = mLagMul[i + ne + ni + mNumBnds];
-    double f = x[i] - mbu[i];
+    double f = mCacheIneqns[i];
     double mu = -0.5 * lm / mWeight;
     fret += (f < mu) ? mu : (lm + f * mWeight) * f;
   }
@@ -612,71 +765,275 @@ void tmNLCO_alm::AugLagGrad(const vector<double>& x, vector<double>& g)
   // A couple of useful numbers to have on hand
   size_t ne = mEqns.size();
   size_t ni = mIneqns.size();
-  const double tol_lm = 4.0 * numeric_limits<double>::epsilon();
 
-  // Create a scratch pad for individual constraint gradients
-  static vector<double> gscr;
-  gscr.resize(mSize);
-  
+  // If we haven't seen this point yet, evaluate the functions here and record
+  // their values as we go. Then wherever we're (nearly) sure to need a
+  // gradient too, we can get value and gradient from a single call.
+  bool cached = IsCached(x);
+  if (!cached) {
+    mCacheValid = false;
+    mCacheEqns.resize(ne);
+    mCacheIneqns.resize(ni);
+  }
+
   // compute gradient of objective
-  mObjective->Grad(x, g);
+  if (cached) mObjective->Grad(x, g);
+  else mCacheObjective = mObjective->FuncGrad(x, g);
   tmCheckNaN(g);
 
-  // Accumulate contributions from equality constraints.
-  for (size_t i = 0; i < ne; ++i) {
+  // Accumulate contributions from the constraints. In parallel, each chunk
+  // sums its own share, and we add up the shares in order.
+  if (mPool) {
+    mTaskX = &x;
+    mTaskCached = cached;
+    mTaskGrad = true;
+    mPool->Run();
+    for (size_t k = 0; k < mChunks.size(); ++k) {
+      const vector<double>& gk = mChunks[k].mGrad;
+      for (size_t j = 0; j < mSize; ++j) g[j] += gk[j];
+    }
+  }
+  else {
+    // Serially, one scratch pad for individual constraint gradients will do;
+    // one per thread, since several optimizers may run at once.
+    static thread_local vector<double> gscr;
+    gscr.resize(mSize);
+    AccumulateConstraintGrads(x, cached, 0, ne + ni, g, gscr);
+  }
+  
+  if (!cached) {
+    mCacheX = x;
+    mCacheValid = true;
+    ChargeBudget();
+  }
+}
+
+
+/*****
+Move each component of x that's outside its bounds onto the nearer bound.
+*****/
+void tmNLCO_alm::ProjectOntoBounds(vector<double>& x) const
+{
+  for (size_t i = 0; i < mNumBnds; ++i) {
+    if (x[i] < mbl[i]) x[i] = mbl[i];
+    else if (x[i] > mbu[i]) x[i] = mbu[i];
+  }
+}
+
+
+/*****
+Return true if variable i is on one of its bounds and the gradient g pushes it
+outward, so that the inner minimization should hold it there.
+*****/
+bool tmNLCO_alm::IsHeld(const vector<double>& x, const vector<double>& g,
+  size_t i) const
+{
+  if (i >= mNumBnds) return false;
+  return (x[i] <= mbl[i] && g[i] > 0) || (x[i] >= mbu[i] && g[i] < 0);
+}
+
+
+/*****
+Return true if the cached objective and constraint values were computed at x.
+*****/
+bool tmNLCO_alm::IsCached(const vector<double>& x) const
+{
+  return mCacheValid && x == mCacheX;
+}
+
+
+/*****
+Make sure the cache holds the objective and constraint values at x, evaluating
+them if it doesn't already. Every point the line search tries gets evaluated
+through here, and the accepted one is usually the last one tried; so the
+gradient and the feasibility check that follow it find their values waiting.
+*****/
+void tmNLCO_alm::EvalAtPoint(const vector<double>& x)
+{
+  if (IsCached(x)) return;
+  mCacheValid = false;
+  size_t ne = mEqns.size();
+  size_t ni = mIneqns.size();
+  mCacheObjective = mObjective->Func(x);
+  mCacheEqns.resize(ne);
+  mCacheIneqns.resize(ni);
+  if (mPool) {
+    mTaskX = &x;
+    mTaskGrad = false;
+    mPool->Run();
+  }
+  else EvalConstraints(x, 0, ne + ni);
+  mCacheX = x;
+  mCacheValid = true;
+  ChargeBudget();
+}
+
+
+/*****
+Return the infeasibility of the cached point, measured the same way as in the
+outer loop of Minimize(), except that a value that isn't a number makes it not
+a number too.
+*****/
+double tmNLCO_alm::GetCachedFeasibility() const
+{
+  double feas = 0;
+  for (size_t i = 0; i < mCacheEqns.size(); ++i) {
+    double f = fabs(mCacheEqns[i]);
+#if USE_WORST_CASE_FEASIBILITY
+    if (!(f <= feas)) feas = f;
+#else
+    feas += f;
+#endif
+  }
+  for (size_t i = 0; i < mCacheIneqns.size(); ++i) {
+    double f = mCacheIneqns[i];
+    if (!(f <= 0)) {
+#if USE_WORST_CASE_FEASIBILITY
+      if (!(f <= feas)) feas = f;
+#else
+      feas += f;
+#endif
+    }
+  }
+  return feas;
+}
+
+
+/*****
+Called each time the cache gets a new point. If we have a budget, remember the
+point if it's the best feasible one yet, charge for it, and bail out of the
+minimization if that used up the budget.
+*****/
+void tmNLCO_alm::ChargeBudget()
+{
+  if (!mBudget) return;
+  if (mBudget->IsLimited() && isfinite(mCacheObjective) &&
+    GetCachedFeasibility() < TOL_FEAS &&
+    (!mHaveBest || mCacheObjective < mBestObjective)) {
+    mBestX = mCacheX;
+    mBestObjective = mCacheObjective;
+    mHaveBest = true;
+  }
+  if (mBudget->Charge()) throw EX_BUDGET_EXPIRED();
+}
+
+
+
+/*****
+Decide how many threads to use for this problem and start them, or stop them
+if we're going to be serial.
+*****/
+void tmNLCO_alm::SetUpThreads()
+{
+  size_t nc = mEqns.size() + mIneqns.size();
+  size_t nt = sNumThreads;
+  if (nt == 0) nt = thread::hardware_concurrency();
+  if (nt > nc / MIN_CONSTRAINTS_PER_THREAD) nt = nc / MIN_CONSTRAINTS_PER_THREAD;
+  if (nt < 2) {
+    delete mPool;
+    mPool = NULL;
+    mChunks.clear();
+    return;
+  }
+  if (!mPool || mPool->GetNumThreads() != nt) {
+    delete mPool;
+    mPool = new WorkerPool(this, nt);
+  }
+  mChunks.resize(nt);
+  for (size_t k = 0; k < nt; ++k) {
+    mChunks[k].mBegin = k * nc / nt;
+    mChunks[k].mEnd = (k + 1) * nc / nt;
+    mChunks[k].mScratch.resize(mSize);
+  }
+}
+
+
+/*****
+Evaluate chunk k at mTaskX: its values if mTaskGrad is false, its share of the
+gradient (and values, if not cached) if it's true. Called from the helper
+threads, so it touches nothing but its own chunk and its own constraints.
+*****/
+void tmNLCO_alm::RunChunk(size_t k)
+{
+  Chunk& c = mChunks[k];
+  if (mTaskGrad) {
+    c.mGrad.assign(mSize, 0.);
+    AccumulateConstraintGrads(*mTaskX, mTaskCached, c.mBegin, c.mEnd, c.mGrad,
+      c.mScratch);
+  }
+  else EvalConstraints(*mTaskX, c.mBegin, c.mEnd);
+}
+
+
+/*****
+Evaluate constraints begin to end - 1 at x into the cache. Constraints are
+numbered with the equalities first, then the inequalities.
+*****/
+void tmNLCO_alm::EvalConstraints(const vector<double>& x, size_t begin,
+  size_t end)
+{
+  size_t ne = mEqns.size();
+  for (size_t i = begin; i < end && i < ne; ++i)
+    mCacheEqns[i] = mEqns[i]->Func(x);
+  for (size_t i = MAX(begin, ne); i < end; ++i)
+    mCacheIneqns[i - ne] = mIneqns[i - ne]->Func(x);
+}
+
+
+/*****
+Add the gradient contributions of constraints begin to end - 1 at x to g,
+using gscr as scratch. If cached is false, also record their values.
+*****/
+void tmNLCO_alm::AccumulateConstraintGrads(const vector<double>& x, 
+  bool cached, size_t begin, size_t end, vector<double>& g, 
+  vector<double>& gscr)
+{
+  size_t ne = mEqns.size();
+  const double tol_lm = 4.0 * numeric_limits<double>::epsilon();
+
+  // Equality constraints. These are nearly always active, so on a fresh point
+  // we fetch each gradient along with the value.
+  for (size_t i = begin; i < end && i < ne; ++i) {
     tmDifferentiableFn* eqn = mEqns[i];
     const double& lm = mLagMul[i];
-    double f = eqn->Func(x);
+    bool haveGrad = !cached;
+    double f = cached ? mCacheEqns[i] : 
+      (mCacheEqns[i] = eqn->FuncGrad(x, gscr));
     tmCheckNaN(f);
     double gmul = lm + 2 * f * mWeight;
     if (fabs(gmul) > tol_lm) {
-      eqn->Grad(x, gscr);
+      if (!haveGrad) eqn->Grad(x, gscr);
       tmCheckNaN(gscr);
       for (size_t j = 0; j < mSize; ++j) 
         g[j] += gmul * gscr[j];
     }
   }
-  // Contributions from inequality constraints
-  for (size_t i = 0; i < ni; ++i) {
+  // Inequality constraints. An inequality with a nonzero multiplier was
+  // active last time around and most likely still is.
+  for (size_t ii = MAX(begin, ne); ii < end; ++ii) {
+    size_t i = ii - ne;
     tmDifferentiableFn* ineqn = mIneqns[i];
-    const double& lm = mLagMul[i + ne];
-    double f = ineqn->Func(x);
+    const double& lm = mLagMul[ii];
+    bool haveGrad = false;
+    double f;
+    if (cached) f = mCacheIneqns[i];
+    else if (lm != 0) {
+      f = mCacheIneqns[i] = ineqn->FuncGrad(x, gscr);
+      haveGrad = true;
+    }
+    else f = mCacheIneqns[i] = ineqn->Func(x);
     tmCheckNaN(f);
     double mu = -0.5 * lm / mWeight;
     if (f >= mu) {
       double gmul = lm + 2 * f * mWeight;
       if (fabs(gmul) > tol_lm) {
-        ineqn->Grad(x, gscr);
+        if (!haveGrad) ineqn->Grad(x, gscr);
         tmCheckNaN(gscr);
         for (size_t j = 0; j < mSize; ++j) 
           g[j] += gmul * gscr[j];
       }
     }
   }
-  // Contributions from lower bounds
-  for (size_t i = 0; i < mNumBnds; ++i) {
-    const double& lm = mLagMul[i + ne + ni];
-    double f = mbl[i] - x[i];
-    double mu = -0.5 * lm / mWeight;
-    if (f >= mu) {
-      double gmul = lm + 2 * f * mWeight;
-      if (fabs(gmul) > tol_lm) {
-        g[i] -= gmul;
-      }
-    }
-  }
-  // Contributions from upper bounds
-  for (size_t i = 0; i < mNumBnds; ++i) {
-    const double& lm = mLagMul[i + ne + ni + mNumBnds];
-    double f = x[i] - mbu[i];
-    double mu = -0.5 * lm / mWeight;
-    if (f >= mu) {
-      double gmul = lm + 2 * f * mWeight;
-      if (fabs(gmul) > tol_lm) {
-        g[i] += gmul;
-      }
-    }
-  }
 }
 
 #endif // tmUSE_ALM
@@ -21,7 +21,8 @@ class tmNLCO_alm : public virtual tmNLCO {
 public:
   // Reasons for abnormal termination
   enum {
-    ERROR_TOO_MANY_ITERATIONS = 1
+    ERROR_TOO_MANY_ITERATIONS = 1,
+    ERROR_BUDGET_EXPIRED = 2
   };
 
   tmNLCO_alm();
@@ -42,7 +43,28 @@ public:
   
   void ObjectiveUpdateUI();
   
+  // Number of threads used to evaluate the constraints
+  static std::size_t GetNumThreads();
+  static void SetNumThreads(std::size_t numThreads);
+  
 private:
+  class WorkerPool;
+  
+  // Exception thrown from within an evaluation when the budget runs out
+  class EX_BUDGET_EXPIRED {
+  };
+  
+  // A contiguous range of constraints evaluated by one thread, along with that
+  // thread's share of the gradient and its scratch pad
+  struct Chunk {
+    std::size_t mBegin;              // first constraint, equalities first
+    std::size_t mEnd;                // one past the last constraint
+    std::vector<double> mGrad;        // contribution to the gradient
+    std::vector<double> mScratch;      // individual constraint gradients
+  };
+  
+  static std::size_t sNumThreads;      // threads to use, 0 = one per core
+
   std::size_t mNumBnds;            // number of points we're optimizing
   std::vector<double> mbl;          // lower bound
   std::vector<double> mbu;          // upper bound
@@ -52,13 +74,43 @@ private:
   std::vector<tmDifferentiableFn*> mEqns;    // equality constraints
   std::vector<tmDifferentiableFn*> mIneqns;  // inequality constraints
   double mMaxStep;              // maximum step size in line searches
+  bool mCacheValid;              // true if the values below are current
+  std::vector<double> mCacheX;        // point of the last evaluation
+  double mCacheObjective;            // objective value at mCacheX
+  std::vector<double> mCacheEqns;      // equality values at mCacheX
+  std::vector<double> mCacheIneqns;    // inequality values at mCacheX
+  WorkerPool* mPool;              // helper threads, or NULL if serial
+  std::vector<Chunk> mChunks;          // one per thread of mPool
+  const std::vector<double>* mTaskX;    // point the chunks are evaluated at
+  bool mTaskCached;              // true if the values at mTaskX are cached
+  bool mTaskGrad;                // true to compute gradients, not just values
+  bool mHaveBest;                // true if we've seen a feasible point
+  std::vector<double> mBestX;        // best feasible point seen
+  double mBestObjective;            // objective value at mBestX
+  
+  void SetUpThreads();
+  void RunChunk(std::size_t k);
+  void EvalConstraints(const std::vector<double>& x, std::size_t begin,
+    std::size_t end);
+  void AccumulateConstraintGrads(const std::vector<double>& x, bool cached,
+    std::size_t begin, std::size_t end, std::vector<double>& g,
+    std::vector<double>& gscr);
+  
+  bool IsCached(const std::vector<double>& x) const;
+  void EvalAtPoint(const std::vector<double>& x);
+  double GetCachedFeasibility() const;
+  void ChargeBudget();
   
+  int MinimizeALM(std::vector<double>& x);
   void MinimizeAugLag(std::vector<double>& x, std::size_t &iter, double &f_min);
   void LineSearchAugLag(const std::vector<double>& x_old, const double f_old, 
     const std::vector<double>& g_old, std::vector<double>& srch_dir, 
     std::vector<double>& x_new, double &f_new);
   double AugLagFn(const std::vector<double>& x);
   void AugLagGrad(const std::vector<double>& x, std::vector<double>& gradx);
+  void ProjectOntoBounds(std::vector<double>& x) const;
+  bool IsHeld(const std::vector<double>& x, const std::vector<double>& g,
+    std::size_t i) const;
 
 };
 
@@ -12,6 +12,7 @@ Copyright:    ©2004 Robert J. Lang. All Rights Reserved.
 #include "tmNLCO.h"
 #ifdef tmUSE_WNLIB
 #include "tmNLCO_wnlib.h"
+#include "tmProfiler.h"
 extern "C" { 
 #include "wnnlp.h" 
 #include "wnmem.h" 
@@ -236,6 +237,7 @@ WN_UNBOUNDED = -2 = function is unbounded
 *****/
 int tmNLCO_wnlib::Minimize(vector<double>& x)
 {
+  TM_PROFILE_SCOPE("tmNLCO_wnlib::Minimize");
   TMASSERT(mSize != 0);     // make sure we've set the size
   TMASSERT(objective != 0);     // and that we've set an objective
   wn_nlp_verbose = 0;       // don't print any status information
@@ -0,0 +1,116 @@
+/*******************************************************************************
+File:         tmAutoDiffFn.h
+Project:      TreeMaker 5.x
+Purpose:      Header file for constraint functions with automatic gradients
+Author:       Robert J. Lang
+Modified by:
+Created:      2026-10-19
+Copyright:    ©2026 Robert J. Lang. All Rights Reserved.
+*******************************************************************************/
+
+#ifndef _TMAUTODIFFFN_H_
+#define _TMAUTODIFFFN_H_
+
+#include "tmNLCO.h"
+#include "tmDual.h"
+
+#include <algorithm>
+
+/*
+Class tmAutoDiffFn<F, N> is a tmDifferentiableFn whose gradient is computed by
+forward-mode automatic differentiation (see tmDual.h). A constraint function
+that depends on N of the optimizer's variables derives from it as
+
+  class MyFn : public tmAutoDiffFn<MyFn, N> {
+  public:
+    MyFn(...) {mVars[0] = ...; ...}  // where each argument lives in u
+    template <class T>
+    T Eval(const T* x) const {...}   // the function of x[0] .. x[N - 1]
+  };
+
+and writes the function only once, in Eval(). Func() evaluates it on doubles;
+Grad() and FuncGrad() evaluate it on tmDual<N>s and scatter the N partial
+derivatives into the full gradient vector. Everything is resolved at compile
+time, so there's no virtual call or heap allocation per evaluation.
+
+If two of the mVars entries coincide, their derivatives are summed, which is
+the right answer.
+*/
+
+/**********
+class tmAutoDiffFn<F, N>
+Differentiable function of N variables, defined by F::Eval()
+**********/
+template <class F, std::size_t N>
+class tmAutoDiffFn : public tmDifferentiableFn {
+public:
+  double Func(const std::vector<double>& u);
+  void Grad(const std::vector<double>& u, std::vector<double>& du);
+  double FuncGrad(const std::vector<double>& u, std::vector<double>& du);
+  bool GetVariables(std::vector<std::size_t>& vars) const {
+    vars.assign(mVars, mVars + N);
+    return true;};
+protected:
+  std::size_t mVars[N];   // offsets in u of the arguments of Eval()
+private:
+  const F& Self() const {return *static_cast<const F*>(this);};
+};
+
+
+/**********
+Template definitions
+**********/
+
+/*****
+Return the value of the function
+*****/
+template <class F, std::size_t N>
+double tmAutoDiffFn<F, N>::Func(const std::vector<double>& u)
+{
+  IncFuncCalls();
+  double x[N];
+  for (std::size_t i = 0; i < N; ++i) x[i] = u[mVars[i]];
+  return Self().Eval(x);
+}
+
+
+/*****
+Return the gradient of the function
+*****/
+template <class F, std::size_t N>
+void tmAutoDiffFn<F, N>::Grad(const std::vector<double>& u,
+  std::vector<double>& du)
+{
+  IncGradCalls();
+  tmDual<N> x[N];
+  for (std::size_t i = 0; i < N; ++i) {
+    x[i].v = u[mVars[i]];
+    x[i].d[i] = 1;
+  }
+  tmDual<N> f = Self().Eval(x);
+  std::fill(du.begin(), du.end(), 0.);
+  for (std::size_t i = 0; i < N; ++i) du[mVars[i]] += f.d[i];
+}
+
+
+/*****
+Return the value and the gradient from a single evaluation
+*****/
+template <class F, std::size_t N>
+double tmAutoDiffFn<F, N>::FuncGrad(const std::vector<double>& u,
+  std::vector<double>& du)
+{
+  IncFuncCalls();
+  IncGradCalls();
+  tmDual<N> x[N];
+  for (std::size_t i = 0; i < N; ++i) {
+    x[i].v = u[mVars[i]];
+    x[i].d[i] = 1;
+  }
+  tmDual<N> f = Self().Eval(x);
+  std::fill(du.begin(), du.end(), 0.);
+  for (std::size_t i = 0; i < N; ++i) du[mVars[i]] += f.d[i];
+  return f.v;
+}
+
+#endif // _TMAUTODIFFFN_H_
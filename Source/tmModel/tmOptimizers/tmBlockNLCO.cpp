@@ -0,0 +1,517 @@
+/*******************************************************************************
+File:         tmBlockNLCO.cpp
+Project:      TreeMaker 5.x
+Purpose:      Implementation file for optimization split into independent blocks
+Author:       Robert J. Lang
+Modified by:
+Created:      2026-10-19
+Copyright:    ©2026 Robert J. Lang. All Rights Reserved.
+*******************************************************************************/
+
+#include "tmBlockNLCO.h"
+#include "tmArray.h"
+#include "tmProfiler.h"
+
+using namespace std;
+
+// An inequality links its variables if its value at the start is above
+// -NEAR_ACTIVE. Tree coordinates are of order 1, so this is a small fraction
+// of the paper.
+const double NEAR_ACTIVE = 0.05;
+
+// A constraint left out of the blocks is violated if its value at the
+// solution is above TOL_FEAS, the same tolerance the ALM optimizer uses.
+const double TOL_FEAS = 1.0e-5;
+
+
+/**********
+class tmBlockNLCO::BlockFn
+A function of the full variables, evaluated on one block's variables
+**********/
+class tmBlockNLCO::BlockFn : public tmDifferentiableFn {
+public:
+  BlockFn(tmBlockNLCO* aOwner, Block& aBlock, const Constraint* aCons);
+  double Func(const vector<double>& w);
+  void Grad(const vector<double>& w, vector<double>& dw);
+  double FuncGrad(const vector<double>& w, vector<double>& dw);
+private:
+  tmBlockNLCO* mOwner;          // the optimizer we work for
+  Block& mBlock;                // the block whose variables we're given
+  tmDifferentiableFn* mFn;      // the function of the full variables
+  bool mIsObjective;            // true if mFn is the objective
+  vector<size_t> mFull;         // u[mFull[i]] is ...
+  vector<size_t> mLocal;        // ... w[mLocal[i]]
+
+  vector<double>& Expand(const vector<double>& w);
+  vector<double>& GradBuffer(size_t n);
+  void Contract(const vector<double>& du, vector<double>& dw);
+};
+
+
+/*****
+Scratch vectors for constraints. Each thread needs its own, since the block
+optimizers may run on several threads and may evaluate constraints on several
+threads of their own. The objective uses the block's vectors, which hold the
+starting values of the other blocks' variables.
+*****/
+static thread_local vector<double> sU;
+static thread_local vector<double> sDu;
+
+
+/*****
+Constructor. If aCons is NULL we wrap the objective, which sees all the
+block's variables; otherwise the constraint, which sees just its own.
+*****/
+tmBlockNLCO::BlockFn::BlockFn(tmBlockNLCO* aOwner, Block& aBlock,
+  const Constraint* aCons)
+  : mOwner(aOwner), mBlock(aBlock),
+  mFn(aCons ? aCons->mFn : aOwner->tmNLCO::GetObjective()),
+  mIsObjective(!aCons)
+{
+  if (mIsObjective) {
+    mFull = mBlock.mVars;
+    for (size_t i = 0; i < mFull.size(); ++i) mLocal.push_back(i);
+  }
+  else {
+    mFull = aCons->mVars;
+    for (size_t i = 0; i < mFull.size(); ++i)
+      mLocal.push_back(mOwner->mIndexOf[mFull[i]]);
+  }
+}
+
+
+/*****
+Fill in the full vector from w and return it.
+*****/
+vector<double>& tmBlockNLCO::BlockFn::Expand(const vector<double>& w)
+{
+  vector<double>& u = mIsObjective ? mBlock.mU : sU;
+  u.resize(mOwner->mSize);
+  for (size_t i = 0; i < mFull.size(); ++i) u[mFull[i]] = w[mLocal[i]];
+  return u;
+}
+
+
+/*****
+Return a full-size vector to receive a gradient
+*****/
+vector<double>& tmBlockNLCO::BlockFn::GradBuffer(size_t n)
+{
+  vector<double>& du = mIsObjective ? mBlock.mDu : sDu;
+  du.resize(n);
+  return du;
+}
+
+
+/*****
+Pick our variables' components out of the full gradient du.
+*****/
+void tmBlockNLCO::BlockFn::Contract(const vector<double>& du,
+  vector<double>& dw)
+{
+  dw.assign(mBlock.mVars.size(), 0.);
+  for (size_t i = 0; i < mFull.size(); ++i) dw[mLocal[i]] += du[mFull[i]];
+}
+
+
+/*****
+Return the value of the function
+*****/
+double tmBlockNLCO::BlockFn::Func(const vector<double>& w)
+{
+  IncFuncCalls();
+  vector<double>& u = Expand(w);
+  if (!mIsObjective) return mFn->Func(u);
+  lock_guard<mutex> lock(mOwner->mObjectiveMutex);
+  return mFn->Func(u);
+}
+
+
+/*****
+Return the gradient of the function
+*****/
+void tmBlockNLCO::BlockFn::Grad(const vector<double>& w, vector<double>& dw)
+{
+  IncGradCalls();
+  vector<double>& u = Expand(w);
+  vector<double>& du = GradBuffer(u.size());
+  if (mIsObjective) {
+    lock_guard<mutex> lock(mOwner->mObjectiveMutex);
+    mFn->Grad(u, du);
+  }
+  else mFn->Grad(u, du);
+  Contract(du, dw);
+}
+
+
+/*****
+Return the value and gradient of the function
+*****/
+double tmBlockNLCO::BlockFn::FuncGrad(const vector<double>& w,
+  vector<double>& dw)
+{
+  IncFuncCalls();
+  IncGradCalls();
+  vector<double>& u = Expand(w);
+  vector<double>& du = GradBuffer(u.size());
+  double f;
+  if (mIsObjective) {
+    lock_guard<mutex> lock(mOwner->mObjectiveMutex);
+    f = mFn->FuncGrad(u, du);
+  }
+  else f = mFn->FuncGrad(u, du);
+  Contract(du, dw);
+  return f;
+}
+
+
+#ifdef __MWERKS__
+  #pragma mark -
+#endif
+
+
+/**********
+class tmBlockNLCO
+Optimizer that splits a problem into independent blocks of variables
+**********/
+
+/*****
+Static member initialization. By default we use one thread per core.
+*****/
+size_t tmBlockNLCO::sNumThreads = 0;
+
+
+/*****
+STATIC
+Return the number of threads used to solve blocks; 0 means one per core.
+*****/
+size_t tmBlockNLCO::GetNumThreads()
+{
+  return sNumThreads;
+}
+
+
+/*****
+STATIC
+Set the number of threads used to solve blocks, which will affect all future
+optimizations; 0 means one per core.
+*****/
+void tmBlockNLCO::SetNumThreads(size_t numThreads)
+{
+  sNumThreads = numThreads;
+}
+
+
+/*****
+Constructor. aNLCO solves the problem when it can't be split and stays owned
+by the caller; it owns the objective and constraints.
+*****/
+tmBlockNLCO::tmBlockNLCO(tmNLCO* aNLCO)
+  : mNLCO(aNLCO), mNumBlocks(0), mNextBlock(0)
+{
+}
+
+
+/*****
+Destructor
+*****/
+tmBlockNLCO::~tmBlockNLCO()
+{
+}
+
+
+/*****
+Set the size of the problem
+*****/
+void tmBlockNLCO::SetSize(size_t n)
+{
+  tmNLCO::SetSize(n);
+  mNLCO->SetSize(n);
+}
+
+
+/*****
+Return the number of equality constraints
+*****/
+size_t tmBlockNLCO::GetNumEqualities()
+{
+  return mNLCO->GetNumEqualities();
+}
+
+
+/*****
+Return the number of inequality constraints
+*****/
+size_t tmBlockNLCO::GetNumInequalities()
+{
+  return mNLCO->GetNumInequalities();
+}
+
+
+/*****
+Set the objective function
+*****/
+void tmBlockNLCO::SetObjective(tmDifferentiableFn* f)
+{
+  tmNLCO::SetObjective(f);
+  mNLCO->SetObjective(f);
+}
+
+
+/*****
+Record a constraint and what it reads.
+*****/
+void tmBlockNLCO::RecordConstraint(tmDifferentiableFn* f, Kind kind)
+{
+  AddConstraint(f);
+  Constraint c;
+  c.mFn = f;
+  c.mKind = kind;
+  c.mKnown = f->GetVariables(c.mVars);
+  mCons.push_back(c);
+}
+
+
+/*****
+Add a linear equality constraint
+*****/
+void tmBlockNLCO::AddLinearEquality(tmDifferentiableFn* f)
+{
+  RecordConstraint(f, LINEAR_EQUALITY);
+  mNLCO->AddLinearEquality(f);
+}
+
+
+/*****
+Add a nonlinear equality constraint
+*****/
+void tmBlockNLCO::AddNonlinearEquality(tmDifferentiableFn* f)
+{
+  RecordConstraint(f, NONLINEAR_EQUALITY);
+  mNLCO->AddNonlinearEquality(f);
+}
+
+
+/*****
+Add a linear inequality constraint
+*****/
+void tmBlockNLCO::AddLinearInequality(tmDifferentiableFn* f)
+{
+  RecordConstraint(f, LINEAR_INEQUALITY);
+  mNLCO->AddLinearInequality(f);
+}
+
+
+/*****
+Add a nonlinear inequality constraint
+*****/
+void tmBlockNLCO::AddNonlinearInequality(tmDifferentiableFn* f)
+{
+  RecordConstraint(f, NONLINEAR_INEQUALITY);
+  mNLCO->AddNonlinearInequality(f);
+}
+
+
+/*****
+Set bounds on the variables
+*****/
+void tmBlockNLCO::SetBounds(const vector<double>& bl, const vector<double>& bu)
+{
+  mbl = bl;
+  mbu = bu;
+  mNLCO->SetBounds(bl, bu);
+}
+
+
+/*****
+Group the variables into blocks, joining the variables of each constraint
+flagged in links. Variables that no such constraint reads go into one block
+together, so that we don't make an optimizer for each of them. The blocks are
+numbered in order of their first variable and list their variables in order.
+*****/
+void tmBlockNLCO::FindBlocks(const vector<bool>& links)
+{
+  // Union-find over the variables
+  vector<size_t> parent(mSize);
+  for (size_t k = 0; k < mSize; ++k) parent[k] = k;
+  vector<bool> linked(mSize, false);
+  for (size_t i = 0; i < mCons.size(); ++i) {
+    if (!links[i]) continue;
+    const vector<size_t>& vars = mCons[i].mVars;
+    for (size_t t = 0; t < vars.size(); ++t) {
+      linked[vars[t]] = true;
+      size_t a = vars[0];
+      while (parent[a] != a) a = parent[a] = parent[parent[a]];
+      size_t b = vars[t];
+      while (parent[b] != b) b = parent[b] = parent[parent[b]];
+      if (a != b) parent[max(a, b)] = min(a, b);
+    }
+  }
+
+  // Number the blocks
+  mBlocks.clear();
+  vector<size_t> blockOf(mSize, tmArray<size_t>::BAD_OFFSET);
+  size_t freeBlock = tmArray<size_t>::BAD_OFFSET;
+  mIndexOf.resize(mSize);
+  for (size_t k = 0; k < mSize; ++k) {
+    size_t r = k;
+    while (parent[r] != r) r = parent[r];
+    size_t& b = linked[k] ? blockOf[r] : freeBlock;
+    if (b == tmArray<size_t>::BAD_OFFSET) {
+      b = mBlocks.size();
+      mBlocks.push_back(Block());
+    }
+    blockOf[k] = b;
+    mIndexOf[k] = mBlocks[b].mVars.size();
+    mBlocks[b].mVars.push_back(k);
+  }
+
+  // Hand out the constraints. All the variables of a linking constraint are
+  // in one block.
+  for (size_t i = 0; i < mCons.size(); ++i) {
+    if (!links[i] || mCons[i].mVars.empty()) continue;
+    mBlocks[blockOf[mCons[i].mVars[0]]].mCons.push_back(i);
+  }
+}
+
+
+/*****
+Set up and solve block k, starting from mStart. The blocks share our budget,
+if we have one. Any exception is saved for the calling thread to rethrow.
+*****/
+void tmBlockNLCO::SolveBlock(size_t k)
+{
+  TM_PROFILE_SCOPE("tmBlockNLCO::SolveBlock");
+  Block& b = mBlocks[k];
+  size_t m = b.mVars.size();
+  b.mU = mStart;
+  b.mX.resize(m);
+  for (size_t i = 0; i < m; ++i) b.mX[i] = mStart[b.mVars[i]];
+  b.mInform = 0;
+  tmNLCO* theNLCO = NULL;
+#ifdef tmUSE_ALM
+  theNLCO = new tmNLCO_alm();
+#endif
+  try {
+    theNLCO->SetBudget(mBudget);
+    theNLCO->SetSize(m);
+    if (!mbl.empty()) {
+      vector<double> bl(m), bu(m);
+      for (size_t i = 0; i < m; ++i) {
+        bl[i] = mbl[b.mVars[i]];
+        bu[i] = mbu[b.mVars[i]];
+      }
+      theNLCO->SetBounds(bl, bu);
+    }
+    theNLCO->SetObjective(new BlockFn(this, b, NULL));
+    for (size_t j = 0; j < b.mCons.size(); ++j) {
+      const Constraint& c = mCons[b.mCons[j]];
+      BlockFn* f = new BlockFn(this, b, &c);
+      switch (c.mKind) {
+        case LINEAR_EQUALITY: theNLCO->AddLinearEquality(f); break;
+        case NONLINEAR_EQUALITY: theNLCO->AddNonlinearEquality(f); break;
+        case LINEAR_INEQUALITY: theNLCO->AddLinearInequality(f); break;
+        case NONLINEAR_INEQUALITY: theNLCO->AddNonlinearInequality(f); break;
+      }
+    }
+    b.mInform = theNLCO->Minimize(b.mX);
+  }
+  catch (...) {
+    b.mError = current_exception();
+  }
+  delete theNLCO;
+}
+
+
+/*****
+Solve blocks until there are none left. Every thread runs this.
+*****/
+void tmBlockNLCO::SolveBlocks()
+{
+  for (size_t k = mNextBlock++; k < mBlocks.size(); k = mNextBlock++)
+    SolveBlock(k);
+}
+
+
+/*****
+Minimize, starting from and returning x.
+*****/
+int tmBlockNLCO::Minimize(vector<double>& x)
+{
+  if (mUpdater) mNLCO->SetUpdater(mUpdater);
+  if (mBudget) mNLCO->SetBudget(mBudget);
+  mMainThread = this_thread::get_id();
+  mNumBlocks = 1;
+
+  // We split only for the ALM optimizer, which keeps all of its state in the
+  // object and so can run several copies at once; the others solve the whole
+  // problem.
+#ifdef tmUSE_ALM
+  if (!dynamic_cast<tmNLCO_alm*>(mNLCO)) return mNLCO->Minimize(x);
+#else
+  return mNLCO->Minimize(x);
+#endif
+
+  // Equalities and nearly active inequalities link their variables. If any
+  // constraint doesn't say what it reads, we can't split.
+  size_t nc = mCons.size();
+  vector<bool> links(nc, false);
+  for (size_t i = 0; i < nc; ++i) {
+    const Constraint& c = mCons[i];
+    if (!c.mKnown) return mNLCO->Minimize(x);
+    links[i] = (c.mKind == LINEAR_EQUALITY ||
+      c.mKind == NONLINEAR_EQUALITY || c.mFn->Func(x) > -NEAR_ACTIVE);
+  }
+
+  size_t numThreads = sNumThreads;
+  if (numThreads == 0) numThreads = thread::hardware_concurrency();
+  if (numThreads == 0) numThreads = 1;
+
+  while (true) {
+    FindBlocks(links);
+    if (mBlocks.size() < 2) {
+      mNumBlocks = 1;
+      return mNLCO->Minimize(x);
+    }
+
+    // Solve the blocks, some of them on helper threads.
+    mStart = x;
+    mNextBlock = 0;
+    vector<thread> helpers;
+    for (size_t t = 1; t < numThreads && t < mBlocks.size(); ++t)
+      helpers.push_back(thread(&tmBlockNLCO::SolveBlocks, this));
+    SolveBlocks();
+    for (size_t t = 0; t < helpers.size(); ++t) helpers[t].join();
+
+    // Collect the results
+    int inform = 0;
+    for (size_t k = 0; k < mBlocks.size(); ++k) {
+      Block& b = mBlocks[k];
+      if (b.mError) rethrow_exception(b.mError);
+      if (inform == 0) inform = b.mInform;
+      for (size_t i = 0; i < b.mVars.size(); ++i) x[b.mVars[i]] = b.mX[i];
+    }
+    mNumBlocks = mBlocks.size();
+    if (inform != 0) return inform;
+
+    // Check the constraints we left out. Any that are now violated join the
+    // links, and we try again from here.
+    bool violated = false;
+    for (size_t i = 0; i < nc; ++i)
+      if (!links[i] && mCons[i].mFn->Func(x) > TOL_FEAS) {
+        links[i] = true;
+        violated = true;
+      }
+    if (!violated) return 0;
+  }
+}
+
+
+/*****
+Pass UI updates from the objective on to the real optimizer, but only from
+the thread that called Minimize(); helper threads mustn't touch the UI.
+*****/
+void tmBlockNLCO::ObjectiveUpdateUI()
+{
+  if (this_thread::get_id() == mMainThread) mNLCO->ObjectiveUpdateUI();
+}
@@ -0,0 +1,124 @@
+/*******************************************************************************
+File:         tmBlockNLCO.h
+Project:      TreeMaker 5.x
+Purpose:      Header file for optimization split into independent blocks
+Author:       Robert J. Lang
+Modified by:
+Created:      2026-10-19
+Copyright:    ©2026 Robert J. Lang. All Rights Reserved.
+*******************************************************************************/
+
+#ifndef _TMBLOCKNLCO_H_
+#define _TMBLOCKNLCO_H_
+
+#include "tmNLCO.h"
+
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+/*
+Class tmBlockNLCO sits between a tmOptimizer and the real tmNLCO and splits
+the problem into blocks of variables that don't interact, each solved by its
+own tmNLCO, several at once on different threads. Only the ALM optimizer keeps
+all of its state in the object, so only it is split; with the others, the
+problem goes straight through.
+
+Two variables interact if some constraint that matters reads both of them
+(see tmDifferentiableFn::GetVariables()). In a tree nearly every pair of nodes
+is joined by a path constraint, so if every constraint counted there would
+never be more than one block. But most path constraints are far from active
+and have no effect on the answer. So only equalities and the inequalities
+that are active or nearly so at the starting point link variables; the rest
+are left out of the blocks. Once the blocks are solved we check the ones we
+left out. If any is violated, it becomes a link, and we split and solve again
+from where we are. Each round adds at least one link, so in the worst case we
+end up with a single block, which is the original problem.
+
+The objective must be a sum of terms that each involve only a single block's
+variables, as those of the edge and strain optimizers are. Each block
+minimizes it with the other blocks' variables held at their starting values.
+The objective is only ever called by one thread at a time, and only the
+calling thread passes UI updates on to the real optimizer.
+
+If there is only one block, the real optimizer solves the whole problem, with
+exactly the result it would have had without us.
+*/
+
+/**********
+class tmBlockNLCO
+Optimizer that splits a problem into independent blocks of variables
+**********/
+class tmBlockNLCO : public tmNLCO {
+public:
+  tmBlockNLCO(tmNLCO* aNLCO);
+  ~tmBlockNLCO();
+
+  void SetSize(std::size_t n);
+  std::size_t GetNumEqualities();
+  std::size_t GetNumInequalities();
+
+  void SetObjective(tmDifferentiableFn* f);
+  void AddLinearEquality(tmDifferentiableFn* f);
+  void AddNonlinearEquality(tmDifferentiableFn* f);
+  void AddLinearInequality(tmDifferentiableFn* f);
+  void AddNonlinearInequality(tmDifferentiableFn* f);
+  void SetBounds(const std::vector<double>& bl, const std::vector<double>& bu);
+
+  int Minimize(std::vector<double>& x);
+
+  void ObjectiveUpdateUI();
+
+  // Number of threads used to solve blocks
+  static std::size_t GetNumThreads();
+  static void SetNumThreads(std::size_t numThreads);
+
+  // Number of blocks in the last call to Minimize()
+  std::size_t GetNumBlocks() const {return mNumBlocks;};
+
+private:
+  class BlockFn;
+  enum Kind {
+    LINEAR_EQUALITY,
+    NONLINEAR_EQUALITY,
+    LINEAR_INEQUALITY,
+    NONLINEAR_INEQUALITY
+  };
+  struct Constraint {
+    tmDifferentiableFn* mFn;          // the constraint, owned by mNLCO
+    Kind mKind;                       // how it was added
+    std::vector<std::size_t> mVars;   // what it reads, if it knows
+    bool mKnown;                      // true if mVars is valid
+  };
+  struct Block {
+    std::vector<std::size_t> mVars;   // its variables, in order
+    std::vector<std::size_t> mCons;   // its constraints
+    std::vector<double> mX;           // its part of the solution
+    std::vector<double> mU;           // full vector seen by the objective
+    std::vector<double> mDu;          // ... and its gradient
+    int mInform;                      // result of its optimization
+    std::exception_ptr mError;        // exception it threw, if any
+  };
+
+  static std::size_t sNumThreads;     // threads to use, 0 = one per core
+
+  tmNLCO* mNLCO;                      // the optimizer of the whole problem
+  std::vector<Constraint> mCons;      // every constraint, in order
+  std::vector<double> mbl;            // lower bounds
+  std::vector<double> mbu;            // upper bounds
+  std::size_t mNumBlocks;             // blocks in the last optimization
+  std::vector<Block> mBlocks;         // blocks of the current round
+  std::vector<std::size_t> mIndexOf;  // index of each variable in its block
+  std::vector<double> mStart;         // full vector of the current round
+  std::atomic<std::size_t> mNextBlock;  // next block to be solved
+  std::mutex mObjectiveMutex;         // one objective evaluation at a time
+  std::thread::id mMainThread;        // the thread that called Minimize()
+
+  void RecordConstraint(tmDifferentiableFn* f, Kind kind);
+  void FindBlocks(const std::vector<bool>& links);
+  void SolveBlocks();
+  void SolveBlock(std::size_t k);
+};
+
+#endif // _TMBLOCKNLCO_H_
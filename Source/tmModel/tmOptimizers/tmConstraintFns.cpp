@@ -10,6 +10,8 @@ Copyright:    ©2004 Robert J. Lang. All Rights Reserved.
 
 #include "tmConstraintFns.h"
 
+#include <iostream>
+
 using namespace std;
 
 /*****************************************************************************
@@ -61,6 +63,35 @@ void OneVarFn::Grad(const vector<double>&, vector<double>& du)
 }
 
 
+/*****
+GetVariables - return the variables the constraint depends on
+*****/
+bool OneVarFn::GetVariables(vector<size_t>& vars) const
+{
+  vars.assign(1, ix);
+  return true;
+}
+
+
+/*****
+Constructor - read the constants written by PutSelf()
+*****/
+OneVarFn::OneVarFn(istream& is)
+{
+  is >> ix >> a >> b;
+}
+
+
+/*****
+PutSelf - write the name and constants of the constraint
+*****/
+bool OneVarFn::PutSelf(ostream& os) const
+{
+  os << "OneVarFn " << ix << ' ' << a << ' ' << b;
+  return true;
+}
+
+
 #ifdef __MWERKS__
 #pragma mark -
 #endif
@@ -114,6 +145,37 @@ void TwoVarFn::Grad(const vector<double>&, vector<double>& du)
 }
 
 
+/*****
+GetVariables - return the variables the constraint depends on
+*****/
+bool TwoVarFn::GetVariables(vector<size_t>& vars) const
+{
+  size_t v[] = {ix, iy};
+  vars.assign(v, v + 2);
+  return true;
+}
+
+
+/*****
+Constructor - read the constants written by PutSelf()
+*****/
+TwoVarFn::TwoVarFn(istream& is)
+{
+  is >> ix >> iy >> a >> b >> c;
+}
+
+
+/*****
+PutSelf - write the name and constants of the constraint
+*****/
+bool TwoVarFn::PutSelf(ostream& os) const
+{
+  os << "TwoVarFn " << ix << ' ' << iy << ' ' << a << ' ' << b
+    << ' ' << c;
+  return true;
+}
+
+
 #ifdef __MWERKS__
 #pragma mark -
 #endif
@@ -173,6 +235,56 @@ void PathFn1::Grad(const vector<double>& u, vector<double>& du)
 }
 
 
+/*****
+FuncGrad - return the value and gradient of the constraint in one pass
+*****/
+double PathFn1::FuncGrad(const vector<double>& u, vector<double>& du)
+{
+  IncFuncCalls();
+  IncGradCalls();
+  du.assign(du.size(), 0.);
+  du[0] = lij;
+  double dist = sqrt(pow(u[ix] - u[jx], 2) + pow(u[iy] - u[jy], 2));
+  double temp = (dist != 0) ? 1. / dist : 0.;
+  du[ix] = temp * (u[jx] - u[ix]);
+  du[jx] = -du[ix];
+  du[iy] = temp * (u[jy] - u[iy]);
+  du[jy] = -du[iy];
+  return u[0] * lij - dist;
+}
+
+
+/*****
+GetVariables - return the variables the constraint depends on
+*****/
+bool PathFn1::GetVariables(vector<size_t>& vars) const
+{
+  size_t v[] = {0, ix, iy, jx, jy};
+  vars.assign(v, v + 5);
+  return true;
+}
+
+
+/*****
+Constructor - read the constants written by PutSelf()
+*****/
+PathFn1::PathFn1(istream& is)
+{
+  is >> ix >> iy >> jx >> jy >> lij;
+}
+
+
+/*****
+PutSelf - write the name and constants of the constraint
+*****/
+bool PathFn1::PutSelf(ostream& os) const
+{
+  os << "PathFn1 " << ix << ' ' << iy << ' ' << jx << ' ' << jy
+    << ' ' << lij;
+  return true;
+}
+
+
 #ifdef __MWERKS__
 #pragma mark -
 #endif
@@ -229,6 +341,54 @@ void PathFn2::Grad(const vector<double>& u, vector<double>& du)
 }
 
 
+/*****
+FuncGrad - return the value and gradient of the constraint in one pass
+*****/
+double PathFn2::FuncGrad(const vector<double>& u, vector<double>& du)
+{
+  IncFuncCalls();
+  IncGradCalls();
+  du.assign(du.size(), 0.);
+  du[0] = lij;
+  double dist = sqrt(pow(u[ix] - vx, 2) + pow(u[iy] - vy, 2));
+  double temp = (dist != 0) ? 1. / dist : 0.;
+  du[ix] = temp * (vx - u[ix]);
+  du[iy] = temp * (vy - u[iy]);
+  return u[0] * lij - dist;
+}
+
+
+/*****
+GetVariables - return the variables the constraint depends on
+*****/
+bool PathFn2::GetVariables(vector<size_t>& vars) const
+{
+  size_t v[] = {0, ix, iy};
+  vars.assign(v, v + 3);
+  return true;
+}
+
+
+/*****
+Constructor - read the constants written by PutSelf()
+*****/
+PathFn2::PathFn2(istream& is)
+{
+  is >> ix >> iy >> vx >> vy >> lij;
+}
+
+
+/*****
+PutSelf - write the name and constants of the constraint
+*****/
+bool PathFn2::PutSelf(ostream& os) const
+{
+  os << "PathFn2 " << ix << ' ' << iy << ' ' << vx << ' ' << vy
+    << ' ' << lij;
+  return true;
+}
+
+
 #ifdef __MWERKS__
 #pragma mark -
 #endif
@@ -285,6 +445,37 @@ void PathAngleFn1::Grad(const vector<double>&, vector<double>& du)
 }
 
 
+/*****
+GetVariables - return the variables the constraint depends on
+*****/
+bool PathAngleFn1::GetVariables(vector<size_t>& vars) const
+{
+  size_t v[] = {ix, iy, jx, jy};
+  vars.assign(v, v + 4);
+  return true;
+}
+
+
+/*****
+Constructor - read the constants written by PutSelf()
+*****/
+PathAngleFn1::PathAngleFn1(istream& is)
+{
+  is >> ix >> iy >> jx >> jy >> ca >> sa;
+}
+
+
+/*****
+PutSelf - write the name and constants of the constraint
+*****/
+bool PathAngleFn1::PutSelf(ostream& os) const
+{
+  os << "PathAngleFn1 " << ix << ' ' << iy << ' ' << jx << ' ' << jy
+    << ' ' << ca << ' ' << sa;
+  return true;
+}
+
+
 #ifdef __MWERKS__
 #pragma mark -
 #endif
@@ -340,6 +531,37 @@ void PathAngleFn2::Grad(const vector<double>&, vector<double>& du)
 }
 
 
+/*****
+GetVariables - return the variables the constraint depends on
+*****/
+bool PathAngleFn2::GetVariables(vector<size_t>& vars) const
+{
+  size_t v[] = {ix, iy};
+  vars.assign(v, v + 2);
+  return true;
+}
+
+
+/*****
+Constructor - read the constants written by PutSelf()
+*****/
+PathAngleFn2::PathAngleFn2(istream& is)
+{
+  is >> ix >> iy >> vx >> vy >> ca >> sa;
+}
+
+
+/*****
+PutSelf - write the name and constants of the constraint
+*****/
+bool PathAngleFn2::PutSelf(ostream& os) const
+{
+  os << "PathAngleFn2 " << ix << ' ' << iy << ' ' << vx << ' ' << vy
+    << ' ' << ca << ' ' << sa;
+  return true;
+}
+
+
 #ifdef __MWERKS__
 #pragma mark -
 #endif
@@ -402,6 +624,56 @@ void StrainPathFn1::Grad(const vector<double>& u, vector<double>& du)
 }
 
 
+/*****
+FuncGrad - return the value and gradient of the constraint in one pass
+*****/
+double StrainPathFn1::FuncGrad(const vector<double>& u, vector<double>& du)
+{
+  IncFuncCalls();
+  IncGradCalls();
+  du.assign(du.size(), 0.);
+  du[0] = lvar;
+  double dist = sqrt(pow(u[ix] - u[jx], 2) + pow(u[iy] - u[jy], 2));
+  double temp = (dist != 0) ? 1. / dist : 0.;
+  du[ix] = temp * (u[jx] - u[ix]);
+  du[jx] = - du[ix];
+  du[iy] = temp * (u[jy] - u[iy]);
+  du[jy] = - du[iy];
+  return lfix + u[0] * lvar - dist;
+}
+
+
+/*****
+GetVariables - return the variables the constraint depends on
+*****/
+bool StrainPathFn1::GetVariables(vector<size_t>& vars) const
+{
+  size_t v[] = {0, ix, iy, jx, jy};
+  vars.assign(v, v + 5);
+  return true;
+}
+
+
+/*****
+Constructor - read the constants written by PutSelf()
+*****/
+StrainPathFn1::StrainPathFn1(istream& is)
+{
+  is >> ix >> iy >> jx >> jy >> lfix >> lvar;
+}
+
+
+/*****
+PutSelf - write the name and constants of the constraint
+*****/
+bool StrainPathFn1::PutSelf(ostream& os) const
+{
+  os << "StrainPathFn1 " << ix << ' ' << iy << ' ' << jx << ' ' << jy
+    << ' ' << lfix << ' ' << lvar;
+  return true;
+}
+
+
 #ifdef __MWERKS__
 #pragma mark -
 #endif
@@ -462,6 +734,54 @@ void StrainPathFn2::Grad(const vector<double>& u, vector<double>& du)
 }
 
 
+/*****
+FuncGrad - return the value and gradient of the constraint in one pass
+*****/
+double StrainPathFn2::FuncGrad(const vector<double>& u, vector<double>& du)
+{
+  IncFuncCalls();
+  IncGradCalls();
+  du.assign(du.size(), 0.);
+  du[0] = lvar;
+  double dist = sqrt(pow(u[ix] - vx, 2) + pow(u[iy] - vy, 2));
+  double temp = (dist != 0) ? 1. / dist : 0.;
+  du[ix] = temp * (vx - u[ix]);
+  du[iy] = temp * (vy - u[iy]);
+  return lfix + u[0] * lvar - dist;
+}
+
+
+/*****
+GetVariables - return the variables the constraint depends on
+*****/
+bool StrainPathFn2::GetVariables(vector<size_t>& vars) const
+{
+  size_t v[] = {0, ix, iy};
+  vars.assign(v, v + 3);
+  return true;
+}
+
+
+/*****
+Constructor - read the constants written by PutSelf()
+*****/
+StrainPathFn2::StrainPathFn2(istream& is)
+{
+  is >> ix >> iy >> vx >> vy >> lfix >> lvar;
+}
+
+
+/*****
+PutSelf - write the name and constants of the constraint
+*****/
+bool StrainPathFn2::PutSelf(ostream& os) const
+{
+  os << "StrainPathFn2 " << ix << ' ' << iy << ' ' << vx << ' ' << vy
+    << ' ' << lfix << ' ' << lvar;
+  return true;
+}
+
+
 #ifdef __MWERKS__
 #pragma mark -
 #endif
@@ -517,6 +837,36 @@ void StrainPathFn3::Grad(const vector<double>&, vector<double>& du)
 }
 
 
+/*****
+GetVariables - return the variables the constraint depends on
+*****/
+bool StrainPathFn3::GetVariables(vector<size_t>& vars) const
+{
+  vars.assign(1, 0);
+  return true;
+}
+
+
+/*****
+Constructor - read the constants written by PutSelf()
+*****/
+StrainPathFn3::StrainPathFn3(istream& is)
+{
+  is >> ux >> uy >> vx >> vy >> lfix >> lvar;
+}
+
+
+/*****
+PutSelf - write the name and constants of the constraint
+*****/
+bool StrainPathFn3::PutSelf(ostream& os) const
+{
+  os << "StrainPathFn3 " << ux << ' ' << uy << ' ' << vx << ' ' << vy
+    << ' ' << lfix << ' ' << lvar;
+  return true;
+}
+
+
 #ifdef __MWERKS__
 #pragma mark -
 #endif
@@ -540,32 +890,31 @@ Constructor - record constants and index into data array
 *****/
 StickToEdgeFn::StickToEdgeFn(size_t aix, size_t aiy, double aw, double ah)
 {
-  ix = aix;
-  iy = aiy;
+  mVars[0] = aix;
+  mVars[1] = aiy;
   w = aw;
   h = ah;
+  wt = StickToEdge_Weight;
 }
 
 
 /*****
-Func - return the value of the constraint
+Constructor - read the constants written by PutSelf()
 *****/
-double StickToEdgeFn::Func(const vector<double>& u)
+StickToEdgeFn::StickToEdgeFn(istream& is)
 {
-  IncFuncCalls();
-  return StickToEdge_Weight * u[ix] * (u[ix] - w) * u[iy] * (u[iy] - h);
+  is >> mVars[0] >> mVars[1] >> w >> h >> wt;
 }
 
 
 /*****
-Grad - return the gradient of the constraint
+PutSelf - write the name and constants of the constraint
 *****/
-void StickToEdgeFn::Grad(const vector<double>& u, vector<double>& du)
+bool StickToEdgeFn::PutSelf(ostream& os) const
 {
-  IncGradCalls();
-  du.assign(du.size(), 0.);
-  du[ix] = StickToEdge_Weight * (2 * u[ix] - w) * u[iy] * (u[iy] - h);
-  du[iy] = StickToEdge_Weight * (2 * u[iy] - h) * u[ix] * (u[ix] - w);
+  os << "StickToEdgeFn " << mVars[0] << ' ' << mVars[1] << ' ' << w
+    << ' ' << h << ' ' << wt;
+  return true;
 }
 
 
@@ -622,6 +971,37 @@ void StickToLineFn::Grad(const vector<double>&, vector<double>& du)
 }
 
 
+/*****
+GetVariables - return the variables the constraint depends on
+*****/
+bool StickToLineFn::GetVariables(vector<size_t>& vars) const
+{
+  size_t v[] = {ix, iy};
+  vars.assign(v, v + 2);
+  return true;
+}
+
+
+/*****
+Constructor - read the constants written by PutSelf()
+*****/
+StickToLineFn::StickToLineFn(istream& is)
+{
+  is >> ix >> iy >> p.x >> p.y >> sa >> ca;
+}
+
+
+/*****
+PutSelf - write the name and constants of the constraint
+*****/
+bool StickToLineFn::PutSelf(ostream& os) const
+{
+  os << "StickToLineFn " << ix << ' ' << iy << ' ' << p.x << ' ' << p.y
+    << ' ' << sa << ' ' << ca;
+  return true;
+}
+
+
 #ifdef __MWERKS__
 #pragma mark -
 #endif
@@ -684,6 +1064,37 @@ void PairFn1A::Grad(const vector<double>&, vector<double>& du)
 }
 
 
+/*****
+GetVariables - return the variables the constraint depends on
+*****/
+bool PairFn1A::GetVariables(vector<size_t>& vars) const
+{
+  size_t v[] = {ix, iy, jx, jy};
+  vars.assign(v, v + 4);
+  return true;
+}
+
+
+/*****
+Constructor - read the constants written by PutSelf()
+*****/
+PairFn1A::PairFn1A(istream& is)
+{
+  is >> ix >> iy >> jx >> jy >> p.x >> p.y >> sa >> ca;
+}
+
+
+/*****
+PutSelf - write the name and constants of the constraint
+*****/
+bool PairFn1A::PutSelf(ostream& os) const
+{
+  os << "PairFn1A " << ix << ' ' << iy << ' ' << jx << ' ' << jy
+    << ' ' << p.x << ' ' << p.y << ' ' << sa << ' ' << ca;
+  return true;
+}
+
+
 #ifdef __MWERKS__
 #pragma mark -
 #endif
@@ -729,6 +1140,37 @@ void PairFn1B::Grad(const vector<double>&, vector<double>& du)
 }
 
 
+/*****
+GetVariables - return the variables the constraint depends on
+*****/
+bool PairFn1B::GetVariables(vector<size_t>& vars) const
+{
+  size_t v[] = {ix, iy, jx, jy};
+  vars.assign(v, v + 4);
+  return true;
+}
+
+
+/*****
+Constructor - read the constants written by PutSelf()
+*****/
+PairFn1B::PairFn1B(istream& is)
+{
+  is >> ix >> iy >> jx >> jy >> p.x >> p.y >> sa >> ca;
+}
+
+
+/*****
+PutSelf - write the name and constants of the constraint
+*****/
+bool PairFn1B::PutSelf(ostream& os) const
+{
+  os << "PairFn1B " << ix << ' ' << iy << ' ' << jx << ' ' << jy
+    << ' ' << p.x << ' ' << p.y << ' ' << sa << ' ' << ca;
+  return true;
+}
+
+
 #ifdef __MWERKS__
 #pragma mark -
 #endif
@@ -789,6 +1231,37 @@ void PairFn2A::Grad(const vector<double>&, vector<double>& du)
 }
 
 
+/*****
+GetVariables - return the variables the constraint depends on
+*****/
+bool PairFn2A::GetVariables(vector<size_t>& vars) const
+{
+  size_t v[] = {ix, iy};
+  vars.assign(v, v + 2);
+  return true;
+}
+
+
+/*****
+Constructor - read the constants written by PutSelf()
+*****/
+PairFn2A::PairFn2A(istream& is)
+{
+  is >> ix >> iy >> vx >> vy >> p.x >> p.y >> sa >> ca;
+}
+
+
+/*****
+PutSelf - write the name and constants of the constraint
+*****/
+bool PairFn2A::PutSelf(ostream& os) const
+{
+  os << "PairFn2A " << ix << ' ' << iy << ' ' << vx << ' ' << vy
+    << ' ' << p.x << ' ' << p.y << ' ' << sa << ' ' << ca;
+  return true;
+}
+
+
 #ifdef __MWERKS__
 #pragma mark -
 #endif
@@ -832,6 +1305,37 @@ void PairFn2B::Grad(const vector<double>&, vector<double>& du)
 }
 
 
+/*****
+GetVariables - return the variables the constraint depends on
+*****/
+bool PairFn2B::GetVariables(vector<size_t>& vars) const
+{
+  size_t v[] = {ix, iy};
+  vars.assign(v, v + 2);
+  return true;
+}
+
+
+/*****
+Constructor - read the constants written by PutSelf()
+*****/
+PairFn2B::PairFn2B(istream& is)
+{
+  is >> ix >> iy >> vx >> vy >> p.x >> p.y >> sa >> ca;
+}
+
+
+/*****
+PutSelf - write the name and constants of the constraint
+*****/
+bool PairFn2B::PutSelf(ostream& os) const
+{
+  os << "PairFn2B " << ix << ' ' << iy << ' ' << vx << ' ' << vy
+    << ' ' << p.x << ' ' << p.y << ' ' << sa << ' ' << ca;
+  return true;
+}
+
+
 #ifdef __MWERKS__
 #pragma mark -
 #endif
@@ -854,38 +1358,33 @@ Constructor - record constants and index into data array
 *****/
 CollinearFn1::CollinearFn1(size_t aix, size_t aiy, size_t ajx, size_t ajy, size_t akx, size_t aky)
 {
-  ix = aix;
-  iy = aiy;
-  jx = ajx;
-  jy = ajy;
-  kx = akx;
-  ky = aky;
+  mVars[0] = aix;
+  mVars[1] = aiy;
+  mVars[2] = ajx;
+  mVars[3] = ajy;
+  mVars[4] = akx;
+  mVars[5] = aky;
 }
 
 
 /*****
-Func - return the value of the constraint
+Constructor - read the constants written by PutSelf()
 *****/
-double CollinearFn1::Func(const vector<double>& u)
+CollinearFn1::CollinearFn1(istream& is)
 {
-  IncFuncCalls();
-  return (u[jy] - u[iy]) * (u[kx] - u[jx]) - (u[ky] - u[jy]) * (u[jx] - u[ix]);
+  is >> mVars[0] >> mVars[1] >> mVars[2] >> mVars[3] >> mVars[4] >> mVars[5];
 }
 
 
 /*****
-Grad - return the gradient of the constraint
+PutSelf - write the name and constants of the constraint
 *****/
-void CollinearFn1::Grad(const vector<double>& u, vector<double>& du)
+bool CollinearFn1::PutSelf(ostream& os) const
 {
-  IncGradCalls();
-  du.assign(du.size(), 0.);
-  du[ix] = (u[ky] - u[jy]);
-  du[kx] = (u[jy] - u[iy]);
-  du[jx] = -(du[ix] + du[kx]);
-  du[iy] = (u[jx] - u[kx]);
-  du[ky] = (u[ix] - u[jx]);
-  du[jy] = -(du[iy] + du[ky]);
+  os << "CollinearFn1 " << mVars[0] << ' ' << mVars[1]
+    << ' ' << mVars[2] << ' ' << mVars[3] << ' ' << mVars[4]
+    << ' ' << mVars[5];
+  return true;
 }
 
 
@@ -911,36 +1410,32 @@ Constructor - record constants and index into data array
 *****/
 CollinearFn2::CollinearFn2(size_t aix, size_t aiy, size_t ajx, size_t ajy, double awx, double awy)
 {
-  ix = aix;
-  iy = aiy;
-  jx = ajx;
-  jy = ajy;
+  mVars[0] = aix;
+  mVars[1] = aiy;
+  mVars[2] = ajx;
+  mVars[3] = ajy;
   wx = awx;
   wy = awy;
 }
 
 
 /*****
-Func - return the value of the constraint
+Constructor - read the constants written by PutSelf()
 *****/
-double CollinearFn2::Func(const vector<double>& u)
+CollinearFn2::CollinearFn2(istream& is)
 {
-  IncFuncCalls();
-  return (u[jy] - u[iy]) * (wx - u[jx]) - (wy - u[jy]) * (u[jx] - u[ix]);
+  is >> mVars[0] >> mVars[1] >> mVars[2] >> mVars[3] >> wx >> wy;
 }
 
 
 /*****
-Grad - return the gradient of the constraint
+PutSelf - write the name and constants of the constraint
 *****/
-void CollinearFn2::Grad(const vector<double>& u, vector<double>& du)
+bool CollinearFn2::PutSelf(ostream& os) const
 {
-  IncGradCalls();
-  du.assign(du.size(), 0.);
-  du[ix] = (wy - u[jy]);
-  du[jx] = -du[ix];
-  du[iy] = (u[jx] - wx);
-  du[jy] = -du[iy];
+  os << "CollinearFn2 " << mVars[0] << ' ' << mVars[1]
+    << ' ' << mVars[2] << ' ' << mVars[3] << ' ' << wx << ' ' << wy;
+  return true;
 }
 
 
@@ -966,8 +1461,8 @@ Constructor - record constants and index into data array
 *****/
 CollinearFn3::CollinearFn3(size_t aix, size_t aiy, double avx, double avy, double awx, double awy)
 {
-  ix = aix;
-  iy = aiy;
+  mVars[0] = aix;
+  mVars[1] = aiy;
   vx = avx;
   vy = avy;
   wx = awx;
@@ -976,24 +1471,22 @@ CollinearFn3::CollinearFn3(size_t aix, size_t aiy, double avx, double avy, doubl
 
 
 /*****
-Func - return the value of the constraint
+Constructor - read the constants written by PutSelf()
 *****/
-double CollinearFn3::Func(const vector<double>& u)
+CollinearFn3::CollinearFn3(istream& is)
 {
-  IncFuncCalls();
-  return (vy - u[iy]) * (wx - vx) - (wy - vy) * (vx - u[ix]);
+  is >> mVars[0] >> mVars[1] >> vx >> vy >> wx >> wy;
 }
 
 
 /*****
-Grad - return the gradient of the constraint
+PutSelf - write the name and constants of the constraint
 *****/
-void CollinearFn3::Grad(const vector<double>&, vector<double>& du)
+bool CollinearFn3::PutSelf(ostream& os) const
 {
-  IncGradCalls();
-  du.assign(du.size(), 0.);
-  du[ix] = (wy - vy);
-  du[iy] = (vx - wx);
+  os << "CollinearFn3 " << mVars[0] << ' ' << mVars[1] << ' ' << vx
+    << ' ' << vy << ' ' << wx << ' ' << wy;
+  return true;
 }
 
 
@@ -1055,6 +1548,38 @@ void BoundaryFn::Grad(const vector<double>&, vector<double>& du)
 }
 
 
+/*****
+GetVariables - return the variables the constraint depends on
+*****/
+bool BoundaryFn::GetVariables(vector<size_t>& vars) const
+{
+  size_t v[] = {ix, iy};
+  vars.assign(v, v + 2);
+  return true;
+}
+
+
+/*****
+Constructor - read the constants written by PutSelf()
+*****/
+BoundaryFn::BoundaryFn(istream& is)
+{
+  is >> ix >> iy >> p1.x >> p1.y >> p2.x >> p2.y >> q.x >> q.y >> t.x >> t.y;
+}
+
+
+/*****
+PutSelf - write the name and constants of the constraint
+*****/
+bool BoundaryFn::PutSelf(ostream& os) const
+{
+  os << "BoundaryFn " << ix << ' ' << iy << ' ' << p1.x << ' ' << p1.y
+    << ' ' << p2.x << ' ' << p2.y << ' ' << q.x << ' ' << q.y << ' ' << t.x
+    << ' ' << t.y;
+  return true;
+}
+
+
 #ifdef __MWERKS__
 #pragma mark -
 #endif
@@ -1278,6 +1803,37 @@ void QuantizeAngleFn1::Grad(const vector<double>& u, vector<double>& du)
 #endif
 
 
+/*****
+GetVariables - return the variables the constraint depends on
+*****/
+bool QuantizeAngleFn1::GetVariables(vector<size_t>& vars) const
+{
+  size_t v[] = {ix, iy, jx, jy};
+  vars.assign(v, v + 4);
+  return true;
+}
+
+
+/*****
+Constructor - read the constants written by PutSelf()
+*****/
+QuantizeAngleFn1::QuantizeAngleFn1(istream& is)
+{
+  is >> ix >> iy >> jx >> jy >> n >> da >> oa >> wt;
+}
+
+
+/*****
+PutSelf - write the name and constants of the constraint
+*****/
+bool QuantizeAngleFn1::PutSelf(ostream& os) const
+{
+  os << "QuantizeAngleFn1 " << ix << ' ' << iy << ' ' << jx << ' ' << jy
+    << ' ' << n << ' ' << da << ' ' << oa << ' ' << wt;
+  return true;
+}
+
+
 #ifdef __MWERKS__
 #pragma mark -
 #endif
@@ -1366,6 +1922,37 @@ void QuantizeAngleFn2::Grad(const vector<double>& u, vector<double>& du)
 }
 
 
+/*****
+GetVariables - return the variables the constraint depends on
+*****/
+bool QuantizeAngleFn2::GetVariables(vector<size_t>& vars) const
+{
+  size_t v[] = {ix, iy};
+  vars.assign(v, v + 2);
+  return true;
+}
+
+
+/*****
+Constructor - read the constants written by PutSelf()
+*****/
+QuantizeAngleFn2::QuantizeAngleFn2(istream& is)
+{
+  is >> ix >> iy >> vx >> vy >> n >> da >> oa >> wt;
+}
+
+
+/*****
+PutSelf - write the name and constants of the constraint
+*****/
+bool QuantizeAngleFn2::PutSelf(ostream& os) const
+{
+  os << "QuantizeAngleFn2 " << ix << ' ' << iy << ' ' << vx << ' ' << vy
+    << ' ' << n << ' ' << da << ' ' << oa << ' ' << wt;
+  return true;
+}
+
+
 #ifdef __MWERKS__
 #pragma mark -
 #endif
@@ -1392,37 +1979,32 @@ Constructor - record constants and index into data array
 LocalizeFn::LocalizeFn(size_t aix, size_t aiy, double avx, double avy,
   double ar)
 {
-  ix = aix;
-  iy = aiy;
+  mVars[0] = aix;
+  mVars[1] = aiy;
   vx = avx;
   vy = avy;
   r = ar;
+  wt = k_Localize_Weight;
 }
 
 
 /*****
-Func - return the value of the constraint
+Constructor - read the constants written by PutSelf()
 *****/
-double LocalizeFn::Func(const vector<double>& u)
+LocalizeFn::LocalizeFn(istream& is)
 {
-  IncFuncCalls();
-  return k_Localize_Weight * sqrt(pow(u[ix] - vx, 2) + pow(u[iy] - vy, 2)) - r;
+  is >> mVars[0] >> mVars[1] >> vx >> vy >> r >> wt;
 }
 
 
 /*****
-Grad - return the gradient of the constraint
+PutSelf - write the name and constants of the constraint
 *****/
-void LocalizeFn::Grad(const vector<double>& u, vector<double>& du)
+bool LocalizeFn::PutSelf(ostream& os) const
 {
-  IncGradCalls();
-  du.assign(du.size(), 0.);
-  double temp = sqrt(pow(u[ix] - vx, 2) + pow(u[iy] - vy, 2));
-  if (temp != 0) 
-    temp = 1. / temp;  // setting temp to 0 is better than NaN
-  temp = k_Localize_Weight * temp;
-  du[ix] = temp * (u[ix] - vx);
-  du[iy] = temp * (u[iy] - vy);
+  os << "LocalizeFn " << mVars[0] << ' ' << mVars[1] << ' ' << vx
+    << ' ' << vy << ' ' << r << ' ' << wt;
+  return true;
 }
 
 
@@ -1496,6 +2078,65 @@ void MultiStrainPathFn1::Grad(const vector<double>& u, vector<double>& du)
 }
 
 
+/*****
+FuncGrad - return the value and gradient of the constraint in one pass
+*****/
+double MultiStrainPathFn1::FuncGrad(const vector<double>& u, vector<double>& du)
+{
+  IncFuncCalls();
+  IncGradCalls();
+  du.assign(du.size(), 0.);
+  double pathlen = lfix;
+  for (size_t i = 0; i < ni; ++i) {
+    pathlen += u[vi[i]] * vf[i];
+    du[vi[i]] = vf[i];
+  }
+  double dist = sqrt(pow(u[ix] - u[jx], 2) + pow(u[iy] - u[jy], 2));
+  double temp = (dist != 0) ? 1. / dist : 0.;
+  du[ix] = temp * (u[jx] - u[ix]);
+  du[jx] = - du[ix];
+  du[iy] = temp * (u[jy] - u[iy]);
+  du[jy] = - du[iy];
+  return pathlen - dist;
+}
+
+
+/*****
+GetVariables - return the variables the constraint depends on
+*****/
+bool MultiStrainPathFn1::GetVariables(vector<size_t>& vars) const
+{
+  size_t v[] = {ix, iy, jx, jy};
+  vars.assign(v, v + 4);
+  for (size_t i = 0; i < ni; ++i) vars.push_back(vi[i]);
+  return true;
+}
+
+
+/*****
+Constructor - read the constants written by PutSelf()
+*****/
+MultiStrainPathFn1::MultiStrainPathFn1(istream& is)
+{
+  is >> ix >> iy >> jx >> jy >> lfix >> ni;
+  vi.resize(ni);
+  vf.resize(ni);
+  for (size_t i = 0; i < ni; ++i) is >> vi[i] >> vf[i];
+}
+
+
+/*****
+PutSelf - write the name and constants of the constraint
+*****/
+bool MultiStrainPathFn1::PutSelf(ostream& os) const
+{
+  os << "MultiStrainPathFn1 " << ix << ' ' << iy << ' ' << jx
+    << ' ' << jy << ' ' << lfix << ' ' << ni;
+  for (size_t i = 0; i < ni; ++i) os << ' ' << vi[i] << ' ' << vf[i];
+  return true;
+}
+
+
 #ifdef __MWERKS__
 #pragma mark -
 #endif
@@ -1563,6 +2204,42 @@ void MultiStrainPathFn2::Grad(const vector<double>& u, vector<double>& du)
 }
 
 
+/*****
+GetVariables - return the variables the constraint depends on
+*****/
+bool MultiStrainPathFn2::GetVariables(vector<size_t>& vars) const
+{
+  size_t v[] = {ix, iy};
+  vars.assign(v, v + 2);
+  for (size_t i = 0; i < ni; ++i) vars.push_back(vi[i]);
+  return true;
+}
+
+
+/*****
+Constructor - read the constants written by PutSelf()
+*****/
+MultiStrainPathFn2::MultiStrainPathFn2(istream& is)
+{
+  is >> ix >> iy >> vx >> vy >> lfix >> ni;
+  vi.resize(ni);
+  vf.resize(ni);
+  for (size_t i = 0; i < ni; ++i) is >> vi[i] >> vf[i];
+}
+
+
+/*****
+PutSelf - write the name and constants of the constraint
+*****/
+bool MultiStrainPathFn2::PutSelf(ostream& os) const
+{
+  os << "MultiStrainPathFn2 " << ix << ' ' << iy << ' ' << vx
+    << ' ' << vy << ' ' << lfix << ' ' << ni;
+  for (size_t i = 0; i < ni; ++i) os << ' ' << vi[i] << ' ' << vf[i];
+  return true;
+}
+
+
 #ifdef __MWERKS__
 #pragma mark -
 #endif
@@ -1626,6 +2303,41 @@ void MultiStrainPathFn3::Grad(const vector<double>&, vector<double>& du)
 }
 
 
+/*****
+GetVariables - return the variables the constraint depends on
+*****/
+bool MultiStrainPathFn3::GetVariables(vector<size_t>& vars) const
+{
+  vars.clear();
+  for (size_t i = 0; i < ni; ++i) vars.push_back(vi[i]);
+  return true;
+}
+
+
+/*****
+Constructor - read the constants written by PutSelf()
+*****/
+MultiStrainPathFn3::MultiStrainPathFn3(istream& is)
+{
+  is >> ux >> uy >> vx >> vy >> lfix >> ni;
+  vi.resize(ni);
+  vf.resize(ni);
+  for (size_t i = 0; i < ni; ++i) is >> vi[i] >> vf[i];
+}
+
+
+/*****
+PutSelf - write the name and constants of the constraint
+*****/
+bool MultiStrainPathFn3::PutSelf(ostream& os) const
+{
+  os << "MultiStrainPathFn3 " << ux << ' ' << uy << ' ' << vx
+    << ' ' << vy << ' ' << lfix << ' ' << ni;
+  for (size_t i = 0; i < ni; ++i) os << ' ' << vi[i] << ' ' << vf[i];
+  return true;
+}
+
+
 #ifdef __MWERKS__
 #pragma mark -
 #endif
@@ -1645,6 +2357,51 @@ w is the width (or height) of the paper.
 Constructor - record constants and index into data array
 *****/
 CornerFn::CornerFn(size_t aix, double aw)
+{
+  mVars[0] = aix;
+  w = aw;
+}
+
+
+/*****
+Constructor - read the constants written by PutSelf()
+*****/
+CornerFn::CornerFn(istream& is)
+{
+  is >> mVars[0] >> w;
+}
+
+
+/*****
+PutSelf - write the name and constants of the constraint
+*****/
+bool CornerFn::PutSelf(ostream& os) const
+{
+  os << "CornerFn " << mVars[0] << ' ' << w;
+  return true;
+}
+
+
+#ifdef __MWERKS__
+#pragma mark -
+#endif
+
+
+/*****************************************************************************
+class WeightedSquaresFn
+The WeightedSquaresFn implements a function of several variables of the form
+ sum(i) w[i] * u[ix + i]^2
+that is the objective of strain minimization. It stands in for that objective
+when a recorded problem is read back (see tmRecordingNLCO).
+Member variables are:
+ix is the index of the first variable
+w is a vector of the weights of the variables
+******************************************************************************/
+
+/*****
+Constructor - record constants and index into data array
+*****/
+WeightedSquaresFn::WeightedSquaresFn(size_t aix, const vector<double>& aw)
 {
   ix = aix;
   w = aw;
@@ -1652,21 +2409,57 @@ CornerFn::CornerFn(size_t aix, double aw)
 
 
 /*****
-Func - return the value of the constraint
+Func - return the value of the function
 *****/
-double CornerFn::Func(const vector<double>& u)
+double WeightedSquaresFn::Func(const vector<double>& u)
 {
   IncFuncCalls();
-  return u[ix] * (u[ix] - w);
+  double f = 0;
+  for (size_t i = 0; i < w.size(); ++i) f += w[i] * pow(u[ix + i], 2);
+  return f;
 }
 
 
 /*****
-Grad - return the gradient of the constraint
+Grad - return the gradient of the function
 *****/
-void CornerFn::Grad(const vector<double>& u, vector<double>& du)
+void WeightedSquaresFn::Grad(const vector<double>& u, vector<double>& du)
 {
   IncGradCalls();
   du.assign(du.size(), 0.);
-  du[ix] = 2 * u[ix] - w;
+  for (size_t i = 0; i < w.size(); ++i) du[ix + i] = 2 * w[i] * u[ix + i];
+}
+
+
+/*****
+GetVariables - return the variables the function depends on
+*****/
+bool WeightedSquaresFn::GetVariables(vector<size_t>& vars) const
+{
+  vars.clear();
+  for (size_t i = 0; i < w.size(); ++i) vars.push_back(ix + i);
+  return true;
+}
+
+
+/*****
+Constructor - read the constants written by PutSelf()
+*****/
+WeightedSquaresFn::WeightedSquaresFn(istream& is)
+{
+  size_t n = 0;
+  is >> ix >> n;
+  w.resize(n);
+  for (size_t i = 0; i < n; ++i) is >> w[i];
+}
+
+
+/*****
+PutSelf - write the name and constants of the function
+*****/
+bool WeightedSquaresFn::PutSelf(ostream& os) const
+{
+  os << "WeightedSquaresFn " << ix << ' ' << w.size();
+  for (size_t i = 0; i < w.size(); ++i) os << ' ' << w[i];
+  return true;
 }
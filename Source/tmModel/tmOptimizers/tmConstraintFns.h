@@ -14,8 +14,12 @@ Copyright:    ©2004 Robert J. Lang. All Rights Reserved.
 // my libraries
 
 #include "tmNLCO.h"
+#include "tmAutoDiffFn.h"
 #include "tmPoint.h"
 
+#include <cmath>
+#include <iosfwd>
+
 /**********
 class OneVarFn 
 Used to constrain a single variable, e.g., a coordinate of a single node.
@@ -23,8 +27,11 @@ Used to constrain a single variable, e.g., a coordinate of a single node.
 class OneVarFn : public tmDifferentiableFn {
 public:
   OneVarFn(std::size_t aix, double aa, double ab);
+  explicit OneVarFn(std::istream& is);
   double Func(const std::vector<double>& u);
   void Grad(const std::vector<double>& u, std::vector<double>& du);
+  bool GetVariables(std::vector<std::size_t>& vars) const;
+  bool PutSelf(std::ostream& os) const;
 private:
   std::size_t ix;
   double a;
@@ -39,8 +46,11 @@ Used to constrain two variables, e.g., a pair of strains
 class TwoVarFn : public tmDifferentiableFn {
 public:
   TwoVarFn(std::size_t aix, double aa, std::size_t aiy, double ab, double ac);
+  explicit TwoVarFn(std::istream& is);
   double Func(const std::vector<double>& u);
   void Grad(const std::vector<double>& u, std::vector<double>& du);
+  bool GetVariables(std::vector<std::size_t>& vars) const;
+  bool PutSelf(std::ostream& os) const;
 private:
   std::size_t ix;
   std::size_t iy;
@@ -57,8 +67,12 @@ Used to constrain distances between two nodes when the scale is flexible.
 class PathFn1 : public tmDifferentiableFn {
 public:
   PathFn1(std::size_t aix, std::size_t aiy, std::size_t ajx, std::size_t ajy, double alij);
+  explicit PathFn1(std::istream& is);
   double Func(const std::vector<double>& u);
   void Grad(const std::vector<double>& u, std::vector<double>& du);
+  double FuncGrad(const std::vector<double>& u, std::vector<double>& du);
+  bool GetVariables(std::vector<std::size_t>& vars) const;
+  bool PutSelf(std::ostream& os) const;
 private:
   std::size_t ix;
   std::size_t iy;
@@ -76,8 +90,12 @@ scale is flexible.
 class PathFn2 : public tmDifferentiableFn {
 public:
   PathFn2(std::size_t aix, std::size_t aiy, double avx, double avy, double alij);
+  explicit PathFn2(std::istream& is);
   double Func(const std::vector<double>& u);
   void Grad(const std::vector<double>& u, std::vector<double>& du);
+  double FuncGrad(const std::vector<double>& u, std::vector<double>& du);
+  bool GetVariables(std::vector<std::size_t>& vars) const;
+  bool PutSelf(std::ostream& os) const;
 private:
   std::size_t ix;
   std::size_t iy;
@@ -94,8 +112,11 @@ Used to fix the angle of a path between two movable nodes to a particular value.
 class PathAngleFn1 : public tmDifferentiableFn {
 public:
   PathAngleFn1(std::size_t aix, std::size_t aiy, std::size_t ajx, std::size_t ajy, double aa);
+  explicit PathAngleFn1(std::istream& is);
   double Func(const std::vector<double>& u);
   void Grad(const std::vector<double>& u, std::vector<double>& du);
+  bool GetVariables(std::vector<std::size_t>& vars) const;
+  bool PutSelf(std::ostream& os) const;
 private:
   std::size_t ix;
   std::size_t iy;
@@ -114,8 +135,11 @@ particular value.
 class PathAngleFn2 : public tmDifferentiableFn {
 public:
   PathAngleFn2(std::size_t aix, std::size_t aiy, double avx, double avy, double aa);
+  explicit PathAngleFn2(std::istream& is);
   double Func(const std::vector<double>& u);
   void Grad(const std::vector<double>& u, std::vector<double>& du);  
+  bool GetVariables(std::vector<std::size_t>& vars) const;
+  bool PutSelf(std::ostream& os) const;
 private:
   std::size_t ix;
   std::size_t iy;
@@ -134,8 +158,12 @@ of the edges may be stretchable.
 class StrainPathFn1 : public tmDifferentiableFn {
 public:
   StrainPathFn1(std::size_t aix, std::size_t aiy, std::size_t ajx, std::size_t ajy, double alfix, double alvar);
+  explicit StrainPathFn1(std::istream& is);
   double Func(const std::vector<double>& u);
   void Grad(const std::vector<double>& u, std::vector<double>& du);
+  double FuncGrad(const std::vector<double>& u, std::vector<double>& du);
+  bool GetVariables(std::vector<std::size_t>& vars) const;
+  bool PutSelf(std::ostream& os) const;
 private:
   std::size_t ix;
   std::size_t iy;
@@ -154,8 +182,12 @@ and a fixed node when some of the edges may be stretchable.
 class StrainPathFn2 : public tmDifferentiableFn {
 public:
   StrainPathFn2(std::size_t aix, std::size_t aiy, double avx, double avy, double alfix, double alvar);
+  explicit StrainPathFn2(std::istream& is);
   double Func(const std::vector<double>& u);
   void Grad(const std::vector<double>& u, std::vector<double>& du);  
+  double FuncGrad(const std::vector<double>& u, std::vector<double>& du);
+  bool GetVariables(std::vector<std::size_t>& vars) const;
+  bool PutSelf(std::ostream& os) const;
 private:
   std::size_t ix;
   std::size_t iy;
@@ -174,8 +206,11 @@ may be stretchable.
 class StrainPathFn3 : public tmDifferentiableFn {
 public:
   StrainPathFn3(double aux, double auy, double avx, double avy, double alfix, double alvar);
+  explicit StrainPathFn3(std::istream& is);
   double Func(const std::vector<double>& u);
   void Grad(const std::vector<double>& u, std::vector<double>& du);    
+  bool GetVariables(std::vector<std::size_t>& vars) const;
+  bool PutSelf(std::ostream& os) const;
 private:
   double ux;
   double uy;
@@ -190,16 +225,19 @@ private:
 class StickToEdgeFn
 Used to constrain a coordinate to lie on the edge of the paper.
 **********/
-class StickToEdgeFn : public tmDifferentiableFn {
+class StickToEdgeFn : public tmAutoDiffFn<StickToEdgeFn, 2> {
 public:
   StickToEdgeFn(std::size_t aix, std::size_t aiy, double aw, double ah);
-  double Func(const std::vector<double>& u);
-  void Grad(const std::vector<double>& u, std::vector<double>& du);
+  explicit StickToEdgeFn(std::istream& is);
+  bool PutSelf(std::ostream& os) const;
+  template <class T>
+  T Eval(const T* x) const {
+    return wt * x[0] * (x[0] - w) * x[1] * (x[1] - h);
+  };
 private:
-  std::size_t ix;
-  std::size_t iy;
   double w;
   double h;
+  double wt;
 };
 
 
@@ -211,8 +249,11 @@ The line is defined by a point on the line and the angle of the line.
 class StickToLineFn : public tmDifferentiableFn {
 public:
   StickToLineFn(std::size_t aix, std::size_t aiy, tmPoint ap, double aa);
+  explicit StickToLineFn(std::istream& is);
   double Func(const std::vector<double>& u);
   void Grad(const std::vector<double>& u, std::vector<double>& du);
+  bool GetVariables(std::vector<std::size_t>& vars) const;
+  bool PutSelf(std::ostream& os) const;
 private:
   std::size_t ix;
   std::size_t iy;
@@ -237,8 +278,11 @@ Used to constraint two movable nodes to be mirror-symmetric.
 class PairFn1A : public tmDifferentiableFn {
 public:
   PairFn1A(std::size_t aix, std::size_t aiy, std::size_t ajx, std::size_t ajy, tmPoint ap, double aa);
+  explicit PairFn1A(std::istream& is);
   double Func(const std::vector<double>& u);
   void Grad(const std::vector<double>& u, std::vector<double>& du);
+  bool GetVariables(std::vector<std::size_t>& vars) const;
+  bool PutSelf(std::ostream& os) const;
 private:
   std::size_t ix;
   std::size_t iy;
@@ -257,8 +301,11 @@ Used to constraint two movable nodes to be mirror-symmetric.
 class PairFn1B : public tmDifferentiableFn {
 public:
   PairFn1B(std::size_t aix, std::size_t aiy, std::size_t ajx, std::size_t ajy, tmPoint ap, double aa);
+  explicit PairFn1B(std::istream& is);
   double Func(const std::vector<double>& u);
   void Grad(const std::vector<double>& u, std::vector<double>& du);
+  bool GetVariables(std::vector<std::size_t>& vars) const;
+  bool PutSelf(std::ostream& os) const;
 private:
   std::size_t ix;
   std::size_t iy;
@@ -284,8 +331,11 @@ Used to constrain a fixed and a movable node to be mirror-symmetric.
 class PairFn2A : public tmDifferentiableFn {
 public:
   PairFn2A(std::size_t aix, std::size_t aiy, double avx, double avy, tmPoint ap, double aa);
+  explicit PairFn2A(std::istream& is);
   double Func(const std::vector<double>& u);
   void Grad(const std::vector<double>& u, std::vector<double>& du);
+  bool GetVariables(std::vector<std::size_t>& vars) const;
+  bool PutSelf(std::ostream& os) const;
 private:
   std::size_t ix;
   std::size_t iy;
@@ -304,8 +354,11 @@ Used to constrain a fixed and a movable node to be mirror-symmetric.
 class PairFn2B : public tmDifferentiableFn {
 public:
   PairFn2B(std::size_t aix, std::size_t aiy, double avx, double avy, tmPoint ap, double aa);
+  explicit PairFn2B(std::istream& is);
   double Func(const std::vector<double>& u);
   void Grad(const std::vector<double>& u, std::vector<double>& du);
+  bool GetVariables(std::vector<std::size_t>& vars) const;
+  bool PutSelf(std::ostream& os) const;
 private:
   std::size_t ix;
   std::size_t iy;
@@ -329,18 +382,16 @@ CollinearFn3 is used when 1 node is variable.
 class CollinearFn1
 Used to constrain 3 nodes to lie on the same line when 3 nodes are variable.
 **********/
-class CollinearFn1 : public tmDifferentiableFn {
+class CollinearFn1 : public tmAutoDiffFn<CollinearFn1, 6> {
 public:
   CollinearFn1(std::size_t aix, std::size_t aiy, std::size_t ajx, std::size_t ajy, std::size_t akx, std::size_t aky);
-  double Func(const std::vector<double>& u);
-  void Grad(const std::vector<double>& u, std::vector<double>& du);  
-private:
-  std::size_t ix;
-  std::size_t iy;
-  std::size_t jx;
-  std::size_t jy;
-  std::size_t kx;
-  std::size_t ky;
+  explicit CollinearFn1(std::istream& is);
+  bool PutSelf(std::ostream& os) const;
+  template <class T>
+  T Eval(const T* x) const {
+    // x = (ix, iy, jx, jy, kx, ky)
+    return (x[3] - x[1]) * (x[4] - x[2]) - (x[5] - x[3]) * (x[2] - x[0]);
+  };
 };
 
 
@@ -348,16 +399,17 @@ private:
 class CollinearFn2
 Used to constrain 3 nodes to lie on the same line when 2 nodes are variable.
 **********/
-class CollinearFn2 : public tmDifferentiableFn {
+class CollinearFn2 : public tmAutoDiffFn<CollinearFn2, 4> {
 public:
   CollinearFn2(std::size_t aix, std::size_t aiy, std::size_t ajx, std::size_t ajy, double awx, double awy);
-  double Func(const std::vector<double>& u);
-  void Grad(const std::vector<double>& u, std::vector<double>& du);  
+  explicit CollinearFn2(std::istream& is);
+  bool PutSelf(std::ostream& os) const;
+  template <class T>
+  T Eval(const T* x) const {
+    // x = (ix, iy, jx, jy)
+    return (x[3] - x[1]) * (wx - x[2]) - (wy - x[3]) * (x[2] - x[0]);
+  };
 private:
-  std::size_t ix;
-  std::size_t iy;
-  std::size_t jx;
-  std::size_t jy;
   double wx;
   double wy;
 };
@@ -367,14 +419,16 @@ private:
 class CollinearFn3
 Used to constrain 3 nodes to lie on the same line when 1 node is variable.
 **********/
-class CollinearFn3 : public tmDifferentiableFn {
+class CollinearFn3 : public tmAutoDiffFn<CollinearFn3, 2> {
 public:
   CollinearFn3(std::size_t aix, std::size_t aiy, double avx, double avy, double awx, double awy);
-  double Func(const std::vector<double>& u);
-  void Grad(const std::vector<double>& u, std::vector<double>& du);
+  explicit CollinearFn3(std::istream& is);
+  bool PutSelf(std::ostream& os) const;
+  template <class T>
+  T Eval(const T* x) const {
+    return (vy - x[1]) * (wx - vx) - (wy - vy) * (vx - x[0]);
+  };
 private:
-  std::size_t ix;
-  std::size_t iy;
   double vx;
   double vy;
   double wx;
@@ -390,8 +444,11 @@ points p1 and p2 as point q is on.
 class BoundaryFn : public tmDifferentiableFn {
 public:
   BoundaryFn(std::size_t aix, std::size_t aiy, tmPoint ap1, tmPoint ap2, tmPoint aq);
+  explicit BoundaryFn(std::istream& is);
   double Func(const std::vector<double>& u);
   void Grad(const std::vector<double>& u, std::vector<double>& du);  
+  bool GetVariables(std::vector<std::size_t>& vars) const;
+  bool PutSelf(std::ostream& os) const;
 private:
   std::size_t ix;
   std::size_t iy;
@@ -410,8 +467,11 @@ class QuantizeAngleFn1 : public tmDifferentiableFn {
 public:
   QuantizeAngleFn1(std::size_t aix, std::size_t aiy, std::size_t ajx, std::size_t ajy,
     std::size_t an, double aoffset);
+  explicit QuantizeAngleFn1(std::istream& is);
   double Func(const std::vector<double>& u);
   void Grad(const std::vector<double>& u, std::vector<double>& du);
+  bool GetVariables(std::vector<std::size_t>& vars) const;
+  bool PutSelf(std::ostream& os) const;
 private:
   std::size_t ix;
   std::size_t iy;
@@ -432,8 +492,11 @@ class QuantizeAngleFn2 : public tmDifferentiableFn {
 public:
   QuantizeAngleFn2(std::size_t aix, std::size_t aiy, double avx, double avy,
     std::size_t an, double aoffset);
+  explicit QuantizeAngleFn2(std::istream& is);
   double Func(const std::vector<double>& u);
   void Grad(const std::vector<double>& u, std::vector<double>& du);
+  bool GetVariables(std::vector<std::size_t>& vars) const;
+  bool PutSelf(std::ostream& os) const;
 private:
   std::size_t ix;
   std::size_t iy;
@@ -450,17 +513,22 @@ private:
 class LocalizeFn
 Used to constrain the coordinates of a node to lie within a circle of a given radius.
 **********/
-class LocalizeFn : public tmDifferentiableFn {
+class LocalizeFn : public tmAutoDiffFn<LocalizeFn, 2> {
 public:
   LocalizeFn(std::size_t aix, std::size_t aiy, double avx, double avy, double ar);
-  double Func(const std::vector<double>& u);
-  void Grad(const std::vector<double>& u, std::vector<double>& du);
+  explicit LocalizeFn(std::istream& is);
+  bool PutSelf(std::ostream& os) const;
+  template <class T>
+  T Eval(const T* x) const {
+    using std::sqrt;
+    using std::pow;
+    return wt * sqrt(pow(x[0] - vx, 2) + pow(x[1] - vy, 2)) - r;
+  };
 private:
-  std::size_t ix;
-  std::size_t iy;
   double vx;
   double vy;
   double r;
+  double wt;
 };
 
 
@@ -473,8 +541,12 @@ class MultiStrainPathFn1 : public tmDifferentiableFn {
 public:
   MultiStrainPathFn1(std::size_t aix, std::size_t aiy, std::size_t ajx, std::size_t ajy, double alfix,
     std::size_t ani, std::vector<std::size_t>& avi, std::vector<double>& avf);
+  explicit MultiStrainPathFn1(std::istream& is);
   double Func(const std::vector<double>& u);
   void Grad(const std::vector<double>& u, std::vector<double>& du);
+  double FuncGrad(const std::vector<double>& u, std::vector<double>& du);
+  bool GetVariables(std::vector<std::size_t>& vars) const;
+  bool PutSelf(std::ostream& os) const;
 private:
   std::size_t ix;
   std::size_t iy;
@@ -496,8 +568,11 @@ class MultiStrainPathFn2 : public tmDifferentiableFn {
 public:
   MultiStrainPathFn2(std::size_t aix, std::size_t aiy, double avx, double avy, double alfix,
     std::size_t ani, std::vector<std::size_t>& avi, std::vector<double>& avf);
+  explicit MultiStrainPathFn2(std::istream& is);
   double Func(const std::vector<double>& u);
   void Grad(const std::vector<double>& u, std::vector<double>& du);  
+  bool GetVariables(std::vector<std::size_t>& vars) const;
+  bool PutSelf(std::ostream& os) const;
 private:
   std::size_t ix;
   std::size_t iy;
@@ -519,8 +594,11 @@ class MultiStrainPathFn3 : public tmDifferentiableFn {
 public:
   MultiStrainPathFn3(double aux, double auy, double avx, double avy, double alfix,
     std::size_t ani, std::vector<std::size_t>& avi, std::vector<double>& avf);
+  explicit MultiStrainPathFn3(std::istream& is);
   double Func(const std::vector<double>& u);
   void Grad(const std::vector<double>& u, std::vector<double>& du);
+  bool GetVariables(std::vector<std::size_t>& vars) const;
+  bool PutSelf(std::ostream& os) const;
 private:
   double ux;
   double uy;
@@ -537,14 +615,37 @@ private:
 class CornerFn
 Used (in pairs) to constrain nodes to lie on any corner of the paper.
 **********/
-class CornerFn : public tmDifferentiableFn {
+class CornerFn : public tmAutoDiffFn<CornerFn, 1> {
 public:
   CornerFn(std::size_t aix, double aw);
+  explicit CornerFn(std::istream& is);
+  bool PutSelf(std::ostream& os) const;
+  template <class T>
+  T Eval(const T* x) const {
+    return x[0] * (x[0] - w);
+  };
+private:
+  double w;
+};
+
+
+/**********
+class WeightedSquaresFn
+A weighted sum of the squares of a run of variables, e.g., the strain
+minimization objective.
+**********/
+class WeightedSquaresFn : public tmDifferentiableFn {
+public:
+  WeightedSquaresFn(std::size_t aix, const std::vector<double>& aw);
+  explicit WeightedSquaresFn(std::istream& is);
   double Func(const std::vector<double>& u);
   void Grad(const std::vector<double>& u, std::vector<double>& du);
+  bool GetVariables(std::vector<std::size_t>& vars) const;
+  bool PutSelf(std::ostream& os) const;
 private:
   std::size_t ix;
-  double w;
+  std::vector<double> w;
 };
 
+
 #endif // _TMCONSTRAINTFNS_H_
@@ -10,6 +10,7 @@ Copyright:    ©2003 Robert J. Lang. All Rights Reserved.
 
 #include "tmEdgeOptimizer.h"
 #include "tmModel.h"
+#include "tmProfiler.h"
 
 using namespace std;
 
@@ -32,6 +33,7 @@ Initialize the calculation.
 void tmEdgeOptimizer::Initialize(tmDpptrArray<tmNode>& movingNodes, 
     tmDpptrArray<tmEdge>& stretchyEdges)
 {
+  TM_PROFILE_SCOPE("tmEdgeOptimizer::Initialize");
   tmTree* theTree = GetTree(); // to have on hand
   
   // Filter the list to retain only unpinned nodes and unpinned edges
@@ -49,6 +51,8 @@ void tmEdgeOptimizer::Initialize(tmDpptrArray<tmNode>& movingNodes,
   // Set up our state vector
   size_t n = mMovingNodes.size();
   mNumVars = 1 + 2 * n;
+  SplitIntoBlocks();
+  ReduceVariables(mMovingNodes, mNumVars);
   mNLCO->SetSize(mNumVars);
   mCurrentStateVec.resize(mNumVars);
   TreeToData();
@@ -134,6 +138,7 @@ void tmEdgeOptimizer::Initialize(tmDpptrArray<tmNode>& movingNodes,
   tmArrayIterator<tmCondition*> iConditions(theTree->GetConditions());
   tmCondition* aCondition;
   while (iConditions.Next(&aCondition)) aCondition->AddConstraints(this);
+  Presolve();
   
   // Ready to go. User should probably check whether the number of equalities
   // exceeds the number of variables.
@@ -267,3 +272,12 @@ void tmEdgeOptimizerObjective::Grad(const std::vector<double>&,
   du.assign(du.size(), 0.);
   du[0] = -1;
 }
+
+
+/*****
+Write ourselves as the function we are, -u[0], for a recorded problem
+*****/
+bool tmEdgeOptimizerObjective::PutSelf(std::ostream& os) const
+{
+  return OneVarFn(0, -1.0, 0.0).PutSelf(os);
+}
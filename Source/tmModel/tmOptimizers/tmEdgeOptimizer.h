@@ -53,6 +53,7 @@ class tmEdgeOptimizerObjective : public tmDifferentiableFn
 public:
   double Func(const std::vector<double>& u);
   void Grad(const std::vector<double>& u, std::vector<double>& du);
+  bool PutSelf(std::ostream& os) const;
 private:
   tmEdgeOptimizer* mEdgeOptimizer;
   tmEdgeOptimizerObjective(tmEdgeOptimizer* aEdgeOptimizer);
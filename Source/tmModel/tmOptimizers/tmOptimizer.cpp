@@ -10,6 +10,10 @@ Copyright:    ©2005 Robert J. Lang. All Rights Reserved.
 
 #include "tmOptimizer.h"
 #include "tmModel.h"
+#include "tmReducedNLCO.h"
+#include "tmRecordingNLCO.h"
+#include "tmBlockNLCO.h"
+#include "tmProfiler.h"
 
 using namespace std;
 
@@ -19,16 +23,49 @@ Base class for TreeMaker optimizers. Provides two virtual methods that all
 subclasses must support, used for transferring data between optimizer and tree.
 **********/
 
+/*****
+Static member initialization. By default we reduce symmetric problems.
+*****/
+bool tmOptimizer::sReduceSymmetry = true;
+
+
+/*****
+Static member initialization. By default we eliminate the variables that
+conditions fix or tie together.
+*****/
+bool tmOptimizer::sEliminateEqualities = true;
+
+
+/*****
+Static member initialization. By default we split problems into blocks.
+*****/
+bool tmOptimizer::sSplitBlocks = true;
+
+
 /*****
 Constructor
 *****/
 tmOptimizer::tmOptimizer(tmTree* aTree, tmNLCO* aNLCO)
-  : tmTreeCleaner(aTree), mInitialized(false), mNLCO(aNLCO)
+  : tmTreeCleaner(aTree), mInitialized(false), mNLCO(aNLCO), 
+  mReducedNLCO(NULL), mRecordingNLCO(NULL), mBlockNLCO(NULL),
+  mBudget(new tmNLCOBudget())
 {
   aTree->PutSelf(mInitialState);
 }
 
 
+/*****
+Destructor
+*****/
+tmOptimizer::~tmOptimizer()
+{
+  delete mRecordingNLCO;
+  delete mReducedNLCO;
+  delete mBlockNLCO;
+  delete mBudget;
+}
+
+
 /*****
 Revert to the pre-optimization configuration.
 *****/
@@ -43,12 +80,23 @@ Optimize the tree.
 *****/
 void tmOptimizer::Optimize()
 {
+  TM_PROFILE_SCOPE("tmOptimizer::Optimize");
   TMASSERT(mInitialized);
   
-  // Minimize the merit function subject to the constraints. Exceptions can be
-  // generated either by user cancellation.
+  // Minimize the merit function subject to the constraints, within our
+  // budget. Exceptions can be generated either by user cancellation.
   std::vector<double> scratchState = mCurrentStateVec;
-  int inform = mNLCO->Minimize(scratchState);
+  mBudget->Start();
+  mNLCO->SetBudget(mBudget);
+  int inform;
+  try {
+    inform = mNLCO->Minimize(scratchState);
+  }
+  catch (...) {
+    mBudget->Stop();
+    throw;
+  }
+  mBudget->Stop();
   mCurrentStateVec = scratchState;
   
   // Set status
@@ -57,3 +105,273 @@ void tmOptimizer::Optimize()
   // Copy the data into the tree from the state vector
   DataToTree();
 }
+
+
+#ifdef __MWERKS__
+  #pragma mark -
+#endif
+
+
+/*****
+STATIC
+Return true if optimizers set up from now on will take advantage of symmetry.
+*****/
+bool tmOptimizer::GetReduceSymmetry()
+{
+  return sReduceSymmetry;
+}
+
+
+/*****
+STATIC
+Set whether optimizers set up from now on take advantage of symmetry. If not,
+symmetry conditions are imposed as equality constraints.
+*****/
+void tmOptimizer::SetReduceSymmetry(bool reduceSymmetry)
+{
+  sReduceSymmetry = reduceSymmetry;
+}
+
+
+/*****
+Return true if one of these nodes is derived from the other by reflection, in
+which case the condition that pairs them needs no constraints.
+*****/
+bool tmOptimizer::IsReflectedPair(tmNode* aNode1, tmNode* aNode2) const
+{
+  size_t i = mMirrorNodes.GetOffset(aNode2);
+  if (i != tmArray<tmNode*>::BAD_OFFSET && mMirrorReps[i] == aNode1) 
+    return true;
+  i = mMirrorNodes.GetOffset(aNode1);
+  return i != tmArray<tmNode*>::BAD_OFFSET && mMirrorReps[i] == aNode2;
+}
+
+
+/*****
+Return true if this node is confined to the symmetry line by construction, in
+which case the condition that puts it there needs no constraints.
+*****/
+bool tmOptimizer::IsOnSymmetryLine(tmNode* aNode) const
+{
+  return mLineNodes.contains(aNode);
+}
+
+
+/*****
+Return the node whose position is the reflection of this one's by
+construction: its partner if it belongs to a reduced mirror pair, itself if
+it's confined to the symmetry line, or NULL if neither.
+*****/
+tmNode* tmOptimizer::GetMirrorNode(tmNode* aNode) const
+{
+  if (mLineNodes.contains(aNode)) return aNode;
+  size_t i = mMirrorNodes.GetOffset(aNode);
+  if (i != tmArray<tmNode*>::BAD_OFFSET) return mMirrorReps[i];
+  i = mMirrorReps.GetOffset(aNode);
+  if (i != tmArray<tmNode*>::BAD_OFFSET) return mMirrorNodes[i];
+  return NULL;
+}
+
+
+/*****
+STATIC
+Return true if optimizers set up from now on will eliminate the variables that
+conditions fix or tie together.
+*****/
+bool tmOptimizer::GetEliminateEqualities()
+{
+  return sEliminateEqualities;
+}
+
+
+/*****
+STATIC
+Set whether optimizers set up from now on eliminate the variables that
+conditions fix or tie together. If not, the conditions are imposed as equality
+constraints.
+*****/
+void tmOptimizer::SetEliminateEqualities(bool eliminateEqualities)
+{
+  sEliminateEqualities = eliminateEqualities;
+}
+
+
+/*****
+Set up the reduced problem and start recording it. movingNodes are the nodes
+whose coordinates are variables and numVars is the size of the full state
+vector. Call this before passing anything to mNLCO.
+*****/
+void tmOptimizer::ReduceVariables(const tmArray<tmNode*>& movingNodes, 
+  size_t numVars)
+{
+  MakeReducedNLCO(movingNodes, numVars);
+  TMASSERT(!mRecordingNLCO);
+  mRecordingNLCO = new tmRecordingNLCO(mNLCO);
+  mNLCO = mRecordingNLCO;
+  
+  // The conditions won't pose the constraints that the reduction satisfies by
+  // construction, but the recorded problem needs them.
+  tmTree* theTree = GetTree();
+  const tmPoint& p = theTree->GetSymLoc();
+  double angle = theTree->GetSymAngle();
+  for (size_t i = 0; i < mLineNodes.size(); ++i) {
+    size_t ix = GetBaseOffset(mLineNodes[i]);
+    mRecordingNLCO->AddImpliedEquality(new StickToLineFn(ix, ix + 1, p, angle));
+  }
+  for (size_t i = 0; i < mMirrorNodes.size(); ++i) {
+    size_t ix = GetBaseOffset(mMirrorReps[i]);
+    size_t jx = GetBaseOffset(mMirrorNodes[i]);
+    mRecordingNLCO->AddImpliedEquality(
+      new PairFn1A(ix, ix + 1, jx, jx + 1, p, angle));
+    mRecordingNLCO->AddImpliedEquality(
+      new PairFn1B(ix, ix + 1, jx, jx + 1, p, angle));
+  }
+}
+
+
+/*****
+Route the problem through a tmReducedNLCO if it can be reduced. If the tree is
+symmetric, find the mirror pairs and symmetric nodes among the moving nodes. A
+node takes part in at most one symmetry reduction; any further symmetry
+conditions on it are imposed as constraints, unless Presolve() can eliminate
+them.
+*****/
+void tmOptimizer::MakeReducedNLCO(const tmArray<tmNode*>& movingNodes, 
+  size_t numVars)
+{
+  tmTree* theTree = GetTree();
+  bool reduceSymmetry = sReduceSymmetry && theTree->HasSymmetry();
+  if (!reduceSymmetry && !sEliminateEqualities) return;
+  TMASSERT(!mReducedNLCO);
+  
+  // derived[k] is true if variable k will be computed from the others.
+  vector<bool> derived(numVars, false);
+  tmArrayIterator<tmCondition*> iConditions(theTree->GetConditions());
+  tmCondition* aCondition;
+  while (reduceSymmetry && iConditions.Next(&aCondition)) {
+    if (tmConditionNodesPaired* c = 
+      dynamic_cast<tmConditionNodesPaired*>(aCondition)) {
+      tmNode* node1 = c->GetNode1();
+      tmNode* node2 = c->GetNode2();
+      if (node1 == node2 || !movingNodes.contains(node1) || 
+        !movingNodes.contains(node2)) continue;
+      size_t ix = GetBaseOffset(node1);
+      size_t jx = GetBaseOffset(node2);
+      if (derived[ix] || derived[jx] || mMirrorReps.contains(node1) ||
+        mMirrorReps.contains(node2)) continue;
+      derived[jx] = derived[jx + 1] = true;
+      mMirrorNodes.push_back(node2);
+      mMirrorReps.push_back(node1);
+    }
+    else if (tmConditionNodeSymmetric* c = 
+      dynamic_cast<tmConditionNodeSymmetric*>(aCondition)) {
+      tmNode* aNode = c->GetNode();
+      if (!movingNodes.contains(aNode)) continue;
+      size_t ix = GetBaseOffset(aNode);
+      if (derived[ix] || mMirrorReps.contains(aNode)) continue;
+      derived[ix] = derived[ix + 1] = true;
+      mLineNodes.push_back(aNode);
+    }
+  }
+  if (mMirrorNodes.empty() && mLineNodes.empty() && !sEliminateEqualities)
+    return;
+  
+  // Build the map from the reduced to the full variables: everything not
+  // derived is copied, and the rest are computed from the copies.
+  tmVariableMap* theMap = new tmVariableMap(numVars);
+  for (size_t k = 0; k < numVars; ++k)
+    if (!derived[k]) theMap->AddCopy(k);
+  const tmPoint& p = theTree->GetSymLoc();
+  double angle = theTree->GetSymAngle();
+  for (size_t i = 0; i < mLineNodes.size(); ++i) {
+    size_t ix = GetBaseOffset(mLineNodes[i]);
+    theMap->AddLine(ix, ix + 1, p, angle);
+  }
+  for (size_t i = 0; i < mMirrorNodes.size(); ++i) {
+    size_t jx = GetBaseOffset(mMirrorNodes[i]);
+    size_t ix = GetBaseOffset(mMirrorReps[i]);
+    theMap->AddReflection(jx, jx + 1, ix, ix + 1, p, angle);
+  }
+  
+  // From now on everything goes through the reduced optimizer.
+  mReducedNLCO = new tmReducedNLCO(mNLCO, theMap, sEliminateEqualities);
+  mNLCO = mReducedNLCO;
+}
+
+
+/*****
+Write the problem as the subclass posed it, starting from the current state,
+in the form that tmRecordingNLCO::GetProblem() reads. Call this after
+Initialize(); before Optimize() the current state is the starting point, after
+it the optimum. Return false if there's no problem yet or some part of it
+couldn't be written.
+*****/
+bool tmOptimizer::PutProblem(ostream& os) const
+{
+  if (!mInitialized || !mRecordingNLCO) return false;
+  return mRecordingNLCO->PutSelf(os, mCurrentStateVec);
+}
+
+
+/*****
+Eliminate the variables that the conditions fix or tie together and hand the
+problem to the real optimizer. Call this after everything has been passed to
+mNLCO, so that the real optimizer knows the size of the problem it will solve.
+*****/
+void tmOptimizer::Presolve()
+{
+  if (mReducedNLCO) mReducedNLCO->Presolve();
+}
+
+
+#ifdef __MWERKS__
+  #pragma mark -
+#endif
+
+
+/*****
+STATIC
+Return true if optimizers set up from now on will split their problems into
+independent blocks where they can.
+*****/
+bool tmOptimizer::GetSplitBlocks()
+{
+  return sSplitBlocks;
+}
+
+
+/*****
+STATIC
+Set whether optimizers set up from now on split their problems into
+independent blocks where they can.
+*****/
+void tmOptimizer::SetSplitBlocks(bool splitBlocks)
+{
+  sSplitBlocks = splitBlocks;
+}
+
+
+/*****
+Return the number of independent blocks the last optimization was split into,
+or 1 if it wasn't split.
+*****/
+size_t tmOptimizer::GetNumBlocks() const
+{
+  if (!mBlockNLCO || mBlockNLCO->GetNumBlocks() == 0) return 1;
+  return mBlockNLCO->GetNumBlocks();
+}
+
+
+/*****
+Route the problem through a tmBlockNLCO, which will solve independent groups
+of variables separately. Call this before passing anything to mNLCO, and
+before ReduceVariables(), so that the blocks are found among the reduced
+variables.
+*****/
+void tmOptimizer::SplitIntoBlocks()
+{
+  if (!sSplitBlocks) return;
+  TMASSERT(!mBlockNLCO && !mReducedNLCO);
+  mBlockNLCO = new tmBlockNLCO(mNLCO);
+  mNLCO = mBlockNLCO;
+}
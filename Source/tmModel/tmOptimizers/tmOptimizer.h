@@ -17,9 +17,15 @@ Copyright:    ©2005 Robert J. Lang. All Rights Reserved.
 
 // TreeMaker model
 #include "tmTreeCleaner.h"
+#include "tmArray.h"
 
 // Forward declarations
 class tmNLCO;
+class tmNLCOBudget;
+class tmBlockNLCO;
+class tmReducedNLCO;
+class tmRecordingNLCO;
+class tmNode;
 
 /**********
 class tmOptimizer
@@ -29,22 +35,85 @@ This class inherits from class tmTreeCleaner, which will delay cleanup until
 the optimizer goes completely out of scope or is destroyed, which means that
 even if we've run the optimizer, we can Revert() and not lose any crease
 patterns, etc.
+
+Subclasses whose objective is a sum over parts of the tree call
+SplitIntoBlocks() before setting up the problem, so that groups of variables
+that don't interact are solved separately (see tmBlockNLCO.h).
+
+Subclasses call ReduceVariables() before setting up the problem and Presolve()
+once all of it, conditions included, has been given to GetNLCO(). If the tree
+has a line of symmetry, mirror pairs of moving nodes then contribute only one
+node's coordinates to the problem and nodes on the symmetry line only their
+distance along it; the rest are derived by reflection. Variables that
+conditions fix or tie to one another by linear equalities are eliminated too
+(see tmReducedNLCO.h). From ReduceVariables() on GetNLCO() returns the
+optimizer of the full problem, which passes the reduced problem to the tmNLCO
+given to the constructor.
+
+ReduceVariables() also puts a tmRecordingNLCO on top of all that, so that
+PutProblem() can write the problem exactly as the subclass posed it, to be
+solved again later without the tree (see tmRecordingNLCO.h).
+
+Optimize() normally runs until the optimizer converges or gives up. Limits on
+its time and evaluations can be set on GetBudget(). If they run out, the tree
+gets the best feasible configuration the optimizer found and
+GetBudget().IsExpired() returns true; if it found none, Optimize() throws
+EX_BAD_CONVERGENCE and leaves the tree alone. Either way GetBudget() reports
+the time and evaluations that the last Optimize() took.
 **********/
 
 class tmOptimizer : public tmTreeCleaner {
 public:
   tmOptimizer(tmTree* aTree, tmNLCO* aNLCO);
-  virtual ~tmOptimizer() {};
+  virtual ~tmOptimizer();
   tmNLCO* GetNLCO() { return mNLCO; };
+  tmNLCOBudget& GetBudget() { return *mBudget; };
   void Revert();
   virtual void Optimize();
   virtual void DataToTree() = 0;
   virtual void TreeToData() = 0;
+  virtual std::size_t GetBaseOffset(tmNode* aNode) = 0;
+  bool PutProblem(std::ostream& os) const;
+  
+  // Symmetry reduction
+  static bool GetReduceSymmetry();
+  static void SetReduceSymmetry(bool reduceSymmetry);
+  bool IsReflectedPair(tmNode* aNode1, tmNode* aNode2) const;
+  bool IsOnSymmetryLine(tmNode* aNode) const;
+  tmNode* GetMirrorNode(tmNode* aNode) const;
+  
+  // Elimination of fixed and tied variables
+  static bool GetEliminateEqualities();
+  static void SetEliminateEqualities(bool eliminateEqualities);
+  
+  // Splitting into independent blocks
+  static bool GetSplitBlocks();
+  static void SetSplitBlocks(bool splitBlocks);
+  std::size_t GetNumBlocks() const;
 protected:
   bool mInitialized;                    // true if we've been fully initialized
   tmNLCO* mNLCO;                        // object that performs NLCO
   std::vector<double> mCurrentStateVec;    // current state vector
   std::stringstream mInitialState;      // initial tree state (used for reversion)
+  
+  void ReduceVariables(const tmArray<tmNode*>& movingNodes, 
+    std::size_t numVars);
+  void Presolve();
+  void SplitIntoBlocks();
+private:
+  static bool sReduceSymmetry;          // true to reduce symmetric problems
+  static bool sEliminateEqualities;     // true to eliminate fixed variables
+  static bool sSplitBlocks;             // true to split into blocks
+  tmBlockNLCO* mBlockNLCO;              // owned optimizer that splits blocks
+  tmReducedNLCO* mReducedNLCO;          // owned optimizer of full problem
+  tmRecordingNLCO* mRecordingNLCO;      // owned recorder of the problem
+  tmNLCOBudget* mBudget;                // owned limits on Optimize()
+  tmArray<tmNode*> mMirrorNodes;        // nodes derived by reflection ...
+  tmArray<tmNode*> mMirrorReps;         // ... of these nodes
+  tmArray<tmNode*> mLineNodes;          // nodes confined to the symmetry line
+  
+  void MakeReducedNLCO(const tmArray<tmNode*>& movingNodes,
+    std::size_t numVars);
 };
 
 
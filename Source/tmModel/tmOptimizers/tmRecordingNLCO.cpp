@@ -0,0 +1,367 @@
+/*******************************************************************************
+File:         tmRecordingNLCO.cpp
+Project:      TreeMaker 5.x
+Purpose:      Source file for recording and replaying optimization problems
+Author:       Robert J. Lang
+Modified by:
+Created:      2026-10-19
+Copyright:    ©2026 Robert J. Lang. All Rights Reserved.
+*******************************************************************************/
+
+#include "tmRecordingNLCO.h"
+#include "tmConstraintFns.h"
+
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+/*****
+Read the next token, which must be the given one, or give up on the problem.
+*****/
+static void GetToken(istream& is, const char* token)
+{
+  string s;
+  if (!(is >> s) || s != token) throw tmRecordingNLCO::EX_BAD_PROBLEM();
+}
+
+
+/*****
+Read a line of n doubles introduced by the given token.
+*****/
+static void GetVector(istream& is, const char* token, size_t n,
+  vector<double>& v)
+{
+  GetToken(is, token);
+  v.resize(n);
+  for (size_t i = 0; i < n; ++i) is >> v[i];
+  if (!is) throw tmRecordingNLCO::EX_BAD_PROBLEM();
+}
+
+
+/*****
+Write a line of doubles introduced by the given token.
+*****/
+static void PutVector(ostream& os, const char* token, const vector<double>& v)
+{
+  os << token;
+  for (size_t i = 0; i < v.size(); ++i) os << ' ' << v[i];
+  os << '\n';
+}
+
+
+#ifdef __MWERKS__
+  #pragma mark -
+#endif
+
+
+/**********
+class tmRecordingNLCO
+Optimizer that remembers the problem it passes on to another optimizer
+**********/
+
+/*****
+Constructor. aNLCO does the actual work, stays owned by the caller and owns
+the objective and constraints.
+*****/
+tmRecordingNLCO::tmRecordingNLCO(tmNLCO* aNLCO)
+  : mNLCO(aNLCO)
+{
+}
+
+
+/*****
+Destructor
+*****/
+tmRecordingNLCO::~tmRecordingNLCO()
+{
+  for (size_t i = 0; i < mImplied.size(); ++i) delete mImplied[i];
+}
+
+
+/*****
+Set the size of the problem
+*****/
+void tmRecordingNLCO::SetSize(size_t n)
+{
+  tmNLCO::SetSize(n);
+  mNLCO->SetSize(n);
+}
+
+
+/*****
+Return the number of equality constraints
+*****/
+size_t tmRecordingNLCO::GetNumEqualities()
+{
+  return mNLCO->GetNumEqualities();
+}
+
+
+/*****
+Return the number of inequality constraints
+*****/
+size_t tmRecordingNLCO::GetNumInequalities()
+{
+  return mNLCO->GetNumInequalities();
+}
+
+
+/*****
+Return the number of variables the real optimizer works with
+*****/
+size_t tmRecordingNLCO::GetNumVariables()
+{
+  return mNLCO->GetNumVariables();
+}
+
+
+/*****
+Set the objective function
+*****/
+void tmRecordingNLCO::SetObjective(tmDifferentiableFn* f)
+{
+  tmNLCO::SetObjective(f);
+  mNLCO->SetObjective(f);
+}
+
+
+/*****
+Add a linear equality constraint
+*****/
+void tmRecordingNLCO::AddLinearEquality(tmDifferentiableFn* f)
+{
+  AddConstraint(f);
+  mKinds.push_back(LINEAR_EQUALITY);
+  mNLCO->AddLinearEquality(f);
+}
+
+
+/*****
+Add a nonlinear equality constraint
+*****/
+void tmRecordingNLCO::AddNonlinearEquality(tmDifferentiableFn* f)
+{
+  AddConstraint(f);
+  mKinds.push_back(NONLINEAR_EQUALITY);
+  mNLCO->AddNonlinearEquality(f);
+}
+
+
+/*****
+Add a linear inequality constraint
+*****/
+void tmRecordingNLCO::AddLinearInequality(tmDifferentiableFn* f)
+{
+  AddConstraint(f);
+  mKinds.push_back(LINEAR_INEQUALITY);
+  mNLCO->AddLinearInequality(f);
+}
+
+
+/*****
+Add a nonlinear inequality constraint
+*****/
+void tmRecordingNLCO::AddNonlinearInequality(tmDifferentiableFn* f)
+{
+  AddConstraint(f);
+  mKinds.push_back(NONLINEAR_INEQUALITY);
+  mNLCO->AddNonlinearInequality(f);
+}
+
+
+/*****
+Set the bounds on the variables
+*****/
+void tmRecordingNLCO::SetBounds(const vector<double>& bl, const vector<double>& bu)
+{
+  mBl = bl;
+  mBu = bu;
+  mNLCO->SetBounds(bl, bu);
+}
+
+
+/*****
+Record a linear equality that the optimizer below us satisfies by construction
+without passing it on. We take ownership of f.
+*****/
+void tmRecordingNLCO::AddImpliedEquality(tmDifferentiableFn* f)
+{
+  mImplied.push_back(f);
+}
+
+
+/*****
+Minimize, starting from and returning x
+*****/
+int tmRecordingNLCO::Minimize(vector<double>& x)
+{
+  if (mUpdater) mNLCO->SetUpdater(mUpdater);
+  if (mBudget) mNLCO->SetBudget(mBudget);
+  int inform = mNLCO->Minimize(x);
+  mNumIterations = mNLCO->GetNumIterations();
+  return inform;
+}
+
+
+/*****
+Pass UI updates from the objective on to the real optimizer.
+*****/
+void tmRecordingNLCO::ObjectiveUpdateUI()
+{
+  mNLCO->ObjectiveUpdateUI();
+}
+
+
+#ifdef __MWERKS__
+  #pragma mark -
+#endif
+
+
+/*****
+STATIC
+Return the name of a kind of constraint as it appears in the file.
+*****/
+const char* tmRecordingNLCO::GetKindName(Kind kind)
+{
+  switch (kind) {
+    case LINEAR_EQUALITY:
+      return "LinearEquality";
+    case NONLINEAR_EQUALITY:
+      return "NonlinearEquality";
+    case LINEAR_INEQUALITY:
+      return "LinearInequality";
+    case NONLINEAR_INEQUALITY:
+      return "NonlinearInequality";
+  }
+  return "";
+}
+
+
+/*****
+Write the problem, starting from x, as text. Return false if some function
+couldn't write itself, in which case what was written can't be read back.
+*****/
+bool tmRecordingNLCO::PutSelf(ostream& os, const vector<double>& x) const
+{
+  TMASSERT(x.size() == mSize);
+  TMASSERT(GetObjective());
+  streamsize precision = os.precision();
+  os.precision(17);
+  bool ok = true;
+  os << "tmNLCOProblem 1\n";
+  os << "size " << mSize << '\n';
+  PutVector(os, "start", x);
+  PutVector(os, "lower", mBl);
+  PutVector(os, "upper", mBu);
+  os << "objective ";
+  ok = GetObjective()->PutSelf(os) && ok;
+  os << '\n';
+  const vector<tmDifferentiableFn*>& constraints = GetConstraints();
+  for (size_t i = 0; i < constraints.size(); ++i) {
+    os << GetKindName(mKinds[i]) << ' ';
+    ok = constraints[i]->PutSelf(os) && ok;
+    os << '\n';
+  }
+  for (size_t i = 0; i < mImplied.size(); ++i) {
+    os << GetKindName(LINEAR_EQUALITY) << ' ';
+    ok = mImplied[i]->PutSelf(os) && ok;
+    os << '\n';
+  }
+  os << "end\n";
+  os.precision(precision);
+  return ok;
+}
+
+
+/*****
+STATIC
+Read a function, written by its PutSelf(), of the first n variables.
+*****/
+tmDifferentiableFn* tmRecordingNLCO::GetFn(istream& is, size_t n)
+{
+  string name;
+  is >> name;
+  tmDifferentiableFn* f;
+  if (name == "OneVarFn") f = new OneVarFn(is);
+  else if (name == "TwoVarFn") f = new TwoVarFn(is);
+  else if (name == "PathFn1") f = new PathFn1(is);
+  else if (name == "PathFn2") f = new PathFn2(is);
+  else if (name == "PathAngleFn1") f = new PathAngleFn1(is);
+  else if (name == "PathAngleFn2") f = new PathAngleFn2(is);
+  else if (name == "StrainPathFn1") f = new StrainPathFn1(is);
+  else if (name == "StrainPathFn2") f = new StrainPathFn2(is);
+  else if (name == "StrainPathFn3") f = new StrainPathFn3(is);
+  else if (name == "StickToEdgeFn") f = new StickToEdgeFn(is);
+  else if (name == "StickToLineFn") f = new StickToLineFn(is);
+  else if (name == "PairFn1A") f = new PairFn1A(is);
+  else if (name == "PairFn1B") f = new PairFn1B(is);
+  else if (name == "PairFn2A") f = new PairFn2A(is);
+  else if (name == "PairFn2B") f = new PairFn2B(is);
+  else if (name == "CollinearFn1") f = new CollinearFn1(is);
+  else if (name == "CollinearFn2") f = new CollinearFn2(is);
+  else if (name == "CollinearFn3") f = new CollinearFn3(is);
+  else if (name == "BoundaryFn") f = new BoundaryFn(is);
+  else if (name == "QuantizeAngleFn1") f = new QuantizeAngleFn1(is);
+  else if (name == "QuantizeAngleFn2") f = new QuantizeAngleFn2(is);
+  else if (name == "LocalizeFn") f = new LocalizeFn(is);
+  else if (name == "MultiStrainPathFn1") f = new MultiStrainPathFn1(is);
+  else if (name == "MultiStrainPathFn2") f = new MultiStrainPathFn2(is);
+  else if (name == "MultiStrainPathFn3") f = new MultiStrainPathFn3(is);
+  else if (name == "CornerFn") f = new CornerFn(is);
+  else if (name == "WeightedSquaresFn") f = new WeightedSquaresFn(is);
+  else throw EX_BAD_PROBLEM();
+
+  // Make sure we read all of it and that it stays within the problem.
+  bool ok = !is.fail();
+  vector<size_t> vars;
+  if (ok && f->GetVariables(vars))
+    for (size_t i = 0; i < vars.size(); ++i) ok = ok && vars[i] < n;
+  if (!ok) {
+    delete f;
+    throw EX_BAD_PROBLEM();
+  }
+  return f;
+}
+
+
+/*****
+STATIC
+Read a problem written by PutSelf() and pose it to aNLCO, which must be fresh.
+Return the starting point in x. aNLCO owns the functions it's given, as usual.
+Throw EX_BAD_PROBLEM if the stream doesn't hold a problem; aNLCO may then have
+been given part of it.
+*****/
+void tmRecordingNLCO::GetProblem(istream& is, tmNLCO* aNLCO,
+  vector<double>& x)
+{
+  GetToken(is, "tmNLCOProblem");
+  int version = 0;
+  if (!(is >> version) || version != 1) throw EX_BAD_PROBLEM();
+  GetToken(is, "size");
+  size_t n = 0;
+  if (!(is >> n) || n == 0) throw EX_BAD_PROBLEM();
+  vector<double> bl, bu;
+  GetVector(is, "start", n, x);
+  GetVector(is, "lower", n, bl);
+  GetVector(is, "upper", n, bu);
+  GetToken(is, "objective");
+  aNLCO->SetSize(n);
+  aNLCO->SetBounds(bl, bu);
+  aNLCO->SetObjective(GetFn(is, n));
+
+  // Constraints, one per line, until the end.
+  string token;
+  while (is >> token && token != "end") {
+    if (token == GetKindName(LINEAR_EQUALITY))
+      aNLCO->AddLinearEquality(GetFn(is, n));
+    else if (token == GetKindName(NONLINEAR_EQUALITY))
+      aNLCO->AddNonlinearEquality(GetFn(is, n));
+    else if (token == GetKindName(LINEAR_INEQUALITY))
+      aNLCO->AddLinearInequality(GetFn(is, n));
+    else if (token == GetKindName(NONLINEAR_INEQUALITY))
+      aNLCO->AddNonlinearInequality(GetFn(is, n));
+    else throw EX_BAD_PROBLEM();
+  }
+  if (token != "end") throw EX_BAD_PROBLEM();
+}
@@ -0,0 +1,101 @@
+/*******************************************************************************
+File:         tmRecordingNLCO.h
+Project:      TreeMaker 5.x
+Purpose:      Header file for recording and replaying optimization problems
+Author:       Robert J. Lang
+Modified by:
+Created:      2026-10-19
+Copyright:    ©2026 Robert J. Lang. All Rights Reserved.
+*******************************************************************************/
+
+#ifndef _TMRECORDINGNLCO_H_
+#define _TMRECORDINGNLCO_H_
+
+#include "tmNLCO.h"
+
+#include <iosfwd>
+
+/*
+Class tmRecordingNLCO sits between a tmOptimizer and the optimizer it would
+otherwise talk to, passes everything through unchanged, and remembers the
+problem as it was posed: size, bounds, objective and constraints, along with
+the kind of each constraint. A reduction by symmetry below us satisfies some
+equalities by construction, and never poses them; they're given to us with
+AddImpliedEquality() to be recorded but not passed on. PutSelf() writes it as text, with a starting
+point, and GetProblem() reads it back into any tmNLCO. The functions write and
+read themselves (see tmDifferentiableFn::PutSelf()); doubles are written with
+enough digits to come back exactly, so a replayed problem is the same problem.
+
+This lets one take a problem out of a real origami design and solve it again,
+with nothing else of TreeMaker around it, by every optimizer that's compiled in.
+The format is one item per line:
+
+  tmNLCOProblem 1
+  size n
+  start x[0] ... x[n - 1]
+  lower bl[0] ... bl[n - 1]
+  upper bu[0] ... bu[n - 1]
+  objective <function>
+  LinearEquality <function>     (and NonlinearEquality, LinearInequality,
+  ...                            NonlinearInequality, one line per constraint)
+  end
+
+where <function> is the name of a class from tmConstraintFns.h followed by its
+constants.
+*/
+
+/**********
+class tmRecordingNLCO
+Optimizer that remembers the problem it passes on to another optimizer
+**********/
+class tmRecordingNLCO : public tmNLCO {
+public:
+  // Exception thrown by GetProblem()
+  class EX_BAD_PROBLEM {
+  };
+
+  tmRecordingNLCO(tmNLCO* aNLCO);
+  ~tmRecordingNLCO();
+
+  void SetSize(std::size_t n);
+  std::size_t GetNumEqualities();
+  std::size_t GetNumInequalities();
+  std::size_t GetNumVariables();
+
+  void SetObjective(tmDifferentiableFn* f);
+  void AddLinearEquality(tmDifferentiableFn* f);
+  void AddNonlinearEquality(tmDifferentiableFn* f);
+  void AddLinearInequality(tmDifferentiableFn* f);
+  void AddNonlinearInequality(tmDifferentiableFn* f);
+  void SetBounds(const std::vector<double>& bl, const std::vector<double>& bu);
+  void AddImpliedEquality(tmDifferentiableFn* f);
+
+  int Minimize(std::vector<double>& x);
+
+  void ObjectiveUpdateUI();
+
+  // Writing and reading problems
+  bool PutSelf(std::ostream& os, const std::vector<double>& x) const;
+  static void GetProblem(std::istream& is, tmNLCO* aNLCO,
+    std::vector<double>& x);
+
+private:
+  // The kinds of constraint, in the order of GetConstraints()
+  enum Kind {
+    LINEAR_EQUALITY,
+    NONLINEAR_EQUALITY,
+    LINEAR_INEQUALITY,
+    NONLINEAR_INEQUALITY
+  };
+
+  tmNLCO* mNLCO;                  // the optimizer that does the work
+  std::vector<Kind> mKinds;       // the kind of each constraint
+  std::vector<double> mBl;        // lower bounds
+  std::vector<double> mBu;        // upper bounds
+  std::vector<tmDifferentiableFn*> mImplied;  // equalities not passed on, owned
+
+  static const char* GetKindName(Kind kind);
+  static tmDifferentiableFn* GetFn(std::istream& is, std::size_t n);
+};
+
+#endif // _TMRECORDINGNLCO_H_
@@ -0,0 +1,863 @@
+/*******************************************************************************
+File:         tmReducedNLCO.cpp
+Project:      TreeMaker 5.x
+Purpose:      Implementation file for optimization over a reduced set of variables
+Author:       Robert J. Lang
+Modified by:
+Created:      2026-10-19
+Copyright:    ©2026 Robert J. Lang. All Rights Reserved.
+*******************************************************************************/
+
+#include "tmReducedNLCO.h"
+#include "tmConstraintFns.h"
+#include "tmArray.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+// Coefficients this small are rounding error in sin() and cos() of a multiple
+// of 90 degrees; we drop them so that an axis-aligned symmetry line gives an
+// exact reflection.
+const double TINY_COEFF = 1.0e-12;
+
+// Slack allowed when deciding whether a bound is implied by the others
+const double BOUND_TOL = 1.0e-10;
+
+/**********
+class tmVariableMap
+Affine map from a reduced vector of variables to a full one
+**********/
+
+/*****
+Constructor. The map starts out with no reduced variables; every full
+variable must then be either copied or derived.
+*****/
+tmVariableMap::tmVariableMap(size_t numFull)
+  : mFull(numFull), mVarOf(numFull, tmArray<size_t>::BAD_OFFSET)
+{
+}
+
+
+/*****
+Add a term to an entry, merging it with any existing term in the same variable
+and dropping it if its coefficient is negligible.
+*****/
+void tmVariableMap::Entry::AddTerm(size_t aj, double aa)
+{
+  for (size_t t = 0; t < n; ++t) {
+    if (j[t] != aj) continue;
+    a[t] += aa;
+    if (fabs(a[t]) < TINY_COEFF) {
+      --n;
+      for (; t < n; ++t) {
+        j[t] = j[t + 1];
+        a[t] = a[t + 1];
+      }
+    }
+    return;
+  }
+  if (fabs(aa) < TINY_COEFF) return;
+  TMASSERT(n < 3);
+  j[n] = aj;
+  a[n] = aa;
+  ++n;
+}
+
+
+/*****
+Append a new reduced variable and return its index.
+*****/
+size_t tmVariableMap::NewVariable()
+{
+  mReduced.push_back(Entry());
+  return mReduced.size() - 1;
+}
+
+
+/*****
+Make full variable k an independent variable of the reduced problem.
+*****/
+void tmVariableMap::AddCopy(size_t k)
+{
+  size_t j = NewVariable();
+  mFull[k].AddTerm(j, 1.0);
+  mReduced[j].AddTerm(k, 1.0);
+  mVarOf[k] = j;
+}
+
+
+/*****
+Confine the point (u[kx], u[ky]) to the line through p at the given angle (in
+degrees). Its one remaining degree of freedom is the distance along the line
+from p.
+*****/
+void tmVariableMap::AddLine(size_t kx, size_t ky, const tmPoint& p,
+  double angle)
+{
+  double ca = cos(angle * DEGREES);
+  double sa = sin(angle * DEGREES);
+  size_t j = NewVariable();
+  mFull[kx].c = p.x;
+  mFull[kx].AddTerm(j, ca);
+  mFull[ky].c = p.y;
+  mFull[ky].AddTerm(j, sa);
+  mReduced[j].c = -p.x * ca - p.y * sa;
+  mReduced[j].AddTerm(kx, ca);
+  mReduced[j].AddTerm(ky, sa);
+}
+
+
+/*****
+Make the point (u[kx], u[ky]) the mirror image of (u[rx], u[ry]) in the line
+through p at the given angle (in degrees). u[rx] and u[ry] must already have
+been added with AddCopy().
+*****/
+void tmVariableMap::AddReflection(size_t kx, size_t ky, size_t rx, size_t ry,
+  const tmPoint& p, double angle)
+{
+  size_t jx = mVarOf[rx];
+  size_t jy = mVarOf[ry];
+  TMASSERT(jx != tmArray<size_t>::BAD_OFFSET);
+  TMASSERT(jy != tmArray<size_t>::BAD_OFFSET);
+  double c2 = cos(2 * angle * DEGREES);
+  double s2 = sin(2 * angle * DEGREES);
+  if (fabs(c2) < TINY_COEFF) c2 = 0;
+  if (fabs(s2) < TINY_COEFF) s2 = 0;
+  mFull[kx].c = p.x - c2 * p.x - s2 * p.y;
+  mFull[kx].AddTerm(jx, c2);
+  mFull[kx].AddTerm(jy, s2);
+  mFull[ky].c = p.y - s2 * p.x + c2 * p.y;
+  mFull[ky].AddTerm(jx, s2);
+  mFull[ky].AddTerm(jy, -c2);
+  
+  // When reducing a point that isn't exactly symmetric, use the average of
+  // the representative and the reflection of its partner. The reflection is
+  // its own inverse, so the same coefficients do.
+  Entry& ex = mReduced[jx];
+  Entry& ey = mReduced[jy];
+  TMASSERT(ex.n == 1 && ey.n == 1);
+  ex.a[0] = ey.a[0] = 0.5;
+  ex.c = 0.5 * mFull[kx].c;
+  ex.AddTerm(kx, 0.5 * c2);
+  ex.AddTerm(ky, 0.5 * s2);
+  ey.c = 0.5 * mFull[ky].c;
+  ey.AddTerm(kx, 0.5 * s2);
+  ey.AddTerm(ky, -0.5 * c2);
+}
+
+
+/*****
+Fix full variable k at the value c.
+*****/
+void tmVariableMap::AddConstant(size_t k, double c)
+{
+  mFull[k].c = c;
+}
+
+
+/*****
+Make full variable k the affine function c + a * u[r] of another one, which
+must already have been added with AddCopy().
+*****/
+void tmVariableMap::AddMultiple(size_t k, size_t r, double a, double c)
+{
+  size_t j = mVarOf[r];
+  TMASSERT(j != tmArray<size_t>::BAD_OFFSET);
+  mFull[k].c = c;
+  mFull[k].AddTerm(j, a);
+}
+
+
+/*****
+Reduce the problem further: our reduced variables become the full variables of
+aMap, which are in turn computed from its reduced variables. Afterwards this
+map goes straight from aMap's reduced variables to our full ones.
+*****/
+void tmVariableMap::Compose(const tmVariableMap& aMap)
+{
+  TMASSERT(aMap.GetNumFull() == GetNumReduced());
+  for (size_t k = 0; k < mFull.size(); ++k) {
+    const Entry& e = mFull[k];
+    Entry ek;
+    ek.c = e.c;
+    for (size_t t = 0; t < e.n; ++t) {
+      const Entry& f = aMap.mFull[e.j[t]];
+      ek.c += e.a[t] * f.c;
+      for (size_t s = 0; s < f.n; ++s) ek.AddTerm(f.j[s], e.a[t] * f.a[s]);
+    }
+    mFull[k] = ek;
+    if (mVarOf[k] != tmArray<size_t>::BAD_OFFSET)
+      mVarOf[k] = aMap.mVarOf[mVarOf[k]];
+  }
+  vector<Entry> reduced(aMap.GetNumReduced());
+  for (size_t j = 0; j < reduced.size(); ++j) {
+    const Entry& e = aMap.mReduced[j];
+    Entry& ej = reduced[j];
+    ej.c = e.c;
+    for (size_t t = 0; t < e.n; ++t) {
+      const Entry& f = mReduced[e.j[t]];
+      ej.c += e.a[t] * f.c;
+      for (size_t s = 0; s < f.n; ++s) ej.AddTerm(f.j[s], e.a[t] * f.a[s]);
+    }
+  }
+  mReduced.swap(reduced);
+}
+
+
+/*****
+Return true if the map just copies every full variable to the reduced variable
+of the same index, in which case there's no point in using it.
+*****/
+bool tmVariableMap::IsIdentity() const
+{
+  if (mReduced.size() != mFull.size()) return false;
+  for (size_t k = 0; k < mFull.size(); ++k) {
+    const Entry& e = mFull[k];
+    if (e.c != 0 || e.n != 1 || e.j[0] != k || e.a[0] != 1) return false;
+  }
+  return true;
+}
+
+
+/*****
+Compute the full vector u from the reduced vector v.
+*****/
+void tmVariableMap::Expand(const vector<double>& v, vector<double>& u) const
+{
+  u.resize(mFull.size());
+  for (size_t k = 0; k < mFull.size(); ++k) {
+    const Entry& e = mFull[k];
+    double x = e.c;
+    for (size_t t = 0; t < e.n; ++t) x += e.a[t] * v[e.j[t]];
+    u[k] = x;
+  }
+}
+
+
+/*****
+Given the gradient du of a function with respect to u, compute its gradient dv
+with respect to v, i.e., multiply by the transpose of the map.
+*****/
+void tmVariableMap::Contract(const vector<double>& du, vector<double>& dv) const
+{
+  dv.assign(mReduced.size(), 0.);
+  for (size_t k = 0; k < mFull.size(); ++k) {
+    const Entry& e = mFull[k];
+    for (size_t t = 0; t < e.n; ++t) dv[e.j[t]] += e.a[t] * du[k];
+  }
+}
+
+
+/*****
+Like Expand(), but only compute the elements of u listed in vars, which must
+not repeat. The rest of u is left as it was.
+*****/
+void tmVariableMap::Expand(const vector<double>& v, const vector<size_t>& vars,
+  vector<double>& u) const
+{
+  u.resize(mFull.size());
+  for (size_t i = 0; i < vars.size(); ++i) {
+    size_t k = vars[i];
+    const Entry& e = mFull[k];
+    double x = e.c;
+    for (size_t t = 0; t < e.n; ++t) x += e.a[t] * v[e.j[t]];
+    u[k] = x;
+  }
+}
+
+
+/*****
+Like Contract(), for a gradient du that is zero outside the elements listed in
+vars, which must not repeat.
+*****/
+void tmVariableMap::Contract(const vector<double>& du,
+  const vector<size_t>& vars, vector<double>& dv) const
+{
+  dv.assign(mReduced.size(), 0.);
+  for (size_t i = 0; i < vars.size(); ++i) {
+    size_t k = vars[i];
+    const Entry& e = mFull[k];
+    for (size_t t = 0; t < e.n; ++t) dv[e.j[t]] += e.a[t] * du[k];
+  }
+}
+
+
+/*****
+Compute the reduced vector v from a full vector u. If u doesn't exactly obey
+the map, this averages mirror pairs and projects onto the lines.
+*****/
+void tmVariableMap::Reduce(const vector<double>& u, vector<double>& v) const
+{
+  v.resize(mReduced.size());
+  for (size_t j = 0; j < mReduced.size(); ++j) {
+    const Entry& e = mReduced[j];
+    double x = e.c;
+    for (size_t t = 0; t < e.n; ++t) x += e.a[t] * u[e.j[t]];
+    v[j] = x;
+  }
+}
+
+
+/*****
+Given the elements uvars of u that a function reads, return in vvars the
+elements of v that they depend on, in order and without repeats.
+*****/
+void tmVariableMap::ReduceVariables(const vector<size_t>& uvars,
+  vector<size_t>& vvars) const
+{
+  vvars.clear();
+  for (size_t i = 0; i < uvars.size(); ++i) {
+    const Entry& e = mFull[uvars[i]];
+    for (size_t t = 0; t < e.n; ++t) vvars.push_back(e.j[t]);
+  }
+  sort(vvars.begin(), vvars.end());
+  vvars.erase(unique(vvars.begin(), vvars.end()), vvars.end());
+}
+
+
+/*****
+Translate bounds bl <= u <= bu into bounds vbl <= v <= vbu. Every full
+variable that depends on a single reduced variable becomes a bound on that
+variable. Those that depend on two (reflections in a slanted line) usually
+follow from the bounds on their partners, e.g. on square paper with a diagonal
+line of symmetry; the ones that don't are returned in unimplied, and the
+caller must impose them as constraints.
+*****/
+void tmVariableMap::ReduceBounds(const vector<double>& bl,
+  const vector<double>& bu, vector<double>& vbl, vector<double>& vbu,
+  vector<size_t>& unimplied) const
+{
+  const double BIG = 1.0e30;
+  size_t nv = mReduced.size();
+  vbl.assign(nv, -BIG);
+  vbu.assign(nv, BIG);
+  unimplied.clear();
+  for (size_t k = 0; k < mFull.size(); ++k) {
+    const Entry& e = mFull[k];
+    if (e.n != 1) continue;
+    double lo = (bl[k] - e.c) / e.a[0];
+    double hi = (bu[k] - e.c) / e.a[0];
+    if (e.a[0] < 0) swap(lo, hi);
+    size_t j = e.j[0];
+    if (vbl[j] < lo) vbl[j] = lo;
+    if (vbu[j] > hi) vbu[j] = hi;
+  }
+  for (size_t j = 0; j < nv; ++j)
+    if (vbl[j] > vbu[j]) vbl[j] = vbu[j] = 0.5 * (vbl[j] + vbu[j]);
+  for (size_t k = 0; k < mFull.size(); ++k) {
+    const Entry& e = mFull[k];
+    if (e.n != 2) continue;
+    double lo = e.c;
+    double hi = e.c;
+    for (size_t t = 0; t < 2; ++t) {
+      double a = e.a[t];
+      size_t j = e.j[t];
+      lo += (a > 0) ? a * vbl[j] : a * vbu[j];
+      hi += (a > 0) ? a * vbu[j] : a * vbl[j];
+    }
+    if (lo < bl[k] - BOUND_TOL * (1 + fabs(bl[k])) ||
+      hi > bu[k] + BOUND_TOL * (1 + fabs(bu[k])))
+      unimplied.push_back(k);
+  }
+}
+
+
+#ifdef __MWERKS__
+  #pragma mark -
+#endif
+
+
+/**********
+class tmReducedFn
+A function of the full variables, evaluated on the reduced ones
+**********/
+
+/*****
+Scratch vectors for the full variables and gradient. Each thread needs its own,
+since the optimizer may evaluate constraints on several threads at once.
+*****/
+static thread_local vector<double> sU;
+static thread_local vector<double> sDu;
+
+
+/*****
+Constructor. We take ownership of f. If f can tell us which variables it
+reads, we expand and contract only those, so that a constraint on a couple of
+nodes costs about what it did before reduction rather than O(u.size()).
+*****/
+tmReducedFn::tmReducedFn(tmDifferentiableFn* f, const tmVariableMap* aMap)
+  : mFn(f), mMap(aMap)
+{
+  mSparse = mFn->GetVariables(mVars);
+  if (mSparse) {
+    sort(mVars.begin(), mVars.end());
+    mVars.erase(unique(mVars.begin(), mVars.end()), mVars.end());
+  }
+}
+
+
+/*****
+Destructor
+*****/
+tmReducedFn::~tmReducedFn()
+{
+  delete mFn;
+}
+
+
+/*****
+Fill in sU from v, either all of it or just the part mFn reads.
+*****/
+void tmReducedFn::ExpandVariables(const vector<double>& v)
+{
+  if (mSparse) mMap->Expand(v, mVars, sU);
+  else mMap->Expand(v, sU);
+}
+
+
+/*****
+Map the gradient in sDu back to the reduced variables.
+*****/
+void tmReducedFn::ContractGradient(vector<double>& dv)
+{
+  if (mSparse) mMap->Contract(sDu, mVars, dv);
+  else mMap->Contract(sDu, dv);
+}
+
+
+/*****
+Return the value of the function
+*****/
+double tmReducedFn::Func(const vector<double>& v)
+{
+  IncFuncCalls();
+  ExpandVariables(v);
+  return mFn->Func(sU);
+}
+
+
+/*****
+Return the gradient of the function
+*****/
+void tmReducedFn::Grad(const vector<double>& v, vector<double>& dv)
+{
+  IncGradCalls();
+  ExpandVariables(v);
+  sDu.resize(sU.size());
+  mFn->Grad(sU, sDu);
+  ContractGradient(dv);
+}
+
+
+/*****
+Return the value and gradient of the function
+*****/
+double tmReducedFn::FuncGrad(const vector<double>& v, vector<double>& dv)
+{
+  IncFuncCalls();
+  IncGradCalls();
+  ExpandVariables(v);
+  sDu.resize(sU.size());
+  double f = mFn->FuncGrad(sU, sDu);
+  ContractGradient(dv);
+  return f;
+}
+
+
+/*****
+Return the reduced variables the function depends on, if we know them
+*****/
+bool tmReducedFn::GetVariables(vector<size_t>& vars) const
+{
+  if (!mSparse) return false;
+  mMap->ReduceVariables(mVars, vars);
+  return true;
+}
+
+
+#ifdef __MWERKS__
+  #pragma mark -
+#endif
+
+
+/**********
+class tmReducedNLCO
+Optimizer that solves a problem posed in the full variables by passing the
+reduced problem to another optimizer
+**********/
+
+/*****
+Find the free variable that v[j] depends on in the forest of eliminations (see
+EliminateEqualities()) and make it v[j]'s parent, updating the affine map
+along the way.
+*****/
+static void FindRoot(size_t j, vector<size_t>& parent, vector<double>& scale,
+  vector<double>& offset)
+{
+  size_t p = parent[j];
+  if (p == j) return;
+  FindRoot(p, parent, scale, offset);
+  offset[j] += scale[j] * offset[p];
+  scale[j] *= scale[p];
+  parent[j] = parent[p];
+}
+
+
+/*****
+Constructor. aNLCO does the actual work and stays owned by the caller; it will
+own the wrapped objective and constraints. We own aMap. If presolve is true, we
+hold on to the problem until Presolve(), so that we can eliminate the simple
+linear equalities from it first.
+*****/
+tmReducedNLCO::tmReducedNLCO(tmNLCO* aNLCO, tmVariableMap* aMap, bool presolve)
+  : mNLCO(aNLCO), mMap(aMap), mPresolved(!presolve), mWrap(true)
+{
+}
+
+
+/*****
+Destructor. Anything we're still holding never made it to mNLCO, so it's ours
+to delete.
+*****/
+tmReducedNLCO::~tmReducedNLCO()
+{
+  if (!mPresolved) delete GetObjective();
+  for (size_t i = 0; i < mHeld.size(); ++i) delete mHeld[i].mFn;
+  for (size_t i = 0; i < mEliminated.size(); ++i) delete mEliminated[i];
+  delete mMap;
+}
+
+
+/*****
+Set the size of the full problem, which tells the real optimizer the size of
+the reduced one.
+*****/
+void tmReducedNLCO::SetSize(size_t n)
+{
+  TMASSERT(n == mMap->GetNumFull());
+  tmNLCO::SetSize(n);
+  if (mPresolved) mNLCO->SetSize(mMap->GetNumReduced());
+}
+
+
+/*****
+Return the number of equality constraints
+*****/
+size_t tmReducedNLCO::GetNumEqualities()
+{
+  return mNLCO->GetNumEqualities();
+}
+
+
+/*****
+Return the number of inequality constraints
+*****/
+size_t tmReducedNLCO::GetNumInequalities()
+{
+  return mNLCO->GetNumInequalities();
+}
+
+
+/*****
+Return the number of variables the real optimizer works with
+*****/
+size_t tmReducedNLCO::GetNumVariables()
+{
+  return mNLCO->GetNumVariables();
+}
+
+
+/*****
+Return f as a function of the reduced variables.
+*****/
+tmDifferentiableFn* tmReducedNLCO::Wrap(tmDifferentiableFn* f)
+{
+  return mWrap ? new tmReducedFn(f, mMap) : f;
+}
+
+
+/*****
+Set the objective function, a function of the full variables
+*****/
+void tmReducedNLCO::SetObjective(tmDifferentiableFn* f)
+{
+  tmNLCO::SetObjective(f);
+  if (mPresolved) mNLCO->SetObjective(Wrap(f));
+}
+
+
+/*****
+Pass a constraint on to the real optimizer, or hold it until Presolve().
+*****/
+void tmReducedNLCO::PassConstraint(Kind kind, tmDifferentiableFn* f)
+{
+  if (!mPresolved) {
+    Constraint c = {kind, f};
+    mHeld.push_back(c);
+    return;
+  }
+  switch (kind) {
+    case LINEAR_EQUALITY:
+      mNLCO->AddLinearEquality(Wrap(f));
+      break;
+    case NONLINEAR_EQUALITY:
+      mNLCO->AddNonlinearEquality(Wrap(f));
+      break;
+    case LINEAR_INEQUALITY:
+      mNLCO->AddLinearInequality(Wrap(f));
+      break;
+    case NONLINEAR_INEQUALITY:
+      mNLCO->AddNonlinearInequality(Wrap(f));
+      break;
+  }
+}
+
+
+/*****
+Add a linear equality constraint
+*****/
+void tmReducedNLCO::AddLinearEquality(tmDifferentiableFn* f)
+{
+  AddConstraint(f);
+  PassConstraint(LINEAR_EQUALITY, f);
+}
+
+
+/*****
+Add a nonlinear equality constraint
+*****/
+void tmReducedNLCO::AddNonlinearEquality(tmDifferentiableFn* f)
+{
+  AddConstraint(f);
+  PassConstraint(NONLINEAR_EQUALITY, f);
+}
+
+
+/*****
+Add a linear inequality constraint
+*****/
+void tmReducedNLCO::AddLinearInequality(tmDifferentiableFn* f)
+{
+  AddConstraint(f);
+  PassConstraint(LINEAR_INEQUALITY, f);
+}
+
+
+/*****
+Add a nonlinear inequality constraint
+*****/
+void tmReducedNLCO::AddNonlinearInequality(tmDifferentiableFn* f)
+{
+  AddConstraint(f);
+  PassConstraint(NONLINEAR_INEQUALITY, f);
+}
+
+
+/*****
+Set bounds on the full variables.
+*****/
+void tmReducedNLCO::SetBounds(const vector<double>& bl, const vector<double>& bu)
+{
+  if (mPresolved) PassBounds(bl, bu);
+  else {
+    mBl = bl;
+    mBu = bu;
+  }
+}
+
+
+/*****
+Pass the bounds on to the real optimizer. Those that the bounds on the reduced
+variables don't take care of become linear inequalities.
+*****/
+void tmReducedNLCO::PassBounds(const vector<double>& bl,
+  const vector<double>& bu)
+{
+  if (!mWrap) {
+    mNLCO->SetBounds(bl, bu);
+    return;
+  }
+  vector<double> vbl, vbu;
+  vector<size_t> unimplied;
+  mMap->ReduceBounds(bl, bu, vbl, vbu, unimplied);
+  mNLCO->SetBounds(vbl, vbu);
+  for (size_t i = 0; i < unimplied.size(); ++i) {
+    size_t k = unimplied[i];
+    mNLCO->AddLinearInequality(Wrap(new OneVarFn(k, -1.0, bl[k])));
+    mNLCO->AddLinearInequality(Wrap(new OneVarFn(k, 1.0, -bu[k])));
+  }
+}
+
+
+/*****
+Find the held linear equalities that involve at most two free variables once
+the variables already eliminated have been substituted, use each of them to
+eliminate one more (or to fix one), and mark them in eliminated. Then reduce
+the map to the variables left free.
+
+The eliminations form a forest: each reduced variable v[j] is either free, or
+fixed at value[j], or offset[j] + scale[j] * v[parent[j]]. Finding the free
+variable at the root is a union-find with an affine map on every link.
+*****/
+void tmReducedNLCO::EliminateEqualities(vector<bool>& eliminated)
+{
+  size_t nv = mMap->GetNumReduced();
+  vector<size_t> parent(nv);
+  vector<double> scale(nv, 1.0);
+  vector<double> offset(nv, 0.0);
+  vector<double> value(nv, 0.0);
+  vector<bool> fixed(nv, false);
+  for (size_t j = 0; j < nv; ++j) parent[j] = j;
+  vector<double> v(nv, 0.0), u, du(mSize, 0.0), dv;
+  vector<size_t> uvars, vvars;
+  size_t numEliminated = 0;
+  for (size_t i = 0; i < mHeld.size(); ++i) {
+    if (mHeld[i].mKind != LINEAR_EQUALITY) continue;
+    tmDifferentiableFn* f = mHeld[i].mFn;
+    if (!f->GetVariables(uvars)) continue;
+    sort(uvars.begin(), uvars.end());
+    uvars.erase(unique(uvars.begin(), uvars.end()), uvars.end());
+    
+    // f is linear, so its value at v = 0 and its gradient there give it as
+    // c + sum over j of dv[j] * v[j].
+    mMap->Expand(v, uvars, u);
+    double c = f->Func(u);
+    f->Grad(u, du);
+    mMap->Contract(du, uvars, dv);
+    mMap->ReduceVariables(uvars, vvars);
+    
+    // Rewrite it in terms of free variables, giving up if there are more than
+    // two of them.
+    size_t nt = 0;
+    size_t r[2];
+    double a[2];
+    double amax = 0;
+    bool simple = true;
+    for (size_t t = 0; t < vvars.size() && simple; ++t) {
+      size_t j = vvars[t];
+      double aj = dv[j];
+      amax = max(amax, fabs(aj));
+      FindRoot(j, parent, scale, offset);
+      size_t rj = parent[j];
+      if (fixed[rj]) {
+        c += aj * (offset[j] + scale[j] * value[rj]);
+        continue;
+      }
+      c += aj * offset[j];
+      aj *= scale[j];
+      size_t s = 0;
+      while (s < nt && r[s] != rj) ++s;
+      if (s < nt) a[s] += aj;
+      else if (nt < 2) {
+        r[nt] = rj;
+        a[nt++] = aj;
+      }
+      else simple = false;
+    }
+    if (!simple) continue;
+    size_t m = 0;
+    for (size_t s = 0; s < nt; ++s)
+      if (fabs(a[s]) > TINY_COEFF * amax) {
+        r[m] = r[s];
+        a[m++] = a[s];
+      }
+    
+    // With no free variables left, the equality either follows from the
+    // others or contradicts them; in the latter case the optimizer must still
+    // see it. With one, it fixes that variable. With two, we eliminate the
+    // one with the larger coefficient, so that the multiplier is at most 1,
+    // or on a tie the later one.
+    if (m == 0) {
+      if (fabs(c) > BOUND_TOL * (1 + amax)) continue;
+    }
+    else if (m == 1) {
+      fixed[r[0]] = true;
+      value[r[0]] = -c / a[0];
+    }
+    else {
+      size_t e = (fabs(a[0]) > fabs(a[1]) || 
+        (fabs(a[0]) == fabs(a[1]) && r[0] > r[1])) ? 0 : 1;
+      size_t k = 1 - e;
+      parent[r[e]] = r[k];
+      scale[r[e]] = -a[k] / a[e];
+      offset[r[e]] = -c / a[e];
+    }
+    eliminated[i] = true;
+    ++numEliminated;
+  }
+  if (numEliminated == 0) return;
+  
+  // Build the map from the free variables to the old reduced ones. If the
+  // equalities leave nothing free, we'd rather let the optimizer work on them
+  // as constraints.
+  tmVariableMap* theMap = new tmVariableMap(nv);
+  for (size_t j = 0; j < nv; ++j) {
+    FindRoot(j, parent, scale, offset);
+    if (parent[j] == j && !fixed[j]) theMap->AddCopy(j);
+  }
+  if (theMap->GetNumReduced() == 0) {
+    delete theMap;
+    eliminated.assign(eliminated.size(), false);
+    return;
+  }
+  for (size_t j = 0; j < nv; ++j) {
+    size_t rj = parent[j];
+    if (rj == j && !fixed[j]) continue;
+    if (fixed[rj]) theMap->AddConstant(j, offset[j] + scale[j] * value[rj]);
+    else theMap->AddMultiple(j, rj, scale[j], offset[j]);
+  }
+  mMap->Compose(*theMap);
+  delete theMap;
+}
+
+
+/*****
+Eliminate what equalities we can and pass the rest of the problem on to the
+real optimizer. Call this once the whole problem has been set up; Minimize()
+will call it if nobody has.
+*****/
+void tmReducedNLCO::Presolve()
+{
+  if (mPresolved) return;
+  mPresolved = true;
+  vector<bool> eliminated(mHeld.size(), false);
+  EliminateEqualities(eliminated);
+  mNLCO->SetSize(mMap->GetNumReduced());
+  if (!mBl.empty()) PassBounds(mBl, mBu);
+  if (GetObjective()) mNLCO->SetObjective(Wrap(GetObjective()));
+  for (size_t i = 0; i < mHeld.size(); ++i) {
+    if (eliminated[i]) mEliminated.push_back(mHeld[i].mFn);
+    else PassConstraint(mHeld[i].mKind, mHeld[i].mFn);
+  }
+  mHeld.clear();
+  mBl.clear();
+  mBu.clear();
+}
+
+
+/*****
+Minimize, starting from and returning the full vector x
+*****/
+int tmReducedNLCO::Minimize(vector<double>& x)
+{
+  Presolve();
+  vector<double> v;
+  mMap->Reduce(x, v);
+  if (mUpdater) mNLCO->SetUpdater(mUpdater);
+  if (mBudget) mNLCO->SetBudget(mBudget);
+  int inform = mNLCO->Minimize(v);
+  mMap->Expand(v, x);
+  return inform;
+}
+
+
+/*****
+Pass UI updates from the objective on to the real optimizer, which decides
+when they actually happen.
+*****/
+void tmReducedNLCO::ObjectiveUpdateUI()
+{
+  mNLCO->ObjectiveUpdateUI();
+}
@@ -0,0 +1,172 @@
+/*******************************************************************************
+File:         tmReducedNLCO.h
+Project:      TreeMaker 5.x
+Purpose:      Header file for optimization over a reduced set of variables
+Author:       Robert J. Lang
+Modified by:
+Created:      2026-10-19
+Copyright:    ©2026 Robert J. Lang. All Rights Reserved.
+*******************************************************************************/
+
+#ifndef _TMREDUCEDNLCO_H_
+#define _TMREDUCEDNLCO_H_
+
+#include "tmNLCO.h"
+#include "tmPoint.h"
+
+/*
+When some of the variables of an optimization are fixed functions of the
+others -- as when one node of a mirror pair is the reflection of its partner,
+or a node is confined to the line of symmetry -- we can hand the optimizer only
+the independent ones. Class tmVariableMap records the affine map from the
+reduced vector v that the optimizer sees to the full state vector u that the
+objective and constraint functions were written for. Each u[k] depends on at
+most two of the v[j], so the map and its transpose cost O(u.size()).
+
+Class tmReducedNLCO sits between a tmOptimizer and the real tmNLCO. It takes
+the objective, constraints and bounds in terms of u, wraps each function in a
+tmReducedFn that expands v into u on the way in and maps the gradient back on
+the way out, and passes the reduced problem to the real optimizer.
+
+Conditions also fix variables outright (a fixed node or edge length) or tie two
+of them together (two edges with the same strain), which they impose as linear
+equalities. Given the chance, tmReducedNLCO holds on to the whole problem until
+Presolve(), then uses every linear equality that involves only one or two
+reduced variables to express one of them in terms of the other, or as a
+constant, and drops it. What's left is the null space of those equalities,
+which the optimizer explores freely rather than through penalty terms.
+*/
+
+/**********
+class tmVariableMap
+Affine map from a reduced vector of variables to a full one
+**********/
+class tmVariableMap {
+public:
+  tmVariableMap(std::size_t numFull);
+
+  std::size_t GetNumFull() const {return mFull.size();};
+  std::size_t GetNumReduced() const {return mReduced.size();};
+
+  // Building the map
+  void AddCopy(std::size_t k);
+  void AddLine(std::size_t kx, std::size_t ky, const tmPoint& p, double angle);
+  void AddReflection(std::size_t kx, std::size_t ky, std::size_t rx,
+    std::size_t ry, const tmPoint& p, double angle);
+  void AddConstant(std::size_t k, double c);
+  void AddMultiple(std::size_t k, std::size_t r, double a, double c);
+  void Compose(const tmVariableMap& aMap);
+  bool IsIdentity() const;
+
+  // Using the map
+  void Expand(const std::vector<double>& v, std::vector<double>& u) const;
+  void Contract(const std::vector<double>& du, std::vector<double>& dv) const;
+  void Expand(const std::vector<double>& v,
+    const std::vector<std::size_t>& vars, std::vector<double>& u) const;
+  void Contract(const std::vector<double>& du,
+    const std::vector<std::size_t>& vars, std::vector<double>& dv) const;
+  void Reduce(const std::vector<double>& u, std::vector<double>& v) const;
+  void ReduceVariables(const std::vector<std::size_t>& uvars,
+    std::vector<std::size_t>& vvars) const;
+  void ReduceBounds(const std::vector<double>& bl,
+    const std::vector<double>& bu, std::vector<double>& vbl,
+    std::vector<double>& vbu, std::vector<std::size_t>& unbounded) const;
+
+private:
+  // One side of the map: x[i] = c + a[0] * y[j[0]] + a[1] * y[j[1]] + ...,
+  // using only the first n terms. u needs at most two, v at most three. A
+  // u with no terms at all is a constant.
+  struct Entry {
+    double c;
+    std::size_t n;
+    std::size_t j[3];
+    double a[3];
+    Entry() : c(0), n(0) {};
+    void AddTerm(std::size_t aj, double aa);
+  };
+  std::vector<Entry> mFull;       // u in terms of v
+  std::vector<Entry> mReduced;    // v in terms of u
+  std::vector<std::size_t> mVarOf;  // the v that copies u[k], or BAD_OFFSET
+
+  std::size_t NewVariable();
+};
+
+
+/**********
+class tmReducedFn
+A function of the full variables, evaluated on the reduced ones
+**********/
+class tmReducedFn : public tmDifferentiableFn {
+public:
+  tmReducedFn(tmDifferentiableFn* f, const tmVariableMap* aMap);
+  ~tmReducedFn();
+  double Func(const std::vector<double>& v);
+  void Grad(const std::vector<double>& v, std::vector<double>& dv);
+  double FuncGrad(const std::vector<double>& v, std::vector<double>& dv);
+  bool GetVariables(std::vector<std::size_t>& vars) const;
+private:
+  tmDifferentiableFn* mFn;        // the function of u, which we own
+  const tmVariableMap* mMap;      // how to get u from v
+  bool mSparse;                   // true if mFn reads only mVars
+  std::vector<std::size_t> mVars; // the elements of u that mFn reads
+
+  void ExpandVariables(const std::vector<double>& v);
+  void ContractGradient(std::vector<double>& dv);
+};
+
+
+/**********
+class tmReducedNLCO
+Optimizer that solves a problem posed in the full variables by passing the
+reduced problem to another optimizer
+**********/
+class tmReducedNLCO : public tmNLCO {
+public:
+  tmReducedNLCO(tmNLCO* aNLCO, tmVariableMap* aMap, bool presolve = false);
+  ~tmReducedNLCO();
+
+  void SetSize(std::size_t n);
+  std::size_t GetNumEqualities();
+  std::size_t GetNumInequalities();
+  std::size_t GetNumVariables();
+
+  void SetObjective(tmDifferentiableFn* f);
+  void AddLinearEquality(tmDifferentiableFn* f);
+  void AddNonlinearEquality(tmDifferentiableFn* f);
+  void AddLinearInequality(tmDifferentiableFn* f);
+  void AddNonlinearInequality(tmDifferentiableFn* f);
+  void SetBounds(const std::vector<double>& bl, const std::vector<double>& bu);
+
+  void Presolve();
+  int Minimize(std::vector<double>& x);
+
+  void ObjectiveUpdateUI();
+private:
+  // The kinds of constraint, for holding them until Presolve()
+  enum Kind {
+    LINEAR_EQUALITY,
+    NONLINEAR_EQUALITY,
+    LINEAR_INEQUALITY,
+    NONLINEAR_INEQUALITY
+  };
+  struct Constraint {
+    Kind mKind;
+    tmDifferentiableFn* mFn;
+  };
+  
+  tmNLCO* mNLCO;                  // the optimizer that does the work
+  tmVariableMap* mMap;            // full vs. reduced variables, which we own
+  bool mPresolved;                // true once mNLCO has the problem
+  bool mWrap;                     // false if the map is the identity
+  std::vector<Constraint> mHeld;  // constraints waiting for Presolve()
+  std::vector<double> mBl;        // bounds waiting for Presolve()
+  std::vector<double> mBu;
+  std::vector<tmDifferentiableFn*> mEliminated; // equalities we dropped, owned
+  
+  tmDifferentiableFn* Wrap(tmDifferentiableFn* f);
+  void PassConstraint(Kind kind, tmDifferentiableFn* f);
+  void PassBounds(const std::vector<double>& bl, const std::vector<double>& bu);
+  void EliminateEqualities(std::vector<bool>& eliminated);
+};
+
+#endif // _TMREDUCEDNLCO_H_
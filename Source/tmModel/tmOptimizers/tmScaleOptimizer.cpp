@@ -10,6 +10,9 @@ Copyright:    ©2003 Robert J. Lang. All Rights Reserved.
 
 #include "tmScaleOptimizer.h"
 #include "tmModel.h"
+#include "tmProfiler.h"
+
+#include <map>
 
 using namespace std;
 
@@ -32,6 +35,7 @@ Initialize the calculation
 *****/
 void tmScaleOptimizer::Initialize()
 {
+  TM_PROFILE_SCOPE("tmScaleOptimizer::Initialize");
   tmTree* theTree = GetTree(); // to have on hand
   
   // Make a list of all leaf nodes.
@@ -40,6 +44,7 @@ void tmScaleOptimizer::Initialize()
   // Set up our state vector
   size_t n = mLeafNodes.size();
   mNumVars = 1 + 2 * n;
+  ReduceVariables(mLeafNodes, mNumVars);
   mNLCO->SetSize(mNumVars);
   mCurrentStateVec.resize(mNumVars);
   TreeToData();
@@ -67,7 +72,13 @@ void tmScaleOptimizer::Initialize()
   // value.
   mNLCO->AddLinearInequality(new OneVarFn(0, -1.0, 0.1 * theTree->GetScale()));
 
-  // Add a constraint for each leaf path.
+  // Add a constraint for each leaf path. If the problem was reduced by
+  // symmetry, a path whose ends both have mirror images is at the same
+  // distance as its image path, so the two constraints are the same but for
+  // the length; we keep one with the longer of the two lengths.
+  vector<size_t> pathi, pathj;
+  vector<double> pathLen;
+  map<pair<size_t, size_t>, size_t> mirrorPaths;
   tmArrayIterator<tmPath*> iOwnedPaths(theTree->GetOwnedPaths());
   tmPath* aPath;
   while (iOwnedPaths.Next(&aPath)) {
@@ -78,18 +89,41 @@ void tmScaleOptimizer::Initialize()
       if (theTree->IsConditioned<tmConditionPathActive>(aPath)) 
         continue;
       
-      // Get indices of the nodes at the end of the paths and add an inequality
-      size_t ix = GetBaseOffset(aPath->GetNodes().front());
-      size_t jx = GetBaseOffset(aPath->GetNodes().back());
-      mNLCO->AddNonlinearInequality(new PathFn1(ix, ix + 1, jx, jx + 1, 
-        aPath->GetMinTreeLength()));
+      // Get indices of the nodes at the end of the paths
+      tmNode* node1 = aPath->GetNodes().front();
+      tmNode* node2 = aPath->GetNodes().back();
+      size_t ix = GetBaseOffset(node1);
+      size_t jx = GetBaseOffset(node2);
+      double len = aPath->GetMinTreeLength();
+      tmNode* mirror1 = GetMirrorNode(node1);
+      tmNode* mirror2 = GetMirrorNode(node2);
+      if (mirror1 && mirror2) {
+        pair<size_t, size_t> key(min(ix, jx), max(ix, jx));
+        size_t mx = GetBaseOffset(mirror1);
+        size_t my = GetBaseOffset(mirror2);
+        pair<size_t, size_t> mkey(min(mx, my), max(mx, my));
+        if (mkey < key) key = mkey;
+        map<pair<size_t, size_t>, size_t>::iterator p = mirrorPaths.find(key);
+        if (p != mirrorPaths.end()) {
+          pathLen[p->second] = max(pathLen[p->second], len);
+          continue;
+        }
+        mirrorPaths[key] = pathLen.size();
+      }
+      pathi.push_back(ix);
+      pathj.push_back(jx);
+      pathLen.push_back(len);
     }
   }
+  for (size_t i = 0; i < pathLen.size(); ++i)
+    mNLCO->AddNonlinearInequality(new PathFn1(pathi[i], pathi[i] + 1, 
+      pathj[i], pathj[i] + 1, pathLen[i]));
   
   // Go through all Conditions and add constraints for each.
   tmArrayIterator<tmCondition*> iConditions(theTree->GetConditions());
   tmCondition* aCondition;
   while (iConditions.Next(&aCondition)) aCondition->AddConstraints(this);
+  Presolve();
   
   // Ready to go. User might want to compare number of equalities against
   // number of variables.
@@ -191,3 +225,12 @@ void tmScaleOptimizerObjective::Grad(const std::vector<double>&,
   du.assign(du.size(), 0.);
   du[0] = -1;
 }
+
+
+/*****
+Write ourselves as the function we are, -u[0], for a recorded problem
+*****/
+bool tmScaleOptimizerObjective::PutSelf(std::ostream& os) const
+{
+  return OneVarFn(0, -1.0, 0.0).PutSelf(os);
+}
@@ -47,6 +47,7 @@ class tmScaleOptimizerObjective : public tmDifferentiableFn
 public:
   double Func(const std::vector<double>& u);
   void Grad(const std::vector<double>& u, std::vector<double>& du);
+  bool PutSelf(std::ostream& os) const;
 private:
   tmScaleOptimizer* mScaleOptimizer;
   tmScaleOptimizerObjective(tmScaleOptimizer* aScaleOptimizer);
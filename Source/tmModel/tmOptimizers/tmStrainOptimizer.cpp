@@ -11,6 +11,7 @@ Copyright:    ©2003 Robert J. Lang. All Rights Reserved.
 #include "tmStrainOptimizer.h"
 #include "tmConstraintFns.h"
 #include "tmNLCO.h"
+#include "tmProfiler.h"
 
 using namespace std;
 
@@ -29,6 +30,7 @@ Initialize the calculation.
 void tmStrainOptimizer::Initialize(tmDpptrArray<tmNode>& movingNodes, 
   tmDpptrArray<tmEdge>& stretchyEdges)
 {
+  TM_PROFILE_SCOPE("tmStrainOptimizer::Initialize");
   tmTree* theTree = GetTree(); // to have on hand
   
   // Include only leaf nodes
@@ -48,6 +50,8 @@ void tmStrainOptimizer::Initialize(tmDpptrArray<tmNode>& movingNodes,
   edgeOffset = 2 * n;          // base index for moving edges (class variable)
   size_t ne = mStretchyEdges.size();  // number of stretchy edges
   mNumVars = edgeOffset + ne;      // total number of variables (class variable)
+  SplitIntoBlocks();
+  ReduceVariables(mMovingNodes, mNumVars);
   mNLCO->SetSize(mNumVars);
   mCurrentStateVec.resize(mNumVars);
   TreeToData();
@@ -144,6 +148,7 @@ void tmStrainOptimizer::Initialize(tmDpptrArray<tmNode>& movingNodes,
   tmArrayIterator<tmCondition*> iConditions(theTree->GetConditions());
   tmCondition* aCondition;
   while (iConditions.Next(&aCondition)) aCondition->AddConstraints(this);
+  Presolve();
   
   // Ready to go. User might want to compare number of equality constraints
   // against the number of variables before proceeding.  
@@ -299,3 +304,14 @@ void tmStrainOptimizerObjective::Grad(const std::vector<double>& u,
   for (size_t i = nn; i < nt; ++i) du[i] = 2 * 
     (mStrainOptimizer->mStiffness[i - nn]) * u[i];
 }
+
+
+/*****
+Write ourselves as the weighted sum of squared strains that we are, for a
+recorded problem
+*****/
+bool tmStrainOptimizerObjective::PutSelf(std::ostream& os) const
+{
+  return WeightedSquaresFn(mStrainOptimizer->edgeOffset,
+    mStrainOptimizer->mStiffness).PutSelf(os);
+}
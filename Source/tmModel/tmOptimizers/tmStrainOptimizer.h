@@ -55,6 +55,7 @@ class tmStrainOptimizerObjective : public tmDifferentiableFn
 public:
   double Func(const std::vector<double>& u);
   void Grad(const std::vector<double>& u, std::vector<double>& du);
+  bool PutSelf(std::ostream& os) const;
 private:
   tmStrainOptimizerObjective(tmStrainOptimizer* aStrainOptimizer);
   tmStrainOptimizer* mStrainOptimizer;
@@ -0,0 +1,306 @@
+/*******************************************************************************
+File:         tmArrayIndex.h
+Project:      TreeMaker 5.x
+Purpose:      Header file for the position map used by indexed arrays
+Author:       Robert J. Lang
+Modified by:
+Created:      2026-10-19
+Copyright:    ©2026 Robert J. Lang. All Rights Reserved.
+*******************************************************************************/
+
+#ifndef _TMARRAYINDEX_H_
+#define _TMARRAYINDEX_H_
+
+/*
+Class tmArrayIndex<K, H> is a small open-addressing hash table that records,
+for each distinct element of an array, how many times it occurs and the offset
+of its first occurrence. It is the engine behind the indexed containers
+(tmIndexedArray<T> and indexed tmDpptrArray<T>), which keep their elements in a
+std::vector as usual -- so iteration order is unchanged -- but answer
+contains() in constant time.
+
+The table uses linear probing with a power-of-two number of slots, a load
+factor of at most 1/2, and backward-shift deletion, so there are no tombstones
+to clean up.
+
+Offsets are maintained lazily. Removing or inserting an element in the middle
+of an array shifts everything behind it, and renumbering all of those entries
+on every edit would cost more than the edit itself. Instead, the owning array
+calls Invalidate(i) to say that offsets from i on may have moved. The table
+keeps the invariant that an element whose first occurrence lies below the
+invalid point has an exact stored offset, while one whose first occurrence lies
+at or beyond it has a stored offset at or beyond it too. So GetSearchStart()
+always gives a safe place to start looking for an element, and GetOffset()
+renumbers the invalid tail (once) only when someone actually asks for an
+offset that lies in it.
+*/
+
+#include <vector>
+#include <functional>
+
+#include "tmHeader.h"
+
+/**********
+class tmArrayHash<K>
+Default hash function for tmArrayIndex. Scrambles std::hash<K> so that keys
+with regular low-order bits (like aligned pointers) still spread over the
+table.
+**********/
+template <class K>
+struct tmArrayHash {
+  std::size_t operator()(const K& k) const {
+    return std::size_t(std::hash<K>()(k) * 0x9E3779B97F4A7C15ULL);};
+};
+
+
+/**********
+class tmArrayIndex<K, H>
+Map from a key to its multiplicity and first offset in an array.
+**********/
+template <class K, class H = tmArrayHash<K> >
+class tmArrayIndex
+{
+public:
+  enum {
+    NOT_FOUND = std::size_t(-1)
+  };
+
+  tmArrayIndex() : mNumKeys(0), mShift(0), mValidBelow(NOT_FOUND) {};
+
+  // Queries
+  bool Contains(const K& k) const;
+  std::size_t GetSearchStart(const K& k) const;
+  template <class I, class F>
+    std::size_t GetOffset(const K& k, I first, I last, F keyOf);
+
+  // Modifying operations
+  void Add(const K& k, std::size_t i);
+  void RemoveOne(const K& k);
+  void RemoveAll(const K& k);
+  void Invalidate(std::size_t i) {
+    if (mValidBelow > i) mValidBelow = i;};
+  void Clear();
+  template <class I, class F>
+    void Rebuild(I first, I last, F keyOf);
+private:
+  struct Slot {
+    K mKey;
+    std::size_t mCount;   // zero marks an empty slot
+    std::size_t mOffset;  // offset of first occurrence, see above
+  };
+  std::vector<Slot> mSlots;   // size is zero or a power of 2
+  std::size_t mNumKeys;       // number of occupied slots
+  std::size_t mShift;         // hash bits discarded to get a slot number
+  std::size_t mValidBelow;    // offsets below this are exact
+  H mHash;
+
+  std::size_t GetHome(const K& k) const {
+    return mHash(k) >> mShift;};
+  std::size_t GetSlot(const K& k) const;
+  void Resize(std::size_t numSlots);
+  template <class I, class F>
+    void Renumber(I first, I last, F keyOf);
+};
+
+
+/**********
+Template definitions
+**********/
+
+/*****
+Return the slot holding key k, or the empty slot where it would go. Only valid
+if the table has slots.
+*****/
+template <class K, class H>
+std::size_t tmArrayIndex<K, H>::GetSlot(const K& k) const
+{
+  std::size_t mask = mSlots.size() - 1;
+  std::size_t s = GetHome(k);
+  while (mSlots[s].mCount != 0 && !(mSlots[s].mKey == k))
+    s = (s + 1) & mask;
+  return s;
+}
+
+
+/*****
+Return true if key k occurs in the array.
+*****/
+template <class K, class H>
+bool tmArrayIndex<K, H>::Contains(const K& k) const
+{
+  if (mNumKeys == 0) return false;
+  return mSlots[GetSlot(k)].mCount != 0;
+}
+
+
+/*****
+Return an offset at or before the first occurrence of key k, or NOT_FOUND if
+the key isn't in the table.
+*****/
+template <class K, class H>
+std::size_t tmArrayIndex<K, H>::GetSearchStart(const K& k) const
+{
+  if (mNumKeys == 0) return NOT_FOUND;
+  const Slot& theSlot = mSlots[GetSlot(k)];
+  if (theSlot.mCount == 0) return NOT_FOUND;
+  return (theSlot.mOffset < mValidBelow) ? theSlot.mOffset : mValidBelow;
+}
+
+
+/*****
+Return the exact offset of the first occurrence of key k, or NOT_FOUND if the
+key isn't in the table. [first, last) must be the full contents of the array;
+if the stored offset isn't known to be exact, the invalid part of the array is
+renumbered first.
+*****/
+template <class K, class H>
+template <class I, class F>
+std::size_t tmArrayIndex<K, H>::GetOffset(const K& k, I first, I last,
+  F keyOf)
+{
+  if (mNumKeys == 0) return NOT_FOUND;
+  std::size_t s = GetSlot(k);
+  if (mSlots[s].mCount == 0) return NOT_FOUND;
+  if (mSlots[s].mOffset < mValidBelow) return mSlots[s].mOffset;
+  Renumber(first, last, keyOf);
+  return mSlots[s].mOffset;
+}
+
+
+/*****
+Record an occurrence of key k at offset i. This is only correct when i lies
+past every other occurrence of k, or has also been passed to Invalidate().
+*****/
+template <class K, class H>
+void tmArrayIndex<K, H>::Add(const K& k, std::size_t i)
+{
+  if (2 * (mNumKeys + 1) > mSlots.size())
+    Resize(mSlots.empty() ? 16 : 2 * mSlots.size());
+  Slot& theSlot = mSlots[GetSlot(k)];
+  if (theSlot.mCount == 0) {
+    theSlot.mKey = k;
+    theSlot.mOffset = i;
+    ++mNumKeys;
+  }
+  ++theSlot.mCount;
+}
+
+
+/*****
+Record the removal of one occurrence of key k.
+*****/
+template <class K, class H>
+void tmArrayIndex<K, H>::RemoveOne(const K& k)
+{
+  if (mNumKeys == 0) return;
+  std::size_t s = GetSlot(k);
+  if (mSlots[s].mCount > 1) --mSlots[s].mCount;
+  else RemoveAll(k);
+}
+
+
+/*****
+Remove key k from the table, if it's there. Entries further along the probe
+sequence are shifted back so that no lookup ever stops early.
+*****/
+template <class K, class H>
+void tmArrayIndex<K, H>::RemoveAll(const K& k)
+{
+  if (mNumKeys == 0) return;
+  std::size_t mask = mSlots.size() - 1;
+  std::size_t s = GetSlot(k);
+  if (mSlots[s].mCount == 0) return;
+  std::size_t t = s;
+  while (true) {
+    t = (t + 1) & mask;
+    if (mSlots[t].mCount == 0) break;
+    // The entry at t can fill the hole at s only if its home slot doesn't lie
+    // cyclically within (s, t].
+    std::size_t h = GetHome(mSlots[t].mKey);
+    bool stays = (s < t) ? (s < h && h <= t) : (s < h || h <= t);
+    if (stays) continue;
+    mSlots[s] = mSlots[t];
+    s = t;
+  }
+  mSlots[s].mCount = 0;
+  --mNumKeys;
+}
+
+
+/*****
+Remove all keys. The slots are retained for reuse.
+*****/
+template <class K, class H>
+void tmArrayIndex<K, H>::Clear()
+{
+  if (mNumKeys != 0)
+    for (std::size_t s = 0; s < mSlots.size(); ++s) mSlots[s].mCount = 0;
+  mNumKeys = 0;
+  mValidBelow = NOT_FOUND;
+}
+
+
+/*****
+Rebuild the table from scratch from the range [first, last); keyOf() maps an
+element of the range to its key.
+*****/
+template <class K, class H>
+template <class I, class F>
+void tmArrayIndex<K, H>::Rebuild(I first, I last, F keyOf)
+{
+  Clear();
+  for (std::size_t i = 0; first != last; ++first, ++i)
+    Add(keyOf(*first), i);
+}
+
+
+/*****
+Make every stored offset exact by renumbering the first occurrences of the
+elements at or after mValidBelow. First we mark those entries as unnumbered by
+setting their offsets to NOT_FOUND (which only touches keys whose first
+occurrence lies in the tail, by the invariant), then the first time we meet
+each such key we give it its offset.
+*****/
+template <class K, class H>
+template <class I, class F>
+void tmArrayIndex<K, H>::Renumber(I first, I last, F keyOf)
+{
+  if (mValidBelow == std::size_t(NOT_FOUND)) return;
+  I tail = first + std::ptrdiff_t(mValidBelow);
+  for (I p = tail; p != last; ++p) {
+    Slot& theSlot = mSlots[GetSlot(keyOf(*p))];
+    if (theSlot.mOffset >= mValidBelow) theSlot.mOffset = NOT_FOUND;
+  }
+  std::size_t i = mValidBelow;
+  for (I p = tail; p != last; ++p, ++i) {
+    Slot& theSlot = mSlots[GetSlot(keyOf(*p))];
+    if (theSlot.mOffset == std::size_t(NOT_FOUND)) theSlot.mOffset = i;
+  }
+  mValidBelow = NOT_FOUND;
+}
+
+
+/*****
+Rehash all entries into a table with the given number of slots, which must be
+a power of 2.
+*****/
+template <class K, class H>
+void tmArrayIndex<K, H>::Resize(std::size_t numSlots)
+{
+  std::vector<Slot> oldSlots;
+  oldSlots.swap(mSlots);
+  Slot emptySlot;
+  emptySlot.mKey = K();
+  emptySlot.mCount = 0;
+  emptySlot.mOffset = 0;
+  mSlots.assign(numSlots, emptySlot);
+  mShift = 8 * sizeof(std::size_t);
+  for (std::size_t n = numSlots; n > 1; n >>= 1) --mShift;
+  for (std::size_t s = 0; s < oldSlots.size(); ++s) {
+    if (oldSlots[s].mCount == 0) continue;
+    mSlots[GetSlot(oldSlots[s].mKey)] = oldSlots[s];
+  }
+}
+
+
+#endif // _TMARRAYINDEX_H_
@@ -129,7 +129,7 @@ Destructor. Notify the tmDpptrTarget that it no longer has me pointing at it
 template <class T>
 tmDpptr<T>::~tmDpptr()
 {
-  if (mTarget) DstRemoveMeAsDpptrSrc(mTarget);
+  if (mTarget) DstReleaseMeAsDpptrSrc(mTarget);
 }
 
 
@@ -12,8 +12,10 @@ Copyright:    ©2003 Robert J. Lang. All Rights Reserved.
 #define _TMDPPTRARRAY_H_
 
 #include <algorithm>
+#include <type_traits>
 
 #include "tmArray.h"
+#include "tmArrayIndex.h"
 #include "tmDpptr.h"
 
 // We overload casts in a couple of places, but not under GCC 3.x, which
@@ -57,8 +59,39 @@ delete elem;
 This deletion has the side effect of removing the first element from
 const_array, even though we declared it as const! Errors based on this
 phenomenon are fairly hard to track down.
+
+A tmDpptrArray<T> can optionally be indexed (see set_indexed()), in which case
+it keeps a tmArrayIndex of its elements. That makes contains() and union_with()
+constant-time lookups rather than scans of the whole array, and lets the
+removal of a deleted object start at its first occurrence. Indexing is a
+property of the particular array object; it is not carried along by copies or
+by casts to tmArray<T*>, which see only the ordinary linear-time queries.
+
+Within the scope of a tmDpptrTeardown, deleting an object doesn't remove it
+from the arrays that hold it right away; each such array instead removes all
+of its deleted objects in one pass when the teardown ends. Until then, the
+array may hold dangling pointers, so don't look at its contents (other than
+by KillItems(), which knows to skip them) inside the teardown. Deferring
+means comparing pointers to dead objects against the dying tmDpptrTarget*,
+which is only safe when T* converts to tmDpptrTarget* by plain pointer
+arithmetic, so arrays of classes that inherit tmDpptrTarget virtually go on
+removing deleted objects immediately.
 */
 
+
+/**********
+struct tmDpptrCanDefer<T>
+True if T inherits tmDpptrTarget non-virtually (tested by whether a
+tmDpptrTarget* can be static_cast to a T*).
+**********/
+template <class T, class = void>
+struct tmDpptrCanDefer : std::false_type {};
+
+template <class T>
+struct tmDpptrCanDefer<T, std::void_t<decltype(
+  static_cast<T*>(std::declval<tmDpptrTarget*>()))> > : std::true_type {};
+
+
 /**********
 class tmDpptrArray<T>
 A dangle-proof list of pointers-to-T. When one of the objects of type T is
@@ -81,7 +114,7 @@ public:
   typedef T* ptr_t;
   
   // Constructor/destructor
-  tmDpptrArray() {};
+  tmDpptrArray() : mIndex(0) {};
   tmDpptrArray(const tmDpptrArray<T>& aList);
   tmDpptrArray(const tmArray<T*>& aList);
   ~tmDpptrArray();
@@ -90,6 +123,10 @@ public:
   const tmDpptrArray& operator=(const tmDpptrArray<T>& aList);
   const tmDpptrArray& operator=(const tmArray<T*>& aList);
   
+  // Optional index for fast lookup
+  void set_indexed(bool indexed);
+  bool is_indexed() const {return mIndex != 0;};
+  
   // Cast to ancestor: allow only read-only cast.
 #if TM_OVERLOAD_CASTS
   operator const tmArray<T*>() const {return *this;};
@@ -111,13 +148,30 @@ public:
   void clear();
   void InsertItemAt(std::size_t n, T* p);
   void ReplaceItemAt(std::size_t n, T* p);
+  void SwapItems(std::size_t inIndexA, std::size_t inIndexB);
+  void MoveItem(std::size_t inFromIndex, std::size_t inToIndex);
+  void rotate_left();
+  void rotate_right();
   void KillItems();
   void merge_with(const tmArray<T*>& aList);    
   void union_with(const tmArray<T*>& aList);
   void intersect_with(const tmArray<T*>& aList);
+  
+  // Queries, answered from the index if there is one
+  std::size_t GetIndex(T* p) const;
+  std::size_t GetOffset(T* p) const;
+  bool contains(T* p) const;
+  bool intersects(const tmArray<T*>& aList) const;
 private:
+  typedef tmArrayIndex<const tmDpptrTarget*> index_t;
+  index_t* mIndex;    // count and first offset of elements, if indexed
+  
   // used in implementation
   void RemoveDpptrTarget(tmDpptrTarget* aDpptrTarget);
+  void TeardownDpptrTarget(tmDpptrTarget* aDpptrTarget);
+  void RemoveDeadDpptrTargets();
+  static const tmDpptrTarget* KeyOf(T* p) {return p;};
+  void RebuildIndex();
   
   // non-const overload not allowed (if compiler allows overloading)
 #if TM_OVERLOAD_CASTS
@@ -147,6 +201,7 @@ Copy constructor from tmDpptrArray<T>
 *****/
 template <class T>
 tmDpptrArray<T>::tmDpptrArray(const tmDpptrArray<T>& aList)
+  : mIndex(0)
 {
   merge_with(aList);
 }
@@ -157,6 +212,7 @@ Copy constructor from tmArray<T*>
 *****/
 template <class T>
 tmDpptrArray<T>::tmDpptrArray(const tmArray<T*>& aList)
+  : mIndex(0)
 {
   merge_with(aList);
 }
@@ -168,8 +224,10 @@ Assignment from tmDpptrArray<T>
 template <class T>
 const tmDpptrArray<T>& tmDpptrArray<T>::operator=(const tmDpptrArray<T>& aList)
 {
+  if (&aList == this) return *this;
   clear();
   merge_with(aList);
+  return *this;
 }
 
 
@@ -179,8 +237,28 @@ Assignment from tmArray<T*>
 template <class T>
 const tmDpptrArray<T>& tmDpptrArray<T>::operator=(const tmArray<T*>& aList)
 {
+  if (&aList == this) return *this;
   clear();
   merge_with(aList);
+  return *this;
+}
+
+
+/*****
+Turn the lookup index on or off. Turning it on indexes the current contents.
+*****/
+template <class T>
+void tmDpptrArray<T>::set_indexed(bool indexed)
+{
+  if (indexed == is_indexed()) return;
+  if (indexed) {
+    mIndex = new index_t();
+    RebuildIndex();
+  }
+  else {
+    delete mIndex;
+    mIndex = 0;
+  }
 }
 
 
@@ -191,7 +269,8 @@ template <class T>
 tmDpptrArray<T>::~tmDpptrArray()
 {
   for (std::size_t i = 0; i < this->size(); ++i) 
-    DstRemoveMeAsDpptrSrc((*this)[i]);
+    DstReleaseMeAsDpptrSrc((*this)[i]);
+  delete mIndex;
 }
 
 
@@ -203,6 +282,7 @@ void tmDpptrArray<T>::push_back(T* p)
 {
   tmArray<T*>::push_back(p);
   DstAddMeAsDpptrSrc(p);
+  if (mIndex) mIndex->Add(KeyOf(p), this->size() - 1);
 }
 
 
@@ -215,6 +295,10 @@ void tmDpptrArray<T>::push_front(T* pt)
 {
   tmArray<T*>::insert(this->begin(), pt);
   DstAddMeAsDpptrSrc(pt);
+  if (mIndex) {
+    mIndex->Invalidate(0);
+    mIndex->Add(KeyOf(pt), 0);
+  }
 }
 
 
@@ -234,7 +318,17 @@ Remove all copies of this item from the list.
 *****/
 template <class T>
 void tmDpptrArray<T>::erase_remove(T* pt) {
-	if (this->contains(pt)) {
+	if (mIndex) {
+		std::size_t i = mIndex->GetSearchStart(KeyOf(pt));
+		if (i == std::size_t(index_t::NOT_FOUND))
+			return;
+		mIndex->RemoveAll(KeyOf(pt));
+		tmArray<T*>::erase(std::remove(this->begin() + std::ptrdiff_t(i), this->end(), pt), this->end());
+		if (i < this->size())
+			mIndex->Invalidate(i);
+		DstRemoveMeAsDpptrSrc(pt);
+	}
+	else if (this->contains(pt)) {
 		tmArray<T*>::erase_remove(pt);
 		DstRemoveMeAsDpptrSrc(pt);
 	};
@@ -258,6 +352,7 @@ void tmDpptrArray<T>::replace_with(T*& told, T*& tnew)
     *p = tnew;
     DstAddMeAsDpptrSrc(*p);
   }
+  if (mIndex && removedMe) RebuildIndex();
 }
 
 
@@ -270,6 +365,7 @@ void tmDpptrArray<T>::clear()
   for (std::size_t i = 0; i < this->size(); ++i) 
     DstRemoveMeAsDpptrSrc((*this)[i]);
   tmArray<T*>::clear();
+  if (mIndex) mIndex->Clear();
 }
 
 
@@ -281,6 +377,10 @@ void tmDpptrArray<T>::InsertItemAt(std::size_t n, T* pt)
 {
   tmArray<T*>::InsertItemAt(n, pt);
   DstAddMeAsDpptrSrc(pt);
+  if (mIndex) {
+    if (n < this->size()) mIndex->Invalidate(n - 1);
+    mIndex->Add(KeyOf(pt), n - 1);
+  }
 }
 
 
@@ -294,6 +394,55 @@ void tmDpptrArray<T>::ReplaceItemAt(std::size_t n, T* pt)
   tmArray<T*>::ReplaceItemAt(n, pt);
   DstAddMeAsDpptrSrc(pt);
   DstRemoveMeAsDpptrSrc(qt);
+  if (mIndex) {
+    mIndex->RemoveOne(KeyOf(qt));
+    mIndex->Invalidate(n - 1);
+    mIndex->Add(KeyOf(pt), n - 1);
+  }
+}
+
+
+/*****
+Swap two items in a list.
+*****/
+template <class T>
+void tmDpptrArray<T>::SwapItems(std::size_t inIndexA, std::size_t inIndexB)
+{
+  tmArray<T*>::SwapItems(inIndexA, inIndexB);
+  if (mIndex) mIndex->Invalidate(std::min(inIndexA, inIndexB) - 1);
+}
+
+
+/*****
+Move one item to another location in a list based on location
+*****/
+template <class T>
+void tmDpptrArray<T>::MoveItem(std::size_t inFromIndex, std::size_t inToIndex)
+{
+  tmArray<T*>::MoveItem(inFromIndex, inToIndex);
+  if (mIndex) mIndex->Invalidate(std::min(inFromIndex, inToIndex) - 1);
+}
+
+
+/*****
+Rotate all items toward the front of the array by one position.
+*****/
+template <class T>
+void tmDpptrArray<T>::rotate_left()
+{
+  tmArray<T*>::rotate_left();
+  if (mIndex) mIndex->Invalidate(0);
+}
+
+
+/*****
+Rotate all items toward the back of the array by one position.
+*****/
+template <class T>
+void tmDpptrArray<T>::rotate_right()
+{
+  tmArray<T*>::rotate_right();
+  if (mIndex) mIndex->Invalidate(0);
 }
 
 
@@ -301,12 +450,23 @@ void tmDpptrArray<T>::ReplaceItemAt(std::size_t n, T* pt)
 Delete all of the items in the list (which clears out the list). Note that if
 the list contains duplicates, then deleting that item will remove more than one
 item from the list. So, to be safe (and efficient) we will repeatedly delete
-the last item from the list.
+the last item from the list. Within a tmDpptrTeardown, deletion doesn't remove
+anything from the list, so we pop each item ourselves and skip the ones that
+have already been deleted.
 *****/
 template <class T>
 void tmDpptrArray<T>::KillItems()
 {
-  while (this->not_empty()) delete this->back();
+  if (!tmDpptrCanDefer<T>::value || !tmDpptrTeardown::IsActive()) {
+    while (this->not_empty()) delete this->back();
+    return;
+  }
+  while (this->not_empty()) {
+    T* pt = this->back();
+    tmArray<T*>::pop_back();
+    if (mIndex) mIndex->RemoveOne(KeyOf(pt));
+    if (!tmDpptrTeardown::IsDead(pt)) delete pt;
+  }
 }
 
 
@@ -339,7 +499,7 @@ template <class T>
 void tmDpptrArray<T>::intersect_with(const tmArray<T*>& aList)
 {
   for (std::size_t i = 0; i < this->size(); ++i) {
-    T* pt = aList[i];
+    T* pt = (*this)[i];
     if (!aList.contains(pt)) {
       erase_remove(pt);
       --i;
@@ -357,9 +517,111 @@ Called by:
 *****/
 template <class T>
 void tmDpptrArray<T>::RemoveDpptrTarget(tmDpptrTarget* aDpptrTarget) {
-	tmArray<T*>::erase(std::remove_if(this->begin(), this->end(), [aDpptrTarget](T* ptr) {
+	std::size_t i = 0;
+	if (mIndex) {
+		i = mIndex->GetSearchStart(aDpptrTarget);
+		if (i == std::size_t(index_t::NOT_FOUND))
+			return;
+		mIndex->RemoveAll(aDpptrTarget);
+	}
+	tmArray<T*>::erase(std::remove_if(this->begin() + std::ptrdiff_t(i), this->end(), [aDpptrTarget](T* ptr) {
 		return static_cast<tmDpptrTarget*>(ptr) == aDpptrTarget;
 	}), this->end());
+	if (mIndex && i < this->size())
+		mIndex->Invalidate(i);
+}
+
+
+/*****
+Within a teardown, put off removing the references to a destroyed object until
+the end, if we can.
+Called by:
+tmDpptrTeardown
+*****/
+template <class T>
+void tmDpptrArray<T>::TeardownDpptrTarget(tmDpptrTarget* aDpptrTarget)
+{
+  if (tmDpptrCanDefer<T>::value) DeferDpptrTargetRemoval();
+  else RemoveDpptrTarget(aDpptrTarget);
+}
+
+
+/*****
+Remove all references to objects destroyed during the current teardown, in a
+single pass.
+Called by:
+tmDpptrTeardown
+*****/
+template <class T>
+void tmDpptrArray<T>::RemoveDeadDpptrTargets()
+{
+  iterator p = std::remove_if(this->begin(), this->end(), [](T* ptr) {
+    return tmDpptrTeardown::IsDead(ptr);
+  });
+  if (p == this->end()) return;
+  tmArray<T*>::erase(p, this->end());
+  if (mIndex) RebuildIndex();
+}
+
+
+/*****
+Return the 1-based index of the given item. Return BAD_INDEX if it doesn't
+exist.
+*****/
+template <class T>
+std::size_t tmDpptrArray<T>::GetIndex(T* p) const
+{
+  if (!mIndex) return tmArray<T*>::GetIndex(p);
+  std::size_t i = mIndex->GetOffset(KeyOf(p), this->begin(), this->end(), KeyOf);
+  if (i == std::size_t(index_t::NOT_FOUND)) return tmArray<T*>::BAD_INDEX;
+  return i + 1;
+}
+
+
+/*****
+Return the offset of the given item. Return BAD_OFFSET if it doesn't exist.
+*****/
+template <class T>
+std::size_t tmDpptrArray<T>::GetOffset(T* p) const
+{
+  if (!mIndex) return tmArray<T*>::GetOffset(p);
+  std::size_t i = mIndex->GetOffset(KeyOf(p), this->begin(), this->end(), KeyOf);
+  if (i == std::size_t(index_t::NOT_FOUND)) return tmArray<T*>::BAD_OFFSET;
+  return i;
+}
+
+
+/*****
+Return true if the array contains the given element at least once
+*****/
+template <class T>
+bool tmDpptrArray<T>::contains(T* p) const
+{
+  if (!mIndex) return tmArray<T*>::contains(p);
+  return mIndex->Contains(KeyOf(p));
+}
+
+
+/*****
+Return true if the two lists have any common element
+*****/
+template <class T>
+bool tmDpptrArray<T>::intersects(const tmArray<T*>& aList) const
+{
+  if (!mIndex) return tmArray<T*>::intersects(aList);
+  for (std::size_t i = 0; i < aList.size(); ++i)
+    if (contains(aList[i])) return true;
+  return false;
+}
+
+
+/*****
+Reconstruct the index from the full contents of the array.
+*****/
+template <class T>
+void tmDpptrArray<T>::RebuildIndex()
+{
+  mIndex->Rebuild(this->begin(), this->end(), KeyOf);
 }
 
 
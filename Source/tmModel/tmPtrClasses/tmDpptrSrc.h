@@ -21,17 +21,40 @@ type tmDpptrTarget
 class tmDpptrSrc
 {
 public:
-  virtual ~tmDpptrSrc() {};
+  tmDpptrSrc() {
+    if (tmDpptrTeardown::IsActive()) tmDpptrTeardown::NoteNewSrc(this);};
+  tmDpptrSrc(const tmDpptrSrc&) {
+    if (tmDpptrTeardown::IsActive()) tmDpptrTeardown::NoteNewSrc(this);};
+  tmDpptrSrc& operator=(const tmDpptrSrc&) {return *this;};
+  virtual ~tmDpptrSrc() {
+    if (tmDpptrTeardown::IsActive()) tmDpptrTeardown::NoteDeadSrc(this);};
 protected:
   // Used by subclasses
   void DstAddMeAsDpptrSrc(tmDpptrTarget* aDpptrTarget) {
     aDpptrTarget->AddDpptrSrc(this);};
   void DstRemoveMeAsDpptrSrc(tmDpptrTarget* aDpptrTarget) {
+    if (tmDpptrTeardown::IsActive() && tmDpptrTeardown::IsDead(aDpptrTarget))
+      return;
     aDpptrTarget->RemoveDpptrSrc(this);};
+  void DstReleaseMeAsDpptrSrc(tmDpptrTarget* aDpptrTarget) {
+    // Like DstRemoveMeAsDpptrSrc(), but only for use by destructors; within a
+    // tmDpptrTeardown the target's list is purged later, all at once.
+    if (tmDpptrTeardown::IsActive())
+      tmDpptrTeardown::NoteReleasedTarget(aDpptrTarget);
+    else aDpptrTarget->RemoveDpptrSrc(this);};
+  void DeferDpptrTargetRemoval() {
+    tmDpptrTeardown::NoteDirtySrc(this);};
   // Implemented by subclasses
   virtual void RemoveDpptrTarget(tmDpptrTarget*) {};
+  virtual void TeardownDpptrTarget(tmDpptrTarget* aDpptrTarget) {
+    // Called instead of RemoveDpptrTarget() within a tmDpptrTeardown. Sources
+    // that can defer the removal call DeferDpptrTargetRemoval() and drop all
+    // dead targets at once in RemoveDeadDpptrTargets().
+    RemoveDpptrTarget(aDpptrTarget);};
+  virtual void RemoveDeadDpptrTargets() {};
 private:
   friend class tmDpptrTarget;
+  friend class tmDpptrTeardown;
 };
 
 #endif // _TMDPPTRSRC_H_
@@ -11,6 +11,8 @@ Copyright:    ©2003 Robert J. Lang. All Rights Reserved.
 #include "tmDpptrTarget.h"
 #include "tmDpptrSrc.h"
 
+#include "tmArrayIndex.h"
+
 #include <algorithm>
 
 using namespace std;
@@ -22,6 +24,17 @@ When the tmDpptrTarget is deleted, it notifies the tmDpptrSrc, which nulls its p
 When a tmDpptrSrc is destroyed (or reassigned), it notifies the tmDpptrTarget which 
 removes the tmDpptr from its list of DpptrSrcs. Thus, no tmDpptrSrc will ever dangle,
 that is, point incorrectly into memory.
+
+Tearing down a big structure this way does a lot of redundant work: every
+deleted object searches every list that points at it, and every deleted list
+searches every object it points at, even when all of them are about to go. A
+tmDpptrTeardown batches that work. While one exists, a dying target only tells
+its array sources that they have become dirty, and a dying source only notes
+which live targets still list it. When the teardown ends, each dirty array
+drops all of its dead entries in a single pass and each affected target purges
+its dead sources likewise. Dead objects are remembered by address, so if a new
+target or source is constructed at a dead address while the teardown is
+active, the pending work is flushed first.
 */
 
 
@@ -36,6 +49,7 @@ Constructor. Nothing special happens.
 *****/
 tmDpptrTarget::tmDpptrTarget()
 {
+  if (tmDpptrTeardown::IsActive()) tmDpptrTeardown::NoteNewTarget(this);
 }
 
 
@@ -47,6 +61,7 @@ pointing at it.
 tmDpptrTarget::tmDpptrTarget(const tmDpptrTarget&)
   : mDpptrSrcs()
 {
+  if (tmDpptrTeardown::IsActive()) tmDpptrTeardown::NoteNewTarget(this);
 }
 
 
@@ -68,6 +83,10 @@ Notify any DpptrSrcs that point to me to clear their pointers to me.
 *****/
 tmDpptrTarget::~tmDpptrTarget()
 {
+  if (tmDpptrTeardown::IsActive()) {
+    tmDpptrTeardown::NoteDeadTarget(this);
+    return;
+  }
   //  Note: a tmDpptrArray<T> can hold multiple references to the same object, in which
   //  case mDpptrSrcs will hold multiple pointers to the same tmDpptrArray<T>.
   vector<tmDpptrSrc*> theDpptrSrcs(mDpptrSrcs);
@@ -101,3 +120,187 @@ void tmDpptrTarget::RemoveDpptrSrc(tmDpptrSrc* r)
 {
   mDpptrSrcs.erase(remove(mDpptrSrcs.begin(), mDpptrSrcs.end(), r), mDpptrSrcs.end());
 }
+
+
+#ifdef __MWERKS__
+  #pragma mark -
+#endif
+
+
+/**********
+class tmDpptrTeardown::Batch
+The deferred bookkeeping of a teardown. Each set of addresses is kept as a
+tmArrayIndex used as a hash set; the dirty objects are also kept in order of
+first appearance so that the final cleanup is deterministic.
+**********/
+class tmDpptrTeardown::Batch {
+public:
+  typedef tmArrayIndex<const void*> set_t;
+  set_t mDeadTargets;           // targets destroyed during the teardown
+  set_t mDeadSrcs;              // sources destroyed during the teardown
+  set_t mDirtySrcSet;           // live sources that hold dead targets
+  set_t mDirtyTargetSet;        // live targets that hold dead sources
+  vector<tmDpptrSrc*> mDirtySrcs;
+  vector<tmDpptrTarget*> mDirtyTargets;
+};
+
+
+tmDpptrTeardown::Batch* tmDpptrTeardown::sBatch = 0;
+
+
+/*****
+tmDpptrTeardown::tmDpptrTeardown()
+Constructor. Start batching, unless an enclosing teardown already is.
+*****/
+tmDpptrTeardown::tmDpptrTeardown()
+  : mOwnsBatch(sBatch == 0)
+{
+  if (mOwnsBatch) sBatch = new Batch();
+}
+
+
+/*****
+tmDpptrTeardown::~tmDpptrTeardown()
+Destructor. The outermost teardown does all of the deferred work.
+*****/
+tmDpptrTeardown::~tmDpptrTeardown()
+{
+  if (!mOwnsBatch) return;
+  Flush();
+  delete sBatch;
+  sBatch = 0;
+}
+
+
+/*****
+bool tmDpptrTeardown::IsDead(const tmDpptrTarget*)
+Return true if the target was destroyed during the current teardown.
+*****/
+bool tmDpptrTeardown::IsDead(const tmDpptrTarget* aTarget)
+{
+  return sBatch && sBatch->mDeadTargets.Contains(aTarget);
+}
+
+
+/*****
+void tmDpptrTeardown::NoteNewTarget(const tmDpptrTarget*)
+A target is being constructed. If it reuses the address of a dead one, finish
+off the pending work before anyone mistakes it for the dead one.
+*****/
+void tmDpptrTeardown::NoteNewTarget(const tmDpptrTarget* aTarget)
+{
+  if (sBatch->mDeadTargets.Contains(aTarget)) Flush();
+}
+
+
+/*****
+void tmDpptrTeardown::NoteNewSrc(const tmDpptrSrc*)
+Same thing for sources.
+*****/
+void tmDpptrTeardown::NoteNewSrc(const tmDpptrSrc* aSrc)
+{
+  if (sBatch->mDeadSrcs.Contains(aSrc)) Flush();
+}
+
+
+/*****
+void tmDpptrTeardown::NoteDeadTarget(tmDpptrTarget*)
+A target is being destroyed. Let each live source that points at it either
+clear its reference now or mark itself dirty.
+called by:
+tmDpptrTarget::~tmDpptrTarget()
+*****/
+void tmDpptrTeardown::NoteDeadTarget(tmDpptrTarget* aTarget)
+{
+  Batch& b = *sBatch;
+  b.mDeadTargets.Add(aTarget, 0);
+  b.mDirtyTargetSet.RemoveAll(aTarget);
+  vector<tmDpptrSrc*> theDpptrSrcs;
+  theDpptrSrcs.swap(aTarget->mDpptrSrcs);
+  for (size_t i = 0; i < theDpptrSrcs.size(); ++i) {
+    tmDpptrSrc* theDpptrSrc = theDpptrSrcs[i];
+    if (b.mDeadSrcs.Contains(theDpptrSrc)) continue;
+    theDpptrSrc->TeardownDpptrTarget(aTarget);
+  }
+}
+
+
+/*****
+void tmDpptrTeardown::NoteDeadSrc(tmDpptrSrc*)
+A source is being destroyed; its references have already been released.
+called by:
+tmDpptrSrc::~tmDpptrSrc()
+*****/
+void tmDpptrTeardown::NoteDeadSrc(tmDpptrSrc* aSrc)
+{
+  sBatch->mDeadSrcs.Add(aSrc, 0);
+  sBatch->mDirtySrcSet.RemoveAll(aSrc);
+}
+
+
+/*****
+void tmDpptrTeardown::NoteDirtySrc(tmDpptrSrc*)
+A source holds at least one dead target, to be removed at the end.
+called by:
+tmDpptrSrc::DeferDpptrTargetRemoval()
+*****/
+void tmDpptrTeardown::NoteDirtySrc(tmDpptrSrc* aSrc)
+{
+  Batch& b = *sBatch;
+  if (b.mDirtySrcSet.Contains(aSrc)) return;
+  b.mDirtySrcSet.Add(aSrc, 0);
+  b.mDirtySrcs.push_back(aSrc);
+}
+
+
+/*****
+void tmDpptrTeardown::NoteReleasedTarget(tmDpptrTarget*)
+A dying source pointed at this target. If the target is still alive, its list
+of sources needs purging at the end.
+called by:
+tmDpptrSrc::DstReleaseMeAsDpptrSrc()
+*****/
+void tmDpptrTeardown::NoteReleasedTarget(tmDpptrTarget* aTarget)
+{
+  Batch& b = *sBatch;
+  if (b.mDeadTargets.Contains(aTarget)) return;
+  if (b.mDirtyTargetSet.Contains(aTarget)) return;
+  b.mDirtyTargetSet.Add(aTarget, 0);
+  b.mDirtyTargets.push_back(aTarget);
+}
+
+
+/*****
+void tmDpptrTeardown::Flush()
+Do all of the deferred work: compact every dirty source and purge the dead
+sources from every dirty target. Afterwards the batch is empty but still
+active. The dirty lists can contain entries that died after they were listed
+(or even new objects at their addresses); membership in the dirty sets is
+what counts.
+*****/
+void tmDpptrTeardown::Flush()
+{
+  Batch& b = *sBatch;
+  for (size_t i = 0; i < b.mDirtySrcs.size(); ++i) {
+    tmDpptrSrc* theDpptrSrc = b.mDirtySrcs[i];
+    if (!b.mDirtySrcSet.Contains(theDpptrSrc)) continue;
+    b.mDirtySrcSet.RemoveAll(theDpptrSrc);
+    theDpptrSrc->RemoveDeadDpptrTargets();
+  }
+  for (size_t i = 0; i < b.mDirtyTargets.size(); ++i) {
+    tmDpptrTarget* theTarget = b.mDirtyTargets[i];
+    if (!b.mDirtyTargetSet.Contains(theTarget)) continue;
+    b.mDirtyTargetSet.RemoveAll(theTarget);
+    vector<tmDpptrSrc*>& theDpptrSrcs = theTarget->mDpptrSrcs;
+    theDpptrSrcs.erase(remove_if(theDpptrSrcs.begin(), theDpptrSrcs.end(),
+      [&b](tmDpptrSrc* theDpptrSrc) {
+        return b.mDeadSrcs.Contains(theDpptrSrc);
+      }), theDpptrSrcs.end());
+  }
+  b.mDirtySrcs.clear();
+  b.mDirtyTargets.clear();
+  b.mDirtySrcSet.Clear();
+  b.mDirtyTargetSet.Clear();
+  b.mDeadTargets.Clear();
+  b.mDeadSrcs.Clear();
+}
@@ -32,6 +32,42 @@ private:
   void AddDpptrSrc(tmDpptrSrc* r);    // add a pointer-to-me
   void RemoveDpptrSrc(tmDpptrSrc* r);    // remove a pointer-to-me
   friend class tmDpptrSrc;        // gives access to AddDpptrSrc() and RemoveDpptrSrc()
+  friend class tmDpptrTeardown;   // gives access to mDpptrSrcs
+};
+
+
+/**********
+class tmDpptrTeardown
+While an object of this class exists, destruction of dpptr targets and sources
+is batched: references are removed lazily and each array is compacted once,
+when the outermost tmDpptrTeardown goes out of scope. Only deletions should
+happen inside its scope.
+**********/
+class tmDpptrTeardown {
+public:
+  tmDpptrTeardown();
+  ~tmDpptrTeardown();
+  static bool IsActive() {return sBatch != 0;};
+  static bool IsDead(const tmDpptrTarget* aTarget);
+private:
+  class Batch;
+  static Batch* sBatch;   // pending bookkeeping of the outermost teardown
+  bool mOwnsBatch;        // true if this is the outermost teardown
+  
+  // Used by tmDpptrTarget and tmDpptrSrc
+  static void NoteNewTarget(const tmDpptrTarget* aTarget);
+  static void NoteNewSrc(const tmDpptrSrc* aSrc);
+  static void NoteDeadTarget(tmDpptrTarget* aTarget);
+  static void NoteDeadSrc(tmDpptrSrc* aSrc);
+  static void NoteDirtySrc(tmDpptrSrc* aSrc);
+  static void NoteReleasedTarget(tmDpptrTarget* aTarget);
+  static void Flush();
+  friend class tmDpptrTarget;
+  friend class tmDpptrSrc;
+  
+  // not copyable
+  tmDpptrTeardown(const tmDpptrTeardown&);
+  tmDpptrTeardown& operator=(const tmDpptrTeardown&);
 };
 
 #endif // _TMDPPTRTARGET_H_
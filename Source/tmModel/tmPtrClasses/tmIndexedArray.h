@@ -0,0 +1,408 @@
+/*******************************************************************************
+File:         tmIndexedArray.h
+Project:      TreeMaker 5.x
+Purpose:      Header file for tmArray with constant-time membership tests
+Author:       Robert J. Lang
+Modified by:
+Created:      2026-10-19
+Copyright:    ©2026 Robert J. Lang. All Rights Reserved.
+*******************************************************************************/
+
+#ifndef _TMINDEXEDARRAY_H_
+#define _TMINDEXEDARRAY_H_
+
+/*
+Class tmIndexedArray<T, H> is a tmArray<T> that also keeps a tmArrayIndex, a
+hash map from each element to the offset of its first occurrence. The elements
+still live in the underlying std::vector in the same order, so iteration and
+subscripting behave exactly as they do for tmArray<T>; but
+contains(), GetOffset(), GetIndex(), union_with() and the set operations on
+whole lists no longer scan the array, which turns the common "build a list
+without duplicates" loop from quadratic into linear time.
+
+Use it where a list is built up incrementally and tested for membership a lot.
+Removal from the middle of the array still costs time proportional to the
+number of elements behind the removed one (as it does for std::vector itself),
+and the first GetOffset() after such an edit may renumber that part of the
+index.
+
+As with tmDpptrArray<T>, the tmArray member functions are not virtual, so
+subscripting returns read-only references and the std::vector modifiers that
+would bypass the index are hidden. (Writing through an iterator, or sorting
+the array in place, would still bypass it; don't.) You can pass a
+tmIndexedArray<T> wherever a const tmArray<T>& is expected; the callee then
+sees an ordinary tmArray<T> and gets the ordinary linear-time queries.
+
+Elements must be copyable, default-constructible, comparable with ==, and
+hashable by H, which defaults to tmArrayHash<T> (a scrambled std::hash<T>).
+*/
+
+#include "tmArray.h"
+#include "tmArrayIndex.h"
+
+/**********
+class tmIndexedArray<T, H>
+A tmArray<T> with hashed lookup of elements.
+**********/
+template <class T, class H = tmArrayHash<T> >
+class tmIndexedArray : public tmArray<T>
+{
+public:
+  // typenames
+  typedef typename tmArray<T>::reference reference;
+  typedef typename tmArray<T>::const_reference const_reference;
+  typedef typename tmArray<T>::iterator iterator;
+  typedef typename tmArray<T>::const_iterator const_iterator;
+  typedef typename tmArray<T>::size_type size_type;
+  typedef typename tmArray<T>::difference_type difference_type;
+  typedef T value_type;
+
+  // Constructor
+  tmIndexedArray() {};
+  tmIndexedArray(const tmArray<T>& aList);
+
+  // Assignment
+  tmIndexedArray& operator=(const tmArray<T>& aList);
+
+  // Subscripting returns read-only reference to array element so you can't
+  // overwrite an element and circumvent the index.
+  const T& operator[](std::size_t i) const {
+    return tmArray<T>::operator[](i);};
+  const T& operator[](std::size_t i) {
+    return tmArray<T>::operator[](i);};
+  const T& NthItem(std::size_t n) const {
+    return tmArray<T>::NthItem(n);};
+  const T& NthItem(std::size_t n) {
+    return tmArray<T>::NthItem(n);};
+
+  // Modifying operations
+  void push_back(const T& t);
+  void pop_back();
+  void push_front(const T& t);
+  void union_with(const T& t);
+  void erase_remove(const T& t);
+  void replace_with(const T& told, const T& tnew);
+  void clear();
+  void RemoveItemAt(std::size_t n);
+  void InsertItemAt(std::size_t n, const T& t);
+  void ReplaceItemAt(std::size_t n, const T& t);
+  void SwapItems(std::size_t inIndexA, std::size_t inIndexB);
+  void MoveItem(std::size_t inFromIndex, std::size_t inToIndex);
+  void rotate_left();
+  void rotate_right();
+  void merge_with(const tmArray<T>& aList);
+  void union_with(const tmArray<T>& aList);
+  void intersect_with(const tmArray<T>& aList);
+
+  // Queries answered from the index
+  std::size_t GetIndex(const T& t) const;
+  std::size_t GetOffset(const T& t) const;
+  bool contains(const T& t) const {
+    // Return true if the array contains the given element at least once
+    return mIndex.Contains(t);
+  };
+  bool intersects(const tmArray<T>& aList) const;
+private:
+  mutable tmArrayIndex<T, H> mIndex;  // count and first offset of elements
+
+  // used in implementation
+  static const T& KeyOf(const T& t) {return t;};
+  void RebuildIndex();
+
+  // tmArray<T> members, not supported
+  void assign_all(const T& t);
+
+  // vector<T> members, not supported
+  iterator insert(iterator position, const value_type& x);
+  void insert(iterator position, size_type n, const value_type& x);
+  iterator erase(iterator position);
+  iterator erase(iterator first, iterator last);
+  void assign(size_type n, const value_type& x);
+  void resize(size_type n);
+  void resize(size_type n, const value_type& x);
+  void swap(std::vector<T>& v);
+};
+
+
+/**********
+Template definitions
+**********/
+
+/*****
+Copy constructor from tmArray<T>
+*****/
+template <class T, class H>
+tmIndexedArray<T, H>::tmIndexedArray(const tmArray<T>& aList)
+  : tmArray<T>(aList)
+{
+  RebuildIndex();
+}
+
+
+/*****
+Assignment from tmArray<T>
+*****/
+template <class T, class H>
+tmIndexedArray<T, H>& tmIndexedArray<T, H>::operator=(const tmArray<T>& aList)
+{
+  tmArray<T>::operator=(aList);
+  RebuildIndex();
+  return *this;
+}
+
+
+/*****
+Add an element to the end of the list
+*****/
+template <class T, class H>
+void tmIndexedArray<T, H>::push_back(const T& t)
+{
+  tmArray<T>::push_back(t);
+  mIndex.Add(t, this->size() - 1);
+}
+
+
+/*****
+Remove the element at the end of the list
+*****/
+template <class T, class H>
+void tmIndexedArray<T, H>::pop_back()
+{
+  TMASSERT(this->not_empty());
+  mIndex.RemoveOne(tmArray<T>::back());
+  tmArray<T>::pop_back();
+}
+
+
+/*****
+Add an element to the beginning of the list
+*****/
+template <class T, class H>
+void tmIndexedArray<T, H>::push_front(const T& t)
+{
+  tmArray<T>::push_front(t);
+  mIndex.Invalidate(0);
+  mIndex.Add(t, 0);
+}
+
+
+/*****
+Add an element to the list if it isn't already there
+*****/
+template <class T, class H>
+void tmIndexedArray<T, H>::union_with(const T& t)
+{
+  if (!contains(t)) push_back(t);
+}
+
+
+/*****
+Remove all copies of an item from the list
+*****/
+template <class T, class H>
+void tmIndexedArray<T, H>::erase_remove(const T& t)
+{
+  std::size_t i = mIndex.GetSearchStart(t);
+  if (i == std::size_t(tmArrayIndex<T, H>::NOT_FOUND)) return;
+  T tt = t;   // t might refer to an element of this list
+  mIndex.RemoveAll(tt);
+  tmArray<T>::erase(std::remove(tmArray<T>::begin() + std::ptrdiff_t(i),
+    tmArray<T>::end(), tt), tmArray<T>::end());
+  if (i < this->size()) mIndex.Invalidate(i);
+}
+
+
+/*****
+Replace all occurrences of an item with a different item
+*****/
+template <class T, class H>
+void tmIndexedArray<T, H>::replace_with(const T& told, const T& tnew)
+{
+  if (!contains(told)) return;
+  tmArray<T>::replace_with(told, tnew);
+  RebuildIndex();
+}
+
+
+/*****
+Remove all items
+*****/
+template <class T, class H>
+void tmIndexedArray<T, H>::clear()
+{
+  tmArray<T>::clear();
+  mIndex.Clear();
+}
+
+
+/*****
+Remove an item from a list given its index
+*****/
+template <class T, class H>
+void tmIndexedArray<T, H>::RemoveItemAt(std::size_t n)
+{
+  TMASSERT((n >= 1) && (n <= this->size()));
+  mIndex.RemoveOne(tmArray<T>::operator[](n - 1));
+  tmArray<T>::RemoveItemAt(n);
+  if (n <= this->size()) mIndex.Invalidate(n - 1);
+}
+
+
+/*****
+Insert an item at a specified index
+*****/
+template <class T, class H>
+void tmIndexedArray<T, H>::InsertItemAt(std::size_t n, const T& t)
+{
+  tmArray<T>::InsertItemAt(n, t);
+  if (n < this->size()) mIndex.Invalidate(n - 1);
+  mIndex.Add(t, n - 1);
+}
+
+
+/*****
+Replace an item in a list with another, based on location
+*****/
+template <class T, class H>
+void tmIndexedArray<T, H>::ReplaceItemAt(std::size_t n, const T& t)
+{
+  mIndex.RemoveOne(tmArray<T>::NthItem(n));
+  tmArray<T>::ReplaceItemAt(n, t);
+  mIndex.Invalidate(n - 1);
+  mIndex.Add(t, n - 1);
+}
+
+
+/*****
+Swap two items in a list.
+*****/
+template <class T, class H>
+void tmIndexedArray<T, H>::SwapItems(std::size_t inIndexA,
+  std::size_t inIndexB)
+{
+  tmArray<T>::SwapItems(inIndexA, inIndexB);
+  mIndex.Invalidate(std::min(inIndexA, inIndexB) - 1);
+}
+
+
+/*****
+Move one item to another location in a list based on location
+*****/
+template <class T, class H>
+void tmIndexedArray<T, H>::MoveItem(std::size_t inFromIndex,
+  std::size_t inToIndex)
+{
+  tmArray<T>::MoveItem(inFromIndex, inToIndex);
+  mIndex.Invalidate(std::min(inFromIndex, inToIndex) - 1);
+}
+
+
+/*****
+Rotate all items toward the front of the array by one position.
+*****/
+template <class T, class H>
+void tmIndexedArray<T, H>::rotate_left()
+{
+  tmArray<T>::rotate_left();
+  mIndex.Invalidate(0);
+}
+
+
+/*****
+Rotate all items toward the back of the array by one position.
+*****/
+template <class T, class H>
+void tmIndexedArray<T, H>::rotate_right()
+{
+  tmArray<T>::rotate_right();
+  mIndex.Invalidate(0);
+}
+
+
+/*****
+Append all elements of another list
+*****/
+template <class T, class H>
+void tmIndexedArray<T, H>::merge_with(const tmArray<T>& aList)
+{
+  for (std::size_t i = 0; i < aList.size(); ++i) push_back(aList[i]);
+}
+
+
+/*****
+Append the elements of another list that are different to this one.
+*****/
+template <class T, class H>
+void tmIndexedArray<T, H>::union_with(const tmArray<T>& aList)
+{
+  for (std::size_t i = 0; i < aList.size(); ++i) union_with(aList[i]);
+}
+
+
+/*****
+Retain only the elements contained by another list. The other list is indexed
+once, so this takes time proportional to the sum of the two lengths.
+*****/
+template <class T, class H>
+void tmIndexedArray<T, H>::intersect_with(const tmArray<T>& aList)
+{
+  tmArrayIndex<T, H> otherIndex;
+  otherIndex.Rebuild(aList.begin(), aList.end(), KeyOf);
+  iterator p = std::remove_if(tmArray<T>::begin(), tmArray<T>::end(),
+    [&otherIndex](const T& t) {return !otherIndex.Contains(t);});
+  if (p == tmArray<T>::end()) return;
+  tmArray<T>::erase(p, tmArray<T>::end());
+  RebuildIndex();
+}
+
+
+/*****
+Return the 1-based index of the given item. Return BAD_INDEX if it doesn't
+exist.
+*****/
+template <class T, class H>
+std::size_t tmIndexedArray<T, H>::GetIndex(const T& t) const
+{
+  std::size_t i = GetOffset(t);
+  if (i == std::size_t(tmArray<T>::BAD_OFFSET)) return tmArray<T>::BAD_INDEX;
+  return i + 1;
+}
+
+
+/*****
+Return the offset of the given item. Return BAD_OFFSET if it doesn't exist.
+*****/
+template <class T, class H>
+std::size_t tmIndexedArray<T, H>::GetOffset(const T& t) const
+{
+  std::size_t i = mIndex.GetOffset(t, tmArray<T>::begin(), tmArray<T>::end(),
+    KeyOf);
+  if (i == std::size_t(tmArrayIndex<T, H>::NOT_FOUND))
+    return tmArray<T>::BAD_OFFSET;
+  return i;
+}
+
+
+/*****
+Return true if the two lists have any common element
+*****/
+template <class T, class H>
+bool tmIndexedArray<T, H>::intersects(const tmArray<T>& aList) const
+{
+  for (std::size_t i = 0; i < aList.size(); ++i)
+    if (contains(aList[i])) return true;
+  return false;
+}
+
+
+/*****
+Reconstruct the index from the full contents of the array.
+*****/
+template <class T, class H>
+void tmIndexedArray<T, H>::RebuildIndex()
+{
+  mIndex.Rebuild(tmArray<T>::begin(), tmArray<T>::end(), KeyOf);
+}
+
+
+#endif // _TMINDEXEDARRAY_H_
@@ -17,6 +17,7 @@ Copyright:    ©2003 Robert J. Lang. All Rights Reserved.
 // TreeMaker array classes
 #include "tmArray.h"
 #include "tmArrayIterator.h"
+#include "tmIndexedArray.h"
 #include "tmDpptr.h"
 #include "tmDpptrArray.h"
 
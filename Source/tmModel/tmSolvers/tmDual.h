@@ -0,0 +1,290 @@
+/*******************************************************************************
+File:         tmDual.h
+Project:      TreeMaker 5.x
+Purpose:      Header file for forward-mode automatic differentiation
+Author:       Robert J. Lang
+Modified by:
+Created:      2026-10-19
+Copyright:    ©2026 Robert J. Lang. All Rights Reserved.
+*******************************************************************************/
+
+#ifndef _TMDUAL_H_
+#define _TMDUAL_H_
+
+#include "tmHeader.h"
+
+#include <cmath>
+
+/*
+Class tmDual<N> is a dual number: a value together with its partial
+derivatives with respect to N independent variables. Arithmetic on tmDuals
+applies the chain rule as it goes, so if you evaluate an expression on tmDuals
+whose derivative parts are seeded with the unit vectors, the result carries
+the value of the expression and its full gradient, both computed in one pass.
+
+N is a compile-time constant (the number of variables a constraint actually
+depends on, typically 2 to 6), so a tmDual lives on the stack, its derivative
+loops have fixed trip counts and the compiler unrolls them. Write the
+expression once as a template on the number type, e.g.
+
+  template <class T>
+  T Dist(const T* x) {return sqrt(pow(x[0] - x[2], 2) + pow(x[1] - x[3], 2));}
+
+then call it on doubles for the value alone or on tmDual<4>s for the value and
+gradient. The value part of a tmDual is computed with exactly the same
+floating-point operations as the double version, so the two always agree.
+
+The functions below cover what the constraint functions use. Add others as
+needed; each one needs the value and the derivative of the underlying
+function, nothing more.
+*/
+
+/**********
+class tmDual<N>
+A value and its gradient with respect to N variables
+**********/
+template <std::size_t N>
+class tmDual {
+public:
+  double v;     // the value
+  double d[N];  // partial derivatives of the value
+
+  tmDual(double av = 0) : v(av) {
+    // A constant, whose derivatives are all zero
+    for (std::size_t i = 0; i < N; ++i) d[i] = 0;};
+  tmDual(double av, std::size_t k) : v(av) {
+    // The k-th independent variable
+    for (std::size_t i = 0; i < N; ++i) d[i] = 0;
+    d[k] = 1;};
+
+  tmDual& operator+=(const tmDual& b) {
+    v += b.v;
+    for (std::size_t i = 0; i < N; ++i) d[i] += b.d[i];
+    return *this;};
+  tmDual& operator-=(const tmDual& b) {
+    v -= b.v;
+    for (std::size_t i = 0; i < N; ++i) d[i] -= b.d[i];
+    return *this;};
+  tmDual& operator*=(const tmDual& b) {
+    for (std::size_t i = 0; i < N; ++i) d[i] = d[i] * b.v + v * b.d[i];
+    v *= b.v;
+    return *this;};
+  tmDual& operator/=(const tmDual& b) {
+    double r = 1. / b.v;
+    v *= r;
+    for (std::size_t i = 0; i < N; ++i) d[i] = (d[i] - v * b.d[i]) * r;
+    return *this;};
+  tmDual& operator+=(double b) {
+    v += b;
+    return *this;};
+  tmDual& operator-=(double b) {
+    v -= b;
+    return *this;};
+  tmDual& operator*=(double b) {
+    v *= b;
+    for (std::size_t i = 0; i < N; ++i) d[i] *= b;
+    return *this;};
+  tmDual& operator/=(double b) {
+    v /= b;
+    for (std::size_t i = 0; i < N; ++i) d[i] /= b;
+    return *this;};
+};
+
+
+/**********
+Arithmetic
+**********/
+
+template <std::size_t N>
+inline tmDual<N> operator-(const tmDual<N>& a)
+{
+  tmDual<N> r(-a.v);
+  for (std::size_t i = 0; i < N; ++i) r.d[i] = -a.d[i];
+  return r;
+}
+
+template <std::size_t N>
+inline tmDual<N> operator+(const tmDual<N>& a, const tmDual<N>& b)
+{
+  tmDual<N> r(a.v + b.v);
+  for (std::size_t i = 0; i < N; ++i) r.d[i] = a.d[i] + b.d[i];
+  return r;
+}
+
+template <std::size_t N>
+inline tmDual<N> operator+(const tmDual<N>& a, double b)
+{
+  tmDual<N> r(a.v + b);
+  for (std::size_t i = 0; i < N; ++i) r.d[i] = a.d[i];
+  return r;
+}
+
+template <std::size_t N>
+inline tmDual<N> operator+(double a, const tmDual<N>& b)
+{
+  tmDual<N> r(a + b.v);
+  for (std::size_t i = 0; i < N; ++i) r.d[i] = b.d[i];
+  return r;
+}
+
+template <std::size_t N>
+inline tmDual<N> operator-(const tmDual<N>& a, const tmDual<N>& b)
+{
+  tmDual<N> r(a.v - b.v);
+  for (std::size_t i = 0; i < N; ++i) r.d[i] = a.d[i] - b.d[i];
+  return r;
+}
+
+template <std::size_t N>
+inline tmDual<N> operator-(const tmDual<N>& a, double b)
+{
+  tmDual<N> r(a.v - b);
+  for (std::size_t i = 0; i < N; ++i) r.d[i] = a.d[i];
+  return r;
+}
+
+template <std::size_t N>
+inline tmDual<N> operator-(double a, const tmDual<N>& b)
+{
+  tmDual<N> r(a - b.v);
+  for (std::size_t i = 0; i < N; ++i) r.d[i] = -b.d[i];
+  return r;
+}
+
+template <std::size_t N>
+inline tmDual<N> operator*(const tmDual<N>& a, const tmDual<N>& b)
+{
+  tmDual<N> r(a.v * b.v);
+  for (std::size_t i = 0; i < N; ++i) r.d[i] = a.d[i] * b.v + a.v * b.d[i];
+  return r;
+}
+
+template <std::size_t N>
+inline tmDual<N> operator*(const tmDual<N>& a, double b)
+{
+  tmDual<N> r(a.v * b);
+  for (std::size_t i = 0; i < N; ++i) r.d[i] = a.d[i] * b;
+  return r;
+}
+
+template <std::size_t N>
+inline tmDual<N> operator*(double a, const tmDual<N>& b)
+{
+  tmDual<N> r(a * b.v);
+  for (std::size_t i = 0; i < N; ++i) r.d[i] = a * b.d[i];
+  return r;
+}
+
+template <std::size_t N>
+inline tmDual<N> operator/(const tmDual<N>& a, const tmDual<N>& b)
+{
+  double q = 1. / b.v;
+  tmDual<N> r(a.v * q);
+  for (std::size_t i = 0; i < N; ++i) r.d[i] = (a.d[i] - r.v * b.d[i]) * q;
+  return r;
+}
+
+template <std::size_t N>
+inline tmDual<N> operator/(const tmDual<N>& a, double b)
+{
+  tmDual<N> r(a.v / b);
+  for (std::size_t i = 0; i < N; ++i) r.d[i] = a.d[i] / b;
+  return r;
+}
+
+template <std::size_t N>
+inline tmDual<N> operator/(double a, const tmDual<N>& b)
+{
+  tmDual<N> r(a / b.v);
+  double s = -r.v / b.v;
+  for (std::size_t i = 0; i < N; ++i) r.d[i] = s * b.d[i];
+  return r;
+}
+
+
+/**********
+Comparison, which looks only at the value
+**********/
+
+template <std::size_t N>
+inline bool operator<(const tmDual<N>& a, const tmDual<N>& b) {return a.v < b.v;}
+template <std::size_t N>
+inline bool operator<(const tmDual<N>& a, double b) {return a.v < b;}
+template <std::size_t N>
+inline bool operator>(const tmDual<N>& a, const tmDual<N>& b) {return a.v > b.v;}
+template <std::size_t N>
+inline bool operator>(const tmDual<N>& a, double b) {return a.v > b;}
+template <std::size_t N>
+inline bool operator==(const tmDual<N>& a, double b) {return a.v == b;}
+template <std::size_t N>
+inline bool operator!=(const tmDual<N>& a, double b) {return a.v != b;}
+
+
+/**********
+Elementary functions
+**********/
+
+/*****
+Apply a function with value fv and derivative fd at a.v to a.
+*****/
+template <std::size_t N>
+inline tmDual<N> tmChain(const tmDual<N>& a, double fv, double fd)
+{
+  tmDual<N> r(fv);
+  for (std::size_t i = 0; i < N; ++i) r.d[i] = fd * a.d[i];
+  return r;
+}
+
+/*****
+Square root. At zero the derivative is infinite; like the hand-written
+gradients, we return a zero derivative there rather than a NaN.
+*****/
+template <std::size_t N>
+inline tmDual<N> sqrt(const tmDual<N>& a)
+{
+  double s = std::sqrt(a.v);
+  return tmChain(a, s, (s != 0) ? 0.5 / s : 0.);
+}
+
+/*****
+Real power with a constant exponent. Squares are by far the most common case
+and get multiplied out, as the compiler does for pow(double, 2).
+*****/
+template <std::size_t N>
+inline tmDual<N> pow(const tmDual<N>& a, double p)
+{
+  if (p == 2) return tmChain(a, a.v * a.v, 2 * a.v);
+  double s = std::pow(a.v, p);
+  return tmChain(a, s, (a.v != 0) ? p * s / a.v : p * std::pow(a.v, p - 1));
+}
+
+template <std::size_t N>
+inline tmDual<N> sin(const tmDual<N>& a)
+{
+  return tmChain(a, std::sin(a.v), std::cos(a.v));
+}
+
+template <std::size_t N>
+inline tmDual<N> cos(const tmDual<N>& a)
+{
+  return tmChain(a, std::cos(a.v), -std::sin(a.v));
+}
+
+template <std::size_t N>
+inline tmDual<N> fabs(const tmDual<N>& a)
+{
+  return (a.v < 0) ? -a : a;
+}
+
+template <std::size_t N>
+inline tmDual<N> atan2(const tmDual<N>& y, const tmDual<N>& x)
+{
+  double r2 = x.v * x.v + y.v * y.v;
+  tmDual<N> r(std::atan2(y.v, x.v));
+  if (r2 == 0) return r;
+  for (std::size_t i = 0; i < N; ++i)
+    r.d[i] = (x.v * y.d[i] - y.v * x.d[i]) / r2;
+  return r;
+}
+
+#endif // _TMDUAL_H_
@@ -3,7 +3,7 @@ File:         tmMatrix.h
 Project:      TreeMaker 5.x
 Purpose:      Header file for TreeMaker matrix classe
 Author:       Robert J. Lang
-Modified by:  
+Modified by:
 Created:      2003-11-21
 Copyright:    ©2003 Robert J. Lang. All Rights Reserved.
 *******************************************************************************/
@@ -11,31 +11,100 @@ Copyright:    ©2003 Robert J. Lang. All Rights Reserved.
 #ifndef _TMMATRIX_H_
 #define _TMMATRIX_H_
 
+#include "tmHeader.h"
+
+#include <algorithm>
 #include <vector>
 
 /*
 Class tmMatrix<T> implements a row-and-column matrix. It's used in the Newton-
 Raphson equation solver, which is based on the LU decompostion of the gradient
-matrix. This class has been implemented in a minimal way as a
-std::vector<std::vector<T> >.
+matrix, and for the inverse Hessian of the ALM optimizer. The elements are
+stored row by row in a single contiguous block, so a[i] is a pointer to the
+first element of row i and a[i][j] works as it would for a C array. Walking
+along a row touches consecutive memory, which is what the kernels below (and
+the compiler's vectorizer) want.
+
+Class tmMatrixView<T> is a window onto a rectangular block of some matrix: a
+pointer to its first element plus a row stride. Views don't own their
+elements; they're how a kernel gets at a sub-block without copying it.
+
+The kernels at the bottom of this file are the inner loops of the solvers.
+They are written as loops along contiguous rows, and each one performs its
+floating-point operations in the same order as the straightforward loops it
+replaces, so results don't change from one build to the next.
 */
 
+/**********
+class tmMatrixView<T>
+A strided view of a block of matrix elements
+**********/
+template <class T>
+class tmMatrixView {
+public:
+  tmMatrixView(T* aData = 0, std::size_t aRows = 0, std::size_t aCols = 0,
+    std::size_t aStride = 0) :
+    mData(aData), mRows(aRows), mCols(aCols), mStride(aStride) {};
+  template <class U>
+  tmMatrixView(const tmMatrixView<U>& aView) :
+    mData(aView.GetData()), mRows(aView.GetRows()), mCols(aView.GetCols()),
+    mStride(aView.GetStride()) {};
+
+  T* operator[](std::size_t i) const {
+    // Return a pointer to the first element of row i
+    return mData + i * mStride;};
+  T* GetData() const {return mData;};
+  std::size_t GetRows() const {return mRows;};
+  std::size_t GetCols() const {return mCols;};
+  std::size_t GetStride() const {return mStride;};
+  tmMatrixView GetBlock(std::size_t i0, std::size_t j0, std::size_t aRows,
+    std::size_t aCols) const {
+    // Return a view of the aRows x aCols block whose first element is (i0, j0)
+    TMASSERT(i0 + aRows <= mRows && j0 + aCols <= mCols);
+    return tmMatrixView(mData + i0 * mStride + j0, aRows, aCols, mStride);};
+private:
+  T* mData;             // first element of the block
+  std::size_t mRows;    // number of rows in the block
+  std::size_t mCols;    // number of columns in the block
+  std::size_t mStride;  // distance between the starts of consecutive rows
+};
+
+
 /**********
 class tmMatrix<T>
 **********/
 template <class T>
-class tmMatrix : public std::vector<std::vector<T> > {
+class tmMatrix {
 public:
   tmMatrix(std::size_t aRows = 0, std::size_t aCols = 0, const T& t = 0);
-  std::size_t GetRows(void) {
+  std::size_t GetRows(void) const {
     // Return the number of rows in the matrix (first index)
-    return this->size();};
-  std::size_t GetCols(void) {
+    return mRows;};
+  std::size_t GetCols(void) const {
     // Return the number of columns in the matrix (second index)
-    if (GetRows()) return (*this)[0].size(); else return 0;};
+    return mCols;};
+  T* operator[](std::size_t i) {
+    // Return a pointer to the first element of row i
+    return mData.data() + i * mCols;};
+  const T* operator[](std::size_t i) const {
+    return mData.data() + i * mCols;};
+  T* GetData() {return mData.data();};
+  const T* GetData() const {return mData.data();};
+  tmMatrixView<T> GetView() {
+    return tmMatrixView<T>(mData.data(), mRows, mCols, mCols);};
+  tmMatrixView<const T> GetView() const {
+    return tmMatrixView<const T>(mData.data(), mRows, mCols, mCols);};
+  tmMatrixView<T> GetBlock(std::size_t i0, std::size_t j0, std::size_t aRows,
+    std::size_t aCols) {return GetView().GetBlock(i0, j0, aRows, aCols);};
+  tmMatrixView<const T> GetBlock(std::size_t i0, std::size_t j0,
+    std::size_t aRows, std::size_t aCols) const {
+    return GetView().GetBlock(i0, j0, aRows, aCols);};
+  void assign(const T& t) {mData.assign(mData.size(), t);};
   void resize(std::size_t aRows, std::size_t aCols);
 private:
-  void resize(std::size_t sz);    // hide this ancestor method
+  std::vector<T> mData;   // elements, row by row
+  std::size_t mRows;      // number of rows
+  std::size_t mCols;      // number of columns, also the row stride
 };
 
 
@@ -48,23 +117,165 @@ Constructor sets size and optionally assigns a value to the element
 *****/
 template <class T>
 tmMatrix<T>::tmMatrix(std::size_t aRows, std::size_t aCols, const T& t)
-  : std::vector<std::vector<T> >(aRows)
+  : mData(aRows * aCols, t), mRows(aRows), mCols(aCols)
 {
-  for (std::size_t i = 0; i < this->size(); ++i) {
-    (*this)[i].resize(aCols);
-    (*this)[i].assign(aCols, t);
-  }
 }
 
 
 /*****
-Change row and column dimensions of a tmMatrix
+Change row and column dimensions of a tmMatrix. Elements that lie within both
+the old and new dimensions keep their values; new elements are zero.
 *****/
 template <class T>
 void tmMatrix<T>::resize(std::size_t aRows, std::size_t aCols)
 {
-  std::vector<std::vector<T> >::resize(aRows);
-  for (std::size_t i = 0; i < this->size(); ++i) (*this)[i].resize(aCols);
+  if (aCols == mCols) {
+    mData.resize(aRows * aCols, T(0));
+    mRows = aRows;
+    return;
+  }
+  std::vector<T> newData(aRows * aCols, T(0));
+  std::size_t nr = std::min(aRows, mRows);
+  std::size_t nc = std::min(aCols, mCols);
+  for (std::size_t i = 0; i < nr; ++i)
+    std::copy(&mData[i * mCols], &mData[i * mCols] + nc, &newData[i * aCols]);
+  mData.swap(newData);
+  mRows = aRows;
+  mCols = aCols;
+}
+
+
+/**********
+Kernels
+**********/
+
+/*****
+y[0..n-1] += a * x[0..n-1]
+*****/
+template <class T>
+inline void tmAxpy(std::size_t n, const T& a, const T* x, T* y)
+{
+  for (std::size_t i = 0; i < n; ++i) y[i] += a * x[i];
+}
+
+
+/*****
+y[0..n-1] -= a * x[0..n-1]
+*****/
+template <class T>
+inline void tmAxmy(std::size_t n, const T& a, const T* x, T* y)
+{
+  for (std::size_t i = 0; i < n; ++i) y[i] -= a * x[i];
+}
+
+
+/*****
+Return s - x[0..n-1] . y[0..n-1], summed in order of increasing index.
+*****/
+template <class T>
+inline T tmSubDot(std::size_t n, T s, const T* x, const T* y)
+{
+  for (std::size_t i = 0; i < n; ++i) s -= x[i] * y[i];
+  return s;
+}
+
+
+/*****
+Compute c -= a * b for views a (m x p), b (p x n) and c (m x n). This is the
+trailing update of a blocked LU decomposition. Each element of c is updated in
+order of increasing inner index, exactly as an unblocked elimination would do
+it; the loops are tiled so that a panel of b stays in cache while the rows of
+a and c stream past it.
+*****/
+template <class T>
+void tmMultiplySubtract(const tmMatrixView<const T>& a,
+  const tmMatrixView<const T>& b, const tmMatrixView<T>& c)
+{
+  const std::size_t COL_TILE = 256;
+  std::size_t m = c.GetRows();
+  std::size_t n = c.GetCols();
+  std::size_t p = a.GetCols();
+  TMASSERT(a.GetRows() == m && b.GetRows() == p && b.GetCols() == n);
+  for (std::size_t j0 = 0; j0 < n; j0 += COL_TILE) {
+    std::size_t nj = std::min(COL_TILE, n - j0);
+    for (std::size_t i = 0; i < m; ++i) {
+      const T* ai = a[i];
+      T* ci = c[i] + j0;
+      
+      // Four rows of b at a time, so each element of c is loaded and stored
+      // once per four updates instead of once per update.
+      std::size_t k = 0;
+      for (; k + 4 <= p; k += 4) {
+        const T a0 = ai[k], a1 = ai[k + 1], a2 = ai[k + 2], a3 = ai[k + 3];
+        const T* b0 = b[k] + j0;
+        const T* b1 = b[k + 1] + j0;
+        const T* b2 = b[k + 2] + j0;
+        const T* b3 = b[k + 3] + j0;
+        for (std::size_t j = 0; j < nj; ++j) {
+          T cij = ci[j];
+          cij -= a0 * b0[j];
+          cij -= a1 * b1[j];
+          cij -= a2 * b2[j];
+          cij -= a3 * b3[j];
+          ci[j] = cij;
+        }
+      }
+      for (; k < p; ++k) tmAxmy(nj, ai[k], b[k] + j0, ci);
+    }
+  }
+}
+
+
+/*****
+Compute y = h * x for a symmetric matrix h. Since row j of h is also column j,
+a large product is done as a sum of scaled rows, which vectorizes where a dot
+product of each row with x would not; small ones aren't worth the extra stores.
+Either way each y[i] is summed in order of increasing j.
+*****/
+template <class T>
+void tmSymmetricMultiply(const tmMatrix<T>& h, const T* x, T* y)
+{
+  const std::size_t MIN_AXPY_SIZE = 128;
+  std::size_t n = h.GetRows();
+  TMASSERT(h.GetCols() == n);
+  if (n < MIN_AXPY_SIZE) {
+    for (std::size_t i = 0; i < n; ++i) {
+      const T* hi = h[i];
+      T yi = T(0);
+      for (std::size_t j = 0; j < n; ++j) yi += hi[j] * x[j];
+      y[i] = yi;
+    }
+    return;
+  }
+  std::fill(y, y + n, T(0));
+  for (std::size_t j = 0; j < n; ++j) tmAxpy(n, x[j], h[j], y);
+}
+
+
+/*****
+Perform the BFGS update of a symmetric inverse Hessian h,
+  h += fac * s s' - fad * v v' + fae * u u'
+where s is the step, v is h times the change in gradient, and u is the
+correction vector (Press et al, Numerical Recipes, eq. 10.7.9). Rather than
+updating the upper triangle and mirroring it into the lower triangle one
+column at a time, this updates each whole row; the elements below the diagonal
+are computed with the factors swapped so that h stays exactly symmetric.
+*****/
+template <class T>
+void tmBFGSUpdate(tmMatrix<T>& h, const T* s, const T* v, const T* u,
+  const T& fac, const T& fad, const T& fae)
+{
+  std::size_t n = h.GetRows();
+  TMASSERT(h.GetCols() == n);
+  for (std::size_t i = 0; i < n; ++i) {
+    T* hi = h[i];
+    const T si = s[i], vi = v[i], ui = u[i];
+    for (std::size_t j = 0; j < i; ++j)
+      hi[j] += (fac * s[j]) * si - (fad * v[j]) * vi + (fae * u[j]) * ui;
+    const T fsi = fac * si, fvi = fad * vi, fui = fae * ui;
+    for (std::size_t j = i; j < n; ++j)
+      hi[j] += fsi * s[j] - fvi * v[j] + fui * u[j];
+  }
 }
 
 #endif // _MATRIX_H_
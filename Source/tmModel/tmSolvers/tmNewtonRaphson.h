@@ -34,6 +34,7 @@ class tmNewtonRaphson {
 public:
   class EX_TOO_MANY_ITERATIONS {};
   class EX_SINGULAR_MATRIX {};
+  enum {LU_BLOCK_SIZE = 32};    // columns per panel in LUDecomposition
   virtual ~tmNewtonRaphson () {};
   void SolveEqns(std::size_t ntrials, std::vector<T>& x, const T& tolx, 
     const T& tolf);
@@ -117,6 +118,13 @@ by the partial pivoting; d is output as ±1 depending on whether the number of
 row interchanges was even or odd, respectively. This routine is used in
 combination with LUBackSubstitution to solve linear equations or invert a
 matrix.
+
+PFTV use Crout's method, which walks down the columns of the matrix. We
+instead eliminate a panel of LU_BLOCK_SIZE columns at a time and then update
+the rest of the matrix from the finished panel, a row at a time, so that for
+large matrices nearly all of the work is done along contiguous rows. Every
+element still receives its updates in the same order as in Crout's method and
+the pivots are chosen by the same rule, so the result is identical.
 *****/
 template <class T>
 void tmNewtonRaphson<T>::LUDecomposition(tmMatrix<T>& a, T& d)
@@ -130,59 +138,68 @@ void tmNewtonRaphson<T>::LUDecomposition(tmMatrix<T>& a, T& d)
 
   // loop over rows to get the implicit scaling information and check for
   // singularity
-  T big, dum, sum, temp;
+  T big, dum, temp;
   for (std::size_t i = 0; i < n; ++i) {
+    const T* ai = a[i];
     big = T(0.0);
     for (std::size_t j = 0; j < n; ++j)
-      if ((temp = fabs(a[i][j])) > big) big = temp;
+      if ((temp = fabs(ai[j])) > big) big = temp;
     if (big == 0.0) throw EX_SINGULAR_MATRIX();
     mRowScaling[i] = T(1.0) / big;  // save the scaling
   }
   
-  // This is the loop over columns of Crout's method
-  for (std::size_t j = 0; j < n; ++j) {
-    std::size_t imax = size_t(-1);
-    for (std::size_t i = 0; i < j; ++i) {
-      sum = a[i][j];
-      for (std::size_t k = 0; k < i; ++k) sum -= a[i][k] * a[k][j];
-      a[i][j] = sum;
-    }
+  // This is the loop over panels of columns
+  for (std::size_t k0 = 0; k0 < n; k0 += LU_BLOCK_SIZE) {
+    std::size_t k1 = std::min(k0 + LU_BLOCK_SIZE, n);
     
-    // initializes the search for the largest pivot element
-    big = T(0.0);
-    for (std::size_t i = j; i < n; ++i) {
-      sum = a[i][j];
-      for (std::size_t k = 0; k < j; ++k)
-        sum -= a[i][k] * a[k][j];
-      a[i][j] = sum;
+    // Factor the panel, one column at a time. The columns to the left of j
+    // have already been applied to column j, so we can search for the pivot.
+    for (std::size_t j = k0; j < k1; ++j) {
+      std::size_t imax = size_t(-1);
+      big = T(0.0);
+      for (std::size_t i = j; i < n; ++i) {
       
-      // is figure of merit for pivot better than the best so far?
-      if ( (dum = mRowScaling[i] * fabs(sum)) >= big) {
-        big = dum;
-        imax = i;
+        // is figure of merit for pivot better than the best so far?
+        if ( (dum = mRowScaling[i] * fabs(a[i][j])) >= big) {
+          big = dum;
+          imax = i;
+        }
       }
-    }
-    
-    // Do we need to interchange rows?
-    if (j != imax) {
-      for (std::size_t k = 0; k < n; ++k) {
-        dum = a[imax][k];
-        a[imax][k] = a[j][k];
-        a[j][k] = dum;
+      
+      // Do we need to interchange rows?
+      if (j != imax) {
+        std::swap_ranges(a[imax], a[imax] + n, a[j]);
+        d = -d;        // update parity of d
+        mRowScaling[imax] = mRowScaling[j];  // and interchange the scale factor.
+      }
+      mRowPermutation[j] = imax;
+      
+      // If the pivot element is zero, the matrix is singular (to the precision
+      // of the algorithm). For some applications, it's desirable to substitute
+      // TINY for zero.
+      T* aj = a[j];
+      if (aj[j] == 0.0) aj[j] = TINY;
+      dum = T(1.0) / (aj[j]);  // Divide by the pivot element
+      
+      // Eliminate column j from the rest of the panel.
+      for (std::size_t i = j + 1; i < n; ++i) {
+        T* ai = a[i];
+        ai[j] *= dum;
+        tmAxmy(k1 - j - 1, ai[j], aj + j + 1, ai + j + 1);
       }
-      d = -d;        // update parity of d
-      mRowScaling[imax] = mRowScaling[j];  // and interchange the scale factor.
     }
-    mRowPermutation[j] = imax;
+    if (k1 == n) break;
     
-    // If the pivot element is zero, the matrix is singular (to the precision
-    // of the algorithm). For some applications, it's desirable to substitute
-    // TINY for zero.
-    if (a[j][j] == 0.0) a[j][j] = TINY;
-    if (j != n) {
-      dum = T(1.0) / (a[j][j]);  // Divide by the pivot element
-      for (std::size_t i = j + 1; i < n; ++i) a[i][j] *= dum;
+    // Apply the panel to the rows of U to its right...
+    for (std::size_t i = k0 + 1; i < k1; ++i) {
+      T* ai = a[i];
+      for (std::size_t k = k0; k < i; ++k) tmAxmy(n - k1, ai[k], a[k] + k1,
+        ai + k1);
     }
+    
+    // ...and then to everything below and to the right.
+    tmMultiplySubtract<T>(a.GetBlock(k1, k0, n - k1, k1 - k0),
+      a.GetBlock(k0, k1, k1 - k0, n - k1), a.GetBlock(k1, k1, n - k1, n - k1));
   }
 }
 
@@ -213,7 +230,7 @@ void tmNewtonRaphson<T>::LUBackSubstitution(tmMatrix<T>& a, std::vector<T>& b)
     sum = b[ip];
     b[ip] = b[i];
     if (ii != BAD_INDEX)
-      for (std::size_t j = ii; j <= i - 1; ++j) sum -= a[i][j] * b[j];
+      sum = tmSubDot(i - ii, sum, a[i] + ii, &b[ii]);
     else if (sum) ii = i;
     b[i] = sum;
   }
@@ -222,9 +239,9 @@ void tmNewtonRaphson<T>::LUBackSubstitution(tmMatrix<T>& a, std::vector<T>& b)
   // since i is an unsigned long, our stopping criterion is wrap-around rather
   // than (i >= 0).
   for (std::size_t i = n - 1; i != BAD_INDEX; i--) {
-    sum = b[i];
-    for (std::size_t j = i + 1; j < n; ++j) sum -= a[i][j] * b[j];
-    b[i] = sum / a[i][i];
+    const T* ai = a[i];
+    sum = tmSubDot(n - i - 1, b[i], ai + i + 1, &b[i + 1]);
+    b[i] = sum / ai[i];
   }
 }
 
@@ -19,6 +19,7 @@ Copyright:    ©2004 Robert J. Lang. All Rights Reserved.
 #include "tmPath.h"
 #include "tmPoly.h"
 #include "tmNewtonRaphson.h"
+#include "tmProfiler.h"
 
 using namespace std;
 
@@ -90,6 +91,20 @@ bool tmStubInfo::operator<(const tmStubInfo& rhs) const
 }
 
 
+/*****
+Hash a StubInfo record. Like operator==(), this only looks at the (sorted)
+list of active nodes.
+*****/
+size_t tmStubInfoHash::operator()(const tmStubInfo& stubInfo) const
+{
+  tmArrayHash<tmNode*> nodeHash;
+  size_t h = stubInfo.mActiveNodes.size();
+  for (size_t i = 0; i < stubInfo.mActiveNodes.size(); ++i)
+    h = 31 * h + nodeHash(stubInfo.mActiveNodes[i]);
+  return tmArrayHash<size_t>()(h);
+}
+
+
 #ifdef __MWERKS__
 #pragma mark -
 #endif
@@ -141,7 +156,9 @@ take into account that the returned list could be empty.
 void tmStubFinder::FindAllStubs(const tmArray<tmNode*>& aNodeList, 
   tmArray<tmStubInfo>& sInfoList)
 {
+  TM_PROFILE_SCOPE("tmStubFinder::FindAllStubs");
   sInfoList.clear();
+  tmIndexedArray<tmStubInfo, tmStubInfoHash> foundList;
   tmArray<tmNode*> leafNodeList;
   tmNode::FilterLeafNodes(leafNodeList, aNodeList);
   size_t numNodes = leafNodeList.size();
@@ -168,13 +185,14 @@ void tmStubFinder::FindAllStubs(const tmArray<tmNode*>& aNodeList,
           mTrialNodes[3] = leafNodeList[i3];
           for (size_t i4 = 0; i4 < mSpanningEdges.size(); ++i4) {
             mTrialEdge = mSpanningEdges[i4];
-            TestOneCombo(sInfoList);
+            TestOneCombo(foundList);
           }
         }
       }
     }
   }
   // Sort the list in order of stub length
+  sInfoList.assign(foundList.begin(), foundList.end());
   sort(sInfoList.begin(), sInfoList.end());
 }
 
@@ -182,10 +200,13 @@ void tmStubFinder::FindAllStubs(const tmArray<tmNode*>& aNodeList,
 /*****
 Try a single combination of nodes (stored in mTrialNodes) and split edge
 (mTrialEdge) and if the combination yields a solution, push it onto the list
-sInfoList.
+sInfoList. The list is indexed because the duplicate test runs once per
+solution found, and there are a lot of them for large polygons.
 *****/
-void tmStubFinder::TestOneCombo(tmArray<tmStubInfo>& sInfoList)
+void tmStubFinder::TestOneCombo(
+  tmIndexedArray<tmStubInfo, tmStubInfoHash>& sInfoList)
 {
+  TM_PROFILE_SCOPE("tmStubFinder::TestOneCombo");
   tmNode* edgeFirstNode = mTrialEdge->mNodes.front();
   for (size_t i = 0; i < 4; ++i) {
     mParms[i][0] = mTrialNodes[i]->mLoc.x;
@@ -315,6 +336,7 @@ Repeatedly add stubs to a tree until all polys have only three sides.
 *****/
 void tmStubFinder::TriangulateTree()
 {
+  TM_PROFILE_SCOPE("tmStubFinder::TriangulateTree");
   // Repeatedly go through the polys looking for one of order-4 or higher; when
   // we find one, fracture it and start over at the beginning. When we've gone
   // through all the polys without finding one, we're done fracturing; at that
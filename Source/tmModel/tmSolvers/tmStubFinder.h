@@ -18,6 +18,7 @@ Copyright:    ©2004 Robert J. Lang. All Rights Reserved.
 #include "tmPoint.h"
 #include "tmNewtonRaphson.h"
 #include "tmArray.h"
+#include "tmIndexedArray.h"
 
 // Forward declarations
 class tmTree;
@@ -47,6 +48,16 @@ struct tmStubInfo {
 };
 
 
+/**********
+struct tmStubInfoHash
+Hash function consistent with tmStubInfo::operator==(), for indexed lists of
+solutions
+**********/
+struct tmStubInfoHash {
+  std::size_t operator()(const tmStubInfo& stubInfo) const;
+};
+
+
 /**********
 class tmStubFinder
 Class that solves for stubs added to the tree that give 4 (or more) active
@@ -79,7 +90,7 @@ private:
   tmEdge* mTrialEdge;       // and one edge
   tmStubFinder();
   tmStubFinder(const tmStubFinder& aStubFinder);
-  void TestOneCombo(tmArray<tmStubInfo>& sInfoList);
+  void TestOneCombo(tmIndexedArray<tmStubInfo, tmStubInfoHash>& sInfoList);
 };
 
 #endif // _TMSTUBFINDER_H_
@@ -23,6 +23,37 @@ class tmCluster
 A group of tmParts; a base class of a tmTree
 **********/
 
+/*****
+tmCluster::tmCluster()
+Constructor. All part lists are indexed, so Contains() (which the GUI calls for
+every part it draws, to see whether it's selected) and the removal of deleted
+parts don't have to search the lists.
+*****/
+tmCluster::tmCluster()
+{
+  mNodes.set_indexed(true);
+  mEdges.set_indexed(true);
+  mPaths.set_indexed(true);
+  mPolys.set_indexed(true);
+  mVertices.set_indexed(true);
+  mCreases.set_indexed(true);
+  mFacets.set_indexed(true);
+  mConditions.set_indexed(true);
+}
+
+
+/*****
+tmCluster::tmCluster(const tmCluster& aCluster)
+Copy constructor. Copies of the part lists don't carry an index of their own,
+so we go through the default constructor and then copy the contents.
+*****/
+tmCluster::tmCluster(const tmCluster& aCluster)
+  : tmCluster()
+{
+  AddParts(aCluster);
+}
+
+
 /*****
 size_t tmCluster::GetNumAllParts() const
 Return the number of all parts in the cluster.
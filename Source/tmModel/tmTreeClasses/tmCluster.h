@@ -35,6 +35,10 @@ public:
   tmDpptrArray<tmFacet> mFacets;
   tmDpptrArray<tmCondition> mConditions;
 
+  // Constructors; the part lists are indexed for fast membership tests
+  tmCluster();
+  tmCluster(const tmCluster& aCluster);
+
   // Named getters that return lists
   tmDpptrArray<tmNode>& GetNodes() {return mNodes;};
   tmDpptrArray<tmEdge>& GetEdges() {return mEdges;};
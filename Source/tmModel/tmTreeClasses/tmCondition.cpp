@@ -160,3 +160,9 @@ Get the subclass-specific contents of this condition from a stream in version 4
 format. Implemented by subclasses.
 *****/
 // void tmCondition::GetRestv4(istream& is);
+
+
+/*****
+Memory pool shared by all condition classes
+*****/
+TM_IMPLEMENT_POOL(tmCondition)
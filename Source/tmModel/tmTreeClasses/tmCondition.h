@@ -64,6 +64,10 @@ private:
   virtual std::size_t GetNumLinesRest() = 0;
   virtual void PutRestv4(std::ostream& os) = 0;
   virtual void GetRestv4(std::istream& is) = 0; 
+  virtual void CopyRest(tmCondition* aCondition) = 0;
+
+  // Memory comes from a pool shared by all conditions
+  TM_DECLARE_POOL()
 
   // Friend classes     
   friend class tmTree;
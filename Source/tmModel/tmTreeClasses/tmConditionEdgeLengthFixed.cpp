@@ -148,6 +148,17 @@ void tmConditionEdgeLengthFixed::GetRestv4(istream& is)
 }
 
 
+/*****
+Copy the rest of this condition from another tree
+*****/
+void tmConditionEdgeLengthFixed::CopyRest(tmCondition* aCondition)
+{
+  tmConditionEdgeLengthFixed* c = dynamic_cast<tmConditionEdgeLengthFixed*>(aCondition);
+  TMASSERT(c);
+  mTree->CopyPtr(mEdge, c->mEdge);
+}
+
+
 /*****
 Dynamic type implementation
 *****/
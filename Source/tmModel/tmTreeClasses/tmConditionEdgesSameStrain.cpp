@@ -164,6 +164,18 @@ void tmConditionEdgesSameStrain::GetRestv4(istream& is)
 }
 
 
+/*****
+Copy the rest of this condition from another tree
+*****/
+void tmConditionEdgesSameStrain::CopyRest(tmCondition* aCondition)
+{
+  tmConditionEdgesSameStrain* c = dynamic_cast<tmConditionEdgesSameStrain*>(aCondition);
+  TMASSERT(c);
+  mTree->CopyPtr(mEdge1, c->mEdge1);
+  mTree->CopyPtr(mEdge2, c->mEdge2);
+}
+
+
 /*****
 Dynamic type implementation
 *****/
@@ -323,6 +323,24 @@ void tmConditionNodeCombo::GetRestv4(istream& is)
 }
 
 
+/*****
+Copy the rest of this condition from another tree
+*****/
+void tmConditionNodeCombo::CopyRest(tmCondition* aCondition)
+{
+  tmConditionNodeCombo* c = dynamic_cast<tmConditionNodeCombo*>(aCondition);
+  TMASSERT(c);
+  mTree->CopyPtr(mNode, c->mNode);
+  mToSymmetryLine = c->mToSymmetryLine;
+  mToPaperEdge = c->mToPaperEdge;
+  mToPaperCorner = c->mToPaperCorner;
+  mXFixed = c->mXFixed;
+  mXFixValue = c->mXFixValue;
+  mYFixed = c->mYFixed;
+  mYFixValue = c->mYFixValue;
+}
+
+
 /*****
 Dynamic type implementation
 *****/
@@ -220,6 +220,21 @@ void tmConditionNodeFixed::GetRestv4(istream& is)
 }
 
 
+/*****
+Copy the rest of this condition from another tree
+*****/
+void tmConditionNodeFixed::CopyRest(tmCondition* aCondition)
+{
+  tmConditionNodeFixed* c = dynamic_cast<tmConditionNodeFixed*>(aCondition);
+  TMASSERT(c);
+  mTree->CopyPtr(mNode, c->mNode);
+  mXFixed = c->mXFixed;
+  mYFixed = c->mYFixed;
+  mXFixValue = c->mXFixValue;
+  mYFixValue = c->mYFixValue;
+}
+
+
 /*****
 Dynamic type implementation
 *****/
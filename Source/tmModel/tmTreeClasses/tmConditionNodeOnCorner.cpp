@@ -160,6 +160,17 @@ void tmConditionNodeOnCorner::GetRestv4(istream& is)
 }
 
 
+/*****
+Copy the rest of this condition from another tree
+*****/
+void tmConditionNodeOnCorner::CopyRest(tmCondition* aCondition)
+{
+  tmConditionNodeOnCorner* c = dynamic_cast<tmConditionNodeOnCorner*>(aCondition);
+  TMASSERT(c);
+  mTree->CopyPtr(mNode, c->mNode);
+}
+
+
 /*****
 Dynamic type implementation
 *****/
@@ -157,6 +157,17 @@ void tmConditionNodeOnEdge::GetRestv4(istream& is)
 }
 
 
+/*****
+Copy the rest of this condition from another tree
+*****/
+void tmConditionNodeOnEdge::CopyRest(tmCondition* aCondition)
+{
+  tmConditionNodeOnEdge* c = dynamic_cast<tmConditionNodeOnEdge*>(aCondition);
+  TMASSERT(c);
+  mTree->CopyPtr(mNode, c->mNode);
+}
+
+
 /*****
 Dynamic type implementation
 *****/
@@ -92,6 +92,7 @@ Add constraints for a tmScaleOptimizer
 void tmConditionNodeSymmetric::AddConstraints(tmScaleOptimizer* t)
 {
   if (!mTree->mHasSymmetry) return;
+  if (t->IsOnSymmetryLine(mNode)) return;  // symmetric by construction
   size_t ix = t->GetBaseOffset(mNode);
   if (ix != tmArray<tmNode*>::BAD_OFFSET) {
     size_t iy = ix + 1; 
@@ -106,7 +107,8 @@ Add constraints for a tmEdgeOptimizer
 *****/    
 void tmConditionNodeSymmetric::AddConstraints(tmEdgeOptimizer* t)
 {
-  if (!mTree->mHasSymmetry) return; 
+  if (!mTree->mHasSymmetry) return;
+  if (t->IsOnSymmetryLine(mNode)) return;  // symmetric by construction
   size_t ix = t->GetBaseOffset(mNode);
   if (ix != tmArray<tmNode*>::BAD_OFFSET) {
     size_t iy = ix + 1;
@@ -122,6 +124,7 @@ Add constraints for a tmStrainOptimizer
 void tmConditionNodeSymmetric::AddConstraints(tmStrainOptimizer* t)
 {
   if (!mTree->mHasSymmetry) return;
+  if (t->IsOnSymmetryLine(mNode)) return;  // symmetric by construction
   size_t ix = t->GetBaseOffset(mNode);
   if (ix != tmArray<tmNode*>::BAD_OFFSET) {
     size_t iy = ix + 1;
@@ -163,6 +166,17 @@ void tmConditionNodeSymmetric::GetRestv4(istream& is)
 }
 
 
+/*****
+Copy the rest of this condition from another tree
+*****/
+void tmConditionNodeSymmetric::CopyRest(tmCondition* aCondition)
+{
+  tmConditionNodeSymmetric* c = dynamic_cast<tmConditionNodeSymmetric*>(aCondition);
+  TMASSERT(c);
+  mTree->CopyPtr(mNode, c->mNode);
+}
+
+
 /*****
 Dynamic type implementation
 *****/
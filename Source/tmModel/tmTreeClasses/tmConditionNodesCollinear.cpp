@@ -270,6 +270,19 @@ void tmConditionNodesCollinear::GetRestv4(istream& is)
 }
 
 
+/*****
+Copy the rest of this condition from another tree
+*****/
+void tmConditionNodesCollinear::CopyRest(tmCondition* aCondition)
+{
+  tmConditionNodesCollinear* c = dynamic_cast<tmConditionNodesCollinear*>(aCondition);
+  TMASSERT(c);
+  mTree->CopyPtr(mNode1, c->mNode1);
+  mTree->CopyPtr(mNode2, c->mNode2);
+  mTree->CopyPtr(mNode3, c->mNode3);
+}
+
+
 /*****
 Dynamic type implementation
 *****/
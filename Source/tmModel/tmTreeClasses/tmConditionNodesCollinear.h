@@ -65,6 +65,7 @@ private:
   std::size_t GetNumLinesRest();
   void PutRestv4(std::ostream& os);
   void GetRestv4(std::istream& is);
+  void CopyRest(tmCondition* aCondition);
 
   // Class tag for stream I/O
   TM_DECLARE_TAG()
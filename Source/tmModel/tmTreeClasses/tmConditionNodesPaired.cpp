@@ -111,7 +111,8 @@ Add constraints for a tmScaleOptimizer
 *****/    
 void tmConditionNodesPaired::AddConstraints(tmScaleOptimizer* t)
 {
-  if (!mTree->mHasSymmetry) return; 
+  if (!mTree->mHasSymmetry) return;
+  if (t->IsReflectedPair(mNode1, mNode2)) return;  // paired by construction
   size_t ix = t->GetBaseOffset(mNode1);
   size_t jx = t->GetBaseOffset(mNode2);
   if (ix != tmArray<tmNode*>::BAD_OFFSET && 
@@ -132,6 +133,7 @@ Add constraints for a tmEdgeOptimizer
 void tmConditionNodesPaired::AddConstraints(tmEdgeOptimizer* t)
 {
   if (!mTree->mHasSymmetry) return;
+  if (t->IsReflectedPair(mNode1, mNode2)) return;  // paired by construction
   
   size_t ix = t->GetBaseOffset(mNode1);
   size_t iy = ix + 1;
@@ -172,6 +174,7 @@ Add constraints for a tmStrainOptimizer
 void tmConditionNodesPaired::AddConstraints(tmStrainOptimizer* t)
 {
   if (!mTree->mHasSymmetry) return;
+  if (t->IsReflectedPair(mNode1, mNode2)) return;  // paired by construction
   
   size_t ix = t->GetBaseOffset(mNode1);
   size_t iy = ix + 1;
@@ -240,6 +243,18 @@ void tmConditionNodesPaired::GetRestv4(istream& is)
 }
 
 
+/*****
+Copy the rest of this condition from another tree
+*****/
+void tmConditionNodesPaired::CopyRest(tmCondition* aCondition)
+{
+  tmConditionNodesPaired* c = dynamic_cast<tmConditionNodesPaired*>(aCondition);
+  TMASSERT(c);
+  mTree->CopyPtr(mNode1, c->mNode1);
+  mTree->CopyPtr(mNode2, c->mNode2);
+}
+
+
 /*****
 Dynamic type implementation
 *****/
@@ -277,6 +277,21 @@ void tmConditionPathActive::GetRestv4(istream& is)
 }
 
 
+/*****
+Copy the rest of this condition from another tree. As in GetRestv4(), the
+path is looked up from its end nodes.
+*****/
+void tmConditionPathActive::CopyRest(tmCondition* aCondition)
+{
+  tmConditionPathActive* c = dynamic_cast<tmConditionPathActive*>(aCondition);
+  TMASSERT(c);
+  mTree->CopyPtr(mNode1, c->mNode1);
+  mTree->CopyPtr(mNode2, c->mNode2);
+  mPath = mTree->FindLeafPath(mNode1, mNode2);
+  TMASSERT(mPath);
+}
+
+
 /*****
 Dynamic type implementation
 *****/
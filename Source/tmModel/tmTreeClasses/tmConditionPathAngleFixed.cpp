@@ -191,6 +191,18 @@ void tmConditionPathAngleFixed::GetRestv4(istream& is)
 }
 
 
+/*****
+Copy the rest of this condition from another tree
+*****/
+void tmConditionPathAngleFixed::CopyRest(tmCondition* aCondition)
+{
+  tmConditionPathAngleFixed* c = dynamic_cast<tmConditionPathAngleFixed*>(aCondition);
+  TMASSERT(c);
+  tmConditionPathActive::CopyRest(aCondition); // copy inherited data
+  mAngle = c->mAngle;
+}
+
+
 /*****
 Dynamic type implementation
 *****/
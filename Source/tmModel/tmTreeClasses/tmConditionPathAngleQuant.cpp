@@ -210,6 +210,19 @@ void tmConditionPathAngleQuant::GetRestv4(istream& is)
 }
 
 
+/*****
+Copy the rest of this condition from another tree
+*****/
+void tmConditionPathAngleQuant::CopyRest(tmCondition* aCondition)
+{
+  tmConditionPathAngleQuant* c = dynamic_cast<tmConditionPathAngleQuant*>(aCondition);
+  TMASSERT(c);
+  tmConditionPathActive::CopyRest(aCondition);
+  mQuant = c->mQuant;
+  mQuantOffset = c->mQuantOffset;
+}
+
+
 /*****
 Dynamic type implementation
 *****/
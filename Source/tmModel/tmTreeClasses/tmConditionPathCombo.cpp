@@ -465,6 +465,26 @@ void tmConditionPathCombo::GetRestv4(istream& is)
 }
 
 
+/*****
+Copy the rest of this condition from another tree. As in GetRestv4(), the
+path is looked up from its end nodes.
+*****/
+void tmConditionPathCombo::CopyRest(tmCondition* aCondition)
+{
+  tmConditionPathCombo* c = dynamic_cast<tmConditionPathCombo*>(aCondition);
+  TMASSERT(c);
+  mTree->CopyPtr(mNode1, c->mNode1);
+  mTree->CopyPtr(mNode2, c->mNode2);
+  mPath = mTree->FindLeafPath(mNode1, mNode2);
+  TMASSERT(mPath);
+  mIsAngleFixed = c->mIsAngleFixed;
+  mAngle = c->mAngle;
+  mIsAngleQuant = c->mIsAngleQuant;
+  mQuant = c->mQuant;
+  mQuantOffset = c->mQuantOffset;
+}
+
+
 /*****
 Dynamic type implementation
 *****/
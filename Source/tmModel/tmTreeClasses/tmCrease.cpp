@@ -362,34 +362,6 @@ void tmCrease::CalcBend()
 #endif
 
 
-/*****
-Calculate the fold direction of this crease, which depends on the relative order
-of the two facets on either side and their color orientation.
-*****/
-void tmCrease::CalcFold()
-{
-  if (mFwdFacet == 0 || mBkdFacet == 0)
-    mFold = BORDER;
-  else if (mFwdFacet->mColor == mBkdFacet->mColor)
-    mFold = FLAT;
-  else if (mFwdFacet->mColor == tmFacet::COLOR_UP)
-    if (mFwdFacet->mOrder > mBkdFacet->mOrder)
-      mFold = MOUNTAIN;
-    else
-      mFold = VALLEY;
-  else
-    if (mFwdFacet->mOrder > mBkdFacet->mOrder)
-      mFold = VALLEY;
-    else
-      mFold = MOUNTAIN;
-} 
-
-
-#ifdef __MWERKS__
-  #pragma mark -
-#endif
-
-
 /*****
 Clear the data that is recalculated at cleanup
 *****/
@@ -444,6 +416,23 @@ void tmCrease::Getv5Self(istream& is)
 }
 
 
+/*****
+Copy a tmCrease of another tree
+*****/
+void tmCrease::CopySelf(tmCrease* aCrease)
+{
+  mIndex = aCrease->mIndex;
+  mKind = aCrease->mKind;
+  mTree->CopyPtrArray(mVertices, aCrease->mVertices);
+  mTree->CopyPtr(mFwdFacet, aCrease->mFwdFacet);
+  mTree->CopyPtr(mBkdFacet, aCrease->mBkdFacet);
+  mFold = aCrease->mFold;
+  mCCFlag = aCrease->mCCFlag;
+  mSTFlag = aCrease->mSTFlag;
+  mTree->CopyOwnerPtr(mCreaseOwner, aCrease->mCreaseOwner);
+}
+
+
 /*****
 Put a tmCrease in version 4 format
 *****/
@@ -471,3 +460,4 @@ void tmCrease::Getv4Self(istream& is)
 Dynamic type implementation
 *****/
 TM_IMPLEMENT_TAG(tmCrease, "crse")
+TM_IMPLEMENT_POOL(tmCrease)
@@ -231,9 +231,6 @@ private:
   // Bend calculation
   void CalcBend();
   
-  // Fold direction
-  void CalcFold();
-  
   // Data recalculated at cleanup
   void ClearCleanupData();
     
@@ -243,9 +240,15 @@ private:
   void Putv4Self(std::ostream& os);
   void Getv4Self(std::istream& is);
   
+  // Structural copy
+  void CopySelf(tmCrease* aCrease);
+  
   // Class tag for stream I/O
   TM_DECLARE_TAG()
   
+  // Memory comes from a pool
+  TM_DECLARE_POOL()
+  
   // Friend classes
   friend class tmPart;
   friend class tmPart::StringT<tmCrease>;
@@ -46,6 +46,11 @@ void tmEdge::InitEdge()
   
   // Clear owner
   mEdgeOwner = 0;
+  
+  // A new edge means new paths (and the routines that delete edges clear the
+  // flag themselves)
+  mTreePathLength = 0;
+  mTree->mIsTreeTourValid = false;
 }
 
 
@@ -209,6 +214,23 @@ void tmEdge::Getv5Self(istream& is)
 }
 
 
+/*****
+Copy a tmEdge of another tree.
+*****/
+void tmEdge::CopySelf(tmEdge* aEdge)
+{
+  mIndex = aEdge->mIndex;
+  strcpy(mLabel, aEdge->mLabel);
+  mLength = aEdge->mLength;
+  mStrain = aEdge->mStrain;
+  mStiffness = aEdge->mStiffness;
+  mIsPinnedEdge = aEdge->mIsPinnedEdge;
+  mIsConditionedEdge = aEdge->mIsConditionedEdge;
+  mTree->CopyPtrArray(mNodes, aEdge->mNodes);
+  mTree->CopyOwnerPtr(mEdgeOwner, aEdge->mEdgeOwner);
+}
+
+
 /*****
 Put a tmEdge in version 4 format.
 *****/
@@ -274,7 +296,42 @@ void tmEdge::Getv3Self(istream& is)
 }
 
 
+/*****
+Put a tmEdge in compact version 5 format: just its settings and its nodes.
+*****/
+void tmEdge::Putv5CompactSelf(ostream& os)
+{
+  PutPOD(os, GetTagStr());
+  PutPOD(os, mLabel);
+  PutPOD(os, mLength);
+  PutPOD(os, mStrain);
+  PutPOD(os, mStiffness);
+  mTree->PutPtrArray(os, mNodes);
+}
+
+
+/*****
+Get a tmEdge in compact version 5 format. The edge is owned by the tree and
+registers itself with its nodes; everything else is left to cleanup.
+*****/
+void tmEdge::Getv5CompactSelf(istream& is)
+{
+  CheckTagStr<tmEdge>(is);
+  GetPOD(is, mLabel);
+  GetPOD(is, mLength);
+  GetPOD(is, mStrain);
+  GetPOD(is, mStiffness);
+  mTree->GetPtrArray(is, mNodes);
+  for (size_t i = 0; i < mNodes.size(); ++i) mNodes[i]->mEdges.push_back(this);
+  
+  // Set ownership
+  mTree->mOwnedEdges.push_back(this);
+  mEdgeOwner = mTree;
+}
+
+
 /*****
 Dynamic type implementation
 *****/
 TM_IMPLEMENT_TAG(tmEdge, "edge")
+TM_IMPLEMENT_POOL(tmEdge)
@@ -97,6 +97,10 @@ private:
   
   // owner
   tmEdgeOwner* mEdgeOwner;
+  
+  // Strained length that paths were last summed with (see
+  // tmTree::CalcTreePathLengths())
+  tmFloat mTreePathLength;
 
   // Constructors
   void InitEdge();
@@ -110,9 +114,17 @@ private:
   void Putv4Self(std::ostream& os);
   void Getv4Self(std::istream& is);
   void Getv3Self(std::istream& is);
+  void Putv5CompactSelf(std::ostream& os);
+  void Getv5CompactSelf(std::istream& is);
+  
+  // Structural copy
+  void CopySelf(tmEdge* aEdge);
   
   // Class tag for stream I/O
   TM_DECLARE_TAG()
+  
+  // Memory comes from a pool
+  TM_DECLARE_POOL()
     
   // Friend classes
   friend class tmPart;
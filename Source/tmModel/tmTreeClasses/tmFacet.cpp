@@ -527,37 +527,6 @@ void tmFacet::CalcOrder(std::size_t& nextOrder)
 #endif
 
 
-/*****
-Propagate the color from this facet to adjacent not-yet-oriented facets.
-Calling this routine for a single facet will propagate the color assignment
-throughout the crease pattern as long as folded-ness has been set.
-*****/
-void tmFacet::CalcColor(const Color aColor)
-{
-  TMASSERT(mColor == NOT_ORIENTED);
-  mColor = aColor;
-  for (size_t i = 0; i < mCreases.size(); ++i) {
-    tmCrease* theCrease = mCreases[i];
-    tmFacet* otherFacet = theCrease->GetOtherFacet(this);
-    if (!otherFacet || otherFacet->mColor != NOT_ORIENTED) continue;
-    switch(theCrease->GetKind()) {
-      case tmCrease::AXIAL:
-      case tmCrease::GUSSET:
-      case tmCrease::RIDGE:
-      case tmCrease::FOLDED_HINGE:
-      case tmCrease::PSEUDOHINGE:
-        otherFacet->CalcColor(OppositeColor(aColor));
-        break;
-      case tmCrease::UNFOLDED_HINGE:
-        otherFacet->CalcColor(aColor);
-        break;
-      default:
-        TMFAIL("In tmFacet::CalcColor() crease type was not defined");
-    }
-  }
-}
-
-
 /*****
 Return the opposite color from the passed one. aColor must be either WHITE_UP
 or COLOR_UP.
@@ -618,7 +587,27 @@ void tmFacet::Getv5Self(istream& is)
 }
 
 
+/*****
+Copy a tmFacet of another tree
+*****/
+void tmFacet::CopySelf(tmFacet* aFacet)
+{
+  mIndex = aFacet->mIndex;
+  mCentroid = aFacet->mCentroid;
+  mIsWellFormed = aFacet->mIsWellFormed;
+  mTree->CopyPtrArray(mVertices, aFacet->mVertices);
+  mTree->CopyPtrArray(mCreases, aFacet->mCreases);
+  mTree->CopyPtr(mCorridorEdge, aFacet->mCorridorEdge);
+  mTree->CopyPtrArray(mHeadFacets, aFacet->mHeadFacets);
+  mTree->CopyPtrArray(mTailFacets, aFacet->mTailFacets);
+  mOrder = aFacet->mOrder;
+  mColor = aFacet->mColor;
+  mTree->CopyOwnerPtr(mFacetOwner, aFacet->mFacetOwner);
+}
+
+
 /*****
 Dynamic type implementation
 *****/
 TM_IMPLEMENT_TAG(tmFacet, "fact")
+TM_IMPLEMENT_POOL(tmFacet)
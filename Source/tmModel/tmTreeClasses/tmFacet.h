@@ -189,16 +189,21 @@ private:
   void CalcOrder(std::size_t& nextOrder);
     
   // Color utilities
-  void CalcColor(const Color aColor);
   static Color OppositeColor(const Color aColor);
 
   // Stream I/O
   void Putv5Self(std::ostream& os);
   void Getv5Self(std::istream& is);
   
+  // Structural copy
+  void CopySelf(tmFacet* aFacet);
+  
   // Class tag for stream I/O
   TM_DECLARE_TAG()
   
+  // Memory comes from a pool
+  TM_DECLARE_POOL()
+  
   // Friend classes
   friend class tmPart;
   friend class tmPart::StringT<tmFacet>;
@@ -41,6 +41,10 @@ void tmNode::InitNode()
   mIsJunctionNode = false;
   mIsConditionedNode = false;
   
+  // Clear tour positions
+  mTourEnter = 0;
+  mTourExit = 0;
+  
   // Clear owner
   mNodeOwner = 0;
 }
@@ -334,6 +338,30 @@ void tmNode::Getv5Self(istream& is)
 }
 
 
+/*****
+Copy a tmNode of another tree, field for field as in Getv5Self().
+*****/
+void tmNode::CopySelf(tmNode* aNode)
+{
+  mIndex = aNode->mIndex;
+  strcpy(mLabel, aNode->mLabel);
+  mLoc = aNode->mLoc;
+  mDepth = aNode->mDepth;
+  mElevation = aNode->mElevation;
+  mIsLeafNode = aNode->mIsLeafNode;
+  mIsSubNode = aNode->mIsSubNode;
+  mIsBorderNode = aNode->mIsBorderNode;
+  mIsPinnedNode = aNode->mIsPinnedNode;
+  mIsPolygonNode = aNode->mIsPolygonNode;
+  mIsJunctionNode = aNode->mIsJunctionNode;
+  mIsConditionedNode = aNode->mIsConditionedNode;
+  mTree->CopyPtrArray(mEdges, aNode->mEdges);
+  mTree->CopyPtrArray(mLeafPaths, aNode->mLeafPaths);
+  mTree->CopyPtrArray(mOwnedVertices, aNode->mOwnedVertices);
+  mTree->CopyOwnerPtr(mNodeOwner, aNode->mNodeOwner);
+}
+
+
 /*****
 Put a tmNode to a file in version 4 format. Note that we do not put any
 polys, vertices, or creases.
@@ -485,7 +513,37 @@ void tmNode::Getv3Self(istream& is)
 }
 
 
+/*****
+Put a tmNode in compact version 5 format. Only tree nodes are put this way,
+and only their label and location are not derived from something else.
+*****/
+void tmNode::Putv5CompactSelf(ostream& os)
+{
+  TMASSERT(!mIsSubNode);
+  PutPOD(os, GetTagStr());
+  PutPOD(os, mLabel);
+  PutPOD(os, mLoc);
+}
+
+
+/*****
+Get a tmNode in compact version 5 format. The node is owned by the tree; its
+edges register themselves as they are read.
+*****/
+void tmNode::Getv5CompactSelf(istream& is)
+{
+  CheckTagStr<tmNode>(is);
+  GetPOD(is, mLabel);
+  GetPOD(is, mLoc);
+  
+  // Set ownership
+  mTree->mOwnedNodes.push_back(this);
+  mNodeOwner = mTree;
+}
+
+
 /*****
 Dynamic type implementation
 *****/
 TM_IMPLEMENT_TAG(tmNode, "node")
+TM_IMPLEMENT_POOL(tmNode)
@@ -167,6 +167,11 @@ private:
   tmDpptrArray<tmEdge> mEdges;
   tmDpptrArray<tmPath> mLeafPaths;
   
+  // Position in a depth-first tour of the tree, and the last position of the
+  // nodes below this one (see tmTree::CalcTreeTour())
+  std::size_t mTourEnter;
+  std::size_t mTourExit;
+  
   // owner
   tmNodeOwner* mNodeOwner;
   
@@ -193,10 +198,18 @@ private:
   void Putv4Self(std::ostream& os);
   void Getv4Self(std::istream& is);
   void Getv3Self(std::istream& is);
+  void Putv5CompactSelf(std::ostream& os);
+  void Getv5CompactSelf(std::istream& is);
+  
+  // Structural copy
+  void CopySelf(tmNode* aNode);
   
   // Class tag for stream I/O
   TM_DECLARE_TAG()
   
+  // Memory comes from a pool
+  TM_DECLARE_POOL()
+  
   // Friend classes
   friend class tmPart;
   friend class tmPart::StringT<tmNode>;
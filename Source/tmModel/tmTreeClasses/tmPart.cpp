@@ -11,6 +11,9 @@ Copyright:    ©2003 Robert J. Lang. All Rights Reserved.
 #include "tmPart.h"
 #include "tmModel.h"
 
+#include <new>
+#include <cstdint>
+
 using namespace std;
 
 /*  
@@ -669,6 +672,206 @@ void tmPart::InitTypes()
 #endif
 
 
+/**********
+class tmPartPool
+Slab allocator for the parts of a tree.
+**********/
+
+/*****
+Constructor. Register the pool so that its statistics can be reported.
+*****/
+tmPartPool::tmPartPool(const char* aName)
+  : mName(aName), mNumAllocs(0), mNumLive(0), mNumSlabs(0), mNumSlabAllocs(0)
+{
+  GetPoolList().push_back(this);
+}
+
+
+/*****
+Return memory for an object of the given size. Take it from the first slab
+with free room: a previously freed object if there is one, otherwise the next
+never-used object in the slab.
+*****/
+void* tmPartPool::Allocate(size_t size)
+{
+  ++mNumAllocs;
+  ++mNumLive;
+  SizeClass* sc = GetSizeClass(size);
+  if (!sc) return ::operator new(size);
+  Slab* s = sc->mFirst;
+  if (!s) {
+    if (sc->mSpare) {
+      s = sc->mSpare;
+      sc->mSpare = 0;
+    }
+    else s = NewSlab(sc);
+    LinkSlab(sc, s);
+  }
+  void* p;
+  if (s->mFree) {
+    p = s->mFree;
+    s->mFree = *static_cast<void**>(p);
+  }
+  else {
+    p = s->GetObjects() + s->mNumCarved * sc->mSize;
+    ++s->mNumCarved;
+  }
+  ++s->mNumLive;
+  if (s->mNumLive == sc->mCapacity) UnlinkSlab(sc, s);
+  return p;
+}
+
+
+/*****
+Give back memory for an object of the given size. The slab that holds it is
+found from the address alone, since slabs are aligned to their size. An empty
+slab is kept as the spare if there isn't one yet, otherwise it's released.
+*****/
+void tmPartPool::Free(void* p, size_t size)
+{
+  if (!p) return;
+  --mNumLive;
+  if (size_t(size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT > MAX_SIZE) {
+    ::operator delete(p);
+    return;
+  }
+  Slab* s = reinterpret_cast<Slab*>(
+    reinterpret_cast<uintptr_t>(p) & ~uintptr_t(SLAB_SIZE - 1));
+  SizeClass* sc = s->mClass;
+  TMASSERT(s->mNumLive > 0);
+  if (s->mNumLive == sc->mCapacity) LinkSlab(sc, s);
+  *static_cast<void**>(p) = s->mFree;
+  s->mFree = p;
+  --s->mNumLive;
+  if (s->mNumLive != 0) return;
+  UnlinkSlab(sc, s);
+  if (sc->mSpare) {
+    DeleteSlab(s);
+    return;
+  }
+  // Start the spare afresh so that objects are handed out in address order.
+  s->mFree = 0;
+  s->mNumCarved = 0;
+  sc->mSpare = s;
+}
+
+
+/*****
+Return the size class for objects of the given size, creating it if needed.
+Return a null pointer for objects too big to pool.
+*****/
+tmPartPool::SizeClass* tmPartPool::GetSizeClass(size_t size)
+{
+  size = (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+  if (size > MAX_SIZE) return 0;
+  for (size_t i = 0; i < mSizeClasses.size(); ++i)
+    if (mSizeClasses[i]->mSize == size) return mSizeClasses[i];
+  SizeClass* sc = new SizeClass;
+  sc->mSize = size;
+  size_t header = (sizeof(Slab) + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+  sc->mCapacity = (SLAB_SIZE - header) / size;
+  sc->mFirst = 0;
+  sc->mSpare = 0;
+  mSizeClasses.push_back(sc);
+  return sc;
+}
+
+
+/*****
+Return a pointer to the first object in the slab, which follows the header.
+*****/
+char* tmPartPool::Slab::GetObjects()
+{
+  return reinterpret_cast<char*>(this) +
+    (sizeof(Slab) + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+
+/*****
+Get a new slab from the heap.
+*****/
+tmPartPool::Slab* tmPartPool::NewSlab(SizeClass* sc)
+{
+  Slab* s = static_cast<Slab*>(
+    ::operator new(SLAB_SIZE, align_val_t(SLAB_SIZE)));
+  s->mClass = sc;
+  s->mPrev = s->mNext = 0;
+  s->mFree = 0;
+  s->mNumLive = 0;
+  s->mNumCarved = 0;
+  ++mNumSlabs;
+  ++mNumSlabAllocs;
+  return s;
+}
+
+
+/*****
+Give a slab back to the heap.
+*****/
+void tmPartPool::DeleteSlab(Slab* s)
+{
+  ::operator delete(s, align_val_t(SLAB_SIZE));
+  --mNumSlabs;
+}
+
+
+/*****
+STATIC
+Add a slab to the end of the list of slabs with free room. Adding at the end
+means we finish filling the slabs we already have before going back to a slab
+that has just had an object freed.
+*****/
+void tmPartPool::LinkSlab(SizeClass* sc, Slab* s)
+{
+  s->mNext = 0;
+  if (!sc->mFirst) {
+    s->mPrev = s;
+    sc->mFirst = s;
+    return;
+  }
+  // mFirst->mPrev points at the last slab in the list.
+  Slab* last = sc->mFirst->mPrev;
+  last->mNext = s;
+  s->mPrev = last;
+  sc->mFirst->mPrev = s;
+}
+
+
+/*****
+STATIC
+Remove a slab from the list of slabs with free room.
+*****/
+void tmPartPool::UnlinkSlab(SizeClass* sc, Slab* s)
+{
+  if (s == sc->mFirst) {
+    sc->mFirst = s->mNext;
+    if (sc->mFirst) sc->mFirst->mPrev = s->mPrev;
+  }
+  else {
+    s->mPrev->mNext = s->mNext;
+    if (s->mNext) s->mNext->mPrev = s->mPrev;
+    else sc->mFirst->mPrev = s->mPrev;
+  }
+  s->mPrev = s->mNext = 0;
+}
+
+
+/*****
+STATIC
+Return the list of all pools that have been created.
+*****/
+vector<tmPartPool*>& tmPartPool::GetPoolList()
+{
+  static vector<tmPartPool*>* sPools = new vector<tmPartPool*>();
+  return *sPools;
+}
+
+
+#ifdef __MWERKS__
+  #pragma mark -
+#endif
+
+
 #if 0 // not needed, just for illustration
 /*
 This snippet illustrates how to use the tmPart::MakeTypeArray<R, G<T> >()
@@ -22,6 +22,7 @@ Copyright:    ©2003 Robert J. Lang. All Rights Reserved.
 #include "tmModel_fwd.h"
 #include "tmArray.h"
 #include "tmPoint.h"
+#include "tmPartPool.h"
 
 /**********
 Dynamic type system macros
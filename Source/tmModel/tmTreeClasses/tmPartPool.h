@@ -0,0 +1,140 @@
+/*******************************************************************************
+File:         tmPartPool.h
+Project:      TreeMaker 5.x
+Purpose:      Header file for class tmPartPool
+Author:       Robert J. Lang
+Modified by:
+Created:      2026-10-19
+Copyright:    ©2026 Robert J. Lang. All Rights Reserved.
+*******************************************************************************/
+
+#ifndef _TMPARTPOOL_H_
+#define _TMPARTPOOL_H_
+
+// Common TreeMaker header
+#include "tmHeader.h"
+
+// Standard libraries
+#include <vector>
+
+/*
+Building a crease pattern creates and destroys hundreds of thousands of small
+parts (paths, polys, vertices, creases, facets), each one a separate trip to
+the general-purpose heap. Each part class that declares TM_DECLARE_POOL() in its
+class declaration and TM_IMPLEMENT_POOL() in its implementation file instead
+gets its memory from its own tmPartPool.
+
+A tmPartPool carves objects out of large, aligned slabs. Objects of a given
+size that are created one after the other (as the parts of a freshly built
+crease pattern are, in index order) lie next to each other in memory, which
+makes walking the lists of a tmCluster cache-friendly. When the last object in
+a slab is destroyed the whole slab is given back (one empty slab per size is
+kept for reuse), so wiping a tree releases its memory slab by slab rather than
+object by object. A pool keeps a separate set of slabs for each object size,
+so a base class like tmCondition can serve all of its subclasses.
+
+Pools are per part class, shared by all trees, and live for the rest of the
+program. Like the rest of the model they are not thread-safe. Define
+TM_PART_POOLS as 0 to fall back on the ordinary heap (e.g., when hunting memory
+errors with a tool that needs to see each allocation).
+*/
+
+#ifndef TM_PART_POOLS
+  #define TM_PART_POOLS 1
+#endif
+
+
+/**********
+class tmPartPool
+Slab allocator for the parts of a tree.
+**********/
+class tmPartPool {
+public:
+  tmPartPool(const char* aName);
+
+  // Allocation
+  void* Allocate(std::size_t size);
+  void Free(void* p, std::size_t size);
+
+  // Statistics
+  const char* GetName() const {return mName;};
+  std::size_t GetNumAllocs() const {return mNumAllocs;};
+  std::size_t GetNumLive() const {return mNumLive;};
+  std::size_t GetNumSlabs() const {return mNumSlabs;};
+  std::size_t GetNumSlabAllocs() const {return mNumSlabAllocs;};
+  static const std::vector<tmPartPool*>& GetPools() {return GetPoolList();};
+private:
+  enum {
+    SLAB_SIZE = 65536,    // bytes per slab, also the alignment of slabs
+    ALIGNMENT = 16,       // alignment of objects within a slab
+    MAX_SIZE = 4096       // larger objects go straight to the heap
+  };
+  struct Slab;
+  struct SizeClass {
+    std::size_t mSize;      // rounded object size
+    std::size_t mCapacity;  // number of objects per slab
+    Slab* mFirst;           // slabs with free room, doubly linked
+    Slab* mSpare;           // an empty slab kept for reuse
+  };
+  struct Slab {
+    SizeClass* mClass;      // the size class that owns this slab
+    Slab* mPrev;            // links in the list of slabs with free room
+    Slab* mNext;
+    void* mFree;            // singly linked list of freed objects
+    std::size_t mNumLive;   // number of objects in use
+    std::size_t mNumCarved; // number of objects ever handed out
+    char* GetObjects();
+  };
+
+  const char* mName;
+  std::vector<SizeClass*> mSizeClasses;
+  std::size_t mNumAllocs;       // total number of objects allocated
+  std::size_t mNumLive;         // number of objects in use
+  std::size_t mNumSlabs;        // number of slabs held
+  std::size_t mNumSlabAllocs;   // total number of slabs obtained from the heap
+
+  SizeClass* GetSizeClass(std::size_t size);
+  Slab* NewSlab(SizeClass* sc);
+  void DeleteSlab(Slab* s);
+  static void LinkSlab(SizeClass* sc, Slab* s);
+  static void UnlinkSlab(SizeClass* sc, Slab* s);
+  static std::vector<tmPartPool*>& GetPoolList();
+
+  // not copyable
+  tmPartPool(const tmPartPool&);
+  tmPartPool& operator=(const tmPartPool&);
+};
+
+
+/*****
+Declaration. Gives a tmPart subclass (and its descendants) class-specific
+allocation from a tmPartPool.
+*****/
+#if TM_PART_POOLS
+  #define TM_DECLARE_POOL() \
+  public:\
+    static void* operator new(std::size_t size) {\
+      return GetPool().Allocate(size);};\
+    static void operator delete(void* p, std::size_t size) {\
+      GetPool().Free(p, size);};\
+    static tmPartPool& GetPool();
+#else
+  #define TM_DECLARE_POOL()
+#endif // TM_PART_POOLS
+
+
+/*****
+Implementation. The pool is created on first use and never destroyed, so that
+parts of trees that outlive static destruction can still be freed.
+*****/
+#if TM_PART_POOLS
+  #define TM_IMPLEMENT_POOL(PART_CLASS) \
+  tmPartPool& PART_CLASS::GetPool() {\
+    static tmPartPool* sPool = new tmPartPool(#PART_CLASS);\
+    return *sPool;}
+#else
+  #define TM_IMPLEMENT_POOL(PART_CLASS)
+#endif // TM_PART_POOLS
+
+
+#endif // _TMPARTPOOL_H_
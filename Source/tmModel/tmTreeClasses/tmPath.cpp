@@ -260,15 +260,38 @@ Calculate all of the length-like member variables for this tree path. Also set
 whether the path is valid and/or active based on the calculated lengths.
 *****/
 void tmPath::TreePathCalcLengths()
+{
+  TreePathCalcMinTreeLength();
+  TreePathCalcPaperLengths();
+}
+
+
+/*****
+Compute the minimum length of this tree path based on the lengths of its edges
+and any strain that is present. tmTree::CalcTreePathLengths() relies on the
+sum being taken in the same order every time.
+*****/
+void tmPath::TreePathCalcMinTreeLength()
 {
   // Only call this for tree paths.
   TMASSERT(IsTreePath());
   
-  // compute the minimum length of each path based on the lengths of its edges 
-  // and any strain that is present
   mMinTreeLength = 0.0;
   for (size_t i = 0; i < mEdges.size(); ++i)
     mMinTreeLength += mEdges[i]->GetStrainedLength();
+}
+
+
+/*****
+Calculate the length-like member variables of this tree path that follow from
+its minimum tree length, the scale and the locations of its nodes, and set
+whether the path is valid and/or active.
+*****/
+void tmPath::TreePathCalcPaperLengths()
+{
+  // Only call this for tree paths.
+  TMASSERT(IsTreePath());
+  
   mMinPaperLength = mMinTreeLength * mTree->mScale;
   
   // compute the actual length of the path, based on the coordinates of its
@@ -675,6 +698,38 @@ void tmPath::Getv5Self(istream& is)
 }
 
 
+/*****
+Copy a tmPath of another tree. References to parts are remapped by index.
+*****/
+void tmPath::CopySelf(tmPath* aPath)
+{
+  mIndex = aPath->mIndex;
+  mMinTreeLength = aPath->mMinTreeLength;
+  mMinPaperLength = aPath->mMinPaperLength;
+  mActTreeLength = aPath->mActTreeLength;
+  mActPaperLength = aPath->mActPaperLength;
+  mIsLeafPath = aPath->mIsLeafPath;
+  mIsSubPath = aPath->mIsSubPath;
+  mIsFeasiblePath = aPath->mIsFeasiblePath;
+  mIsActivePath = aPath->mIsActivePath;
+  mIsBorderPath = aPath->mIsBorderPath;
+  mIsPolygonPath = aPath->mIsPolygonPath;
+  mIsConditionedPath = aPath->mIsConditionedPath;
+  mTree->CopyPtr(mFwdPoly, aPath->mFwdPoly);
+  mTree->CopyPtr(mBkdPoly, aPath->mBkdPoly);
+  mTree->CopyPtrArray(mNodes, aPath->mNodes);
+  mTree->CopyPtrArray(mEdges, aPath->mEdges);
+  mTree->CopyPtr(mOutsetPath, aPath->mOutsetPath);
+  mFrontReduction = aPath->mFrontReduction;
+  mBackReduction = aPath->mBackReduction;
+  mMinDepth = aPath->mMinDepth;
+  mMinDepthDist = aPath->mMinDepthDist;
+  mTree->CopyPtrArray(mOwnedVertices, aPath->mOwnedVertices);
+  mTree->CopyPtrArray(mOwnedCreases, aPath->mOwnedCreases);
+  mTree->CopyOwnerPtr(mPathOwner, aPath->mPathOwner);
+}
+
+
 /*****
 Put a tmPath in version 4 format. Note that we do not put any
 polys, vertices, or creases.
@@ -789,3 +844,4 @@ void tmPath::Getv3Self(istream& is)
 Dynamic type implementation
 *****/
 TM_IMPLEMENT_TAG(tmPath, "path")
+TM_IMPLEMENT_POOL(tmPath)
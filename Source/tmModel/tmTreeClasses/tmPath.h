@@ -243,6 +243,8 @@ private:
 
   // Miscellaneous utilities
   void TreePathCalcLengths();
+  void TreePathCalcMinTreeLength();
+  void TreePathCalcPaperLengths();
   static bool TestIsFeasible(const tmFloat& actLen, const tmFloat& minLen);
   static bool TestIsActive(const tmFloat& actLen, const tmFloat& minLen);
   bool StartsOrEndsWith(tmNode* aNode) const;
@@ -267,9 +269,15 @@ private:
   void Getv4Self(std::istream& is);
   void Getv3Self(std::istream& is);
   
+  // Structural copy
+  void CopySelf(tmPath* aPath);
+  
   // Class tag for stream I/O
   TM_DECLARE_TAG()
   
+  // Memory comes from a pool
+  TM_DECLARE_POOL()
+  
   // Friend classes
   friend class tmDpptrArray<tmPath>;
   friend class tmPart;
@@ -10,6 +10,7 @@ Copyright:    ©2003 Robert J. Lang. All Rights Reserved.
 
 #include "tmPoly.h"
 #include "tmModel.h"
+#include "tmProfiler.h"
 
 #ifdef TMDEBUG
   #include <fstream>
@@ -142,19 +143,22 @@ Return the nodes and edges in the subtree spanned by this poly.
 *****/
 void tmPoly::GetSubTree(tmArray<tmNode*>& nlist, tmArray<tmEdge*>& elist) const
 {
-  nlist.clear();
-  elist.clear();
+  // Ring paths overlap heavily, so we accumulate in indexed lists.
+  tmIndexedArray<tmNode*> nodes;
+  tmIndexedArray<tmEdge*> edges;
   for (size_t i = 0; i < mRingPaths.size(); ++i) {
     tmPath* thePath = mRingPaths[i];
     for (size_t j = 0; j < thePath->mEdges.size(); ++j) {
       tmEdge* theEdge = thePath->mEdges[j];
-      if (!elist.contains(theEdge)) {
-        elist.push_back(theEdge);
-        nlist.union_with(theEdge->mNodes.front());
-        nlist.union_with(theEdge->mNodes.back());
+      if (!edges.contains(theEdge)) {
+        edges.push_back(theEdge);
+        nodes.union_with(theEdge->mNodes.front());
+        nodes.union_with(theEdge->mNodes.back());
       }
     }
   }
+  nlist = nodes;
+  elist = edges;
 }
 
 
@@ -662,6 +666,7 @@ tmPoly (nothing will happen).
 *****/
 void tmPoly::BuildPolyContents()
 {
+  TM_PROFILE_SCOPE("tmPoly::BuildPolyContents");
   // If this tmPoly already contains any inset nodes, it's already been built
   // and we can stop here.
   if (HasPolyContents()) return;
@@ -1231,7 +1236,7 @@ void tmPoly::CalcBend()
   
   // Make a list of all vertices in this polygon. Collect them from the interior
   // creases, then add in the corners of the polygon.
-  tmArray<tmVertex*> allVertices;
+  tmIndexedArray<tmVertex*> allVertices;
   for (size_t i = 0; i < mOwnedCreases.size(); ++i)
     allVertices.union_with(mOwnedCreases[i]->mVertices);
   for (size_t i = 0; i < mRingNodes.size(); ++i)
@@ -1458,6 +1463,32 @@ void tmPoly::Getv5Self(istream& is)
 }
 
 
+/*****
+Copy a poly of another tree
+*****/
+void tmPoly::CopySelf(tmPoly* aPoly)
+{
+  mIndex = aPoly->mIndex;
+  mCentroid = aPoly->mCentroid;
+  mIsSubPoly = aPoly->mIsSubPoly;
+  mTree->CopyPtrArray(mRingNodes, aPoly->mRingNodes);
+  mTree->CopyPtrArray(mRingPaths, aPoly->mRingPaths);
+  mTree->CopyPtrArray(mCrossPaths, aPoly->mCrossPaths);
+  mTree->CopyPtrArray(mInsetNodes, aPoly->mInsetNodes);
+  mTree->CopyPtrArray(mSpokePaths, aPoly->mSpokePaths);
+  mTree->CopyPtr(mRidgePath, aPoly->mRidgePath);
+  mNodeLocs = aPoly->mNodeLocs;
+  mTree->CopyPtrArray(mLocalRootVertices, aPoly->mLocalRootVertices);
+  mTree->CopyPtrArray(mLocalRootCreases, aPoly->mLocalRootCreases);
+  mTree->CopyPtrArray(mOwnedNodes, aPoly->mOwnedNodes);
+  mTree->CopyPtrArray(mOwnedPaths, aPoly->mOwnedPaths);
+  mTree->CopyPtrArray(mOwnedPolys, aPoly->mOwnedPolys);
+  mTree->CopyPtrArray(mOwnedCreases, aPoly->mOwnedCreases);
+  mTree->CopyPtrArray(mOwnedFacets, aPoly->mOwnedFacets);
+  mTree->CopyOwnerPtr(mPolyOwner, aPoly->mPolyOwner);
+}
+
+
 /*****
 Put a poly in version 4 format
 *****/
@@ -1495,3 +1526,4 @@ void tmPoly::Getv4Self(istream& is)
 Dynamic type implementation
 *****/
 TM_IMPLEMENT_TAG(tmPoly, "poly")
+TM_IMPLEMENT_POOL(tmPoly)
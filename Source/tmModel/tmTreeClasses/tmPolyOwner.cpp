@@ -20,6 +20,170 @@ Similarly, when a tmPoly is deleted, it tells its owner, which removes it from
 the list.
 */
 
+/**********
+class tmPolyPathGrid
+A uniform grid over the polygon paths of BuildPolysFromPaths(), used to find
+the already-accepted paths that a new path might cross without testing it
+against all of them.
+**********/
+class tmPolyPathGrid {
+public:
+  tmPolyPathGrid(const tmArray<tmPath*>& aPathList);
+  void GetNeighbors(tmPath* aPath, tmArray<tmPath*>& neighbors);
+  void Add(tmPath* aPath);
+private:
+  tmPoint mMin;                     // lower left corner of the grid
+  tmFloat mCellSize;                // width and height of a cell
+  tmFloat mMargin;                  // how far paths are fattened
+  size_t mNumX;                     // number of columns
+  size_t mNumY;                     // number of rows
+  vector<vector<size_t> > mCells;   // accepted paths that touch each cell
+  vector<tmPath*> mPaths;           // accepted paths, in order of acceptance
+  vector<size_t> mStamps;           // last query that tested each path
+  size_t mStamp;                    // number of the current query
+  vector<size_t> mPathCells;        // cells touched by the current path
+  
+  size_t GetCol(tmFloat x) const;
+  size_t GetRow(tmFloat y) const;
+  void GetPathCells(tmPath* aPath);
+};
+
+
+/*****
+Constructor sizes the grid to the bounding box of the polygon paths in the
+list, with about one cell per path. If there are no such paths, or they're all
+degenerate, the grid is a single cell.
+*****/
+tmPolyPathGrid::tmPolyPathGrid(const tmArray<tmPath*>& aPathList)
+  : mCellSize(1.0), mMargin(0.0), mNumX(1), mNumY(1), mCells(1), mStamp(0)
+{
+  size_t numPaths = 0;
+  tmPoint maxPt;
+  for (size_t i = 0; i < aPathList.size(); ++i) {
+    tmPath* aPath = aPathList[i];
+    if (!aPath->IsPolygonPath()) continue;
+    const tmPoint& p = aPath->GetNodes().front()->GetLoc();
+    const tmPoint& q = aPath->GetNodes().back()->GetLoc();
+    if (numPaths == 0) mMin = maxPt = p;
+    mMin.x = min(mMin.x, min(p.x, q.x));
+    mMin.y = min(mMin.y, min(p.y, q.y));
+    maxPt.x = max(maxPt.x, max(p.x, q.x));
+    maxPt.y = max(maxPt.y, max(p.y, q.y));
+    ++numPaths;
+  }
+  if (numPaths == 0) return;
+  
+  // tmPath::IntersectsInterior() computes its intersection parameters from a
+  // cross product that may be as small as sqrt(epsilon), so a crossing it
+  // reports can lie a little way off either path (by about 1e-8 of the size
+  // of the design). Fattening every path by a margin much larger than that
+  // guarantees that two paths it says cross share at least one cell.
+  tmFloat size = max(maxPt.x - mMin.x, maxPt.y - mMin.y);
+  if (size <= 0) return;
+  mMargin = 1.0e-4 * size;
+  mMin -= tmPoint(mMargin, mMargin);
+  size += 2 * mMargin;
+  size_t numSide = size_t(ceil(sqrt(tmFloat(numPaths))));
+  mCellSize = size / numSide;
+  mNumX = 1 + size_t((maxPt.x + mMargin - mMin.x) / mCellSize);
+  mNumY = 1 + size_t((maxPt.y + mMargin - mMin.y) / mCellSize);
+  mNumX = min(mNumX, numSide);
+  mNumY = min(mNumY, numSide);
+  mCells.assign(mNumX * mNumY, vector<size_t>());
+}
+
+
+/*****
+Return the column that contains the given x coordinate, clamped to the grid.
+*****/
+size_t tmPolyPathGrid::GetCol(tmFloat x) const
+{
+  tmFloat c = (x - mMin.x) / mCellSize;
+  if (c <= 0) return 0;
+  return min(size_t(c), mNumX - 1);
+}
+
+
+/*****
+Return the row that contains the given y coordinate, clamped to the grid.
+*****/
+size_t tmPolyPathGrid::GetRow(tmFloat y) const
+{
+  tmFloat r = (y - mMin.y) / mCellSize;
+  if (r <= 0) return 0;
+  return min(size_t(r), mNumY - 1);
+}
+
+
+/*****
+Put the indices of all cells that come within mMargin of aPath into
+mPathCells. We walk the path a column at a time, so a long path touches only
+the cells along it rather than every cell of its bounding box.
+*****/
+void tmPolyPathGrid::GetPathCells(tmPath* aPath)
+{
+  mPathCells.clear();
+  tmPoint p = aPath->GetNodes().front()->GetLoc();
+  tmPoint q = aPath->GetNodes().back()->GetLoc();
+  if (p.x > q.x) swap(p, q);
+  size_t ix0 = GetCol(p.x - mMargin);
+  size_t ix1 = GetCol(q.x + mMargin);
+  for (size_t ix = ix0; ix <= ix1; ++ix) {
+    // Part of the path that lies within this column, widened by mMargin
+    tmFloat xa = max(p.x, mMin.x + ix * mCellSize - mMargin);
+    tmFloat xb = min(q.x, mMin.x + (ix + 1) * mCellSize + mMargin);
+    if (xa > xb) xa = xb = (xb < p.x) ? p.x : q.x;
+    tmFloat ya = p.y, yb = q.y;
+    if (q.x > p.x) {
+      tmFloat slope = (q.y - p.y) / (q.x - p.x);
+      ya = p.y + (xa - p.x) * slope;
+      yb = p.y + (xb - p.x) * slope;
+    }
+    if (ya > yb) swap(ya, yb);
+    size_t iy0 = GetRow(ya - mMargin);
+    size_t iy1 = GetRow(yb + mMargin);
+    for (size_t iy = iy0; iy <= iy1; ++iy)
+      mPathCells.push_back(iy * mNumX + ix);
+  }
+}
+
+
+/*****
+Put into neighbors each path added so far that shares a cell with aPath, once
+each. Any path that aPath crosses is among them. Leaves the cells of aPath in
+mPathCells for a following call to Add().
+*****/
+void tmPolyPathGrid::GetNeighbors(tmPath* aPath, tmArray<tmPath*>& neighbors)
+{
+  neighbors.clear();
+  GetPathCells(aPath);
+  ++mStamp;
+  for (size_t i = 0; i < mPathCells.size(); ++i) {
+    const vector<size_t>& cell = mCells[mPathCells[i]];
+    for (size_t j = 0; j < cell.size(); ++j) {
+      size_t k = cell[j];
+      if (mStamps[k] == mStamp) continue;
+      mStamps[k] = mStamp;
+      neighbors.push_back(mPaths[k]);
+    }
+  }
+}
+
+
+/*****
+Add aPath, which must be the path of the last call to GetNeighbors(), to the
+accepted paths.
+*****/
+void tmPolyPathGrid::Add(tmPath* aPath)
+{
+  size_t k = mPaths.size();
+  mPaths.push_back(aPath);
+  mStamps.push_back(0);
+  for (size_t i = 0; i < mPathCells.size(); ++i)
+    mCells[mPathCells[i]].push_back(k);
+}
+
+
 /**********
 class tmPolyOwner
 Base class for an object that owns polys and is responsible for their deletion.
@@ -74,8 +238,8 @@ bool tmPolyOwner::CanStartPolyFwd(tmPath* aPath, const tmPoint& centroid)
 {
   if (aPath->mFwdPoly != 0) return false;
   if (!aPath->IsBorderPath()) return true;
-  return AreCCW(aPath->mNodes.front()->mLoc, 
-    aPath->mNodes.back()->mLoc, centroid);
+  return AreCCW(aPath->GetNodes().front()->GetLoc(), 
+    aPath->GetNodes().back()->GetLoc(), centroid);
 }  
 
 
@@ -87,8 +251,8 @@ bool tmPolyOwner::CanStartPolyBkd(tmPath* aPath, const tmPoint& centroid)
 {
   if (aPath->mBkdPoly != 0) return false;
   if (!aPath->IsBorderPath()) return true;
-  return AreCW(aPath->mNodes.front()->mLoc, 
-    aPath->mNodes.back()->mLoc, centroid);
+  return AreCW(aPath->GetNodes().front()->GetLoc(), 
+    aPath->GetNodes().back()->GetLoc(), centroid);
 }  
 
 
@@ -162,21 +326,30 @@ void tmPolyOwner::BuildPolysFromPaths(tmArray<tmPath*>& aPathList,
   // rare, but if it happens, it screws our algorithm. Within slivers, we're
   // more concerned with consistency than precision, so we'll adopt the simple
   // expedient that as we build our list, we won't accept any polygon paths
-  // that intersect ones that already exist.
+  // that intersect ones that already exist. Rather than test each path
+  // against all of its predecessors, we only test it against the accepted
+  // paths that share a grid cell with it, which are the only ones it can
+  // cross; the paths we accept are the same.
   tmArray<tmPath*> polygonPaths;
+  tmPolyPathGrid pathGrid(aPathList);
+  tmArray<tmPath*> neighbors;
   size_t numIntersections = 0;
   for (size_t i = 0; i < aPathList.size(); ++i) {
     tmPath* aPath = aPathList[i];
     if (aPath->IsPolygonPath()) {
-      // Check for intersection against all preceding paths.
-      for (size_t j = 0; j < polygonPaths.size(); ++j) {
-        if (aPath->IntersectsInterior(polygonPaths[j])) {
+      // Check for intersection against all nearby preceding paths.
+      pathGrid.GetNeighbors(aPath, neighbors);
+      for (size_t j = 0; j < neighbors.size(); ++j) {
+        if (aPath->IntersectsInterior(neighbors[j])) {
           aPath->mIsPolygonPath = false;
           ++numIntersections;
           break;
         }
       }
-      if (aPath->IsPolygonPath()) polygonPaths.push_back(aPath);
+      if (aPath->IsPolygonPath()) {
+        polygonPaths.push_back(aPath);
+        pathGrid.Add(aPath);
+      }
     };
   }
   
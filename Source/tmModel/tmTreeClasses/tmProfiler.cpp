@@ -0,0 +1,348 @@
+/*******************************************************************************
+File:         tmProfiler.cpp
+Project:      TreeMaker 5.x
+Purpose:      Source file for the hierarchical profiler of profiling builds
+Author:       Robert J. Lang
+Modified by:
+Created:      2026-10-19
+Copyright:    ©2026 Robert J. Lang. All Rights Reserved.
+*******************************************************************************/
+
+#include "tmProfiler.h"
+
+#ifdef TMPROFILE
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+typedef chrono::steady_clock Clock;
+
+/*****
+A node of the tree of scopes: every distinct chain of nested scope names gets
+one, with the totals of all of its calls.
+*****/
+struct ProfileNode {
+  const char* mName;
+  size_t mDepth;
+  vector<size_t> mChildren;           // in the order they were first seen
+  map<string, size_t> mChildOf;       // ... and by name
+  size_t mCalls;
+  Clock::duration mTotal;
+  ProfileNode(const char* aName, size_t aDepth) : mName(aName),
+    mDepth(aDepth), mCalls(0), mTotal(Clock::duration::zero()) {};
+};
+
+
+/*****
+One timed scope, for the trace
+*****/
+struct ProfileEvent {
+  const char* mName;
+  size_t mThread;
+  Clock::time_point mStart;
+  Clock::duration mDuration;
+};
+
+
+/*****
+Everything we've recorded since the last Reset(). mNodes[0] is the root, which
+isn't itself a scope. Each Reset() starts a new generation; scopes that were
+open across it are dropped when they close.
+*****/
+struct ProfileState {
+  mutex mMutex;
+  vector<ProfileNode> mNodes;
+  vector<ProfileEvent> mEvents;
+  map<string, size_t> mCounters;
+  Clock::time_point mEpoch;
+  size_t mGeneration;
+  size_t mNumThreads;
+  ProfileState() : mEpoch(Clock::now()), mGeneration(0), mNumThreads(0) {
+    mNodes.push_back(ProfileNode("", 0));};
+};
+
+
+/*****
+A scope that's open on this thread
+*****/
+struct OpenScope {
+  size_t mNode;
+  size_t mGeneration;
+  Clock::time_point mStart;
+};
+
+
+/*****
+Return the one and only state. It's never destroyed, so that scopes that close
+during static destruction are harmless.
+*****/
+ProfileState& GetState()
+{
+  static ProfileState* sState = new ProfileState();
+  return *sState;
+}
+
+
+thread_local vector<OpenScope> tOpenScopes;   // open scopes on this thread
+thread_local size_t tThread = size_t(-1);     // this thread's number
+
+
+/*****
+Write a string with JSON escapes.
+*****/
+void WriteJSONString(ostream& os, const char* s)
+{
+  os << '"';
+  for (; *s; ++s) {
+    if (*s == '"' || *s == '\\') os << '\\' << *s;
+    else if ((unsigned char)(*s) < 0x20) os << ' ';
+    else os << *s;
+  }
+  os << '"';
+}
+
+
+/*****
+Return a duration in milliseconds.
+*****/
+double ToMs(Clock::duration d)
+{
+  return chrono::duration<double, milli>(d).count();
+}
+
+
+/*****
+Return a duration in microseconds, the unit of the trace format.
+*****/
+double ToUs(Clock::duration d)
+{
+  return chrono::duration<double, micro>(d).count();
+}
+
+
+/*****
+Return the width of the name column for node n and its descendants.
+*****/
+size_t GetNameWidth(const ProfileState& s, size_t n)
+{
+  const ProfileNode& node = s.mNodes[n];
+  size_t width = n == 0 ? 0 : 2 * (node.mDepth - 1) + strlen(node.mName);
+  for (size_t i = 0; i < node.mChildren.size(); ++i)
+    width = max(width, GetNameWidth(s, node.mChildren[i]));
+  return width;
+}
+
+
+/*****
+Write one line of the summary for node n and then its descendants.
+*****/
+void WriteSummaryNode(ostream& os, const ProfileState& s, size_t n,
+  size_t width)
+{
+  const ProfileNode& node = s.mNodes[n];
+  if (n != 0) {
+    Clock::duration self = node.mTotal;
+    for (size_t i = 0; i < node.mChildren.size(); ++i)
+      self -= s.mNodes[node.mChildren[i]].mTotal;
+    string name = string(2 * (node.mDepth - 1), ' ') + node.mName;
+    os << left << setw(int(width)) << name << right
+       << setw(10) << node.mCalls
+       << setw(12) << ToMs(node.mTotal)
+       << setw(12) << ToMs(self) << '\n';
+  }
+  for (size_t i = 0; i < node.mChildren.size(); ++i)
+    WriteSummaryNode(os, s, node.mChildren[i], width);
+}
+
+} // namespace
+
+
+/**********
+class tmProfiler
+Collects the timings and counts of a profiling build
+**********/
+
+/*****
+STATIC
+Open a scope with the given name on this thread.
+*****/
+void tmProfiler::Begin(const char* name)
+{
+  ProfileState& s = GetState();
+  {
+    lock_guard<mutex> lock(s.mMutex);
+    if (tThread == size_t(-1)) tThread = s.mNumThreads++;
+    size_t parent = 0;
+    if (!tOpenScopes.empty() &&
+      tOpenScopes.back().mGeneration == s.mGeneration)
+      parent = tOpenScopes.back().mNode;
+    map<string, size_t>::iterator it = s.mNodes[parent].mChildOf.find(name);
+    size_t n;
+    if (it != s.mNodes[parent].mChildOf.end()) n = it->second;
+    else {
+      n = s.mNodes.size();
+      s.mNodes.push_back(ProfileNode(name, s.mNodes[parent].mDepth + 1));
+      s.mNodes[parent].mChildren.push_back(n);
+      s.mNodes[parent].mChildOf[name] = n;
+    }
+    OpenScope scope = {n, s.mGeneration, Clock::time_point()};
+    tOpenScopes.push_back(scope);
+  }
+  // Start the clock last, so that the bookkeeping isn't charged to the scope.
+  tOpenScopes.back().mStart = Clock::now();
+}
+
+
+/*****
+STATIC
+Close the innermost open scope on this thread.
+*****/
+void tmProfiler::End()
+{
+  Clock::time_point now = Clock::now();
+  if (tOpenScopes.empty()) return;
+  OpenScope scope = tOpenScopes.back();
+  tOpenScopes.pop_back();
+  ProfileState& s = GetState();
+  lock_guard<mutex> lock(s.mMutex);
+  if (scope.mGeneration != s.mGeneration) return;
+  ProfileNode& node = s.mNodes[scope.mNode];
+  node.mCalls++;
+  node.mTotal += now - scope.mStart;
+  if (s.mEvents.size() < MAX_TRACE_EVENTS) {
+    ProfileEvent event = {node.mName, tThread, scope.mStart,
+      now - scope.mStart};
+    s.mEvents.push_back(event);
+  }
+}
+
+
+/*****
+STATIC
+Add n to the named counter.
+*****/
+void tmProfiler::Count(const char* name, size_t n)
+{
+  ProfileState& s = GetState();
+  lock_guard<mutex> lock(s.mMutex);
+  s.mCounters[name] += n;
+}
+
+
+/*****
+STATIC
+Forget everything recorded so far.
+*****/
+void tmProfiler::Reset()
+{
+  ProfileState& s = GetState();
+  lock_guard<mutex> lock(s.mMutex);
+  s.mNodes.clear();
+  s.mNodes.push_back(ProfileNode("", 0));
+  s.mEvents.clear();
+  s.mCounters.clear();
+  s.mEpoch = Clock::now();
+  s.mGeneration++;
+}
+
+
+/*****
+STATIC
+Write the tree of scopes as a table, with the number of calls, the total time
+and the time not spent in child scopes, followed by the counters.
+*****/
+void tmProfiler::WriteSummary(ostream& os)
+{
+  ProfileState& s = GetState();
+  lock_guard<mutex> lock(s.mMutex);
+  size_t width = max(GetNameWidth(s, 0), size_t(24)) + 2;
+  ios_base::fmtflags flags = os.flags();
+  streamsize precision = os.precision();
+  os << fixed << setprecision(3);
+  os << left << setw(int(width)) << "Scope" << right
+     << setw(10) << "Calls"
+     << setw(12) << "Total ms"
+     << setw(12) << "Self ms" << '\n';
+  WriteSummaryNode(os, s, 0, width);
+  if (!s.mCounters.empty()) {
+    os << '\n' << left << setw(int(width)) << "Counter" << right
+       << setw(10) << "Count" << '\n';
+    for (map<string, size_t>::const_iterator it = s.mCounters.begin();
+      it != s.mCounters.end(); ++it)
+      os << left << setw(int(width)) << it->first << right
+         << setw(10) << it->second << '\n';
+  }
+  if (s.mEvents.size() >= MAX_TRACE_EVENTS)
+    os << "(trace holds only the first " << MAX_TRACE_EVENTS << " scopes)\n";
+  os.flags(flags);
+  os.precision(precision);
+}
+
+
+/*****
+STATIC
+Write every recorded scope as a Chrome trace-event JSON document. The counters
+appear as counter events at the end of the trace.
+*****/
+void tmProfiler::WriteTrace(ostream& os)
+{
+  ProfileState& s = GetState();
+  lock_guard<mutex> lock(s.mMutex);
+  ios_base::fmtflags flags = os.flags();
+  streamsize precision = os.precision();
+  os << fixed << setprecision(3);
+  os << "{\"traceEvents\":[\n";
+  Clock::time_point last = s.mEpoch;
+  bool first = true;
+  for (size_t i = 0; i < s.mEvents.size(); ++i) {
+    const ProfileEvent& e = s.mEvents[i];
+    if (!first) os << ",\n";
+    first = false;
+    os << "{\"name\":";
+    WriteJSONString(os, e.mName);
+    os << ",\"cat\":\"tm\",\"ph\":\"X\",\"pid\":1,\"tid\":" << e.mThread
+       << ",\"ts\":" << ToUs(e.mStart - s.mEpoch)
+       << ",\"dur\":" << ToUs(e.mDuration) << "}";
+    last = max(last, e.mStart + e.mDuration);
+  }
+  for (map<string, size_t>::const_iterator it = s.mCounters.begin();
+    it != s.mCounters.end(); ++it) {
+    if (!first) os << ",\n";
+    first = false;
+    os << "{\"name\":";
+    WriteJSONString(os, it->first.c_str());
+    os << ",\"cat\":\"tm\",\"ph\":\"C\",\"pid\":1,\"tid\":0,\"ts\":"
+       << ToUs(last - s.mEpoch) << ",\"args\":{\"value\":" << it->second
+       << "}}";
+  }
+  os << "\n],\"displayTimeUnit\":\"ms\"}\n";
+  os.flags(flags);
+  os.precision(precision);
+}
+
+
+/*****
+STATIC
+Send the summary to the log.
+*****/
+void tmProfiler::LogSummary()
+{
+  stringstream ss;
+  ss << "Profile summary\n";
+  WriteSummary(ss);
+  TMLOG(ss.str());
+}
+
+#endif // TMPROFILE
@@ -0,0 +1,99 @@
+/*******************************************************************************
+File:         tmProfiler.h
+Project:      TreeMaker 5.x
+Purpose:      Header file for the hierarchical profiler of profiling builds
+Author:       Robert J. Lang
+Modified by:
+Created:      2026-10-19
+Copyright:    ©2026 Robert J. Lang. All Rights Reserved.
+*******************************************************************************/
+
+#ifndef _TMPROFILER_H_
+#define _TMPROFILER_H_
+
+// Common TreeMaker header
+#include "tmHeader.h"
+
+/*
+In profiling builds (#define TMPROFILE) the model times the stages of its hot
+paths -- each phase of tmTree::CleanupAfterEdit(), tmPoly::BuildPolyContents(),
+stub finding, reading and writing trees, and each outer and inner iteration of
+the ALM optimizer -- so that we can tell which stage is slow on a given file.
+Put
+
+  TM_PROFILE_SCOPE("name");
+
+at the top of a block to time it, and
+
+  TM_PROFILE_COUNT("name", n);
+
+to add n to a named counter. The name must be a string literal (or otherwise
+live for the rest of the program). Scopes nest: a scope opened while another
+is open on the same thread is recorded as its child, so the results form a
+tree. In other builds both macros compile to nothing.
+
+tmProfiler gathers the results. WriteSummary() writes a table of the tree with
+the number of calls and the total and self time of each node, plus the
+counters; LogSummary() sends the same table to TMLOG(), i.e., the log window
+in the GUI. WriteTrace() writes every timed scope, one event each, as a Chrome
+trace-event JSON file, which chrome://tracing or Perfetto will display as a
+timeline, one row per thread. Only the first MAX_TRACE_EVENTS events are kept
+for the trace; the summary counts them all. Scopes may be opened on any thread.
+*/
+
+#ifdef TMPROFILE
+
+// Standard libraries
+#include <cstddef>
+#include <iosfwd>
+
+
+/**********
+class tmProfiler
+Collects the timings and counts of a profiling build
+**********/
+class tmProfiler {
+public:
+  static const std::size_t MAX_TRACE_EVENTS = 1000000;
+
+  // Recording, normally through the macros below
+  static void Begin(const char* name);
+  static void End();
+  static void Count(const char* name, std::size_t n = 1);
+
+  // Results
+  static void Reset();
+  static void WriteSummary(std::ostream& os);
+  static void WriteTrace(std::ostream& os);
+  static void LogSummary();
+};
+
+
+/**********
+class tmProfileScope
+Times the lifetime of a block
+**********/
+class tmProfileScope {
+public:
+  tmProfileScope(const char* name) {tmProfiler::Begin(name);};
+  ~tmProfileScope() {tmProfiler::End();};
+private:
+  tmProfileScope(const tmProfileScope&);
+  tmProfileScope& operator=(const tmProfileScope&);
+};
+
+
+#define TM_PROFILE_JOIN2(a, b) a##b
+#define TM_PROFILE_JOIN(a, b) TM_PROFILE_JOIN2(a, b)
+#define TM_PROFILE_SCOPE(name) \
+  tmProfileScope TM_PROFILE_JOIN(tmProfileScope_, __LINE__)(name)
+#define TM_PROFILE_COUNT(name, n) tmProfiler::Count(name, n)
+
+#else
+
+#define TM_PROFILE_SCOPE(name)
+#define TM_PROFILE_COUNT(name, n)
+
+#endif // TMPROFILE
+
+#endif // _TMPROFILER_H_
@@ -10,11 +10,13 @@ Copyright:    ©2003 Robert J. Lang. All Rights Reserved.
 
 #include "tmTree.h"
 #include "tmModel.h"
+#include "tmProfiler.h"
 
 #ifdef TMDEBUG
   #include <fstream>
 #endif
 #include <algorithm>
+#include <vector>
 
 using namespace std;
 
@@ -404,6 +406,50 @@ void tmTree::GetCorridorFacets(const tmArray<tmEdge*>& edgeList,
 }
 
 
+/*****
+Preview the status of the leaf paths that would change if the given nodes were
+moved to the given locations, for feedback while the user is dragging nodes.
+Put into infeasiblePaths the leaf paths touching a moving node that would
+become (or stay) infeasible, and into activePaths those that would be active.
+Unlike SetNodeLocs(), this doesn't change the tree, so there's no cleanup; it
+takes time proportional to the number of moving nodes times the number of leaf
+nodes. Minimum path lengths are those of the last cleanup, which is correct as
+long as only node locations change.
+*****/
+void tmTree::GetDragPathStatus(const tmArray<const tmNode*>& movingNodes,
+  const tmArray<tmPoint>& newLocs, tmArray<tmPath*>& infeasiblePaths,
+  tmArray<tmPath*>& activePaths) const
+{
+  TMASSERT(movingNodes.size() == newLocs.size());
+  infeasiblePaths.clear();
+  activePaths.clear();
+  tmIndexedArray<const tmNode*> movingIndex(movingNodes);
+  for (size_t i = 0; i < movingNodes.size(); ++i) {
+    const tmNode* thisNode = movingNodes[i];
+    if (!thisNode->IsLeafNode()) continue;
+    for (size_t j = 0; j < thisNode->mLeafPaths.size(); ++j) {
+      tmPath* thePath = thisNode->mLeafPaths[j];
+      const tmNode* thatNode = thePath->mNodes.front();
+      if (thatNode == thisNode) thatNode = thePath->mNodes.back();
+      tmPoint thatLoc = thatNode->mLoc;
+      
+      // If both ends are moving, handle the path only once, from the end that
+      // comes first in the list.
+      size_t k = movingIndex.GetOffset(thatNode);
+      if (k != tmArray<const tmNode*>::BAD_OFFSET) {
+        if (k < i) continue;
+        thatLoc = newLocs[k];
+      }
+      tmFloat actLen = Mag(newLocs[i] - thatLoc);
+      if (!tmPath::TestIsFeasible(actLen, thePath->mMinPaperLength))
+        infeasiblePaths.push_back(thePath);
+      else if (tmPath::TestIsActive(actLen, thePath->mMinPaperLength))
+        activePaths.push_back(thePath);
+    }
+  }
+}
+
+
 #ifdef __MWERKS__
 #pragma mark -
 #endif
@@ -497,6 +543,145 @@ void tmTree::AddNode(tmNode* fromNode, const tmPoint& where,
 }
 
 
+/*****
+STATIC
+Return true if the edges in edgeList join the nodes of a list of numNodes
+nodes into a single tree, i.e., BuildTree() would accept them: there must be
+one fewer edge than nodes, every edge must refer to nodes in the list, and no
+edge may join two nodes that are already connected, which we track by merging
+sets of connected nodes.
+*****/
+bool tmTree::CanBuildTree(size_t numNodes, const vector<EdgeDesc>& edgeList)
+{
+  if (numNodes == 0) return edgeList.empty();
+  if (edgeList.size() != numNodes - 1) return false;
+  vector<size_t> parent(numNodes);
+  for (size_t i = 0; i < numNodes; ++i) parent[i] = i;
+  for (size_t i = 0; i < edgeList.size(); ++i) {
+    size_t n1 = edgeList[i].mNode1;
+    size_t n2 = edgeList[i].mNode2;
+    if (n1 >= numNodes || n2 >= numNodes) return false;
+    while (parent[n1] != n1) n1 = parent[n1] = parent[parent[n1]];
+    while (parent[n2] != n2) n2 = parent[n2] = parent[parent[n2]];
+    if (n1 == n2) return false;
+    parent[n1] = n2;
+  }
+  return true;
+}
+
+
+/*****
+Build a whole tree at once from a list of node locations and a list of edges,
+each of which refers to its nodes by their positions in nodeList. This does
+the work of one call to AddNode() per node, but creates each path directly
+rather than by searching all of the paths so far for ones to extend, and
+cleans up only once. The tree must be empty, and the edges must pass
+CanBuildTree(); if they don't, we throw EX_BAD_BUILD_TREE before changing
+anything. Return the new nodes and edges in the order given.
+
+To add conditions as well without a second cleanup, create them (with
+MakeOnePartCondition() and friends or the SetNodesFixed...() family) within
+the same tmTreeCleaner scope as the call to BuildTree().
+*****/
+void tmTree::BuildTree(const vector<NodeDesc>& nodeList,
+  const vector<EdgeDesc>& edgeList, tmArray<tmNode*>& newNodes,
+  tmArray<tmEdge*>& newEdges)
+{
+  TMASSERT(mNodes.empty());
+  if (!CanBuildTree(nodeList.size(), edgeList)) throw EX_BAD_BUILD_TREE();
+  newNodes.clear();
+  newEdges.clear();
+  size_t numNodes = nodeList.size();
+  if (numNodes == 0) return;
+  
+  tmTreeCleaner tc(this);
+  for (size_t i = 0; i < numNodes; ++i) {
+    tmNode* newNode = new tmNode(this, this, nodeList[i].mLoc);
+    strncpy(newNode->mLabel, nodeList[i].mLabel.c_str(), MAX_LABEL_LEN);
+    newNodes.push_back(newNode);
+  }
+  for (size_t i = 0; i < edgeList.size(); ++i) {
+    const EdgeDesc& theDesc = edgeList[i];
+    tmEdge* newEdge = new tmEdge(this, newNodes[theDesc.mNode1], 
+      newNodes[theDesc.mNode2], theDesc.mLength);
+    strncpy(newEdge->mLabel, theDesc.mLabel.c_str(), MAX_LABEL_LEN);
+    newEdge->mStrain = theDesc.mStrain;
+    newEdge->mStiffness = theDesc.mStiffness;
+    newEdges.push_back(newEdge);
+  }
+  MakeTreePaths();
+}
+
+
+/*****
+Create the path between every pair of nodes of a tree that has nodes and edges
+but no paths, and set which nodes and paths are leaves. Everything that
+depends on lengths or positions is left to cleanup. If the edges don't
+connect all of the nodes (which can only happen if they came from a damaged
+file), throw a EX_IO_BAD_REF_INDEX.
+*****/
+void tmTree::MakeTreePaths()
+{
+  TMASSERT(mOwnedPaths.empty());
+  size_t numNodes = mOwnedNodes.size();
+  for (size_t i = 0; i < numNodes; ++i) {
+    tmNode* theNode = mOwnedNodes[i];
+    theNode->mIsLeafNode = (theNode->mEdges.size() <= 1);
+    theNode->mLeafPaths.clear();
+  }
+  
+  // For each node, search the tree outward from it, recording the edge by
+  // which we first reach every other node. Walking those edges back from any
+  // node later in the list gives the path to it. Node indices are 1-based.
+  vector<tmEdge*> fromEdge(mNodes.size() + 1);
+  vector<tmNode*> reached;
+  vector<tmNode*> pathNodes;
+  vector<tmEdge*> pathEdges;
+  for (size_t i = 0; i < numNodes; ++i) {
+    tmNode* startNode = mOwnedNodes[i];
+    fill(fromEdge.begin(), fromEdge.end(), (tmEdge*)(0));
+    reached.clear();
+    reached.push_back(startNode);
+    for (size_t k = 0; k < reached.size(); ++k) {
+      tmNode* theNode = reached[k];
+      for (size_t ie = 0; ie < theNode->mEdges.size(); ++ie) {
+        tmEdge* theEdge = theNode->mEdges[ie];
+        tmNode* otherNode = theEdge->GetOtherNode(theNode);
+        if (otherNode == startNode || fromEdge[otherNode->mIndex]) continue;
+        fromEdge[otherNode->mIndex] = theEdge;
+        reached.push_back(otherNode);
+      }
+    }
+    if (reached.size() != numNodes)
+      throw EX_IO_BAD_REF_INDEX("disconnected tree");
+    for (size_t j = i + 1; j < numNodes; ++j) {
+      tmNode* endNode = mOwnedNodes[j];
+      pathNodes.clear();
+      pathEdges.clear();
+      for (tmNode* theNode = endNode; theNode != startNode; ) {
+        tmEdge* theEdge = fromEdge[theNode->mIndex];
+        pathNodes.push_back(theNode);
+        pathEdges.push_back(theEdge);
+        theNode = theEdge->GetOtherNode(theNode);
+      }
+      pathNodes.push_back(startNode);
+      tmPath* newPath = new tmPath(this);
+      newPath->mPathOwner = this;
+      mOwnedPaths.push_back(newPath);
+      for (size_t k = pathNodes.size(); k > 0; --k)
+        newPath->mNodes.push_back(pathNodes[k - 1]);
+      for (size_t k = pathEdges.size(); k > 0; --k)
+        newPath->mEdges.push_back(pathEdges[k - 1]);
+      if (startNode->mIsLeafNode && endNode->mIsLeafNode) {
+        newPath->mIsLeafPath = true;
+        startNode->mLeafPaths.push_back(newPath);
+        endNode->mLeafPaths.push_back(newPath);
+      }
+    }
+  }
+}
+
+
 /*****
 Add a new tmNode along an edge, breaking the edge into two new edges. splitLoc
 is the distance (in tree units) along the edge, relative to the strained length
@@ -808,6 +993,7 @@ void tmTree::AbsorbEdge(tmEdge* aEdge)
   // Delete the absorbed node and edge.
   delete aEdge;
   delete killNode;
+  mIsTreeTourValid = false;
   
   // Update the leaf-ness of the kept node and its incident paths. Note that
   // absorbing an edge can convert a branch node into a leaf node or vice-versa,
@@ -987,10 +1173,15 @@ void tmTree::KillSomeNodesAndEdges(tmArray<tmNode*>& markedNodes,
   size_t pathsLeft = mOwnedPaths.size() - delPaths.size();
   if ((nodesLeft * (nodesLeft - 1)) / 2 != pathsLeft) throw EX_BAD_KILL_PARTS();
   
-  // Delete all of the marked parts.
-  for (size_t in = 0; in < delNodes.size(); ++in) delete delNodes[in];
-  for (size_t ie = 0; ie < delEdges.size(); ++ie) delete delEdges[ie];
-  for (size_t ip = 0; ip < delPaths.size(); ++ip) delete delPaths[ip];
+  // Delete all of the marked parts. The teardown defers the removal of the
+  // deleted parts from the lists that reference them until all are gone.
+  {
+    tmDpptrTeardown td;
+    for (size_t in = 0; in < delNodes.size(); ++in) delete delNodes[in];
+    for (size_t ie = 0; ie < delEdges.size(); ++ie) delete delEdges[ie];
+    for (size_t ip = 0; ip < delPaths.size(); ++ip) delete delPaths[ip];
+  }
+  mIsTreeTourValid = false;
   
   // Now go through the remaining parts and re-set the structural flags, i.e.,
   // the flags that indicate which nodes and paths are leaf. Also
@@ -1092,11 +1283,14 @@ void tmTree::KillSomeParts(tmArray<tmNode*>& markedNodes,
 
 
 /*****
-Kill all elements of the crease pattern.
+Kill all elements of the crease pattern. This is done within a teardown, so
+that the references among the dying parts are dropped in bulk rather than one
+at a time.
 *****/
 void tmTree::KillCreasePattern()
 {
   tmTreeCleaner tc(this);
+  tmDpptrTeardown td;
   mVertices.KillItems();
   mCreases.KillItems();
   mFacets.KillItems();
@@ -1112,6 +1306,7 @@ may be left behind, so we'll have to kill those, too.
 void tmTree::KillPolysAndCreasePattern()
 {
   tmTreeCleaner tc(this);
+  tmDpptrTeardown td;
   KillCreasePattern();
   mPolys.KillItems();
 }
@@ -1715,6 +1910,7 @@ for unoptimized or partially- optimized trees.
 *****/
 void tmTree::BuildTreePolys()
 {
+  TM_PROFILE_SCOPE("tmTree::BuildTreePolys");
   // BuildTreePolys() relies on the accuracy of various dimensional flags and
   // the validity of any existing polys; for this reason, it should only be
   // called for clean Trees (ones for which CleanupAfterEdit() has been
@@ -1750,6 +1946,7 @@ optimized trees.
 *****/
 void tmTree::BuildPolysAndCreasePattern()
 {
+  TM_PROFILE_SCOPE("tmTree::BuildPolysAndCreasePattern");
 #ifdef TMDEBUG
   // Debug builds record tree state at the beginning of this call for dumping
   // in case of assertion.
@@ -1906,6 +2103,10 @@ void tmTree::InitTree()
   mIsFacetDataValid = false;
   mIsLocalRootConnectable = false;
   mNeedsCleanup = false;
+  mIsTreeTourValid = false;
+  mHasUnverifiedState = false;
+  mHasStoredChecksum = false;
+  mStoredChecksum = 0;
   
 #ifdef TMDEBUG
   mQuitCleanupEarly = false;
@@ -1941,14 +2142,15 @@ tmTree::~tmTree()
 
 
 /*****
-Return a deep copy of this tree.
+Return a deep copy of this tree. This used to be done by putting the tree to a
+stringstream and getting it back; now the parts are copied directly, which
+gives the same structure (with floating-point values exact rather than rounded
+to the stream's precision) for a fraction of the cost.
 *****/
 tmTree* tmTree::Clone()
 {
-  stringstream ss;
-  PutSelf(ss);
   tmTree* theTree = new tmTree();
-  theTree->GetSelf(ss);
+  theTree->CopySelf(this);
   return theTree;
 }
 
@@ -1958,6 +2160,187 @@ tmTree* tmTree::Clone()
 #endif
 
 
+/*****
+Make this (blank) tree into a copy of aTree. This is the structural equivalent
+of aTree->Putv5Self() followed by Getv5Self(): we copy the same member data,
+and every reference to a part of aTree is replaced by the part of this tree
+with the same index. As in Getv5Self(), all parts except conditions are
+created blank first, in index order, so that references can be resolved as
+each part is copied.
+*****/
+void tmTree::CopySelf(tmTree* aTree)
+{
+  TMASSERT(GetNumAllParts() == 0);
+  mPaperWidth = aTree->mPaperWidth;
+  mPaperHeight = aTree->mPaperHeight;
+  mScale = aTree->mScale;
+  
+  mHasSymmetry = aTree->mHasSymmetry;
+  mSymLoc = aTree->mSymLoc;
+  mSymAngle = aTree->mSymAngle;
+  
+  mIsFeasible = aTree->mIsFeasible;
+  mIsPolygonValid = aTree->mIsPolygonValid;
+  mIsPolygonFilled = aTree->mIsPolygonFilled;
+  mIsVertexDepthValid = aTree->mIsVertexDepthValid;
+  mIsFacetDataValid = aTree->mIsFacetDataValid;
+  mIsLocalRootConnectable = aTree->mIsLocalRootConnectable;
+  mNeedsCleanup = aTree->mNeedsCleanup;
+  mIsTreeTourValid = false;
+  mHasUnverifiedState = aTree->mHasUnverifiedState;
+  mHasStoredChecksum = aTree->mHasStoredChecksum;
+  mStoredChecksum = aTree->mStoredChecksum;
+  
+  // Create blank parts, except conditions
+  size_t numNodes = aTree->mNodes.size();
+  size_t numEdges = aTree->mEdges.size();
+  size_t numPaths = aTree->mPaths.size();
+  size_t numPolys = aTree->mPolys.size();
+  size_t numVertices = aTree->mVertices.size();
+  size_t numCreases = aTree->mCreases.size();
+  size_t numFacets = aTree->mFacets.size();
+  mNodes.reserve(numNodes);
+  mEdges.reserve(numEdges);
+  mPaths.reserve(numPaths);
+  mPolys.reserve(numPolys);
+  mVertices.reserve(numVertices);
+  mCreases.reserve(numCreases);
+  mFacets.reserve(numFacets);
+  for (size_t i = 0; i < numNodes; ++i) new tmNode(this);
+  for (size_t i = 0; i < numEdges; ++i) new tmEdge(this);
+  for (size_t i = 0; i < numPaths; ++i) new tmPath(this);
+  for (size_t i = 0; i < numPolys; ++i) new tmPoly(this);
+  for (size_t i = 0; i < numVertices; ++i) new tmVertex(this);
+  for (size_t i = 0; i < numCreases; ++i) new tmCrease(this);
+  for (size_t i = 0; i < numFacets; ++i) new tmFacet(this);
+  
+  // Copy each part
+  for (size_t i = 0; i < numNodes; ++i) mNodes[i]->CopySelf(aTree->mNodes[i]);
+  for (size_t i = 0; i < numEdges; ++i) mEdges[i]->CopySelf(aTree->mEdges[i]);
+  for (size_t i = 0; i < numPaths; ++i) mPaths[i]->CopySelf(aTree->mPaths[i]);
+  for (size_t i = 0; i < numPolys; ++i) mPolys[i]->CopySelf(aTree->mPolys[i]);
+  for (size_t i = 0; i < numVertices; ++i) 
+    mVertices[i]->CopySelf(aTree->mVertices[i]);
+  for (size_t i = 0; i < numCreases; ++i) 
+    mCreases[i]->CopySelf(aTree->mCreases[i]);
+  for (size_t i = 0; i < numFacets; ++i) 
+    mFacets[i]->CopySelf(aTree->mFacets[i]);
+  
+  // Conditions are created as they are copied, and their owner (this tree)
+  // receives a pointer to each one.
+  for (size_t i = 0; i < aTree->mConditions.size(); ++i) 
+    CopyCondition(aTree->mConditions[i]);
+  
+  // Copy the lists of owned parts, except conditions
+  CopyPtrArray(mOwnedNodes, aTree->mOwnedNodes);
+  CopyPtrArray(mOwnedEdges, aTree->mOwnedEdges);
+  CopyPtrArray(mOwnedPaths, aTree->mOwnedPaths);
+  CopyPtrArray(mOwnedPolys, aTree->mOwnedPolys);
+}
+
+
+/*****
+Create a copy of a condition of another tree, polymorphically.
+*****/
+void tmTree::CopyCondition(tmCondition* aCondition)
+{
+  tmCondition* c = dynamic_cast<tmCondition*>(
+    tmPart::GetCreatorFns()[aCondition->GetTag()](this));
+  TMASSERT(c);
+  c->mIndex = aCondition->mIndex;
+  c->mIsFeasibleCondition = aCondition->mIsFeasibleCondition;
+  c->CopyRest(aCondition);
+}
+
+
+/*****
+Copy a tmNodeOwner*, which can be a tmPoly* or a tmTree*
+*****/
+void tmTree::CopyOwnerPtr(tmNodeOwner*& aNodeOwner, tmNodeOwner* const aOwner)
+{
+  if (tmPoly* aPoly = aOwner->NodeOwnerAsPoly())
+    aNodeOwner = CopyPtr(aPoly);
+  else
+    aNodeOwner = this;
+}
+
+
+/*****
+Copy a tmEdgeOwner*, which must be a tmTree*
+*****/
+void tmTree::CopyOwnerPtr(tmEdgeOwner*& aEdgeOwner, tmEdgeOwner* const)
+{
+  aEdgeOwner = this;
+}
+
+
+/*****
+Copy a tmPathOwner*, which can be a tmPoly* or a tmTree*
+*****/
+void tmTree::CopyOwnerPtr(tmPathOwner*& aPathOwner, tmPathOwner* const aOwner)
+{
+  if (tmPoly* aPoly = aOwner->PathOwnerAsPoly())
+    aPathOwner = CopyPtr(aPoly);
+  else
+    aPathOwner = this;
+}
+
+
+/*****
+Copy a tmPolyOwner*, which can be a tmPoly* or a tmTree*
+*****/
+void tmTree::CopyOwnerPtr(tmPolyOwner*& aPolyOwner, tmPolyOwner* const aOwner)
+{
+  if (tmPoly* aPoly = aOwner->PolyOwnerAsPoly())
+    aPolyOwner = CopyPtr(aPoly);
+  else
+    aPolyOwner = this;
+}
+
+
+/*****
+Copy a tmVertexOwner*, which can be a tmNode* or a tmPath*
+*****/
+void tmTree::CopyOwnerPtr(tmVertexOwner*& aVertexOwner, 
+  tmVertexOwner* const aOwner)
+{
+  if (tmNode* aNode = aOwner->VertexOwnerAsNode())
+    aVertexOwner = CopyPtr(aNode);
+  else
+    aVertexOwner = CopyPtr(aOwner->VertexOwnerAsPath());
+}
+
+
+/*****
+Copy a tmCreaseOwner*, which can be a tmPath* or a tmPoly*
+*****/
+void tmTree::CopyOwnerPtr(tmCreaseOwner*& aCreaseOwner, 
+  tmCreaseOwner* const aOwner)
+{
+  if (tmPoly* aPoly = aOwner->CreaseOwnerAsPoly())
+    aCreaseOwner = CopyPtr(aPoly);
+  else
+    aCreaseOwner = CopyPtr(aOwner->CreaseOwnerAsPath());
+}
+
+
+/*****
+Copy a tmFacetOwner*, which can only be a tmPoly*
+*****/
+void tmTree::CopyOwnerPtr(tmFacetOwner*& aFacetOwner, 
+  tmFacetOwner* const aOwner)
+{
+  tmPoly* aPoly = aOwner->FacetOwnerAsPoly();
+  TMASSERT(aPoly);
+  aFacetOwner = CopyPtr(aPoly);
+}
+
+
+#ifdef __MWERKS__
+#pragma mark -
+#endif
+
+
 /*****
 Recalculate the leafness of nodes and paths and each node's individual list of
 leaf paths.
@@ -2007,6 +2390,166 @@ TBD: use this one routine in all of the structural editing methods.
 #endif
 
 
+/*****
+Sort order used in finding the convex hull: left to right, and bottom to top
+among nodes with the same x.
+*****/
+class tmNodeLocLess {
+public:
+  bool operator()(tmNode* n1, tmNode* n2) const {
+    const tmPoint& p1 = n1->GetLoc();
+    const tmPoint& p2 = n2->GetLoc();
+    return (p1.x < p2.x) || (p1.x == p2.x && p1.y < p2.y);};
+};
+
+
+/*****
+Return true if, going counterclockwise around the hull, the node at b should be
+dropped in favor of going straight from a to c. Nodes are constrained by the
+sides of the paper, so there is a strong possibility that we'll have (nearly)
+collinear border nodes, and due to roundoff error one of them may lie a hair
+inside the hull. So, as seen from a, c must lie to the right of b by more than
+ConvexityTol() for b to be dropped; otherwise we keep b, the nearer of the two.
+*****/
+bool tmTree::IsHullConcave(const tmPoint& a, const tmPoint& b, 
+  const tmPoint& c)
+{
+  tmFloat theAngle = Angle(b - a) - Angle(c - a);
+  if (theAngle < -PI) theAngle += TWO_PI;
+  else if (theAngle >= PI) theAngle -= TWO_PI;
+  return theAngle > ConvexityTol();
+}
+
+
+/*****
+Number the nodes in the order of a depth-first tour of the tree from its first
+node, so that the nodes below any node n (taking the first node as the root)
+are those with n->mTourEnter < mTourEnter <= n->mTourExit. Then make the table
+of owned paths by the tour positions of their ends (see TourPathIndex()).
+*****/
+void tmTree::CalcTreeTour()
+{
+  mTourPaths.clear();
+  if (mOwnedNodes.empty()) return;
+  size_t tourPos = 0;
+  vector<pair<tmNode*, tmEdge*> > stack;   // node, and the edge we reached it by
+  vector<size_t> nextEdge;                 // next edge of each node to follow
+  stack.push_back(make_pair(mOwnedNodes[0], (tmEdge*)(0)));
+  nextEdge.push_back(0);
+  mOwnedNodes[0]->mTourEnter = tourPos;
+  while (!stack.empty()) {
+    tmNode* theNode = stack.back().first;
+    tmEdge* fromEdge = stack.back().second;
+    size_t& ie = nextEdge.back();
+    if (ie < theNode->mEdges.size()) {
+      tmEdge* theEdge = theNode->mEdges[ie++];
+      if (theEdge == fromEdge) continue;
+      tmNode* nextNode = theEdge->GetOtherNode(theNode);
+      nextNode->mTourEnter = ++tourPos;
+      stack.push_back(make_pair(nextNode, theEdge));
+      nextEdge.push_back(0);
+    }
+    else {
+      theNode->mTourExit = tourPos;
+      stack.pop_back();
+      nextEdge.pop_back();
+    }
+  }
+  mTourPaths.resize(mOwnedPaths.size());
+  for (size_t i = 0; i < mOwnedPaths.size(); ++i) {
+    tmPath* thePath = mOwnedPaths[i];
+    mTourPaths[TourPathIndex(thePath->mNodes.front()->mTourEnter,
+      thePath->mNodes.back()->mTourEnter)] = thePath;
+  }
+}
+
+
+/*****
+Set the minimum tree length of every owned path. Each path's length is the sum
+of the strained lengths of its edges, and summing every path from scratch
+costs the total length of all paths, which for a tree of N nodes is O(N^2)
+times its depth -- too much to spend on every cleanup when, as in most edits
+and every step of the strain optimizer, only a few edges have changed. So each
+edge remembers the strained length the paths were last summed with, and we
+only re-sum the paths that run through an edge whose length has changed.
+
+Those paths are the ones with exactly one end below the edge. In the tour of
+CalcTreeTour(), the nodes below an edge have consecutive tour positions, so we
+can list the paths directly from mTourPaths, which costs no more memory than
+the tree's own lists of paths. (A list of the paths through each edge would
+cost memory in proportion to the total length of all paths.) Each path is
+re-summed in the same order as always, so the result is exactly what a full
+recalculation would give.
+
+The tour is only valid while the tree's edges are unchanged. Every change in
+the topology creates or deletes an edge, and so clears mIsTreeTourValid (in
+tmEdge::InitEdge() or where the edges are deleted), and then we redo the tour
+here and sum every path.
+*****/
+void tmTree::CalcTreePathLengths()
+{
+  TM_PROFILE_SCOPE("tmTree::CalcTreePathLengths");
+  size_t numNodes = mOwnedNodes.size();
+  size_t numPaths = mOwnedPaths.size();
+  tmArray<tmNode*> lowerNodes;   // lower node of each changed edge
+  size_t numChanged = 0;         // paths through changed edges, with repeats
+  if (mIsTreeTourValid) {
+    for (size_t i = 0; i < mOwnedEdges.size(); ++i) {
+      tmEdge* theEdge = mOwnedEdges[i];
+      tmFloat theLength = theEdge->GetStrainedLength();
+      if (theLength == theEdge->mTreePathLength) continue;
+      theEdge->mTreePathLength = theLength;
+      tmNode* node1 = theEdge->mNodes.front();
+      tmNode* node2 = theEdge->mNodes.back();
+      tmNode* lowerNode =
+        node1->mTourEnter > node2->mTourEnter ? node1 : node2;
+      lowerNodes.push_back(lowerNode);
+      size_t numBelow = lowerNode->mTourExit - lowerNode->mTourEnter + 1;
+      numChanged += numBelow * (numNodes - numBelow);
+    }
+  }
+  
+  // If the tour is out of date or most paths have changed anyway, sum them
+  // all.
+  if (!mIsTreeTourValid || numChanged >= numPaths) {
+    if (!mIsTreeTourValid) CalcTreeTour();
+    for (size_t i = 0; i < mOwnedEdges.size(); ++i) {
+      tmEdge* theEdge = mOwnedEdges[i];
+      theEdge->mTreePathLength = theEdge->GetStrainedLength();
+    }
+    for (size_t i = 0; i < numPaths; ++i)
+      mOwnedPaths[i]->TreePathCalcMinTreeLength();
+    mIsTreeTourValid = true;
+    TM_PROFILE_COUNT("tree paths summed", numPaths);
+    return;
+  }
+  
+  // Otherwise sum just the paths from each node below a changed edge to each
+  // node not below it. A path that crosses more than one changed edge only
+  // needs to be summed once.
+  vector<bool> isSummed;
+  if (lowerNodes.size() > 1) isSummed.resize(mTourPaths.size(), false);
+  size_t numSummed = 0;
+  for (size_t i = 0; i < lowerNodes.size(); ++i) {
+    size_t lo = lowerNodes[i]->mTourEnter;
+    size_t hi = lowerNodes[i]->mTourExit;
+    for (size_t below = lo; below <= hi; ++below)
+      for (size_t other = 0; other < numNodes; ++other) {
+        if (other == lo) other = hi + 1;
+        if (other >= numNodes) break;
+        size_t ip = TourPathIndex(below, other);
+        if (!isSummed.empty()) {
+          if (isSummed[ip]) continue;
+          isSummed[ip] = true;
+        }
+        mTourPaths[ip]->TreePathCalcMinTreeLength();
+        ++numSummed;
+      }
+  }
+  TM_PROFILE_COUNT("tree paths summed", numSummed);
+}
+
+
 /*****
 Compute the border nodes (the convex hull) and border paths from the given list
 of leaf nodes. Set tmNode::mIsBorderNode and tmPath::mIsBorderPath flags of the
@@ -2014,75 +2557,102 @@ affected nodes and paths.
 *****/
 void tmTree::CalcBorderNodesAndPaths(tmArray<tmNode*>& leafNodes)
 {
+  TM_PROFILE_SCOPE("tmTree::CalcBorderNodesAndPaths");
   // we need at least 3 nodes present.
   if (leafNodes.size() < 3) return;
   
-  // First: we find a tmNode somewhere on the hull. We do this by picking a
-  // starting point that lies below and outside the paper; then look for the
-  // tmNode for which the angle of the line connecting it to the start point is
-  // minimized. This gives us a tmNode and a line tangent to the tmNode and, by
-  // extension, to the hull.
-  tmPoint startPt = tmPoint(-1., -1.);
-  tmFloat startAngle = TWO_PI;
-  tmNode* startNode = 0;
-  for (size_t i = 0; i < leafNodes.size(); ++i) {
-    tmNode* thisNode = leafNodes[i];
-    tmFloat thisAngle = Angle(thisNode->mLoc - startPt);
-    if (startAngle > thisAngle) {
-      startAngle = thisAngle;
-      startNode = thisNode;
+  // First we find the corners of the hull with Andrew's monotone chain
+  // algorithm, which takes O(N log N) time for N leaf nodes. (This used to be
+  // a gift-wrapping search over all of the nodes for each border node.) Sort
+  // the nodes from left to right, then sweep across to get the lower hull and
+  // back again to get the upper hull, dropping any node that doesn't make a
+  // strict counterclockwise turn.
+  tmArray<tmNode*> sortedNodes(leafNodes);
+  sort(sortedNodes.begin(), sortedNodes.end(), tmNodeLocLess());
+  size_t n = sortedNodes.size();
+  tmArray<tmNode*> cornerNodes;
+  cornerNodes.reserve(2 * n);
+  for (size_t i = 0; i < n; ++i) {
+    tmNode* theNode = sortedNodes[i];
+    while (cornerNodes.size() >= 2 && 
+      !AreCCW(cornerNodes[cornerNodes.size() - 2]->mLoc,
+      cornerNodes.back()->mLoc, theNode->mLoc))
+      cornerNodes.pop_back();
+    cornerNodes.push_back(theNode);
+  }
+  size_t lowerSize = cornerNodes.size();
+  for (size_t i = n - 1; i > 0; --i) {
+    tmNode* theNode = sortedNodes[i - 1];
+    while (cornerNodes.size() > lowerSize && 
+      !AreCCW(cornerNodes[cornerNodes.size() - 2]->mLoc,
+      cornerNodes.back()->mLoc, theNode->mLoc))
+      cornerNodes.pop_back();
+    cornerNodes.push_back(theNode);
+  }
+  cornerNodes.pop_back();   // that's the first node again
+  size_t h = cornerNodes.size();
+  if (h < 2) return;        // all nodes coincide
+  
+  // Next, sort the rest of the nodes onto the sides of the hull. A node goes
+  // with the side whose wedge (as seen from a point inside the hull) contains
+  // it, which we find by bisection on angle, as long as it lies between the
+  // ends of that side; otherwise we try the neighboring sides. If the nodes
+  // are all collinear, there are just two "sides", running there and back,
+  // and every node goes with both of them.
+  tmPoint center(0., 0.);
+  for (size_t i = 0; i < h; ++i) center += cornerNodes[i]->mLoc;
+  center /= h;
+  tmFloat startAngle = Angle(cornerNodes[0]->mLoc - center);
+  vector<tmFloat> wedgeAngles(h);
+  for (size_t i = 0; i < h; ++i) {
+    wedgeAngles[i] = Angle(cornerNodes[i]->mLoc - center) - startAngle;
+    if (wedgeAngles[i] < 0) wedgeAngles[i] += TWO_PI;
+  }
+  tmIndexedArray<tmNode*> cornerIndex(cornerNodes);
+  vector<vector<pair<tmFloat, size_t> > > sideNodes(h);
+  for (size_t i = 0; i < n; ++i) {
+    tmNode* theNode = sortedNodes[i];
+    if (cornerIndex.contains(theNode)) continue;
+    size_t w = 0;
+    if (h > 2) {
+      tmFloat theAngle = Angle(theNode->mLoc - center) - startAngle;
+      if (theAngle < 0) theAngle += TWO_PI;
+      w = (size_t(upper_bound(wedgeAngles.begin(), wedgeAngles.end(), 
+        theAngle) - wedgeAngles.begin()) + h - 1) % h;
+    }
+    const size_t sides[3] = {w, (w + h - 1) % h, (w + 1) % h};
+    for (size_t j = 0; j < 3; ++j) {
+      size_t k = sides[j];
+      const tmPoint& u = cornerNodes[k]->mLoc;
+      tmPoint uv = cornerNodes[(k + 1) % h]->mLoc - u;
+      tmFloat t = Inner(theNode->mLoc - u, uv);
+      if (t <= 0 || t >= Mag2(uv)) continue;
+      sideNodes[k].push_back(make_pair(t, i));
+      if (h > 2) break;
     }
   }
-  TMASSERT(startNode);    // if we didn't find one, something bad has happened.
+  
+  // Now walk around the hull counterclockwise. Along each side, the nodes are
+  // sorted by their distance from its start, and we run the same chain
+  // algorithm as above but with the tolerance of IsHullConcave(), so that we
+  // keep all the nodes that lie on the side or within a hair of it.
   tmArray<tmNode*> borderNodes;
-  borderNodes.push_back(startNode); // store the first tmNode
-
-  // Now go through and accumulate nodes in the hull. The next tmNode is
-  // defined to be the node whose loc makes the smallest angle with the triple
-  // consisting of the previous 2 pts. There's a slight complication, though;
-  // since nodes are constrained by the sides of the paper, there is a strong
-  // possibility that we'll have (nearly) collinear border nodes. Due to
-  // roundoff error, one or the other might have a "smaller" angle. To resolve
-  // this ambiguity, if two nodes have approximately the same angle, we'll take
-  // the one closest to the last node.
-  tmNode* prevNode = startNode;
-  tmPoint prevPt = startPt;
-  tmNode* thisNode = startNode;
-  tmPoint thisPt = thisNode->mLoc;
-  for (;;) {
-    tmNode* bestNode = 0;
-    tmFloat bestAngle = TWO_PI;
-    tmFloat bestDist = HUGE_VAL;
-    for (size_t i = 0; i < leafNodes.size(); ++i) {
-      tmNode* theNode = leafNodes[i];
-      if (theNode == prevNode || theNode == thisNode) continue;
-      tmPoint& thePt = theNode->mLoc;
-      tmFloat theAngle = AngleChange(prevPt, thisPt, thePt);
-      // A subtle point here. All values of theAngle will lie between 0
-      // (straight line) and PI (doubling-back); we want the smallest angle,
-      // i.e., the "least bend" at the vertex. However, because of our
-      // tolerance of slight concavity, it's possible to obtain an angle change
-      // that's actually slightly larger than PI, which therefore wraps around
-      // to a value near -PI. These are spurious points; they'll never be part
-      // of the convex hull; but we have to manually detect them and throw them
-      // away.
-      if (theAngle < -PI/2) continue;
-      
-      tmFloat theDist = Mag(thePt - thisPt);
-      if ((theAngle < (bestAngle - ConvexityTol())) || 
-        (fabs(theAngle - bestAngle) < ConvexityTol() && theDist < bestDist)) {
-        bestNode = theNode;
-        bestAngle = theAngle;
-        bestDist = theDist;
-      }
+  borderNodes.reserve(n + h);
+  for (size_t i = 0; i < h; ++i) {
+    vector<pair<tmFloat, size_t> >& theSide = sideNodes[i];
+    sort(theSide.begin(), theSide.end());
+    size_t sideStart = borderNodes.size();
+    borderNodes.push_back(cornerNodes[i]);
+    for (size_t j = 0; j <= theSide.size(); ++j) {
+      tmNode* theNode = (j < theSide.size()) ? 
+        sortedNodes[theSide[j].second] : cornerNodes[(i + 1) % h];
+      while (borderNodes.size() >= sideStart + 2 && 
+        IsHullConcave(borderNodes[borderNodes.size() - 2]->mLoc,
+        borderNodes.back()->mLoc, theNode->mLoc))
+        borderNodes.pop_back();
+      borderNodes.push_back(theNode);
     }
-    TMASSERT(bestNode);
-    if (bestNode == startNode) break;
-    borderNodes.push_back(bestNode);
-    prevNode = thisNode;
-    prevPt = thisPt;
-    thisNode = bestNode;
-    thisPt = thisNode->mLoc;
+    borderNodes.pop_back();   // the next corner starts the next side
   }
   
   // Now that we've found all the border nodes, we'll set their flags; also
@@ -2102,6 +2672,7 @@ Set the pinned status of all nodes and edges.
 void tmTree::CalcPinnedNodesAndEdges(tmArray<tmNode*>& leafNodes, 
   tmArray<tmPath*>& leafPaths)
 {
+  TM_PROFILE_SCOPE("tmTree::CalcPinnedNodesAndEdges");
   // Note which of the leaf nodes are pinned.
   for (size_t i = 0; i < leafNodes.size(); ++i)
     leafNodes[i]->CalcIsPinnedNode();
@@ -2125,6 +2696,7 @@ therefrom; delete polygons that have become invalidated.
 void tmTree::CalcPolygonNetwork(tmArray<tmNode*>& leafNodes, 
   tmArray<tmPath*>& leafPaths)
 {
+  TM_PROFILE_SCOPE("tmTree::CalcPolygonNetwork");
   // 12-3-96. BIG change in the algorithm. This algorithm is much broader than
   // before, and takes into account the realization that border nodes don't
   // have to be pinned and border paths don't have to be active.
@@ -2157,37 +2729,62 @@ void tmTree::CalcPolygonNetwork(tmArray<tmNode*>& leafNodes,
   }
     
   // But a polygon tmNode must also have at least two polygon paths coming from
-  // it and a polygon path must connect two polygon nodes. So we will
-  // iteratively go through both lists and "snip off" parts that don't satisfy
-  // the conditions above until we've settled on a stable network.  
-  bool somethingChanged;
-  do {
-    somethingChanged = false;
-    
-    // Polygon paths must connect two polygon nodes   
-    iLeafPaths.ResetTo(tmArray_START);
-    while (iLeafPaths.Next(&aPath)) {
-      if (!aPath->IsPolygonPath()) continue;
-      if (!(aPath->mNodes.front()->IsPolygonNode() &&
-        aPath->mNodes.back()->IsPolygonNode())) {
-        aPath->mIsPolygonPath = false;
-        somethingChanged = true;
-      }
+  // it and a polygon path must connect two polygon nodes. So we "snip off"
+  // parts that don't satisfy the conditions above until we've settled on a
+  // stable network. We used to sweep over both lists until nothing changed,
+  // which could take a sweep for every node of a long dangling chain; instead
+  // we keep a count of the polygon paths at each node and a queue of nodes
+  // that have just lost their polygon status, so that each node and path is
+  // visited a fixed number of times. The network we end up with is the same:
+  // the largest one that satisfies both conditions.
+  
+  // Polygon paths must connect two polygon nodes
+  iLeafPaths.ResetTo(tmArray_START);
+  while (iLeafPaths.Next(&aPath)) {
+    if (!aPath->IsPolygonPath()) continue;
+    if (!(aPath->mNodes.front()->IsPolygonNode() &&
+      aPath->mNodes.back()->IsPolygonNode()))
+      aPath->mIsPolygonPath = false;
+  }
+  
+  // Count the polygon paths at each polygon node.
+  tmIndexedArray<tmNode*> leafNodeIndex(leafNodes);
+  vector<size_t> numPolyPaths(leafNodes.size(), 0);
+  iLeafPaths.ResetTo(tmArray_START);
+  while (iLeafPaths.Next(&aPath)) {
+    if (!aPath->IsPolygonPath()) continue;
+    ++numPolyPaths[leafNodeIndex.GetOffset(aPath->mNodes.front())];
+    ++numPolyPaths[leafNodeIndex.GetOffset(aPath->mNodes.back())];
+  }
+  
+  // Polygon nodes must have 2 or more polygon paths. When a node loses its
+  // status, so do its polygon paths, and the nodes at their other ends each
+  // lose a polygon path.
+  tmArray<tmNode*> doomedNodes;
+  for (size_t i = 0; i < leafNodes.size(); ++i) {
+    aNode = leafNodes[i];
+    if (aNode->IsPolygonNode() && numPolyPaths[i] < 2) {
+      aNode->mIsPolygonNode = false;
+      doomedNodes.push_back(aNode);
     }
-      
-    // Polygon nodes must have 2 or more polygon paths        
-    iLeafNodes.ResetTo(tmArray_START);
-    while (iLeafNodes.Next(&aNode)) {
+  }
+  for (size_t i = 0; i < doomedNodes.size(); ++i) {
+    tmNode* theNode = doomedNodes[i];
+    for (size_t j = 0; j < theNode->mLeafPaths.size(); ++j) {
+      aPath = theNode->mLeafPaths[j];
+      if (!aPath->IsPolygonPath()) continue;
+      aPath->mIsPolygonPath = false;
+      aNode = aPath->mNodes.front();
+      if (aNode == theNode) aNode = aPath->mNodes.back();
       if (!aNode->IsPolygonNode()) continue;
-      size_t polyPaths = 0;
-      tmArrayIterator<tmPath*> j1(aNode->mLeafPaths);
-      while (j1.Next(&aPath)) if (aPath->IsPolygonPath()) polyPaths++;
-      if (polyPaths < 2) {
+      size_t& numLeft = numPolyPaths[leafNodeIndex.GetOffset(aNode)];
+      --numLeft;
+      if (numLeft < 2) {
         aNode->mIsPolygonNode = false;
-        somethingChanged = true;
+        doomedNodes.push_back(aNode);
       }
     }
-  } while (somethingChanged);
+  }
 
   // Check to see if any tmPoly has become invalid; if so, kill it. Note that
   // this will also kill all vertices, facets, and creases interior to the
@@ -2215,6 +2812,7 @@ both polygons assigned, (c) every border path has one polygon assigned.
 *****/
 void tmTree::CalcPolygonValidity(tmArray<tmNode*>& leafNodes)
 {
+  TM_PROFILE_SCOPE("tmTree::CalcPolygonValidity");
   mIsPolygonValid = true;
   for (size_t i = 0; i < leafNodes.size(); ++i)
     if (leafNodes[i]->GetNumPolygonPaths() < 2) {
@@ -2244,6 +2842,7 @@ Seek out and kill any orphan creases or vertices.
 *****/
 void tmTree::KillOrphanVerticesAndCreases()
 {
+  TM_PROFILE_SCOPE("tmTree::KillOrphanVerticesAndCreases");
   // Find and kill orphaned creases. Creases can be owned by polys (if they're
   // in the interior of a poly) or paths (if they're on the boundary of a
   // poly). A crease is orphaned if it's owned by a path, but not incident to
@@ -2303,6 +2902,7 @@ Renumber all of the parts of the tree.
 *****/
 void tmTree::CalcPartIndices()
 {
+  TM_PROFILE_SCOPE("tmTree::CalcPartIndices");
   RenumberParts<tmNode>();
   RenumberParts<tmEdge>();
   RenumberParts<tmPath>();
@@ -2320,6 +2920,7 @@ Return false if any polygon is not filled, or if there are no polygons at all.
 *****/
 void tmTree::CalcPolygonFilled()
 {
+  TM_PROFILE_SCOPE("tmTree::CalcPolygonFilled");
   mIsPolygonFilled = false;
   if (mOwnedPolys.empty()) return;
   for (size_t i = 0; i < mOwnedPolys.size(); ++i) {
@@ -2337,51 +2938,129 @@ position along the axis in the folded base. If we were successful, calculate the
 *****/
 void tmTree::CalcDepthAndBend()
 {
+  TM_PROFILE_SCOPE("tmTree::CalcDepthAndBend");
   if (!mIsPolygonValid) return;
   if (mNodes.empty()) return;
   
   // Set the depth of all tree nodes (which includes both leaf and branch
   // nodes, but not subnodes). First the root node, which, by definition, has a
   // depth of zero; then the other tree nodes, for whom the depth is the
-  // length of the path to the root node.
+  // length of the path to the root node. We reach the tree nodes by a
+  // depth-first search from the root and look up each one's path to the root
+  // in mTourPaths. The search also gives us the parent and level (number of
+  // edges from the root) of each node, which we need below.
   tmNode* rootNode = GetRootNode();
   rootNode->mDepth = 0;
-  for (size_t i = 0; i < mOwnedPaths.size(); ++i) {
-    tmPath* thePath = mOwnedPaths[i];
-    tmNode* theNode;
-    if (thePath->mNodes.front() == rootNode) 
-      theNode = thePath->mNodes.back();
-    else if (thePath->mNodes.back() == rootNode) 
-      theNode = thePath->mNodes.front();
-    else continue;
-    theNode->mDepth = thePath->GetMinPaperLength();
-  }
-  
-  // Reset the depth of every path.
+  if (!mIsTreeTourValid) CalcTreeTour();   // normally done in this cleanup
+  vector<size_t> searchPos(mNodes.size() + 1);  // search position, by index
+  vector<tmNode*> searchNodes;    // tree nodes in search order
+  vector<size_t> parentPos;       // search position of each one's parent,
+  vector<tmEdge*> parentEdges;    // the edge to its parent,
+  vector<size_t> levels;          // and its level
+  searchNodes.reserve(mOwnedNodes.size());
+  parentPos.reserve(mOwnedNodes.size());
+  parentEdges.reserve(mOwnedNodes.size());
+  levels.reserve(mOwnedNodes.size());
+  searchPos[rootNode->GetIndex()] = 0;
+  searchNodes.push_back(rootNode);
+  parentPos.push_back(0);
+  parentEdges.push_back(0);
+  levels.push_back(0);
+  vector<pair<size_t, size_t> > stack;  // search position, next edge to follow
+  stack.push_back(make_pair(size_t(0), size_t(0)));
+  while (!stack.empty()) {
+    size_t pos = stack.back().first;
+    tmNode* theNode = searchNodes[pos];
+    size_t ie = stack.back().second++;
+    if (ie >= theNode->mEdges.size()) {
+      stack.pop_back();
+      continue;
+    }
+    tmEdge* theEdge = theNode->mEdges[ie];
+    if (theEdge == parentEdges[pos]) continue;
+    tmNode* nextNode = theEdge->GetOtherNode(theNode);
+    size_t nextPos = searchNodes.size();
+    searchPos[nextNode->GetIndex()] = nextPos;
+    searchNodes.push_back(nextNode);
+    parentPos.push_back(pos);
+    parentEdges.push_back(theEdge);
+    levels.push_back(levels[pos] + 1);
+    nextNode->mDepth = mTourPaths[TourPathIndex(rootNode->mTourEnter,
+      nextNode->mTourEnter)]->GetMinPaperLength();
+    stack.push_back(make_pair(nextPos, size_t(0)));
+  }
+  size_t numSearched = searchNodes.size();
+  
+  // Reset the depth of every path, and note the search positions of the ends
+  // of each leaf path. Then sort the leaf paths by the positions of their
+  // front nodes.
+  vector<tmPath*> leafPaths;
+  vector<pair<size_t, size_t> > leafEnds;
   for (size_t i = 0; i < mPaths.size(); ++i) {
     tmPath* thePath = mPaths[i];
     thePath->mMinDepth = DEPTH_NOT_SET;
     thePath->mMinDepthDist = 0;
-  }
+    if (!thePath->IsLeafPath()) continue;
+    leafPaths.push_back(thePath);
+    leafEnds.push_back(make_pair(
+      searchPos[thePath->mNodes.front()->GetIndex()],
+      searchPos[thePath->mNodes.back()->GetIndex()]));
+  }
+  vector<size_t> frontStart(numSearched + 1, 0);
+  for (size_t i = 0; i < leafEnds.size(); ++i)
+    ++frontStart[leafEnds[i].first + 1];
+  for (size_t i = 0; i < numSearched; ++i)
+    frontStart[i + 1] += frontStart[i];
+  vector<size_t> byFront(leafEnds.size());
+  vector<size_t> frontEnd(frontStart.begin(), frontStart.end() - 1);
+  for (size_t i = 0; i < leafEnds.size(); ++i)
+    byFront[frontEnd[leafEnds[i].first]++] = i;
     
   // For each leaf path set mMinDepth and mMinDepthDist. This establishes a
   // local depth metric whenever the path, or an inset version of it, becomes
   // active, so we can determine the depth of any point relative to the path.
-  for (size_t i = 0; i < mPaths.size(); ++i) {
-    tmPath* thePath = mPaths[i];
-//    if (thePath->mIsSubPath && thePath->mIsLeafPath) {
-    if (thePath->IsLeafPath()) {
-      thePath->mMinDepth = thePath->mNodes.front()->mDepth;
-      thePath->mMinDepthDist = 0;
-      for (size_t j = 1; j < thePath->mNodes.size(); ++j) {
-        tmNode* pathNode = thePath->mNodes[j];
-        tmFloat nodeDepth = pathNode->mDepth;
-        if (thePath->mMinDepth > nodeDepth) {
-          thePath->mMinDepth = nodeDepth;
-          thePath->mMinDepthDist += 
-            thePath->mEdges[j - 1]->GetStrainedScaledLength();
-        }
-      }
+  // Depth falls along the path until it reaches the lowest common ancestor of
+  // its ends, and rises after, so mMinDepth is the depth of that ancestor and
+  // mMinDepthDist is the distance to it from the front node.
+  //
+  // The lowest common ancestor of the nodes at search positions p < q is the
+  // parent of the node of lowest level among positions p + 1 through q. We
+  // answer these range-minimum queries from a sparse table, in which
+  // minPos[k][i] is the position of lowest level among i through i + 2^k - 1.
+  vector<size_t> floorLog2(numSearched + 1, 0);
+  for (size_t i = 2; i <= numSearched; ++i)
+    floorLog2[i] = floorLog2[i / 2] + 1;
+  vector<vector<size_t> > minPos(1, vector<size_t>(numSearched));
+  for (size_t i = 0; i < numSearched; ++i) minPos[0][i] = i;
+  for (size_t k = 1; (size_t(1) << k) <= numSearched; ++k) {
+    size_t half = size_t(1) << (k - 1);
+    minPos.push_back(vector<size_t>(numSearched - 2 * half + 1));
+    for (size_t i = 0; i < minPos[k].size(); ++i) {
+      size_t pos1 = minPos[k - 1][i];
+      size_t pos2 = minPos[k - 1][i + half];
+      minPos[k][i] = levels[pos2] < levels[pos1] ? pos2 : pos1;
+    }
+  }
+  // Paths that share a front node share their distances up the tree, which we
+  // accumulate edge by edge from the front node, as we would walk the path.
+  vector<tmFloat> upDists(numSearched);
+  for (size_t f = 0; f < numSearched; ++f) {
+    if (frontStart[f] == frontStart[f + 1]) continue;
+    upDists[f] = 0;
+    for (size_t pos = f; pos != 0; pos = parentPos[pos])
+      upDists[parentPos[pos]] = upDists[pos] + 
+        parentEdges[pos]->GetStrainedScaledLength();
+    for (size_t i = frontStart[f]; i < frontStart[f + 1]; ++i) {
+      tmPath* thePath = leafPaths[byFront[i]];
+      size_t b = leafEnds[byFront[i]].second;
+      size_t lo = min(f, b) + 1;
+      size_t hi = max(f, b);
+      size_t k = floorLog2[hi - lo + 1];
+      size_t pos1 = minPos[k][lo];
+      size_t pos2 = minPos[k][hi + 1 - (size_t(1) << k)];
+      size_t ancestorPos = parentPos[levels[pos2] < levels[pos1] ? pos2 : pos1];
+      thePath->mMinDepth = searchNodes[ancestorPos]->mDepth;
+      thePath->mMinDepthDist = upDists[ancestorPos];
     }
   }
   
@@ -2511,6 +3190,7 @@ then we're not valid.
 *****/
 void tmTree::CalcVertexDepthValidity()
 {
+  TM_PROFILE_SCOPE("tmTree::CalcVertexDepthValidity");
   mIsVertexDepthValid = false;
   if (mVertices.empty()) return;
   for (size_t i = 0; i < mVertices.size(); ++i)
@@ -2525,6 +3205,7 @@ and the crease pattern is two-colorable.
 *****/
 void tmTree::CalcFacetDataValidity()
 {
+  TM_PROFILE_SCOPE("tmTree::CalcFacetDataValidity");
   mIsFacetDataValid = false;
   if (mFacets.empty()) return;
   
@@ -2547,6 +3228,7 @@ Compute the facet corridor edges for the tree.
 *****/
 void tmTree::CalcFacetCorridorEdges()
 {
+  TM_PROFILE_SCOPE("tmTree::CalcFacetCorridorEdges");
   TMASSERT(mIsFacetDataValid);
   for (size_t i = 0; i < mOwnedPolys.size(); ++i) {
     tmPoly* thePoly = mOwnedPolys[i];
@@ -2558,33 +3240,125 @@ void tmTree::CalcFacetCorridorEdges()
 /*****
 Compute the color for all facets. Each facet gets a color assignment,
 either WHITE_UP or COLOR_UP. We set one facet and let the result propagate
-throughout the crease pattern.
+throughout the crease pattern: breadth first, across a flat list of each
+facet's neighbors, which we build from the creases. A crease that's folded
+flips the color from one facet to the next; an unfolded hinge keeps it.
 *****/
 void tmTree::CalcFacetColor()
 {
+  TM_PROFILE_SCOPE("tmTree::CalcFacetColor");
   // Initialize by clearing all the facet colors and recording the sole source
   // facet.
-  tmFacet* sourceFacet = 0;
-  for (size_t i = 0; i < mFacets.size(); ++i) {
+  size_t numFacets = mFacets.size();
+  size_t sourcePos = numFacets;
+  for (size_t i = 0; i < numFacets; ++i) {
     tmFacet* theFacet = mFacets[i];
     theFacet->mColor = tmFacet::NOT_ORIENTED;
-    if (theFacet->IsSourceFacet()) sourceFacet = theFacet;
+    if (theFacet->IsSourceFacet()) sourcePos = i;
+  }
+  TMASSERT(sourcePos < numFacets);
+  
+  // List the neighbors of each facet by position in mFacets (which is one
+  // less than the facet index). The neighbors of the facet at position i are
+  // nbrs[firstNbr[i]] up to nbrs[firstNbr[i + 1]], and flips[] records
+  // whether the crease between them flips the color.
+  vector<size_t> firstNbr(numFacets + 1, 0);
+  for (size_t i = 0; i < mCreases.size(); ++i) {
+    tmCrease* theCrease = mCreases[i];
+    if (!theCrease->mFwdFacet || !theCrease->mBkdFacet) continue;
+    ++firstNbr[theCrease->mFwdFacet->GetIndex()];
+    ++firstNbr[theCrease->mBkdFacet->GetIndex()];
+  }
+  for (size_t i = 0; i < numFacets; ++i)
+    firstNbr[i + 1] += firstNbr[i];
+  vector<size_t> nbrs(firstNbr[numFacets]);
+  vector<bool> flips(firstNbr[numFacets]);
+  vector<size_t> nextNbr(firstNbr.begin(), firstNbr.end() - 1);
+  for (size_t i = 0; i < mCreases.size(); ++i) {
+    tmCrease* theCrease = mCreases[i];
+    if (!theCrease->mFwdFacet || !theCrease->mBkdFacet) continue;
+    bool flip = true;
+    switch(theCrease->GetKind()) {
+      case tmCrease::AXIAL:
+      case tmCrease::GUSSET:
+      case tmCrease::RIDGE:
+      case tmCrease::FOLDED_HINGE:
+      case tmCrease::PSEUDOHINGE:
+        break;
+      case tmCrease::UNFOLDED_HINGE:
+        flip = false;
+        break;
+      default:
+        TMFAIL("In tmTree::CalcFacetColor() crease type was not defined");
+    }
+    size_t fwdPos = theCrease->mFwdFacet->GetIndex() - 1;
+    size_t bkdPos = theCrease->mBkdFacet->GetIndex() - 1;
+    nbrs[nextNbr[fwdPos]] = bkdPos;
+    flips[nextNbr[fwdPos]++] = flip;
+    nbrs[nextNbr[bkdPos]] = fwdPos;
+    flips[nextNbr[bkdPos]++] = flip;
+  }
+  
+  // The source facet will always be color up. Facets that can't be reached
+  // from it stay unoriented.
+  vector<tmFacet::Color> colors(numFacets, tmFacet::NOT_ORIENTED);
+  vector<size_t> queue;
+  queue.reserve(numFacets);
+  colors[sourcePos] = tmFacet::COLOR_UP;
+  queue.push_back(sourcePos);
+  for (size_t iq = 0; iq < queue.size(); ++iq) {
+    size_t pos = queue[iq];
+    for (size_t j = firstNbr[pos]; j < firstNbr[pos + 1]; ++j) {
+      size_t otherPos = nbrs[j];
+      if (colors[otherPos] != tmFacet::NOT_ORIENTED) continue;
+      colors[otherPos] = 
+        flips[j] ? tmFacet::OppositeColor(colors[pos]) : colors[pos];
+      queue.push_back(otherPos);
+    }
   }
-  TMASSERT(sourceFacet);
-  
-  // This facet will always be color up. The rest of the facets will have their
-  // color set by recursive propagation of color across creases.
-  sourceFacet->CalcColor(tmFacet::COLOR_UP);
+  for (size_t i = 0; i < numFacets; ++i)
+    mFacets[i]->mColor = colors[i];
 }
 
 
 /*****
-Compute the crease fold direction.
+Compute the crease fold direction, which depends on the relative order of the
+two facets on either side and their color orientation. We gather what we need
+from the facets into flat arrays, one entry per crease, so that the fold
+directions themselves come from a single branch-free pass.
 *****/
 void tmTree::CalcFoldDirections()
 {
-  for (size_t i = 0; i < mCreases.size(); ++i)
-    mCreases[i]->CalcFold();
+  TM_PROFILE_SCOPE("tmTree::CalcFoldDirections");
+  size_t numCreases = mCreases.size();
+  vector<unsigned char> isBorder(numCreases);
+  vector<unsigned char> isSameColor(numCreases);
+  vector<unsigned char> isFwdColorUp(numCreases);
+  vector<unsigned char> isFwdAbove(numCreases);
+  for (size_t i = 0; i < numCreases; ++i) {
+    tmCrease* theCrease = mCreases[i];
+    tmFacet* fwdFacet = theCrease->mFwdFacet;
+    tmFacet* bkdFacet = theCrease->mBkdFacet;
+    if (fwdFacet == 0 || bkdFacet == 0) {
+      isBorder[i] = 1;
+      continue;
+    }
+    isSameColor[i] = fwdFacet->mColor == bkdFacet->mColor;
+    isFwdColorUp[i] = fwdFacet->mColor == tmFacet::COLOR_UP;
+    isFwdAbove[i] = fwdFacet->mOrder > bkdFacet->mOrder;
+  }
+  
+  // A crease between facets of different colors is a mountain fold if the
+  // color-up facet is the one on top, a valley fold otherwise.
+  vector<unsigned char> folds(numCreases);
+  for (size_t i = 0; i < numCreases; ++i) {
+    unsigned char mv = isFwdColorUp[i] == isFwdAbove[i] ? 
+      (unsigned char)(tmCrease::MOUNTAIN) : (unsigned char)(tmCrease::VALLEY);
+    unsigned char fold = isSameColor[i] ? (unsigned char)(tmCrease::FLAT) : mv;
+    folds[i] = isBorder[i] ? (unsigned char)(tmCrease::BORDER) : fold;
+  }
+  for (size_t i = 0; i < numCreases; ++i)
+    mCreases[i]->mFold = tmCrease::Fold(folds[i]);
 }
 
 
@@ -2602,6 +3376,7 @@ Recalculate the depth for nodes and vertices.
 *****/
 void tmTree::CleanupAfterEdit()
 {
+  TM_PROFILE_SCOPE("tmTree::CleanupAfterEdit");
 #ifdef TMDEBUG
   // Debug builds record tree state at the beginning of this call for dumping
   // in case of assertion.
@@ -2617,6 +3392,9 @@ void tmTree::CleanupAfterEdit()
     TMASSERT(numOwnedPaths == (numOwnedNodes * (numOwnedNodes - 1)) / 2);
 #endif // TMDEBUG
 
+  // Whatever derived data we read from a stream is about to be recomputed.
+  mHasUnverifiedState = false;
+  
   // Clear flags that should get set later in this routine but might not if
   // we bail out early.
   mIsFeasible = false;
@@ -2664,6 +3442,10 @@ void tmTree::CleanupAfterEdit()
   tmArray<tmPath*> leafPaths;
   GetLeafPaths(leafPaths);
   
+  // Bring the minimum tree length of each owned path up to date with the
+  // lengths and strains of its edges.
+  CalcTreePathLengths();
+  
   // Go through all paths and set which paths are feasible and active. Feasible
   // paths are paths whose actual length is greater or equal to their minimum
   // length. Active paths are those for which equality holds. Only need to do 
@@ -2673,10 +3455,10 @@ void tmTree::CleanupAfterEdit()
   tmPath* aPath;
   while (iOwnedPaths.Next(&aPath)) {
   
-    // compute the length of each path based on its edges and any strain that
-    // is present; also set the flags for validity and activity, which depend
-    // on these lengths.
-    aPath->TreePathCalcLengths();
+    // compute the paper lengths of each path from its tree length and the
+    // positions of its nodes; also set the flags for validity and activity,
+    // which depend on these lengths.
+    aPath->TreePathCalcPaperLengths();
     
     // Also clear flags we'll be setting shortly    
     aPath->mIsBorderPath = false;
@@ -16,6 +16,9 @@ Copyright:    ©2003 Robert J. Lang. All Rights Reserved.
 
 // Standard libraries
 #include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
 
 // TreeMaker classes
 #include "tmModel_fwd.h"
@@ -54,6 +57,9 @@ public:
   class EX_BAD_REMOVE_STUB {
     // requested edge was not truly a stub
   };
+  class EX_BAD_BUILD_TREE {
+    // edges given to BuildTree() don't make a tree of the given nodes
+  };
   class EX_IO_UNRECOGNIZED_CONDITION {
     // file included unfamiliar conditions
     public:
@@ -299,6 +305,9 @@ public:
   bool CanGetCorridorFacets() const;
   void GetCorridorFacets(const tmArray<tmEdge*>& edgeList, 
     tmArray<tmFacet*>& facetList) const;
+  void GetDragPathStatus(const tmArray<const tmNode*>& movingNodes,
+    const tmArray<tmPoint>& newLocs, tmArray<tmPath*>& infeasiblePaths,
+    tmArray<tmPath*>& activePaths) const;
 
   // Test structures
   static tmTree* MakeTreeBlank();
@@ -310,6 +319,31 @@ public:
   // Topological modification
   void AddNode(tmNode* fromNode, const tmPoint& where, 
     tmNode*& newNode, tmEdge*& newEdge);
+  struct NodeDesc {
+    // A node for BuildTree()
+    tmPoint mLoc;
+    std::string mLabel;
+    NodeDesc(const tmPoint& aLoc = tmPoint(0., 0.), 
+      const std::string& aLabel = "") : mLoc(aLoc), mLabel(aLabel) {};
+  };
+  struct EdgeDesc {
+    // An edge for BuildTree(); mNode1 and mNode2 index its list of NodeDescs
+    std::size_t mNode1;
+    std::size_t mNode2;
+    tmFloat mLength;
+    std::string mLabel;
+    tmFloat mStrain;
+    tmFloat mStiffness;
+    EdgeDesc(std::size_t aNode1 = 0, std::size_t aNode2 = 0, 
+      const tmFloat& aLength = 1, const std::string& aLabel = "") : 
+      mNode1(aNode1), mNode2(aNode2), mLength(aLength), mLabel(aLabel), 
+      mStrain(0), mStiffness(1) {};
+  };
+  static bool CanBuildTree(std::size_t numNodes,
+    const std::vector<EdgeDesc>& edgeList);
+  void BuildTree(const std::vector<NodeDesc>& nodeList,
+    const std::vector<EdgeDesc>& edgeList, tmArray<tmNode*>& newNodes,
+    tmArray<tmEdge*>& newEdges);
   void SplitEdge(tmEdge* aEdge, const tmFloat& splitLoc, tmNode*& newNode);
   bool CanAbsorbNode(tmNode* aNode) const;
   void AbsorbNode(tmNode* aNode, tmEdge*& newEdge);
@@ -445,6 +479,18 @@ public:
   void PutSelf(std::ostream& os);
   void GetSelf(std::istream& is);
   void Exportv4(std::ostream& os);
+  void PutCompactSelf(std::ostream& os);
+  void ImportCSV(std::istream& is);
+  void ImportJSON(std::istream& is);
+  static bool GetTrustStoredState();
+  static void SetTrustStoredState(bool trustStoredState);
+  bool HasUnverifiedState() const {
+    // Return true if the derived data of the tree (flags, polys, and crease
+    // pattern) was read from a stream and hasn't been checked or recomputed
+    // since.
+    return mHasUnverifiedState;
+  };
+  bool VerifyStoredState();
 
 private:
   // User-settable data
@@ -463,6 +509,14 @@ private:
   bool mIsFacetDataValid;
   bool mIsLocalRootConnectable;
   bool mNeedsCleanup;
+  bool mIsTreeTourValid;        // nodes' tour positions are up to date
+  std::vector<tmPath*> mTourPaths;  // owned paths by the tour positions of ends
+  
+  // Derived data taken on trust from a stream (see Getv5Self())
+  static bool sTrustStoredState;
+  bool mHasUnverifiedState;
+  bool mHasStoredChecksum;
+  std::size_t mStoredChecksum;
 
   // Ownership
   tmTree* NodeOwnerAsTree() {return this;};
@@ -485,9 +539,12 @@ private:
   
   // Stream I/O support
   void Putv5Self(std::ostream& os);
+  void Putv5Contents(std::ostream& os);
   void Getv5Self(std::istream& is);
   void Putv5Condition(std::ostream& os, tmCondition* aCondition);
   void Makev5Condition(std::istream& is);
+  void Putv5CompactSelf(std::ostream& os, bool hasPolys);
+  void Getv5CompactSelf(std::istream& is);
   
   void Putv4Self(std::ostream& os);
   void Getv4Self(std::istream& is);
@@ -536,12 +593,47 @@ template <class P>
   void PutOwnerPtr(std::ostream& os, tmFacetOwner* const aFacetOwner);
   void GetOwnerPtr(std::istream& is, tmFacetOwner*& aFacetOwner);
 
+  // Structural copy, used by Clone()
+  void CopySelf(tmTree* aTree);
+  void CopyCondition(tmCondition* aCondition);
+  template <class P>
+    P* CopyPtr(P* const p);
+  template <class P>
+    void CopyPtr(P*& p, P* const aPtr);
+  template <class P>
+    void CopyPtr(tmDpptr<P>& pref, const tmDpptr<P>& aPref);
+  template <class P>
+    void CopyPtrArray(tmArray<P*>& plist, const tmArray<P*>& aList);
+  template <class P>
+    void CopyPtrArray(tmDpptrArray<P>& plist, const tmDpptrArray<P>& aList);
+  
+  void CopyOwnerPtr(tmNodeOwner*& aNodeOwner, tmNodeOwner* const aOwner);
+  void CopyOwnerPtr(tmEdgeOwner*& aEdgeOwner, tmEdgeOwner* const aOwner);
+  void CopyOwnerPtr(tmPathOwner*& aPathOwner, tmPathOwner* const aOwner);
+  void CopyOwnerPtr(tmPolyOwner*& aPolyOwner, tmPolyOwner* const aOwner);
+  void CopyOwnerPtr(tmVertexOwner*& aVertexOwner, tmVertexOwner* const aOwner);
+  void CopyOwnerPtr(tmCreaseOwner*& aCreaseOwner, 
+    tmCreaseOwner* const aOwner);
+  void CopyOwnerPtr(tmFacetOwner*& aFacetOwner, tmFacetOwner* const aOwner);
+
+  // Bulk construction, used by BuildTree() and Getv5CompactSelf()
+  void MakeTreePaths();
+
   // Class tag for stream I/O
   TM_DECLARE_TAG()
     
   // Support for CleanupAfterEdit()
   template <class P>
     void RenumberParts();
+  static bool IsHullConcave(const tmPoint& a, const tmPoint& b,
+    const tmPoint& c);
+  static std::size_t TourPathIndex(std::size_t pos1, std::size_t pos2) {
+    // Index in mTourPaths of the path between the nodes at these (different)
+    // tour positions.
+    if (pos1 < pos2) std::swap(pos1, pos2);
+    return (pos1 * (pos1 - 1)) / 2 + pos2;};
+  void CalcTreeTour();
+  void CalcTreePathLengths();
   void CalcBorderNodesAndPaths(tmArray<tmNode*>& leafNodes);
   void CalcPinnedNodesAndEdges(tmArray<tmNode*>& leafNodes, 
     tmArray<tmPath*>& leafPaths);
@@ -952,4 +1044,69 @@ void tmTree::GetPtrArray(std::istream& is, tmDpptrArray<P>& plist)
 }
 
 
+#ifdef __MWERKS__
+#pragma mark -
+#endif
+
+
+/*****
+Return the part of this tree that corresponds to the given part of another
+tree, i.e., the one that has the same index. This is the copying counterpart
+of GetPtr(), which looks up a part by the index read from a stream.
+*****/
+template <class P>  
+P* tmTree::CopyPtr(P* const p)
+{
+  if (p == NULL) return NULL;
+  tmDpptrArray<P>& plist = tmCluster::GetParts<P>();
+  TMASSERT(p->mIndex >= 1 && p->mIndex <= plist.size());
+  return plist[p->mIndex - 1];
+}
+
+
+/*****
+Set a ptr-to-P to the counterpart of a ptr-to-P in another tree
+*****/
+template <class P>  
+void tmTree::CopyPtr(P*& p, P* const aPtr)
+{
+  p = CopyPtr(aPtr);
+}
+
+
+/*****
+Set a tmDpptr<P> to the counterpart of a tmDpptr<P> in another tree
+*****/
+template <class P>  
+void tmTree::CopyPtr(tmDpptr<P>& pref, const tmDpptr<P>& aPref)
+{
+  pref = CopyPtr((P*)(aPref));
+}
+
+
+/*****
+Fill a tmArray<P*> with the counterparts of a list of parts in another tree
+*****/
+template <class P>  
+void tmTree::CopyPtrArray(tmArray<P*>& plist, const tmArray<P*>& aList)
+{
+  plist.reserve(plist.size() + aList.size());
+  for (std::size_t j = 0; j < aList.size(); ++j)
+    plist.push_back(CopyPtr(aList[j]));
+}
+
+
+/*****
+Fill a tmDpptrArray<P> with the counterparts of a list of parts in another tree
+*****/
+template <class P>  
+void tmTree::CopyPtrArray(tmDpptrArray<P>& plist, 
+  const tmDpptrArray<P>& aList)
+{
+  plist.reserve(plist.size() + aList.size());
+  for (std::size_t j = 0; j < aList.size(); ++j)
+    plist.push_back(CopyPtr(aList[j]));
+}
+
+
 #endif // _TMTREE_H_
@@ -10,10 +10,12 @@ Copyright:    ©2005 Robert J. Lang. All Rights Reserved.
 
 #include "tmTree.h"
 #include "tmModel.h"
+#include "tmProfiler.h"
 
 #ifdef TMDEBUG
   #include <fstream>
 #endif
+#include <set>
 
 using namespace std;
 
@@ -46,7 +48,7 @@ public:
   bool mIsConnectable;            // true = can be connected to other LRNs
   tmArray<tmVertex*> mCCVertices; // vertices in the connected component
   tmArray<tmCrease*> mCCCreases;  // creases in the connected component
-  tmArray<tmPoly*> mCCPolys;      // polys that have a crease in the cc
+  tmIndexedArray<tmPoly*> mCCPolys; // polys that have a crease in the cc
   tmArray<tmVertex*> mSTVertices; // spanning tree vertices
   tmArray<tmCrease*> mSTCreases;  // spanning tree creases
   tmArray<tmVertex*> mCC0;        // vertices of deg=0 in cc
@@ -63,7 +65,6 @@ public:
   void BuildSpanningTree();
   void ClassifyVerticesByDegree();
   void ConnectFacetGraph();
-  bool CanAbsorb(tmRootNetwork* aNetwork, tmVertex*& atVertex);
   void Absorb(tmRootNetwork* aNetwork, tmVertex* atVertex);
   void BreakOneLink();
   
@@ -193,14 +194,22 @@ Classify the axial vertices by degree within this connected component
 and/or its spanning tree. This populates the arrays mCC0, mCC1, mCC2ST1, mCC2ST2.
 In addition, we check whether any vertex can serve as a connection to another
 polygon cluster and note the possibility in the flag mIsConnectable.
+A crease incident to one of our vertices that has been added to any connected
+component (or spanning tree) must have been added to ours, so the degrees can
+be read off the flags rather than by searching mCCCreases and mSTCreases.
 *****/
 void tmRootNetwork::ClassifyVerticesByDegree()
 {
   for (size_t i = 0; i < mCCVertices.size(); ++i) {
     tmVertex* theVertex = mCCVertices[i];
     if (!theVertex->IsAxialVertex()) continue;
-    size_t ccDegree = theVertex->GetDegree(mCCCreases);
-    size_t stDegree = theVertex->GetDegree(mSTCreases);
+    size_t ccDegree = 0;
+    size_t stDegree = 0;
+    for (size_t j = 0; j < theVertex->mCreases.size(); ++j) {
+      tmCrease* theCrease = theVertex->mCreases[j];
+      if (theCrease->mCCFlag == ALREADY_ADDED) ++ccDegree;
+      if (theCrease->mSTFlag == ALREADY_ADDED) ++stDegree;
+    }
     if (ccDegree == 0) mCC0.push_back(theVertex);
     else if (ccDegree == 1) mCC1.push_back(theVertex);
     else if (ccDegree == 2)
@@ -260,44 +269,10 @@ void tmRootNetwork::ConnectFacetGraph()
 }
 
 
-/*****
-Return true if this network (which is the global root network) can absorb the
-given network (which has a lower depth). This basically boils down to whether
-the given network has a root vertex of degree 1 in the connected component that
-is incident to an axial vertex of the global root network.
-*****/
-bool tmRootNetwork::CanAbsorb(tmRootNetwork* aNetwork, tmVertex*& atVertex)
-{
-  for (size_t i = 0; i < mCCPolys.size(); ++i) {
-    // thePoly is a poly in the global root network
-    tmPoly* thePoly = mCCPolys[i];
-    // theVertex should be one of the non-root axial vertices of thePoly,
-    // i.e., a potential point of attachment of the lower-depth network.
-    // Since we don't have a list specifically of non-root axial vertices,
-    // we'll have to take the long way. We'll go through all paths of the
-    // poly (which own any non-corner axial vertices, which are all we're
-    // interested in); then we'll go through the owned vertices of each path.
-    // We'll still go through a bunch of vertices that have no chance of
-    // being a point of attachment, but that can't be helped.
-    for (size_t j = 0; j < thePoly->mRingPaths.size(); ++j) {
-      tmPath* thePath = thePoly->mRingPaths[j];
-      for (size_t k = 0; k < thePath->mOwnedVertices.size(); ++k) {
-        tmVertex* theVertex = thePath->mOwnedVertices[k];
-        if (theVertex->mDiscreteDepth != aNetwork->mDiscreteDepth) continue;
-        if (!aNetwork->mCC1.contains(theVertex)) continue;
-        atVertex = theVertex;
-        return true;
-      }
-    }
-  }
-  return false;
-}
-
-
 /*****
 Absorb the given network, rearranging connections at the given vertex. When we
 absorb a network, we take over its polys (which are used for incidence testing:
-see CanAbsorb()). We don't bother doing anything with the lists of vertices and
+see tmTree::CalcFacetOrder()). We don't bother doing anything with the lists of vertices and
 creases because we'll want the global root network to still know its own local
 root vertices and creases.
 *****/
@@ -407,15 +382,6 @@ void tmTree::CalcRootNetworks(tmArray<tmRootNetwork*>& rootNetworks)
   for (size_t i = 0; i < mOwnedPolys.size(); ++i)
     mOwnedPolys[i]->CalcLocalFacetOrder();
   
-  // Collect all the local root hinges across all polys and their vertices.
-  tmArray<tmVertex*> localRootVertices;
-  tmArray<tmCrease*> localRootCreases;
-  for (size_t i = 0; i < mOwnedPolys.size(); ++i) {
-    tmPoly* thePoly = mOwnedPolys[i];
-    localRootVertices.union_with(thePoly->mLocalRootVertices);
-    localRootCreases.union_with(thePoly->mLocalRootCreases);
-  }
-
   // Reset the flags used in construction of local root network connected
   // components and spanning trees. 
   for (size_t i = 0; i < mVertices.size(); ++i) {
@@ -429,32 +395,35 @@ void tmTree::CalcRootNetworks(tmArray<tmRootNetwork*>& rootNetworks)
     theCrease->mSTFlag = tmRootNetwork::INELIGIBLE;
   }
   
-  // Now mark just the local root vertices and creases as NOT_YET; any vertex
-  // or crease that's not a local root vertex or crease will be left as
-  // INELIGIBLE.
-  for (size_t i = 0; i < localRootVertices.size(); ++i) {
-    tmVertex* theVertex = localRootVertices[i];
-    theVertex->mCCFlag = tmRootNetwork::NOT_YET;
-    theVertex->mSTFlag = tmRootNetwork::NOT_YET;
-  }
-  for (size_t i = 0; i < localRootCreases.size(); ++i) {
-    tmCrease* theCrease = localRootCreases[i];
-    theCrease->mCCFlag = tmRootNetwork::NOT_YET;
-    theCrease->mSTFlag = tmRootNetwork::NOT_YET;
+  // Collect all the local root hinges across all polys and their vertices,
+  // marking each as NOT_YET; any vertex or crease that's not a local root
+  // vertex or crease will be left as INELIGIBLE. A vertex or crease shared by
+  // several polys is only collected the first time we see it, which the flag
+  // tells us without having to search the lists.
+  tmArray<tmVertex*> localRootVertices;
+  for (size_t i = 0; i < mOwnedPolys.size(); ++i) {
+    tmPoly* thePoly = mOwnedPolys[i];
+    for (size_t j = 0; j < thePoly->mLocalRootVertices.size(); ++j) {
+      tmVertex* theVertex = thePoly->mLocalRootVertices[j];
+      if (theVertex->mCCFlag != tmRootNetwork::INELIGIBLE) continue;
+      theVertex->mCCFlag = tmRootNetwork::NOT_YET;
+      theVertex->mSTFlag = tmRootNetwork::NOT_YET;
+      localRootVertices.push_back(theVertex);
+    }
+    for (size_t j = 0; j < thePoly->mLocalRootCreases.size(); ++j) {
+      tmCrease* theCrease = thePoly->mLocalRootCreases[j];
+      theCrease->mCCFlag = tmRootNetwork::NOT_YET;
+      theCrease->mSTFlag = tmRootNetwork::NOT_YET;
+    }
   }
   
   // Create the connected components of local root hinges and vertices. Go
   // through each vertex and make sure it's either in an existing tmRootNetwork
-  // or start a new one.
+  // or start a new one. Every vertex that has been added to a network is
+  // flagged as ALREADY_ADDED, so that's all we need to check.
   for (size_t i = 0; i < localRootVertices.size(); ++i) {
     tmVertex* theVertex = localRootVertices[i];
-    bool alreadyRecorded = false;
-    for (size_t i = 0; i < rootNetworks.size(); ++i)
-      if (rootNetworks[i]->mCCVertices.contains(theVertex)) {
-        alreadyRecorded = true;
-        break;
-      }
-    if (alreadyRecorded) continue;
+    if (theVertex->mCCFlag == tmRootNetwork::ALREADY_ADDED) continue;
     tmRootNetwork* newRootNetwork = 
       new tmRootNetwork(theVertex->GetDiscreteDepth());
     newRootNetwork->TryAddVertexToConnectedComponent(theVertex);
@@ -514,6 +483,7 @@ and across different molecules.
 *****/
 void tmTree::CalcFacetOrder()
 {
+  TM_PROFILE_SCOPE("tmTree::CalcFacetOrder");
   // Construct the local root networks, which are the connected components of
   // the graphs composed of local root vertices and creases.
   tmArray<tmRootNetwork*> rootNetworks;
@@ -571,33 +541,70 @@ void tmTree::CalcFacetOrder()
 // END DEBUGGING
 
   // Now, one by one, let the global root network absorb other pieces that are
-  // incident upon it.
-  while (rootNetworks.not_empty()) {
-    bool absorbedOne = false;
-    for (size_t i = 0; i < rootNetworks.size(); ++i) {    
-      tmRootNetwork* theRootNetwork = rootNetworks[i];
-      tmVertex* atVertex;
-      if (globalRootNetwork->CanAbsorb(theRootNetwork, atVertex)) {
-        globalRootNetwork->Absorb(theRootNetwork, atVertex);
-        rootNetworks.erase_remove(theRootNetwork);
-        delete theRootNetwork;
-        absorbedOne = true;
-        break;
+  // incident upon it. A network can be absorbed once one of its root vertices
+  // of degree 1 in the connected component (and of the same depth) is a
+  // non-root axial vertex of some poly of the global root network; we always
+  // absorb the lowest-numbered such network, at the first such vertex we come
+  // to in the global network's polys. Rather than rescanning every poly for
+  // every network each time around, we index the candidate vertices by the
+  // network they belong to, scan each newly-acquired poly of the global
+  // network just once, and keep the networks that have become absorbable in
+  // an ordered queue.
+  const size_t NO_NETWORK = size_t(-1);
+  vector<size_t> cc1Networks(mVertices.size() + 1, NO_NETWORK);
+  for (size_t i = 0; i < rootNetworks.size(); ++i) {
+    tmRootNetwork* theRootNetwork = rootNetworks[i];
+    for (size_t j = 0; j < theRootNetwork->mCC1.size(); ++j)
+      cc1Networks[theRootNetwork->mCC1[j]->mIndex] = i;
+  }
+  vector<tmVertex*> atVertices(rootNetworks.size(), 0);
+  set<size_t> absorbableNetworks;
+  size_t numScannedPolys = 0;
+  size_t numAbsorbed = 0;
+  for (;;) {
+    // Look for attachment points in any polys that the global root network
+    // has acquired since we last looked. thePoly is a poly in the global root
+    // network; theVertex should be one of its non-root axial vertices, i.e., a
+    // potential point of attachment of a lower-depth network. Since we don't
+    // have a list specifically of non-root axial vertices, we go through all
+    // paths of the poly (which own any non-corner axial vertices, which are
+    // all we're interested in) and then through the owned vertices of each.
+    while (numScannedPolys < globalRootNetwork->mCCPolys.size()) {
+      tmPoly* thePoly = globalRootNetwork->mCCPolys[numScannedPolys++];
+      for (size_t j = 0; j < thePoly->mRingPaths.size(); ++j) {
+        tmPath* thePath = thePoly->mRingPaths[j];
+        for (size_t k = 0; k < thePath->mOwnedVertices.size(); ++k) {
+          tmVertex* theVertex = thePath->mOwnedVertices[k];
+          size_t n = cc1Networks[theVertex->mIndex];
+          if (n == NO_NETWORK || atVertices[n]) continue;
+          if (theVertex->mDiscreteDepth != rootNetworks[n]->mDiscreteDepth)
+            continue;
+          atVertices[n] = theVertex;
+          absorbableNetworks.insert(n);
+        }
       }
     }
+    if (absorbableNetworks.empty()) break;
+    size_t n = *absorbableNetworks.begin();
+    absorbableNetworks.erase(absorbableNetworks.begin());
+    globalRootNetwork->Absorb(rootNetworks[n], atVertices[n]);
+    ++numAbsorbed;
+  }
 // DEBUGGING
-//     if (!absorbedOne) {
-//       ofstream fout("ABSORPTION_FAILURE_DUMP.TXT");
-//       fout << "globalRootNetwork" << endl;
-//       globalRootNetwork->PutSelf(fout);
-//       for (size_t i = 0; i < rootNetworks.size(); ++i) {
-//         fout << "rootNetworks[" << i << "]" << endl;
-//         rootNetworks[i]->PutSelf(fout);
-//       }
+//   if (numAbsorbed != rootNetworks.size()) {
+//     ofstream fout("ABSORPTION_FAILURE_DUMP.TXT");
+//     fout << "globalRootNetwork" << endl;
+//     globalRootNetwork->PutSelf(fout);
+//     for (size_t i = 0; i < rootNetworks.size(); ++i) {
+//       if (atVertices[i]) continue;
+//       fout << "rootNetworks[" << i << "]" << endl;
+//       rootNetworks[i]->PutSelf(fout);
 //     }
+//   }
 // END DEBUGGING
-    TMASSERT(absorbedOne);
-  }
+  TMASSERT(numAbsorbed == rootNetworks.size());
+  for (size_t i = 0; i < rootNetworks.size(); ++i)
+    delete rootNetworks[i];
   
   // Last, we break a single link in the giant facet ordering graph, which makes
   // it sortable (if it wasn't already).
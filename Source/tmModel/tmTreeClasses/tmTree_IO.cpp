@@ -10,6 +10,9 @@ Copyright:    ©2003 Robert J. Lang. All Rights Reserved.
 
 #include "tmTree.h"
 #include "tmModel.h"
+#include "tmProfiler.h"
+
+#include <streambuf>
 
 using namespace std;
 
@@ -54,6 +57,29 @@ CHANGES IN VERSION 5
 
 Routines specific to storing or reading version 5 format data are called
 Putv5(..) and Getv5(..).
+
+A version 5 stream carries all of the derived data of the tree -- flags,
+polys, vertices, creases, facets -- as well as the tree itself, so a tree that
+was clean when it was written needs no cleanup when it's read back. The
+stream ends with a "cksm" tag and a checksum of everything before it; earlier
+readers stop before it and never see it. When we read a clean
+tree we take the derived data on trust (unless SetTrustStoredState(false)) and
+leave checking it against the checksum to VerifyStoredState(), which falls
+back to a full cleanup if it doesn't match.
+
+COMPACT VERSION 5
+
+Nearly everything in a version 5 stream can be recomputed from the nodes,
+edges and conditions: there is a path between every pair of nodes, each
+listing all of the nodes and edges between them, so for big trees the paths
+alone make the stream grow as the cube of the number of nodes. A compact
+stream (version "5.0c", written by PutCompactSelf()) holds only the paper
+settings, the tree nodes and edges, the conditions and a flag that says
+whether the tree had polygons. GetSelf() rebuilds the paths directly from the
+edges, runs a full cleanup, and then rebuilds the polygons and crease pattern
+if there were any. Like version 4, it doesn't keep polygons that the user had
+removed from a partly-built crease pattern. The routines are called
+Putv5CompactSelf(..) and Getv5CompactSelf(..).
   
 CHANGES IN VERSION 4
 
@@ -78,6 +104,56 @@ Routines specific to storing or reading version 3 format data are called
 Putv3() and Getv3Self().
 */
 
+/*
+Trust the derived data of trees read from streams
+*/
+bool tmTree::sTrustStoredState = true;
+
+/*
+Tag that precedes the checksum at the end of a version 5 stream
+*/
+static const char CHECKSUM_TAG[] = "cksm";
+
+
+/**********
+class ChecksumBuf
+Stream buffer that computes a 32-bit FNV-1a hash of everything written to it
+and passes it on to another stream buffer, if it has one.
+**********/
+class ChecksumBuf : public streambuf {
+public:
+  ChecksumBuf(streambuf* aDest) : mDest(aDest), mChecksum(2166136261UL) {
+    setp(mBuffer, mBuffer + sizeof(mBuffer));};
+  size_t GetChecksum() {
+    Flush();
+    return mChecksum;};
+protected:
+  int_type overflow(int_type c) {
+    if (!Flush()) return traits_type::eof();
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+      *pptr() = traits_type::to_char_type(c);
+      pbump(1);
+    }
+    return traits_type::not_eof(c);
+  };
+  int sync() {
+    if (!Flush()) return -1;
+    return mDest ? mDest->pubsync() : 0;
+  };
+private:
+  streambuf* mDest;
+  size_t mChecksum;
+  char mBuffer[1024];
+  bool Flush() {
+    streamsize n = pptr() - pbase();
+    for (const char* p = pbase(); p < pptr(); ++p)
+      mChecksum = ((mChecksum ^ (unsigned char)(*p)) * 16777619UL) & 0xFFFFFFFFUL;
+    setp(mBuffer, mBuffer + sizeof(mBuffer));
+    return !mDest || mDest->sputn(mBuffer, n) == n;
+  };
+};
+
+
 #ifdef __MWERKS__
   #pragma mark --PUBLIC--
 #endif
@@ -88,6 +164,7 @@ Put the tree to a stream.
 *****/
 void tmTree::PutSelf(ostream& os)
 {
+  TM_PROFILE_SCOPE("tmTree::PutSelf");
   Putv5Self(os);
 }
 
@@ -101,6 +178,7 @@ valid state.
 *****/
 void tmTree::GetSelf(istream& is)
 {
+  TM_PROFILE_SCOPE("tmTree::GetSelf");
   // Start by looking for the "tree" tag that begins all TreeMaker files. If we
   // don't see it, then something's wrong with the file, so throw an exception.
   try {
@@ -140,10 +218,63 @@ void tmTree::GetSelf(istream& is)
     }
     Getv5Self(is);
   }
+  else if (version == string("5.0c")) {
+    if (GetNumAllParts() > 0) {
+      tmTreeCleaner tc(this);
+      KillAllParts();
+    }
+    Getv5CompactSelf(is);
+  }
   else throw EX_IO_BAD_TREE_VERSION(version);
 }
 
 
+/*****
+STATIC
+Return true if, when we read a tree that was clean when it was written, we
+keep its stored derived data rather than recomputing it.
+*****/
+bool tmTree::GetTrustStoredState()
+{
+  return sTrustStoredState;
+}
+
+
+/*****
+STATIC
+Set whether we trust the derived data of trees that were clean when written.
+Turn this off to always rebuild it with a full cleanup, as if for an old file.
+*****/
+void tmTree::SetTrustStoredState(bool trustStoredState)
+{
+  sTrustStoredState = trustStoredState;
+}
+
+
+/*****
+If the derived data of the tree was read from a stream and taken on trust,
+check it now against the checksum it was written with. If there's no checksum
+or it doesn't match -- the file predates checksums, or was damaged or edited
+by hand -- recompute the derived data with a full cleanup. Return true if the
+stored data was good or there was nothing to check.
+*****/
+bool tmTree::VerifyStoredState()
+{
+  if (!mHasUnverifiedState) return true;
+  TM_PROFILE_SCOPE("tmTree::VerifyStoredState");
+  mHasUnverifiedState = false;
+  if (mHasStoredChecksum) {
+    ChecksumBuf buf(NULL);
+    ostream os(&buf);
+    Putv5Contents(os);
+    if (buf.GetChecksum() == mStoredChecksum) return true;
+  }
+  CleanupAfterEdit();
+  mNeedsCleanup = false;
+  return false;
+}
+
+
 /*****
 Export the tree in version 4 format to a stream
 *****/
@@ -160,6 +291,22 @@ void tmTree::Exportv4(ostream& os)
 }
 
 
+/*****
+Put the tree to a stream in compact version 5 format, which GetSelf() reads
+back by rebuilding everything that isn't stored. As in Exportv4(), we put a
+copy of the tree stripped of its polys and crease pattern, which leaves only
+tree nodes, edges and paths with consecutive indices.
+*****/
+void tmTree::PutCompactSelf(ostream& os)
+{
+  TM_PROFILE_SCOPE("tmTree::PutCompactSelf");
+  tmTree* theTree = Clone();
+  theTree->KillPolysAndCreasePattern();
+  theTree->Putv5CompactSelf(os, !mOwnedPolys.empty());
+  delete theTree;
+}
+
+
 #ifdef __MWERKS__
   #pragma mark -
   #pragma mark --PRIVATE--
@@ -182,15 +329,37 @@ public:
 };
 
 
+
 #ifdef __MWERKS__
   #pragma mark -
 #endif
 
 
 /*****
-Write the tree to a stream in version 5 format
+Write the tree to a stream in version 5 format, followed by the checksum of
+everything we wrote. If the tree's derived data was taken on trust and we
+get the checksum it was read with, the data is the same, so it's verified.
 *****/
 void tmTree::Putv5Self(ostream& os)
+{
+  ChecksumBuf buf(os.rdbuf());
+  ostream cos(&buf);
+  Putv5Contents(cos);
+  cos.flush();
+  if (!cos) os.setstate(ios::badbit);
+  size_t checksum = buf.GetChecksum();
+  if (mHasUnverifiedState && mHasStoredChecksum && 
+    checksum == mStoredChecksum)
+    mHasUnverifiedState = false;
+  PutPOD(os, CHECKSUM_TAG);
+  PutPOD(os, checksum);
+}
+
+
+/*****
+Write everything but the checksum of a version 5 stream
+*****/
+void tmTree::Putv5Contents(ostream& os)
 {
   os.setf(os.fixed, os.floatfield);
   os.precision(10);
@@ -326,14 +495,34 @@ void tmTree::Getv5Self(istream& is)
   GetPtrArray(is, mOwnedPaths);
   GetPtrArray(is, mOwnedPolys);
   
+  // Get the checksum, which streams written before we had them don't have.
+  mHasStoredChecksum = false;
+  if (!is.eof() && is.peek() == CHECKSUM_TAG[0]) {
+    string tag;
+    GetPOD(is, tag);
+    if (tag != CHECKSUM_TAG) throw EX_IO_BAD_TAG(tag);
+    GetPOD(is, mStoredChecksum);
+    mHasStoredChecksum = true;
+  }
+  
   // Eat remaining newlines/whitespace. We don't set eof because we'll not care
   // about extra characters, and we want to be able to re-use is if it's a
   // stringstream.
   ConsumeTrailingSpace(is);
   
+  // If the tree was clean when it was written, we can keep the derived data we
+  // just read and check it later (see VerifyStoredState()). Otherwise, or if
+  // we lost some conditions along the way, it has to be rebuilt now.
+  size_t numMissed = numConditions - mConditions.size();
+  if (sTrustStoredState && !mNeedsCleanup && !numMissed)
+    mHasUnverifiedState = true;
+  else {
+    CleanupAfterEdit();
+    mNeedsCleanup = false;
+  }
+  
   // If we didn't create as many conditions as there were in the file, throw
   // an exception.
-  size_t numMissed = numConditions - mConditions.size();
   if (numMissed) 
     throw EX_IO_UNRECOGNIZED_CONDITION(numMissed);
 }
@@ -423,6 +612,100 @@ void tmTree::Makev5Condition(istream& is)
 #endif
 
 
+/*****
+Write a tree without polys or crease pattern to a stream in compact version 5
+format.
+*****/
+void tmTree::Putv5CompactSelf(ostream& os, bool hasPolys)
+{
+  TMASSERT(mPolys.empty());
+  TMASSERT(mNodes.size() == mOwnedNodes.size());
+  TMASSERT(mEdges.size() == mOwnedEdges.size());
+  os.setf(os.fixed, os.floatfield);
+  os.precision(10);
+  
+  PutPOD(os, GetTagStr());    // put the tag string
+  PutPOD(os, "5.0c");         // put the version
+  
+  // Put the settings of the tree
+  PutPOD(os, mPaperWidth);
+  PutPOD(os, mPaperHeight);
+  PutPOD(os, mScale);
+  
+  PutPOD(os, mHasSymmetry);
+  PutPOD(os, mSymLoc);
+  PutPOD(os, mSymAngle);
+  
+  PutPOD(os, hasPolys);
+  
+  // Put the parts that can't be rebuilt from anything else
+  size_t numNodes = mNodes.size();
+  size_t numEdges = mEdges.size();
+  size_t numConditions = mConditions.size();
+  
+  PutPOD(os, numNodes);
+  PutPOD(os, numEdges);
+  PutPOD(os, numConditions);
+  
+  for (size_t i = 0; i < numNodes; ++i) mNodes[i]->Putv5CompactSelf(os);
+  for (size_t i = 0; i < numEdges; ++i) mEdges[i]->Putv5CompactSelf(os);
+  for (size_t i = 0; i < numConditions; ++i) Putv5Condition(os, mConditions[i]);
+}
+
+
+/*****
+Read the tree from a stream in compact version 5 format and rebuild everything
+that wasn't stored. If there were unrecognized conditions, we'll throw a
+EX_IO_UNRECOGNIZED_CONDITION after the tree is rebuilt.
+*****/
+void tmTree::Getv5CompactSelf(istream& is)
+{
+  GetPOD(is, mPaperWidth);
+  GetPOD(is, mPaperHeight);
+  GetPOD(is, mScale);
+  
+  GetPOD(is, mHasSymmetry);
+  GetPOD(is, mSymLoc);
+  GetPOD(is, mSymAngle);
+  
+  bool hasPolys;
+  GetPOD(is, hasPolys);
+  
+  size_t numNodes, numEdges, numConditions;
+  GetPOD(is, numNodes);
+  GetPOD(is, numEdges);
+  GetPOD(is, numConditions);
+  
+  // Nodes and edges take ownership of themselves as they're read, and each
+  // edge adds itself to its nodes.
+  for (size_t i = 0; i < numNodes; ++i) new tmNode(this);
+  for (size_t i = 0; i < numEdges; ++i) new tmEdge(this);
+  for (size_t i = 0; i < numNodes; ++i) mNodes[i]->Getv5CompactSelf(is);
+  for (size_t i = 0; i < numEdges; ++i) mEdges[i]->Getv5CompactSelf(is);
+  
+  // Path conditions look up their paths as they're read, so the paths have to
+  // exist before the conditions.
+  MakeTreePaths();
+  for (size_t i = 0; i < numConditions; ++i) Makev5Condition(is);
+  
+  ConsumeTrailingSpace(is);
+  
+  // Compute all of the dimensional data, then the polys and crease pattern.
+  CleanupAfterEdit();
+  mNeedsCleanup = false;
+  if (hasPolys) BuildPolysAndCreasePattern();
+  
+  size_t numMissed = numConditions - mConditions.size();
+  if (numMissed) 
+    throw EX_IO_UNRECOGNIZED_CONDITION(numMissed);
+}
+
+
+#ifdef __MWERKS__
+  #pragma mark -
+#endif
+
+
 /*****
 Write an existing tree to a stream in version 4 format.
 *****/
@@ -0,0 +1,982 @@
+/*******************************************************************************
+File:         tmTree_Import.cpp
+Project:      TreeMaker 5.x
+Purpose:      Implementation file for importing trees from CSV and JSON
+Author:       Robert J. Lang
+Modified by:
+Created:      2026-10-19
+Copyright:    ©2026 Robert J. Lang. All Rights Reserved.
+*******************************************************************************/
+
+#include "tmTree.h"
+#include "tmModel.h"
+#include "tmProfiler.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <map>
+#include <sstream>
+
+using namespace std;
+
+/*
+ImportCSV() and ImportJSON() build a tree from a description written by some
+other program (a script, a spreadsheet, a generator of test cases) rather than
+by TreeMaker itself. Both formats describe the same things -- the paper, the
+nodes, the edges and the conditions -- and both are read into the same
+description, which is checked completely before the tree is touched. If
+anything is wrong we throw EX_IO_BAD_TOKEN, whose token says what and where,
+and the tree is left as it was. Otherwise the import replaces whatever the
+tree held, except for the paper, scale and symmetry settings that it doesn't
+mention; the whole thing is built with one call to BuildTree() and one
+cleanup.
+
+Each node has an id, any string, by which edges and conditions refer to it.
+Edges are referred to by their two nodes and paths by their two leaf nodes.
+Lengths are in tree units and locations and angles are in the same units as
+everywhere else: paper units and degrees. Labels longer than MAX_LABEL_LEN are
+cut short.
+
+CSV: one record per line, whose first field says what kind of record it is.
+Blank lines and lines that start with '#' are ignored. A field may be quoted
+with '"', with '""' inside for a quote, so that labels can hold commas. Fields
+in [] may be left off.
+
+  paper,<width>,<height>
+  scale,<scale>
+  symmetry,<x>,<y>,<angle>
+  node,<id>,<x>,<y>[,<label>]
+  edge,<node id>,<node id>,<length>[,<label>[,<strain>[,<stiffness>]]]
+  condition,<kind>,<node ids>[,<values>]
+
+JSON: one object, all of whose members are optional:
+
+  {
+    "paper": {"width": 1, "height": 1},
+    "scale": 0.1,
+    "symmetry": {"x": 0.5, "y": 0.5, "angle": 90},
+    "nodes": [{"id": "a", "x": 0.5, "y": 0.5, "label": "body"}, ...],
+    "edges": [{"nodes": ["a", "b"], "length": 1, "label": "", "strain": 0,
+      "stiffness": 1}, ...],
+    "conditions": [{"kind": "node_fixed", "nodes": ["a"], "x": 0.5}, ...]
+  }
+
+where an id may be a string or a number, edges' lengths default to 1 and
+their strain and stiffness to 0 and 1 as usual.
+
+The kinds of condition, the nodes each takes, and its values (in CSV, in this
+order after the nodes; an empty field leaves a value out) are
+
+  node_symmetric      1 leaf node         on the line of symmetry
+  node_on_edge        1 leaf node         on an edge of the paper
+  node_on_corner      1 leaf node         on a corner of the paper
+  node_fixed          1 leaf node         [x], [y] (at least one)
+  nodes_paired        2 leaf nodes        mirror images about the symmetry line
+  nodes_collinear     3 leaf nodes
+  edge_length_fixed   2 nodes (1 edge)
+  edges_same_strain   4 nodes (2 edges)
+  path_active         2 leaf nodes
+  path_angle_fixed    2 leaf nodes        angle
+  path_angle_quant    2 leaf nodes        quant, [offset]
+*/
+
+namespace {
+
+/*****
+The kinds of conditions that can be imported, in the order of CONDITION_KINDS
+*****/
+enum {
+  NODE_SYMMETRIC,
+  NODE_ON_EDGE,
+  NODE_ON_CORNER,
+  NODE_FIXED,
+  NODES_PAIRED,
+  NODES_COLLINEAR,
+  EDGE_LENGTH_FIXED,
+  EDGES_SAME_STRAIN,
+  PATH_ACTIVE,
+  PATH_ANGLE_FIXED,
+  PATH_ANGLE_QUANT,
+  NUM_CONDITION_KINDS
+};
+
+
+/*****
+What each kind of condition takes
+*****/
+struct ConditionKind {
+  const char* mName;              // name in the file
+  size_t mNumNodes;               // number of node ids
+  size_t mNumValues;              // number of values, at most 2
+  size_t mNumRequired;            // ... of which must be given
+  const char* mValueNames[2];     // member names of the values in JSON
+};
+
+const ConditionKind CONDITION_KINDS[NUM_CONDITION_KINDS] = {
+  {"node_symmetric", 1, 0, 0, {0, 0}},
+  {"node_on_edge", 1, 0, 0, {0, 0}},
+  {"node_on_corner", 1, 0, 0, {0, 0}},
+  {"node_fixed", 1, 2, 0, {"x", "y"}},
+  {"nodes_paired", 2, 0, 0, {0, 0}},
+  {"nodes_collinear", 3, 0, 0, {0, 0}},
+  {"edge_length_fixed", 2, 0, 0, {0, 0}},
+  {"edges_same_strain", 4, 0, 0, {0, 0}},
+  {"path_active", 2, 0, 0, {0, 0}},
+  {"path_angle_fixed", 2, 1, 1, {"angle", 0}},
+  {"path_angle_quant", 2, 2, 1, {"quant", "offset"}}
+};
+
+
+/*****
+One imported condition
+*****/
+struct ConditionDesc {
+  size_t mKind;                   // index into CONDITION_KINDS
+  vector<size_t> mNodes;          // indices into TreeDesc::mNodes
+  bool mHasValue[2];
+  tmFloat mValue[2];
+  string mWhere;                  // where it was read, for messages
+};
+
+
+/*****
+Everything an import describes
+*****/
+struct TreeDesc {
+  bool mHasPaper;
+  tmFloat mPaperWidth;
+  tmFloat mPaperHeight;
+  bool mHasScale;
+  tmFloat mScale;
+  bool mHasSymmetry;
+  tmPoint mSymLoc;
+  tmFloat mSymAngle;
+  vector<tmTree::NodeDesc> mNodes;
+  vector<tmTree::EdgeDesc> mEdges;
+  vector<ConditionDesc> mConditions;
+  map<string, size_t> mNodeIndex;                 // node index by id
+  map<pair<size_t, size_t>, size_t> mEdgeIndex;   // edge index by nodes
+  TreeDesc() : mHasPaper(false), mPaperWidth(1), mPaperHeight(1),
+    mHasScale(false), mScale(1), mHasSymmetry(false), mSymLoc(0, 0),
+    mSymAngle(0) {};
+};
+
+
+/*****
+Throw an exception that says what went wrong where.
+*****/
+void Fail(const string& where, const string& what)
+{
+  throw tmTree::EX_IO_BAD_TOKEN(where + ": " + what);
+}
+
+
+/*****
+Return the number in string s, which must hold nothing else.
+*****/
+tmFloat ToFloat(const string& s, const string& where)
+{
+  const char* start = s.c_str();
+  char* end;
+  double x = strtod(start, &end);
+  while (*end == ' ' || *end == '\t') ++end;
+  if (end == start || *end) Fail(where, "\"" + s + "\" is not a number");
+  return x;
+}
+
+
+/*****
+Add a node with the given id to the description.
+*****/
+void AddNodeDesc(TreeDesc& d, const string& id, const tmPoint& loc,
+  const string& label, const string& where)
+{
+  if (id.empty()) Fail(where, "node has no id");
+  if (d.mNodeIndex.count(id)) Fail(where, "node \"" + id + "\" is repeated");
+  d.mNodeIndex[id] = d.mNodes.size();
+  d.mNodes.push_back(tmTree::NodeDesc(loc, label));
+}
+
+
+/*****
+Return the index of the node with the given id.
+*****/
+size_t FindNodeDesc(const TreeDesc& d, const string& id, const string& where)
+{
+  map<string, size_t>::const_iterator it = d.mNodeIndex.find(id);
+  if (it == d.mNodeIndex.end()) Fail(where, "no node \"" + id + "\"");
+  return it->second;
+}
+
+
+/*****
+Add an edge between the nodes with the given ids to the description.
+*****/
+void AddEdgeDesc(TreeDesc& d, const string& id1, const string& id2,
+  const tmFloat& length, const string& where)
+{
+  size_t n1 = FindNodeDesc(d, id1, where);
+  size_t n2 = FindNodeDesc(d, id2, where);
+  if (n1 == n2) Fail(where, "edge joins node \"" + id1 + "\" to itself");
+  if (length <= 0) Fail(where, "edge length must be positive");
+  pair<size_t, size_t> key(min(n1, n2), max(n1, n2));
+  if (d.mEdgeIndex.count(key)) Fail(where, "edge is repeated");
+  d.mEdgeIndex[key] = d.mEdges.size();
+  d.mEdges.push_back(tmTree::EdgeDesc(n1, n2, length));
+}
+
+
+/*****
+Return the index of the kind of condition with the given name.
+*****/
+size_t FindConditionKind(const string& name, const string& where)
+{
+  for (size_t i = 0; i < NUM_CONDITION_KINDS; ++i)
+    if (name == CONDITION_KINDS[i].mName) return i;
+  Fail(where, "unknown condition \"" + name + "\"");
+  return 0;
+}
+
+
+/*****
+Return the index of the edge between nodes n1 and n2 of the description.
+*****/
+size_t FindEdgeDesc(const TreeDesc& d, size_t n1, size_t n2,
+  const string& where)
+{
+  map<pair<size_t, size_t>, size_t>::const_iterator it =
+    d.mEdgeIndex.find(make_pair(min(n1, n2), max(n1, n2)));
+  if (it == d.mEdgeIndex.end()) Fail(where, "nodes are not joined by an edge");
+  return it->second;
+}
+
+
+/*****
+Check everything about the description that could make building the tree
+fail, so that we find out before we've thrown the old tree away.
+*****/
+void CheckTreeDesc(const TreeDesc& d, const string& where)
+{
+  if (d.mHasPaper && (d.mPaperWidth <= 0 || d.mPaperHeight <= 0))
+    Fail(where, "paper size must be positive");
+  if (d.mHasScale && d.mScale <= 0) Fail(where, "scale must be positive");
+  if (!tmTree::CanBuildTree(d.mNodes.size(), d.mEdges))
+    Fail(where, "edges do not join the nodes into a single tree");
+  vector<size_t> degree(d.mNodes.size(), 0);
+  for (size_t i = 0; i < d.mEdges.size(); ++i) {
+    degree[d.mEdges[i].mNode1]++;
+    degree[d.mEdges[i].mNode2]++;
+  }
+  for (size_t i = 0; i < d.mConditions.size(); ++i) {
+    const ConditionDesc& c = d.mConditions[i];
+    const vector<size_t>& n = c.mNodes;
+    for (size_t j = 0; j < n.size(); ++j)
+      for (size_t k = j + 1; k < n.size(); ++k)
+        if (n[j] == n[k] && c.mKind != EDGES_SAME_STRAIN)
+          Fail(c.mWhere, "condition names a node twice");
+    switch (c.mKind) {
+      case NODE_FIXED:
+        if (!c.mHasValue[0] && !c.mHasValue[1])
+          Fail(c.mWhere, "node_fixed needs x or y");
+        // fall through
+      case NODE_SYMMETRIC:
+      case NODE_ON_EDGE:
+      case NODE_ON_CORNER:
+      case NODES_PAIRED:
+      case NODES_COLLINEAR:
+        for (size_t j = 0; j < n.size(); ++j)
+          if (degree[n[j]] > 1)
+            Fail(c.mWhere, "node condition needs leaf nodes");
+        break;
+      case EDGE_LENGTH_FIXED:
+        FindEdgeDesc(d, n[0], n[1], c.mWhere);
+        break;
+      case EDGES_SAME_STRAIN:
+        if (FindEdgeDesc(d, n[0], n[1], c.mWhere) ==
+          FindEdgeDesc(d, n[2], n[3], c.mWhere))
+          Fail(c.mWhere, "condition names an edge twice");
+        break;
+      case PATH_ACTIVE:
+      case PATH_ANGLE_FIXED:
+      case PATH_ANGLE_QUANT:
+        if (degree[n[0]] > 1 || degree[n[1]] > 1)
+          Fail(c.mWhere, "path condition needs two leaf nodes");
+        if (c.mKind == PATH_ANGLE_QUANT &&
+          (c.mValue[0] < 1 || c.mValue[0] != size_t(c.mValue[0])))
+          Fail(c.mWhere, "quant must be a positive whole number");
+        break;
+    }
+  }
+}
+
+
+/*****
+Replace the contents of theTree with the checked description d, with a single
+cleanup at the end.
+*****/
+void BuildTreeDesc(tmTree* theTree, const TreeDesc& d)
+{
+  tmTreeCleaner tc(theTree);
+  theTree->KillAllParts();
+  if (d.mHasPaper) {
+    theTree->SetPaperWidth(d.mPaperWidth);
+    theTree->SetPaperHeight(d.mPaperHeight);
+  }
+  if (d.mHasScale) theTree->SetScale(d.mScale);
+  if (d.mHasSymmetry) theTree->SetSymmetry(d.mSymLoc, d.mSymAngle);
+  tmArray<tmNode*> nodes;
+  tmArray<tmEdge*> edges;
+  theTree->BuildTree(d.mNodes, d.mEdges, nodes, edges);
+  for (size_t i = 0; i < d.mConditions.size(); ++i) {
+    const ConditionDesc& c = d.mConditions[i];
+    const vector<size_t>& n = c.mNodes;
+    tmArray<tmNode*> nodeList;
+    tmArray<tmEdge*> edgeList;
+    tmArray<tmPath*> pathList;
+    switch (c.mKind) {
+      case NODE_SYMMETRIC:
+      case NODE_ON_EDGE:
+      case NODE_ON_CORNER:
+      case NODE_FIXED:
+        nodeList.push_back(nodes[n[0]]);
+        break;
+      case EDGE_LENGTH_FIXED:
+      case EDGES_SAME_STRAIN:
+        for (size_t j = 0; j < n.size(); j += 2)
+          edgeList.push_back(edges[FindEdgeDesc(d, n[j], n[j + 1], c.mWhere)]);
+        break;
+      case PATH_ACTIVE:
+      case PATH_ANGLE_FIXED:
+      case PATH_ANGLE_QUANT:
+        pathList.push_back(theTree->GetLeafPath(nodes[n[0]], nodes[n[1]]));
+        break;
+    }
+    switch (c.mKind) {
+      case NODE_SYMMETRIC:
+        theTree->SetNodesFixedToSymmetryLine(nodeList);
+        break;
+      case NODE_ON_EDGE:
+        theTree->SetNodesFixedToPaperEdge(nodeList);
+        break;
+      case NODE_ON_CORNER:
+        theTree->SetNodesFixedToPaperCorner(nodeList);
+        break;
+      case NODE_FIXED:
+        theTree->SetNodesFixedToPosition(nodeList, c.mHasValue[0],
+          c.mValue[0], c.mHasValue[1], c.mValue[1]);
+        break;
+      case NODES_PAIRED:
+        theTree->MakeTwoPartCondition<tmConditionNodesPaired, tmNode>(
+          nodes[n[0]], nodes[n[1]]);
+        break;
+      case NODES_COLLINEAR:
+        theTree->MakeThreePartCondition<tmConditionNodesCollinear, tmNode>(
+          nodes[n[0]], nodes[n[1]], nodes[n[2]]);
+        break;
+      case EDGE_LENGTH_FIXED:
+        theTree->MakeOnePartCondition<tmConditionEdgeLengthFixed, tmEdge>(
+          edgeList[0]);
+        break;
+      case EDGES_SAME_STRAIN:
+        theTree->SetEdgesSameStrain(edgeList);
+        break;
+      case PATH_ACTIVE:
+        theTree->SetPathsActive(pathList);
+        break;
+      case PATH_ANGLE_FIXED:
+        theTree->SetPathsAngleFixed(pathList, c.mValue[0]);
+        break;
+      case PATH_ANGLE_QUANT:
+        theTree->SetPathsAngleQuant(pathList, size_t(c.mValue[0]),
+          c.mHasValue[1] ? c.mValue[1] : 0);
+        break;
+    }
+  }
+}
+
+
+#ifdef __MWERKS__
+#pragma mark -
+#endif
+
+
+/*****
+Split one line of CSV into its fields.
+*****/
+void SplitCSVLine(const string& line, vector<string>& fields,
+  const string& where)
+{
+  fields.clear();
+  size_t i = 0;
+  for (;;) {
+    string field;
+    while (i < line.size() && (line[i] == ' ' || line[i] == '\t')) ++i;
+    if (i < line.size() && line[i] == '"') {
+      ++i;
+      for (;;) {
+        if (i >= line.size()) Fail(where, "unterminated quote");
+        if (line[i] == '"') {
+          if (i + 1 < line.size() && line[i + 1] == '"') {
+            field += '"';
+            i += 2;
+          }
+          else {
+            ++i;
+            break;
+          }
+        }
+        else field += line[i++];
+      }
+      while (i < line.size() && (line[i] == ' ' || line[i] == '\t')) ++i;
+      if (i < line.size() && line[i] != ',')
+        Fail(where, "text after closing quote");
+    }
+    else {
+      while (i < line.size() && line[i] != ',') field += line[i++];
+      size_t end = field.find_last_not_of(" \t");
+      field.erase(end == string::npos ? 0 : end + 1);
+    }
+    fields.push_back(field);
+    if (i >= line.size()) break;
+    ++i;  // skip the comma
+  }
+}
+
+
+/*****
+Read a CSV description of a tree.
+*****/
+void ReadCSV(istream& is, TreeDesc& d)
+{
+  string line;
+  vector<string> f;
+  size_t lineNum = 0;
+  while (getline(is, line)) {
+    ++lineNum;
+    if (!line.empty() && line[line.size() - 1] == '\r')
+      line.erase(line.size() - 1);
+    if (line.find_first_not_of(" \t") == string::npos) continue;
+    if (line[line.find_first_not_of(" \t")] == '#') continue;
+    stringstream ss;
+    ss << "line " << lineNum;
+    string where = ss.str();
+    SplitCSVLine(line, f, where);
+    const string& kind = f[0];
+    if (kind == "paper") {
+      if (f.size() != 3) Fail(where, "paper needs width and height");
+      d.mHasPaper = true;
+      d.mPaperWidth = ToFloat(f[1], where);
+      d.mPaperHeight = ToFloat(f[2], where);
+    }
+    else if (kind == "scale") {
+      if (f.size() != 2) Fail(where, "scale needs one value");
+      d.mHasScale = true;
+      d.mScale = ToFloat(f[1], where);
+    }
+    else if (kind == "symmetry") {
+      if (f.size() != 4) Fail(where, "symmetry needs x, y and angle");
+      d.mHasSymmetry = true;
+      d.mSymLoc = tmPoint(ToFloat(f[1], where), ToFloat(f[2], where));
+      d.mSymAngle = ToFloat(f[3], where);
+    }
+    else if (kind == "node") {
+      if (f.size() < 4 || f.size() > 5)
+        Fail(where, "node needs id, x, y and optional label");
+      tmPoint loc(ToFloat(f[2], where), ToFloat(f[3], where));
+      AddNodeDesc(d, f[1], loc, f.size() > 4 ? f[4] : "", where);
+    }
+    else if (kind == "edge") {
+      if (f.size() < 4 || f.size() > 7) Fail(where,
+        "edge needs two node ids, length and optional label, strain, "
+        "stiffness");
+      AddEdgeDesc(d, f[1], f[2], ToFloat(f[3], where), where);
+      tmTree::EdgeDesc& e = d.mEdges.back();
+      if (f.size() > 4) e.mLabel = f[4];
+      if (f.size() > 5 && !f[5].empty()) e.mStrain = ToFloat(f[5], where);
+      if (f.size() > 6 && !f[6].empty()) e.mStiffness = ToFloat(f[6], where);
+    }
+    else if (kind == "condition") {
+      if (f.size() < 2) Fail(where, "condition needs a kind");
+      ConditionDesc c;
+      c.mKind = FindConditionKind(f[1], where);
+      c.mWhere = where;
+      const ConditionKind& k = CONDITION_KINDS[c.mKind];
+      if (f.size() < 2 + k.mNumNodes + k.mNumRequired ||
+        f.size() > 2 + k.mNumNodes + k.mNumValues) {
+        stringstream msg;
+        msg << f[1] << " needs " << k.mNumNodes << " node ids";
+        if (k.mNumValues) msg << " and up to " << k.mNumValues << " values";
+        Fail(where, msg.str());
+      }
+      for (size_t i = 0; i < k.mNumNodes; ++i)
+        c.mNodes.push_back(FindNodeDesc(d, f[2 + i], where));
+      for (size_t i = 0; i < 2; ++i) {
+        size_t fi = 2 + k.mNumNodes + i;
+        c.mHasValue[i] = fi < f.size() && !f[fi].empty();
+        c.mValue[i] = c.mHasValue[i] ? ToFloat(f[fi], where) : 0;
+        if (i < k.mNumRequired && !c.mHasValue[i])
+          Fail(where, string(f[1]) + " needs " + k.mValueNames[i]);
+      }
+      d.mConditions.push_back(c);
+    }
+    else Fail(where, "unknown record \"" + kind + "\"");
+  }
+}
+
+
+#ifdef __MWERKS__
+#pragma mark -
+#endif
+
+
+/*****
+A parsed JSON value. Numbers also keep the text they were written as, so that
+a number can serve as a node id.
+*****/
+struct JSONValue {
+  enum Type {NUL, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT};
+  Type mType;
+  bool mBool;
+  double mNumber;
+  string mString;
+  vector<JSONValue> mArray;
+  vector<pair<string, JSONValue> > mObject;
+  size_t mLine;                   // line on which it started
+  JSONValue() : mType(NUL), mBool(false), mNumber(0), mLine(0) {};
+  const JSONValue* Find(const char* name) const;
+  string Where() const;
+};
+
+
+/*****
+Return the member of an object with the given name, or 0 if it has none.
+*****/
+const JSONValue* JSONValue::Find(const char* name) const
+{
+  for (size_t i = 0; i < mObject.size(); ++i)
+    if (mObject[i].first == name) return &mObject[i].second;
+  return 0;
+}
+
+
+/*****
+Return where the value was read, for messages.
+*****/
+string JSONValue::Where() const
+{
+  stringstream ss;
+  ss << "line " << mLine;
+  return ss.str();
+}
+
+
+/*****
+Reads JSON text, keeping count of lines for messages.
+*****/
+class JSONReader {
+public:
+  JSONReader(istream& is) : mIs(is), mLine(1) {};
+  void ReadDocument(JSONValue& v);
+private:
+  istream& mIs;
+  size_t mLine;
+  string Where() const;
+  int Peek();
+  int Get();
+  void SkipSpace();
+  void Expect(char c);
+  void ReadValue(JSONValue& v);
+  void ReadString(string& s);
+  void ReadNumber(JSONValue& v);
+  void ReadWord(const char* word);
+};
+
+
+/*****
+Return where we are, for messages.
+*****/
+string JSONReader::Where() const
+{
+  stringstream ss;
+  ss << "line " << mLine;
+  return ss.str();
+}
+
+
+/*****
+Return the next character without consuming it, or EOF.
+*****/
+int JSONReader::Peek()
+{
+  return mIs.peek();
+}
+
+
+/*****
+Consume and return the next character, or EOF.
+*****/
+int JSONReader::Get()
+{
+  int c = mIs.get();
+  if (c == '\n') ++mLine;
+  return c;
+}
+
+
+/*****
+Skip white space.
+*****/
+void JSONReader::SkipSpace()
+{
+  for (;;) {
+    int c = Peek();
+    if (c != ' ' && c != '\t' && c != '\n' && c != '\r') return;
+    Get();
+  }
+}
+
+
+/*****
+Skip white space, then consume character c, which must be next.
+*****/
+void JSONReader::Expect(char c)
+{
+  SkipSpace();
+  if (Get() != c) Fail(Where(), string("expected '") + c + "'");
+}
+
+
+/*****
+Read a whole document, which must be a single value.
+*****/
+void JSONReader::ReadDocument(JSONValue& v)
+{
+  ReadValue(v);
+  SkipSpace();
+  if (Peek() != EOF) Fail(Where(), "text after end of document");
+}
+
+
+/*****
+Read any value.
+*****/
+void JSONReader::ReadValue(JSONValue& v)
+{
+  SkipSpace();
+  v.mLine = mLine;
+  int c = Peek();
+  switch (c) {
+    case '{':
+      v.mType = JSONValue::OBJECT;
+      Get();
+      SkipSpace();
+      if (Peek() == '}') {
+        Get();
+        return;
+      }
+      for (;;) {
+        v.mObject.push_back(make_pair(string(), JSONValue()));
+        SkipSpace();
+        if (Peek() != '"') Fail(Where(), "expected member name");
+        ReadString(v.mObject.back().first);
+        Expect(':');
+        ReadValue(v.mObject.back().second);
+        SkipSpace();
+        c = Get();
+        if (c == '}') return;
+        if (c != ',') Fail(Where(), "expected ',' or '}'");
+      }
+    case '[':
+      v.mType = JSONValue::ARRAY;
+      Get();
+      SkipSpace();
+      if (Peek() == ']') {
+        Get();
+        return;
+      }
+      for (;;) {
+        v.mArray.push_back(JSONValue());
+        ReadValue(v.mArray.back());
+        SkipSpace();
+        c = Get();
+        if (c == ']') return;
+        if (c != ',') Fail(Where(), "expected ',' or ']'");
+      }
+    case '"':
+      v.mType = JSONValue::STRING;
+      ReadString(v.mString);
+      return;
+    case 't':
+      v.mType = JSONValue::BOOLEAN;
+      v.mBool = true;
+      ReadWord("true");
+      return;
+    case 'f':
+      v.mType = JSONValue::BOOLEAN;
+      ReadWord("false");
+      return;
+    case 'n':
+      ReadWord("null");
+      return;
+    case EOF:
+      Fail(Where(), "unexpected end of document");
+      return;
+    default:
+      ReadNumber(v);
+  }
+}
+
+
+/*****
+Read a string, turning escapes into the characters they stand for (as UTF-8).
+*****/
+void JSONReader::ReadString(string& s)
+{
+  Get();  // the opening quote
+  s.clear();
+  for (;;) {
+    int c = Get();
+    if (c == EOF || c == '\n') Fail(Where(), "unterminated string");
+    if (c == '"') return;
+    if (c != '\\') {
+      s += char(c);
+      continue;
+    }
+    c = Get();
+    switch (c) {
+      case '"': case '\\': case '/': s += char(c); break;
+      case 'b': s += '\b'; break;
+      case 'f': s += '\f'; break;
+      case 'n': s += '\n'; break;
+      case 'r': s += '\r'; break;
+      case 't': s += '\t'; break;
+      case 'u': {
+        unsigned long u = 0;
+        for (size_t i = 0; i < 4; ++i) {
+          c = Get();
+          if (!isxdigit(c)) Fail(Where(), "bad \\u escape");
+          u = 16 * u + (isdigit(c) ? c - '0' : (tolower(c) - 'a' + 10));
+        }
+        if (u < 0x80) s += char(u);
+        else if (u < 0x800) {
+          s += char(0xC0 | (u >> 6));
+          s += char(0x80 | (u & 0x3F));
+        }
+        else {
+          s += char(0xE0 | (u >> 12));
+          s += char(0x80 | ((u >> 6) & 0x3F));
+          s += char(0x80 | (u & 0x3F));
+        }
+        break;
+      }
+      default:
+        Fail(Where(), "bad escape in string");
+    }
+  }
+}
+
+
+/*****
+Read a number.
+*****/
+void JSONReader::ReadNumber(JSONValue& v)
+{
+  v.mType = JSONValue::NUMBER;
+  for (;;) {
+    int c = Peek();
+    if (!isdigit(c) && c != '-' && c != '+' && c != '.' && c != 'e' &&
+      c != 'E') break;
+    v.mString += char(Get());
+  }
+  if (v.mString.empty()) Fail(Where(), "unexpected character");
+  v.mNumber = ToFloat(v.mString, Where());
+}
+
+
+/*****
+Read one of the words true, false and null.
+*****/
+void JSONReader::ReadWord(const char* word)
+{
+  for (const char* p = word; *p; ++p)
+    if (Get() != *p) Fail(Where(), "unexpected character");
+}
+
+
+/*****
+Return the number that is member name of object v, or dflt if there's no such
+member. If required, there must be one.
+*****/
+tmFloat GetJSONNumber(const JSONValue& v, const char* name, tmFloat dflt,
+  bool required, bool* found = 0)
+{
+  const JSONValue* m = v.Find(name);
+  if (found) *found = (m != 0);
+  if (!m) {
+    if (required) Fail(v.Where(), string("missing \"") + name + "\"");
+    return dflt;
+  }
+  if (m->mType != JSONValue::NUMBER)
+    Fail(m->Where(), string("\"") + name + "\" must be a number");
+  return m->mNumber;
+}
+
+
+/*****
+Return the string that is member name of object v, or "" if there's none.
+*****/
+string GetJSONString(const JSONValue& v, const char* name)
+{
+  const JSONValue* m = v.Find(name);
+  if (!m) return "";
+  if (m->mType != JSONValue::STRING)
+    Fail(m->Where(), string("\"") + name + "\" must be a string");
+  return m->mString;
+}
+
+
+/*****
+Return the member name of object v, which must be an array if it exists.
+*****/
+const JSONValue* GetJSONArray(const JSONValue& v, const char* name)
+{
+  const JSONValue* m = v.Find(name);
+  if (m && m->mType != JSONValue::ARRAY)
+    Fail(m->Where(), string("\"") + name + "\" must be an array");
+  return m;
+}
+
+
+/*****
+Return the node id that is value v.
+*****/
+string GetJSONId(const JSONValue& v)
+{
+  if (v.mType != JSONValue::STRING && v.mType != JSONValue::NUMBER)
+    Fail(v.Where(), "node id must be a string or number");
+  return v.mString;
+}
+
+
+/*****
+Check that v is an object.
+*****/
+void CheckJSONObject(const JSONValue& v, const char* what)
+{
+  if (v.mType != JSONValue::OBJECT)
+    Fail(v.Where(), string(what) + " must be an object");
+}
+
+
+/*****
+Read a JSON description of a tree.
+*****/
+void ReadJSON(istream& is, TreeDesc& d)
+{
+  JSONValue root;
+  JSONReader(is).ReadDocument(root);
+  CheckJSONObject(root, "document");
+  if (const JSONValue* paper = root.Find("paper")) {
+    CheckJSONObject(*paper, "paper");
+    d.mHasPaper = true;
+    d.mPaperWidth = GetJSONNumber(*paper, "width", 0, true);
+    d.mPaperHeight = GetJSONNumber(*paper, "height", 0, true);
+  }
+  d.mScale = GetJSONNumber(root, "scale", 1, false, &d.mHasScale);
+  if (const JSONValue* sym = root.Find("symmetry")) {
+    CheckJSONObject(*sym, "symmetry");
+    d.mHasSymmetry = true;
+    d.mSymLoc = tmPoint(GetJSONNumber(*sym, "x", 0, true),
+      GetJSONNumber(*sym, "y", 0, true));
+    d.mSymAngle = GetJSONNumber(*sym, "angle", 0, true);
+  }
+  if (const JSONValue* nodes = GetJSONArray(root, "nodes")) {
+    for (size_t i = 0; i < nodes->mArray.size(); ++i) {
+      const JSONValue& n = nodes->mArray[i];
+      CheckJSONObject(n, "node");
+      const JSONValue* id = n.Find("id");
+      if (!id) Fail(n.Where(), "node has no id");
+      tmPoint loc(GetJSONNumber(n, "x", 0, true),
+        GetJSONNumber(n, "y", 0, true));
+      AddNodeDesc(d, GetJSONId(*id), loc, GetJSONString(n, "label"),
+        n.Where());
+    }
+  }
+  if (const JSONValue* edges = GetJSONArray(root, "edges")) {
+    for (size_t i = 0; i < edges->mArray.size(); ++i) {
+      const JSONValue& e = edges->mArray[i];
+      CheckJSONObject(e, "edge");
+      const JSONValue* ends = GetJSONArray(e, "nodes");
+      if (!ends || ends->mArray.size() != 2)
+        Fail(e.Where(), "edge needs \"nodes\" with two node ids");
+      AddEdgeDesc(d, GetJSONId(ends->mArray[0]), GetJSONId(ends->mArray[1]),
+        GetJSONNumber(e, "length", 1, false), e.Where());
+      tmTree::EdgeDesc& theDesc = d.mEdges.back();
+      theDesc.mLabel = GetJSONString(e, "label");
+      theDesc.mStrain = GetJSONNumber(e, "strain", 0, false);
+      theDesc.mStiffness = GetJSONNumber(e, "stiffness", 1, false);
+    }
+  }
+  if (const JSONValue* conds = GetJSONArray(root, "conditions")) {
+    for (size_t i = 0; i < conds->mArray.size(); ++i) {
+      const JSONValue& cv = conds->mArray[i];
+      CheckJSONObject(cv, "condition");
+      ConditionDesc c;
+      c.mWhere = cv.Where();
+      string kind = GetJSONString(cv, "kind");
+      c.mKind = FindConditionKind(kind, c.mWhere);
+      const ConditionKind& k = CONDITION_KINDS[c.mKind];
+      const JSONValue* ids = GetJSONArray(cv, "nodes");
+      if (!ids || ids->mArray.size() != k.mNumNodes) {
+        stringstream msg;
+        msg << kind << " needs " << k.mNumNodes << " node ids";
+        Fail(c.mWhere, msg.str());
+      }
+      for (size_t j = 0; j < k.mNumNodes; ++j)
+        c.mNodes.push_back(FindNodeDesc(d, GetJSONId(ids->mArray[j]),
+          c.mWhere));
+      for (size_t j = 0; j < 2; ++j) {
+        c.mHasValue[j] = false;
+        c.mValue[j] = j < k.mNumValues ? GetJSONNumber(cv, k.mValueNames[j],
+          0, j < k.mNumRequired, &c.mHasValue[j]) : 0;
+      }
+      d.mConditions.push_back(c);
+    }
+  }
+}
+
+} // namespace
+
+
+/**********
+class tmTree
+Import routines
+**********/
+
+/*****
+Replace the tree with the one described by CSV text from the stream. See the
+top of this file for the format.
+*****/
+void tmTree::ImportCSV(istream& is)
+{
+  TM_PROFILE_SCOPE("tmTree::ImportCSV");
+  TreeDesc d;
+  ReadCSV(is, d);
+  CheckTreeDesc(d, "CSV");
+  BuildTreeDesc(this, d);
+}
+
+
+/*****
+Replace the tree with the one described by JSON text from the stream. See the
+top of this file for the format.
+*****/
+void tmTree::ImportJSON(istream& is)
+{
+  TM_PROFILE_SCOPE("tmTree::ImportJSON");
+  TreeDesc d;
+  ReadJSON(is, d);
+  CheckTreeDesc(d, "JSON");
+  BuildTreeDesc(this, d);
+}
@@ -393,6 +393,27 @@ void tmVertex::Getv5Self(istream& is)
 }
 
 
+/*****
+Copy a tmVertex of another tree
+*****/
+void tmVertex::CopySelf(tmVertex* aVertex)
+{
+  mIndex = aVertex->mIndex;
+  mLoc = aVertex->mLoc;
+  mElevation = aVertex->mElevation;
+  mIsBorderVertex = aVertex->mIsBorderVertex;
+  mTree->CopyPtr(mTreeNode, aVertex->mTreeNode);
+  mTree->CopyPtr(mLeftPseudohingeMate, aVertex->mLeftPseudohingeMate);
+  mTree->CopyPtr(mRightPseudohingeMate, aVertex->mRightPseudohingeMate);
+  mTree->CopyPtrArray(mCreases, aVertex->mCreases);
+  mDepth = aVertex->mDepth;
+  mDiscreteDepth = aVertex->mDiscreteDepth;
+  mCCFlag = aVertex->mCCFlag;
+  mSTFlag = aVertex->mSTFlag;
+  mTree->CopyOwnerPtr(mVertexOwner, aVertex->mVertexOwner);
+}
+
+
 /*****
 Put a tmVertex in version 4 format
 *****/
@@ -418,3 +439,4 @@ void tmVertex::Getv4Self(istream& is)
 Dynamic type implementation
 *****/
 TM_IMPLEMENT_TAG(tmVertex, "vrtx")
+TM_IMPLEMENT_POOL(tmVertex)
@@ -157,9 +157,15 @@ private:
   void Putv4Self(std::ostream& os);
   void Getv4Self(std::istream& is);
   
+  // Structural copy
+  void CopySelf(tmVertex* aVertex);
+  
   // Class tag for stream I/O
   TM_DECLARE_TAG()
   
+  // Memory comes from a pool
+  TM_DECLARE_POOL()
+  
   // Friend classes
   friend class tmPart;
   friend class tmPart::StringT<tmVertex>;
@@ -25,6 +25,7 @@ Copyright:    ©2003 Robert J. Lang. All Rights Reserved.
 #include "tmwxHtmlHelpFrame.h"
 
 #include "tmVersion.h"
+#include "tmProfiler.h"
 
 // Additional wxWidgets headers
 #include "wx/docview.h"
@@ -43,6 +44,9 @@ Copyright:    ©2003 Robert J. Lang. All Rights Reserved.
 #include "wx/ipc.h"
 #include "wx/artprov.h"
 
+// Standard libraries
+#include <fstream>
+
 // use GNOME print dialog & engine if available
 #if wxUSE_LIBGNOMEPRINT
   #include "wx/html/forcelnk.h"
@@ -151,6 +155,16 @@ tmwxApp::tmwxApp() : wxApp() {
 	Bind(wxEVT_UPDATE_UI, &tmwxApp::OnAppDebugAction1UpdateUI, this, tmwxID_APP_DEBUG_ACTION_1);
 	Bind(wxEVT_MENU,      &tmwxApp::OnAppDebugAction1,         this, tmwxID_APP_DEBUG_ACTION_1);
 #endif // TMDEBUG
+
+#ifdef TMPROFILE
+	// Profile menu
+	Bind(wxEVT_UPDATE_UI, &tmwxApp::OnLogProfileUpdateUI,       this, tmwxID_LOG_PROFILE);
+	Bind(wxEVT_MENU,      &tmwxApp::OnLogProfile,               this, tmwxID_LOG_PROFILE);
+	Bind(wxEVT_UPDATE_UI, &tmwxApp::OnSaveProfileTraceUpdateUI, this, tmwxID_SAVE_PROFILE_TRACE);
+	Bind(wxEVT_MENU,      &tmwxApp::OnSaveProfileTrace,         this, tmwxID_SAVE_PROFILE_TRACE);
+	Bind(wxEVT_UPDATE_UI, &tmwxApp::OnResetProfileUpdateUI,     this, tmwxID_RESET_PROFILE);
+	Bind(wxEVT_MENU,      &tmwxApp::OnResetProfile,             this, tmwxID_RESET_PROFILE);
+#endif // TMPROFILE
 	
 	// Help menu
 	Bind(wxEVT_MENU, &tmwxApp::OnAbout, this, wxID_ABOUT);
@@ -619,6 +633,10 @@ wxMenuBar* tmwxApp::MakeMenuBar(wxFrame* aFrame, wxDocument* aDoc)
       wxT("Revert"),
       wxT("Revert to the saved version of the file"));   
     fileMenu->AppendSeparator();
+    AppendPlainItem(fileMenu,tmwxID_EXPORT_COMPACT, 
+      wxT("Export Compact..."),
+      wxT("Export the tree without its crease pattern and other derived data"));   
+    fileMenu->AppendSeparator();
 
 #ifdef TMDEBUG
     AppendPlainItem(fileMenu,tmwxID_EXPORT_V4, 
@@ -1022,6 +1040,26 @@ wxMenuBar* tmwxApp::MakeMenuBar(wxFrame* aFrame, wxDocument* aDoc)
     wxT("many conditions."));
   menuBar->Append(debugMenu, wxT("&Debug"));
 #endif // TMDEBUG  
+
+  ////////////////////////////////////////
+  // Profile menu
+  ////////////////////////////////////////
+#ifdef TMPROFILE
+  // Profiling builds time the stages of cleanup and optimization (see
+  // tmProfiler.h) and can report the results.
+  wxMenu *profileMenu = new wxMenu;
+  profileMenu->Append(tmwxID_LOG_PROFILE, 
+    wxT("Log Profile Summary"),
+    wxT("Write the time spent in each stage to the log window"));
+  profileMenu->Append(tmwxID_SAVE_PROFILE_TRACE, 
+    wxT("Save Profile Trace..."),
+    wxT("Save the timing of each stage as a Chrome trace-event file"));
+  profileMenu->AppendSeparator();
+  profileMenu->Append(tmwxID_RESET_PROFILE, 
+    wxT("Reset Profile"),
+    wxT("Discard the timings recorded so far"));
+  menuBar->Append(profileMenu, wxT("&Profile"));
+#endif // TMPROFILE
   
   ////////////////////////////////////////
   // Help menu
@@ -1377,6 +1415,74 @@ void tmwxApp::OnAppDebugAction1(wxCommandEvent&)
 #endif // TMDEBUG
 
 
+#ifdef TMPROFILE
+/*****
+Enable Profile->Log Profile Summary
+*****/
+void tmwxApp::OnLogProfileUpdateUI(wxUpdateUIEvent& event)
+{
+  event.Enable(true);
+}
+
+
+/*****
+Write the profile summary to the log window and make sure it's visible.
+*****/
+void tmwxApp::OnLogProfile(wxCommandEvent&)
+{
+  tmProfiler::LogSummary();
+  if (gLogFrame && !gLogFrame->IsShown()) gLogFrame->Show(true);
+}
+
+
+/*****
+Enable Profile->Save Profile Trace
+*****/
+void tmwxApp::OnSaveProfileTraceUpdateUI(wxUpdateUIEvent& event)
+{
+  event.Enable(true);
+}
+
+
+/*****
+Save everything recorded so far as a Chrome trace-event file, which can be
+viewed in chrome://tracing or Perfetto.
+*****/
+void tmwxApp::OnSaveProfileTrace(wxCommandEvent&)
+{
+  wxFileDialog fileDialog(NULL, wxT("Save Profile Trace"), wxEmptyString,
+    wxT("treemaker_profile.json"), wxT("*.json"),
+    wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+  if (fileDialog.ShowModal() == wxID_CANCEL) return;
+  wxString fname = fileDialog.GetPath();
+  std::ofstream fout(fname.mb_str());
+  if (!fout.is_open()) {
+    tmwxAlertError(fname + wxT(" is not a valid file name"));
+    return;
+  }
+  tmProfiler::WriteTrace(fout);
+}
+
+
+/*****
+Enable Profile->Reset Profile
+*****/
+void tmwxApp::OnResetProfileUpdateUI(wxUpdateUIEvent& event)
+{
+  event.Enable(true);
+}
+
+
+/*****
+Discard everything recorded so far, e.g., to profile a single operation.
+*****/
+void tmwxApp::OnResetProfile(wxCommandEvent&)
+{
+  tmProfiler::Reset();
+}
+#endif // TMPROFILE
+
+
 #ifdef __MWERKS__
   #pragma mark -
 #endif
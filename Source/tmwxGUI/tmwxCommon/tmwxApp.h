@@ -70,6 +70,7 @@ enum {
   // wxID_SAVEAS,
   // wxID_REVERT,
   tmwxID_EXPORT_V4 = 1000,
+  tmwxID_EXPORT_COMPACT,
   // wxID_PRINT,
   // wxID_PRINT_SETUP,
   // wxID_PREVIEW,
@@ -181,6 +182,14 @@ enum {
   // wxID_ABOUT
   // wxID_HELP
 #endif // TMDEBUG
+
+  // Profile menu
+#ifdef TMPROFILE
+  ,
+  tmwxID_LOG_PROFILE,
+  tmwxID_SAVE_PROFILE_TRACE,
+  tmwxID_RESET_PROFILE
+#endif // TMPROFILE
 };
 
 
@@ -250,6 +259,14 @@ public:
 	void OnAppDebugAction1UpdateUI(wxUpdateUIEvent& event);
 	void OnAppDebugAction1(wxCommandEvent& event);
 
+	// Profile menu
+	void OnLogProfileUpdateUI(wxUpdateUIEvent& event);
+	void OnLogProfile(wxCommandEvent& event);
+	void OnSaveProfileTraceUpdateUI(wxUpdateUIEvent& event);
+	void OnSaveProfileTrace(wxCommandEvent& event);
+	void OnResetProfileUpdateUI(wxUpdateUIEvent& event);
+	void OnResetProfile(wxCommandEvent& event);
+
 	// Help menu
 	void OnAboutUpdateUI(wxUpdateUIEvent& event);
 	void OnAbout(wxCommandEvent& event);
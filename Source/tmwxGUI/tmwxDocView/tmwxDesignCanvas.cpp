@@ -503,6 +503,21 @@ template <>
 bool tmwxDesignCanvas::IsVisible<tmPath>(tmPath* aPath)
 {
   if (mDoc->mSelection.Contains(aPath)) return true;
+  if (IsDragPreviewPath(aPath)) {
+    // While dragging, active and infeasible paths that touch the moving nodes
+    // are shown as they would be if the drag ended here.
+    if (mViewSettings.mShowLeafPaths) return true;
+    if (mViewSettings.mShowSubPaths && aPath->IsSubPath()) return true;
+    if (mViewSettings.mShowActivePaths && mDragActivePaths.contains(aPath))
+      return true;
+    if (mViewSettings.mShowInfeasiblePaths && 
+      mDragInfeasiblePaths.contains(aPath)) return true;
+    if (mViewSettings.mShowBorderPaths && aPath->IsBorderPath()) return true;
+    if (mViewSettings.mShowPolygonPaths && aPath->IsPolygonPath()) return true;
+    if (mViewSettings.mShowPathConditions && aPath->IsConditionedPath()) 
+      return true;
+    return false;
+  }
   if (mViewSettings.mShowLeafPaths && aPath->IsLeafPath()) return true;
   if (mViewSettings.mShowBranchPaths && !aPath->IsLeafPath()) return true;
   if (mViewSettings.mShowSubPaths && aPath->IsSubPath()) return true;
@@ -517,6 +532,41 @@ bool tmwxDesignCanvas::IsVisible<tmPath>(tmPath* aPath)
 }
 
 
+/*****
+Return true if aPath is a leaf path whose status we're previewing because we
+are in the middle of dragging one of its end nodes.
+*****/
+bool tmwxDesignCanvas::IsDragPreviewPath(tmPath* aPath)
+{
+  if (!mDragging || mMovingNodes.empty() || !aPath->IsLeafPath()) 
+    return false;
+  return mMovingNodes.contains(aPath->GetNodes().front()) ||
+    mMovingNodes.contains(aPath->GetNodes().back());
+}
+
+
+/*****
+Recompute which leaf paths would become infeasible or active if the moving
+nodes were dropped at their current drag positions. Only paths touching the
+moving nodes are examined, so this is cheap enough to call on every mouse
+move; the tree itself isn't touched until the drag ends.
+*****/
+void tmwxDesignCanvas::UpdateDragPreview()
+{
+  static tmArray<tmPoint> newLocs;
+  static tmArray<tmPath*> infeasiblePaths;
+  static tmArray<tmPath*> activePaths;
+  size_t numMovingNodes = mMovingNodes.size();
+  newLocs.resize(numMovingNodes);
+  for (size_t i = 0; i < numMovingNodes; ++i)
+    newLocs[i] = CalcLoc(mMovingNodes[i]);
+  GetTree()->GetDragPathStatus(mMovingNodes, newLocs, infeasiblePaths, 
+    activePaths);
+  mDragInfeasiblePaths = infeasiblePaths;
+  mDragActivePaths = activePaths;
+}
+
+
 /*****
 Return true if aPoly is visible.
 *****/
@@ -1308,11 +1358,18 @@ void tmwxDesignCanvas::DrawPart<tmwxDesignCanvas::Lines, tmEdge>(
 
 /*****
 Return the appropriate color for this path, which depends on its flag values.
+During a drag, leaf paths attached to the moving nodes are colored by their
+previewed status instead.
 *****/
 template <>
 wxColor tmwxDesignCanvas::GetBasePartColor<tmPath>(tmPath* aPath)
 {
   if (!aPath->IsLeafPath()) return PATH_INTERNAL_COLOR;
+  else if (IsDragPreviewPath(aPath)) {
+    if (mDragInfeasiblePaths.contains(aPath)) return PATH_INFEASIBLE_COLOR;
+    else if (mDragActivePaths.contains(aPath)) return PATH_ACTIVE_COLOR;
+    else return PATH_VALID_COLOR;
+  }
   else if (!aPath->IsFeasiblePath()) return PATH_INFEASIBLE_COLOR;
   else if (aPath->IsActivePath()) return PATH_ACTIVE_COLOR;
   else return PATH_VALID_COLOR;
@@ -2823,6 +2880,8 @@ void tmwxDesignCanvas::OnMouse(wxMouseEvent& event)
     // Now, we prepare for a drag. We go through the selected nodes and Edges
     // and see if any of the selected parts can move.
     mMovingNodes.clear();
+    mDragInfeasiblePaths.clear();
+    mDragActivePaths.clear();
     tmDpptrArray<tmNode>& selectedNodes = mDoc->mSelection.GetNodes();
     for (size_t i = 0; i < selectedNodes.size(); ++i) {
       tmNode* aNode = selectedNodes[i];
@@ -2912,6 +2971,9 @@ void tmwxDesignCanvas::OnMouse(wxMouseEvent& event)
       mDragOffset.x = event.GetLogicalPosition(dc).x - mDragStart.x;
       mDragOffset.y = event.GetLogicalPosition(dc).y - mDragStart.y;
     }
+    // Work out how the paths attached to the moving nodes would fare at the
+    // new locations, so the redraw can color them accordingly.
+    if (mDragging && !mMovingNodes.empty()) UpdateDragPreview();
     // Now do a total redraw to show the result of the drag.
     if(mDragging || dx != 0 || dy != 0 ) {
 #ifndef __WXMAC__
@@ -2973,6 +3035,8 @@ void tmwxDesignCanvas::OnMouse(wxMouseEvent& event)
     if (mDragging) ReleaseMouse();
     mDragging = false;
     mDragOffset.x = mDragOffset.y = 0;
+    mDragInfeasiblePaths.clear();
+    mDragActivePaths.clear();
   }
 }
 
@@ -17,6 +17,7 @@ Copyright:    ©2003 Robert J. Lang. All Rights Reserved.
 // TreeMaker classes
 #include "tmPoint.h"
 #include "tmDpptrArray.h"
+#include "tmIndexedArray.h"
 #include "tmPart.h"
 
 #include "tmwxViewSettings.h"
@@ -92,7 +93,9 @@ private:
   wxPoint mDragOffset;            // offset of a drag
   bool mDragging;                 // true if we're dragging
   bool mPrinting;                 // true if we're printing
-  tmArray<const tmNode*> mMovingNodes;  // nodes that get dragged
+  tmIndexedArray<const tmNode*> mMovingNodes;  // nodes that get dragged
+  tmIndexedArray<tmPath*> mDragInfeasiblePaths; // would-be infeasible paths
+  tmIndexedArray<tmPath*> mDragActivePaths;     // would-be active paths
 
   // Paper size
   void CalcBorderScrollSize();
@@ -110,6 +113,8 @@ private:
   tmPoint DCToTree(const wxPoint& p) const; 
   template <class P>
     bool IsVisible(P* p);
+  bool IsDragPreviewPath(tmPath* aPath);
+  void UpdateDragPreview();
     
   // Calculation of location
   template <class P>
@@ -334,6 +334,13 @@ tmwxDoc::tmwxInputStream& tmwxDoc::LoadObject(tmwxInputStream& stream)
   mTree = theTree;
   mCleanState.str("");
   mTree->PutSelf(mCleanState);
+  // Writing the clean state checked the polys and crease pattern we read
+  // against the file's checksum. If they didn't match (or the file had none),
+  // they've now been rebuilt, so the clean state has to be written again.
+  if (!mTree->VerifyStoredState()) {
+    mCleanState.str("");
+    mTree->PutSelf(mCleanState);
+  }
   return stream;
 }
 
@@ -400,6 +407,8 @@ BEGIN_EVENT_TABLE(tmwxDoc, wxDocument)
   // File menu
   EVT_UPDATE_UI(tmwxID_EXPORT_V4, tmwxDoc::OnExportv4UpdateUI)
   EVT_MENU(tmwxID_EXPORT_V4, tmwxDoc::OnExportv4)
+  EVT_UPDATE_UI(tmwxID_EXPORT_COMPACT, tmwxDoc::OnExportCompactUpdateUI)
+  EVT_MENU(tmwxID_EXPORT_COMPACT, tmwxDoc::OnExportCompact)
   
   // Edit menu
   EVT_UPDATE_UI(wxID_CUT, tmwxDoc::OnCutUpdateUI)
@@ -77,6 +77,8 @@ public:
   // File menu
   void OnExportv4UpdateUI(wxUpdateUIEvent& event);
   void OnExportv4(wxCommandEvent& event);
+  void OnExportCompactUpdateUI(wxUpdateUIEvent& event);
+  void OnExportCompact(wxCommandEvent& event);
   
   // Edit menu
   void OnCutUpdateUI(wxUpdateUIEvent& event);
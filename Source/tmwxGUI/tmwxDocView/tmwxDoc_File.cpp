@@ -66,3 +66,39 @@ void tmwxDoc::OnExportv4(wxCommandEvent&)
 #warning "TODO: Check what's going on here"
 #endif
 }
+
+
+/*****
+Enable File->Export Compact
+*****/
+void tmwxDoc::OnExportCompactUpdateUI(wxUpdateUIEvent& event)
+{
+  event.Enable(true);
+}
+
+
+/*****
+Perform File->Export Compact
+Saves only the tree, its conditions and the paper settings; the paths, polys
+and crease pattern are rebuilt when the file is opened. Much smaller than a
+regular file for big trees, so it's meant for archiving and sending designs.
+*****/
+void tmwxDoc::OnExportCompact(wxCommandEvent&)
+{
+  wxString pname;
+  GetPrintableName(pname);
+  wxString pname1 = pname.BeforeLast(wxT('.')); // strip extension
+  if (pname1.empty()) pname1 = pname;
+  pname1 += wxT("_compact.tmd5");
+  wxFileDialog fileDialog(NULL, wxT("Export Compact"), wxEmptyString, pname1, 
+    wxT("*.tmd5"), wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+  if (fileDialog.ShowModal() == wxID_CANCEL) return;
+  wxString fname = fileDialog.GetPath();
+  ofstream fout(fname.mb_str(), ios_base::binary);
+  if (!fout.is_open()) {
+    tmwxAlertError(fname + wxT(" is not a valid file name"));
+    return;
+  }
+  mTree->PutCompactSelf(fout);
+  fout.close();
+}